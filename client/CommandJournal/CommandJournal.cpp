@@ -0,0 +1,463 @@
+#include "CommandJournal.h"
+#include "Metrics.h"
+#include "AppData.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CommandJournal::CommandJournal(const std::string& path)
+    : path(path), nextOrder(0), newestDateMs(0), fileHandle(nullptr), fileDescriptor(-1),
+    recordsSinceCompact(0), writtenSeq(0), syncedSeq(0), syncing(false), lastSyncOk(true)
+{
+    replay();
+    if (!path.empty() && !openFile()) {
+        std::cerr << "Unable to open command journal: " << path << std::endl;
+    }
+}
+
+CommandJournal::~CommandJournal() {
+    flush();
+    closeFile();
+}
+
+std::string CommandJournal::defaultPath() {
+    return AppData::path("command_journal.jsonl");
+}
+
+bool CommandJournal::recordReceived(const std::string& account, const EmailHandler::EmailInfo& email) {
+    if (email.id.empty()) return true;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = messages.find(email.id);
+    if (it != messages.end()) {
+        return !it->second.finished;
+    }
+
+    Json::Value record;
+    record["op"] = "received";
+    record["id"] = email.id;
+    record["account"] = account;
+    record["email"] = emailToJson(email);
+    append(lock, record, false);
+    return true;
+}
+
+bool CommandJournal::isKnown(const std::string& messageId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return messages.count(messageId) > 0;
+}
+
+CommandJournal::StepState CommandJournal::stepState(const std::string& messageId, const std::string& step,
+    std::string& result, std::string& attachment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = messages.find(messageId);
+    if (it == messages.end()) {
+        return StepState::NotStarted;
+    }
+
+    auto done = it->second.done.find(step);
+    if (done != it->second.done.end()) {
+        result = done->second.result;
+        attachment = done->second.attachment;
+        return done->second.succeeded ? StepState::Succeeded : StepState::Failed;
+    }
+    return it->second.started.count(step) ? StepState::InDoubt : StepState::NotStarted;
+}
+
+bool CommandJournal::stepStarted(const std::string& messageId, const std::string& step) {
+    if (messageId.empty()) return true;
+    std::unique_lock<std::mutex> lock(mutex);
+    Json::Value record;
+    record["op"] = "start";
+    record["id"] = messageId;
+    record["step"] = step;
+    return append(lock, record, true);
+}
+
+void CommandJournal::stepDone(const std::string& messageId, const std::string& step, bool succeeded,
+    const std::string& result, const std::string& attachment) {
+    if (messageId.empty()) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    Json::Value record;
+    record["op"] = "done";
+    record["id"] = messageId;
+    record["step"] = step;
+    record["ok"] = succeeded;
+    record["result"] = result;
+    if (!attachment.empty()) {
+        record["attachment"] = attachment;
+    }
+    append(lock, record, false);
+}
+
+void CommandJournal::recordFinished(const std::string& messageId) {
+    if (messageId.empty()) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = messages.find(messageId);
+    if (it == messages.end() || it->second.finished) {
+        return;
+    }
+
+    Json::Value record;
+    record["op"] = "finished";
+    record["id"] = messageId;
+    record["account"] = it->second.account;
+    record["internal"] = static_cast<Json::Int64>(it->second.email.internalDateMs);
+    append(lock, record, false);
+
+    if (recordsSinceCompact >= COMPACT_AFTER_RECORDS) {
+        compactLocked(lock);
+    }
+}
+
+std::vector<CommandJournal::Entry> CommandJournal::unfinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<unsigned long long, Entry>> ordered;
+    for (const auto& item : messages) {
+        if (!item.second.finished) {
+            ordered.push_back({ item.second.order, Entry{ item.second.account, item.second.email } });
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(),
+        [](const std::pair<unsigned long long, Entry>& a, const std::pair<unsigned long long, Entry>& b) {
+            return a.first < b.first;
+        });
+
+    std::vector<Entry> entries;
+    for (const auto& item : ordered) {
+        entries.push_back(item.second);
+    }
+    return entries;
+}
+
+long long CommandJournal::newestInternalDateMs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return newestDateMs;
+}
+
+void CommandJournal::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    syncLocked(lock, writtenSeq);
+}
+
+void CommandJournal::replay() {
+    if (path.empty()) return;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return;
+
+    std::string line;
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    while (std::getline(file, line)) {
+        Json::Value record;
+        // Dòng hỏng (thường là dòng cuối bị cắt khi client bị tắt đột ngột): bỏ qua
+        if (line.empty() || !reader->parse(line.data(), line.data() + line.size(), &record, nullptr) ||
+            !record.isObject()) {
+            continue;
+        }
+        apply(record);
+        recordsSinceCompact++;
+    }
+}
+
+void CommandJournal::apply(const Json::Value& record) {
+    std::string op = record["op"].asString();
+    std::string id = record["id"].asString();
+    if (id.empty()) return;
+
+    if (op == "received") {
+        Message& message = messages[id];
+        if (message.finished || message.order != 0) return;
+        message.order = ++nextOrder;
+        message.account = record["account"].asString();
+        message.email = emailFromJson(record["email"]);
+        newestDateMs = std::max(newestDateMs, message.email.internalDateMs);
+        return;
+    }
+
+    if (op == "finished") {
+        Message& message = messages[id];
+        if (message.finished) return;
+        if (message.order == 0) message.order = ++nextOrder;
+        message.finished = true;
+        message.account = record["account"].asString();
+        // Email đã xong chỉ còn dùng để chống trùng: bỏ nội dung và kết quả
+        message.email = EmailHandler::EmailInfo();
+        message.email.id = id;
+        message.email.internalDateMs = record["internal"].asInt64();
+        message.started.clear();
+        message.done.clear();
+        newestDateMs = std::max(newestDateMs, message.email.internalDateMs);
+        finishedOrder.push_back(id);
+        forgetOldFinished();
+        return;
+    }
+
+    auto it = messages.find(id);
+    if (it == messages.end() || it->second.finished) return;
+    std::string step = record["step"].asString();
+    if (op == "start") {
+        it->second.started.insert(step);
+    }
+    else if (op == "done") {
+        it->second.done[step] = { record["ok"].asBool(), record["result"].asString(), record["attachment"].asString() };
+    }
+}
+
+void CommandJournal::forgetOldFinished() {
+    while (finishedOrder.size() > MAX_FINISHED_IDS) {
+        messages.erase(finishedOrder.front());
+        finishedOrder.pop_front();
+    }
+}
+
+bool CommandJournal::append(std::unique_lock<std::mutex>& lock, const Json::Value& record, bool durable) {
+    static Metrics::Counter& records = Metrics::registry().counter(
+        "command_journal_records_total", "Records appended to the command journal");
+
+    apply(record);
+    if (path.empty()) {
+        return true;    // Không có file: chỉ giữ trong bộ nhớ
+    }
+    // File chưa mở được (lúc khởi động hoặc sau khi nén): thử mở lại trước khi báo lỗi
+    if (fileHandle == nullptr && fileDescriptor < 0 && !openFile()) {
+        closeFile();
+        std::cerr << "Command journal is not open: " << path << std::endl;
+        return false;
+    }
+    if (!writeFile(Json::FastWriter().write(record))) {
+        std::cerr << "Failed to append to command journal" << std::endl;
+        return false;
+    }
+    records.add();
+    writtenSeq++;
+    recordsSinceCompact++;
+
+    if (durable) {
+        return syncLocked(lock, writtenSeq);
+    }
+    return true;
+}
+
+bool CommandJournal::syncLocked(std::unique_lock<std::mutex>& lock, unsigned long long upTo) {
+    static Metrics::Histogram& syncTime = Metrics::registry().histogram(
+        "command_journal_fsync_microseconds", "Time to fsync the command journal");
+    static Metrics::Counter& syncs = Metrics::registry().counter(
+        "command_journal_fsyncs_total", "fsync calls on the command journal");
+
+    while (syncedSeq < upTo) {
+        if (syncing) {
+            // Thread khác đang fsync: lần đó có thể đã bao gồm dòng của mình
+            synced.wait(lock);
+            continue;
+        }
+
+        // Một fsync cho mọi dòng đã ghi tới lúc này, kể cả dòng của các thread đang chờ
+        syncing = true;
+        unsigned long long target = writtenSeq;
+        lock.unlock();
+        bool ok;
+        {
+            Metrics::ScopedTimer timer(syncTime);
+            ok = syncFile();
+        }
+        syncs.add();
+        lock.lock();
+        syncing = false;
+        lastSyncOk = ok;
+        if (!ok) {
+            std::cerr << "Failed to fsync command journal" << std::endl;
+        }
+        // Lỗi fsync không thử lại mãi: dòng đã nằm trong cache của hệ điều hành, nhưng người đang chờ
+        // dòng "start" được báo lỗi
+        syncedSeq = std::max(syncedSeq, target);
+        synced.notify_all();
+    }
+    return lastSyncOk;
+}
+
+// Viết lại file chỉ với trạng thái hiện tại: email chưa xong giữ đủ các bước,
+// email đã xong chỉ còn một dòng "finished" để chống trùng
+void CommandJournal::compactLocked(std::unique_lock<std::mutex>& lock) {
+    if (path.empty()) return;
+    synced.wait(lock, [this]() { return !syncing; });
+
+    std::vector<std::pair<unsigned long long, const std::string*>> ordered;
+    for (const auto& item : messages) {
+        ordered.push_back({ item.second.order, &item.first });
+    }
+    std::sort(ordered.begin(), ordered.end());
+
+    Json::FastWriter writer;
+    std::string content;
+    size_t lines = 0;
+    for (const auto& item : ordered) {
+        const std::string& id = *item.second;
+        const Message& message = messages[id];
+        Json::Value record;
+        record["id"] = id;
+        record["account"] = message.account;
+        if (message.finished) {
+            record["op"] = "finished";
+            record["internal"] = static_cast<Json::Int64>(message.email.internalDateMs);
+            content += writer.write(record);
+            lines++;
+            continue;
+        }
+
+        record["op"] = "received";
+        record["email"] = emailToJson(message.email);
+        content += writer.write(record);
+        lines++;
+        for (const std::string& step : message.started) {
+            Json::Value started;
+            started["op"] = "start";
+            started["id"] = id;
+            started["step"] = step;
+            content += writer.write(started);
+            lines++;
+        }
+        for (const auto& done : message.done) {
+            Json::Value finishedStep;
+            finishedStep["op"] = "done";
+            finishedStep["id"] = id;
+            finishedStep["step"] = done.first;
+            finishedStep["ok"] = done.second.succeeded;
+            finishedStep["result"] = done.second.result;
+            if (!done.second.attachment.empty()) {
+                finishedStep["attachment"] = done.second.attachment;
+            }
+            content += writer.write(finishedStep);
+            lines++;
+        }
+    }
+
+    // Ghi file tạm, fsync, rồi thay thế: lúc nào trên đĩa cũng có một nhật ký đầy đủ
+    std::string tempPath = path + ".tmp";
+    std::string livePath = path;
+    path = tempPath;
+    closeFile();
+    std::remove(tempPath.c_str());
+    bool ok = openFile() && writeFile(content) && syncFile();
+    closeFile();
+    path = livePath;
+
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tempPath.c_str(), livePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && std::rename(tempPath.c_str(), livePath.c_str()) == 0;
+#endif
+    if (!ok) {
+        std::cerr << "Command journal compaction failed, keeping the old file" << std::endl;
+    }
+    else {
+        recordsSinceCompact = lines;
+    }
+    if (!openFile()) {
+        // append() thử mở lại ở lần ghi sau; tới lúc đó stepStarted() trả false
+        closeFile();
+        std::cerr << "Unable to reopen command journal after compaction: " << livePath << std::endl;
+    }
+    syncedSeq = writtenSeq;
+}
+
+Json::Value CommandJournal::emailToJson(const EmailHandler::EmailInfo& email) {
+    Json::Value value;
+    value["id"] = email.id;
+    value["subject"] = email.subject;
+    value["from"] = email.from;
+    value["date"] = email.date;
+    value["content"] = email.content;
+    value["threadId"] = email.threadId;
+    value["internalDate"] = static_cast<Json::Int64>(email.internalDateMs);
+    return value;
+}
+
+EmailHandler::EmailInfo CommandJournal::emailFromJson(const Json::Value& value) {
+    EmailHandler::EmailInfo email;
+    email.id = value["id"].asString();
+    email.subject = value["subject"].asString();
+    email.from = value["from"].asString();
+    email.date = value["date"].asString();
+    email.content = value["content"].asString();
+    email.threadId = value["threadId"].asString();
+    email.internalDateMs = value["internalDate"].asInt64();
+    return email;
+}
+
+bool CommandJournal::openFile() {
+    bool endsWithNewline = true;
+    {
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        if (existing.is_open() && existing.tellg() > 0) {
+            existing.seekg(-1, std::ios::end);
+            endsWithNewline = existing.get() == '\n';
+        }
+    }
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle = handle;
+#else
+    fileDescriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+#endif
+    // Dòng cuối bị cắt dở: kết thúc nó để dòng mới không dính vào
+    return endsWithNewline || writeFile("\n");
+}
+
+void CommandJournal::closeFile() {
+#ifdef _WIN32
+    if (fileHandle) {
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        fileHandle = nullptr;
+    }
+#else
+    if (fileDescriptor >= 0) {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+}
+
+bool CommandJournal::writeFile(const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(static_cast<HANDLE>(fileHandle), data.data() + offset,
+            static_cast<DWORD>(data.size() - offset), &written, nullptr)) {
+            return false;
+        }
+#else
+        ssize_t written = write(fileDescriptor, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            return false;
+        }
+#endif
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool CommandJournal::syncFile() {
+#ifdef _WIN32
+    return FlushFileBuffers(static_cast<HANDLE>(fileHandle)) != 0;
+#else
+    return fsync(fileDescriptor) == 0;
+#endif
+}
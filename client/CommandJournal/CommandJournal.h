@@ -0,0 +1,119 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "handleMail.h"
+
+// Nhật ký ghi trước (write-ahead) cho email lệnh, để khởi động lại không chạy lệnh hai lần
+// và không bỏ sót lệnh đang làm dở.
+// File JSONL chỉ ghi nối thêm, mỗi dòng một sự kiện:
+//   {"op":"received","id","account","email":{...}}     email lệnh mới
+//   {"op":"start","id","step"}                           sắp gửi lệnh (step = "<host>#<chỉ số lệnh>")
+//   {"op":"done","id","step","ok","result","attachment"} lệnh đã có kết quả
+//   {"op":"finished","id","account","internal"}         đã trả lời (hoặc email không hợp lệ)
+// "start" được fsync trước khi lệnh được gửi; các dòng khác chỉ cần nằm trong cache của hệ điều hành
+// và được fsync cùng lần kế tiếp. Nhiều thread cùng chờ fsync thì chỉ một lần fsync được gọi (group commit).
+// Khôi phục: đọc lại toàn bộ file; đọc lại nhiều lần cho cùng kết quả, dòng cuối bị cắt dở thì bỏ qua.
+class CommandJournal {
+public:
+    enum class StepState {
+        NotStarted,
+        InDoubt,    // Đã gửi nhưng client dừng trước khi có kết quả: không chạy lại
+        Succeeded,
+        Failed
+    };
+
+    struct Entry {
+        std::string account;
+        EmailHandler::EmailInfo email;
+    };
+
+    static const size_t COMPACT_AFTER_RECORDS = 4096;
+    static const size_t MAX_FINISHED_IDS = 1000;   // Số email đã xong được giữ lại để chống trùng
+
+    // Mở (tạo nếu chưa có) và đọc lại nhật ký. Đường dẫn rỗng: chỉ giữ trong bộ nhớ
+    explicit CommandJournal(const std::string& path = defaultPath());
+    ~CommandJournal();
+    CommandJournal(const CommandJournal&) = delete;
+    CommandJournal& operator=(const CommandJournal&) = delete;
+
+    // %APPDATA%\EmailPCControl\command_journal.jsonl
+    static std::string defaultPath();
+
+    // Ghi nhận email lệnh. false nếu email này đã xử lý xong trước đó (bỏ qua).
+    // Email đang làm dở thì trả true mà không ghi thêm: người gọi chạy tiếp các bước còn lại
+    bool recordReceived(const std::string& account, const EmailHandler::EmailInfo& email);
+    bool isKnown(const std::string& messageId);
+
+    // Trạng thái một bước; result/attachment chỉ có khi bước đã xong (Succeeded/Failed)
+    StepState stepState(const std::string& messageId, const std::string& step,
+        std::string& result, std::string& attachment);
+    // Chặn tới khi dòng "start" đã được fsync. false khi không ghi/fsync được (file nhật ký không mở
+    // được...): người gọi không được gửi lệnh
+    bool stepStarted(const std::string& messageId, const std::string& step);
+    void stepDone(const std::string& messageId, const std::string& step, bool succeeded,
+        const std::string& result, const std::string& attachment);
+    void recordFinished(const std::string& messageId);
+
+    // Email đã nhận nhưng chưa trả lời, theo thứ tự nhận
+    std::vector<Entry> unfinished();
+    // internalDate lớn nhất trong các email đã ghi nhận (0 nếu nhật ký rỗng)
+    long long newestInternalDateMs();
+
+    // fsync mọi dòng đã ghi
+    void flush();
+
+private:
+    struct StepResult {
+        bool succeeded;
+        std::string result;
+        std::string attachment;
+    };
+
+    struct Message {
+        std::string account;
+        EmailHandler::EmailInfo email;
+        bool finished = false;
+        std::set<std::string> started;
+        std::map<std::string, StepResult> done;
+        unsigned long long order = 0;
+    };
+
+    void replay();
+    void apply(const Json::Value& record);
+    // Ghi một dòng; durable = chờ tới khi dòng đã được fsync. false khi dòng không ghi được (hoặc
+    // durable mà fsync lỗi); nhật ký chỉ giữ trong bộ nhớ (path rỗng) thì luôn true
+    bool append(std::unique_lock<std::mutex>& lock, const Json::Value& record, bool durable);
+    bool syncLocked(std::unique_lock<std::mutex>& lock, unsigned long long upTo);
+    void compactLocked(std::unique_lock<std::mutex>& lock);
+    void forgetOldFinished();
+    static Json::Value emailToJson(const EmailHandler::EmailInfo& email);
+    static EmailHandler::EmailInfo emailFromJson(const Json::Value& value);
+
+    bool openFile();
+    void closeFile();
+    bool writeFile(const std::string& data);
+    bool syncFile();
+
+    std::string path;
+    std::mutex mutex;
+    std::condition_variable synced;
+
+    std::map<std::string, Message> messages;
+    std::deque<std::string> finishedOrder;
+    unsigned long long nextOrder;
+    long long newestDateMs;
+
+    // File đang mở để ghi nối thêm (HANDLE trên Windows, file descriptor nơi khác)
+    void* fileHandle;
+    int fileDescriptor;
+    size_t recordsSinceCompact;
+    unsigned long long writtenSeq;      // Số dòng đã ghi
+    unsigned long long syncedSeq;       // Số dòng đã fsync
+    bool syncing;                       // Có thread đang fsync (các thread khác chờ kết quả)
+    bool lastSyncOk;                    // Kết quả lần fsync gần nhất, cho các thread đã chờ nó
+};
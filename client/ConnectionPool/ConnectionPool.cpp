@@ -0,0 +1,170 @@
+#include "ConnectionPool.h"
+#include <iostream>
+#include <vector>
+
+ConnectionPool::ConnectionPool(size_t maxIdlePerServer, int idleTimeoutSec, int heartbeatIntervalSec)
+    : maxIdlePerServer(maxIdlePerServer),
+    idleTimeout(idleTimeoutSec),
+    heartbeatInterval(heartbeatIntervalSec),
+    stats{ 0, 0, 0 },
+    stopping(false)
+{
+    heartbeatThread = std::thread(&ConnectionPool::heartbeatLoop, this);
+}
+
+ConnectionPool::~ConnectionPool() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    stopCv.notify_all();
+    if (heartbeatThread.joinable()) {
+        heartbeatThread.join();
+    }
+    clear();
+}
+
+void ConnectionPool::heartbeatLoop() {
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (!stopping) {
+        stopCv.wait_for(lock, std::chrono::milliseconds(HEARTBEAT_CHECK_MS), [this]() { return stopping; });
+        if (stopping) break;
+        lock.unlock();
+        heartbeat();
+        lock.lock();
+    }
+}
+
+std::string ConnectionPool::makeKey(const std::string& serverIP, int port) const {
+    return serverIP + ":" + std::to_string(port);
+}
+
+SocketClient* ConnectionPool::acquire(const std::string& serverIP, int port) {
+    const std::string key = makeKey(serverIP, port);
+
+    while (true) {
+        SocketClient* candidate = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            auto it = idleSessions.find(key);
+            if (it == idleSessions.end() || it->second.empty()) {
+                break;
+            }
+            // Lấy session dùng gần nhất, ít khả năng đã bị đóng nhất
+            candidate = it->second.back().client;
+            it->second.pop_back();
+        }
+
+        if (!candidate->isStale()) {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            stats.reuses++;
+            return candidate;
+        }
+
+        // Server đã đóng kết nối hoặc còn dữ liệu lạ: bỏ đi và thử session khác hoặc kết nối lại
+        delete candidate;
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stats.staleDrops++;
+    }
+
+    SocketClient* session = new SocketClient();
+    if (!session->connect(serverIP, port)) {
+        delete session;
+        return nullptr;
+    }
+    if (!session->setKeepAlive(KEEPALIVE_IDLE_MS, KEEPALIVE_INTERVAL_MS)) {
+        std::cerr << "Failed to enable TCP keepalive for " << key << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    stats.connects++;
+    return session;
+}
+
+void ConnectionPool::release(SocketClient* session, bool reusable) {
+    if (!session) return;
+
+    if (!reusable || !session->isConnected()) {
+        delete session;
+        return;
+    }
+
+    const std::string key = makeKey(session->getServerIP(), session->getServerPort());
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::deque<IdleSession>& sessions = idleSessions[key];
+    if (sessions.size() >= maxIdlePerServer) {
+        delete session;
+        return;
+    }
+    sessions.push_back({ session, now, now });
+}
+
+void ConnectionPool::heartbeat() {
+    auto now = std::chrono::steady_clock::now();
+
+    // Lấy ra các session cần kiểm tra để không giữ lock trong lúc chờ mạng
+    std::vector<std::pair<std::string, IdleSession>> toCheck;
+    std::vector<SocketClient*> expired;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        for (auto& entry : idleSessions) {
+            std::deque<IdleSession>& sessions = entry.second;
+            for (auto it = sessions.begin(); it != sessions.end();) {
+                if (now - it->lastUsed >= idleTimeout) {
+                    expired.push_back(it->client);
+                    it = sessions.erase(it);
+                }
+                else if (now - it->lastHeartbeat >= heartbeatInterval) {
+                    toCheck.push_back({ entry.first, *it });
+                    it = sessions.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    for (SocketClient* client : expired) {
+        delete client;
+    }
+
+    for (auto& item : toCheck) {
+        IdleSession& session = item.second;
+        if (!session.client->sendHeartbeat(HEARTBEAT_TIMEOUT_MS)) {
+            delete session.client;
+            std::lock_guard<std::mutex> lock(poolMutex);
+            stats.staleDrops++;
+            continue;
+        }
+
+        session.lastHeartbeat = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            std::deque<IdleSession>& sessions = idleSessions[item.first];
+            if (sessions.size() < maxIdlePerServer) {
+                sessions.push_back(session);
+                continue;
+            }
+        }
+        // release() đã trả đủ session về pool trong lúc chờ heartbeat
+        delete session.client;
+    }
+}
+
+void ConnectionPool::clear() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (auto& entry : idleSessions) {
+        for (IdleSession& session : entry.second) {
+            delete session.client;
+        }
+    }
+    idleSessions.clear();
+}
+
+ConnectionPool::Stats ConnectionPool::getStats() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return stats;
+}
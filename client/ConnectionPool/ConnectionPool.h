@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "socket.h"
+
+// Giữ các kết nối tới server để tái sử dụng giữa các email,
+// tránh phải connect/disconnect cho mỗi email nhận được.
+// Heartbeat cho session rảnh chạy trên thread riêng của pool, không chặn thread gọi (UI).
+class ConnectionPool {
+public:
+    struct Stats {
+        long long connects;
+        long long reuses;
+        long long staleDrops;
+    };
+
+    explicit ConnectionPool(size_t maxIdlePerServer = 2,
+        int idleTimeoutSec = 300,
+        int heartbeatIntervalSec = 30);
+    ~ConnectionPool();
+
+    // Trả về một session đã kết nối (có sẵn hoặc mới), nullptr nếu không kết nối được.
+    // Session rảnh mà có byte chưa đọc (server đóng kết nối, hoặc phản hồi thừa làm lệch khung) bị đóng
+    SocketClient* acquire(const std::string& serverIP, int port);
+
+    // Trả session về pool; reusable = false khi session đã lỗi giữa chừng
+    void release(SocketClient* session, bool reusable = true);
+
+    void clear();
+
+    Stats getStats();
+
+private:
+    struct IdleSession {
+        SocketClient* client;
+        std::chrono::steady_clock::time_point lastUsed;
+        std::chrono::steady_clock::time_point lastHeartbeat;
+    };
+
+    static const unsigned long KEEPALIVE_IDLE_MS = 30000;
+    static const unsigned long KEEPALIVE_INTERVAL_MS = 5000;
+    static const int HEARTBEAT_TIMEOUT_MS = 2000;
+    static constexpr int HEARTBEAT_CHECK_MS = 1000;
+
+    std::string makeKey(const std::string& serverIP, int port) const;
+    void heartbeatLoop();
+    // Gửi heartbeat cho các session rảnh và loại bỏ session chết hoặc quá hạn
+    void heartbeat();
+
+    size_t maxIdlePerServer;
+    std::chrono::seconds idleTimeout;
+    std::chrono::seconds heartbeatInterval;
+
+    std::map<std::string, std::deque<IdleSession>> idleSessions;
+    std::mutex poolMutex;
+    Stats stats;
+
+    std::thread heartbeatThread;
+    std::condition_variable stopCv;
+    bool stopping;
+};
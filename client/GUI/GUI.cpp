@@ -3,7 +3,14 @@
 #include <fstream>
 #include <json/json.h>
 #include "utils.h"
+#include "StreamRecorder.h"
+#include "SecureSocket.h"
 #include <windows.h>
+#include <atomic>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <iomanip>
 
 BEGIN_EVENT_TABLE(MainFrame, wxFrame)
 EVT_BUTTON(ID_CONNECT, MainFrame::OnConnect)
@@ -34,8 +41,14 @@ MainFrame::MainFrame(const wxString& title)
     socketClient = new SocketClient();
     oauth = nullptr;
     emailHandler = nullptr;
+    tokenService = nullptr;
     isMonitoring = false;
     checkEmailTimer = new wxTimer(this, ID_CHECK_EMAIL_TIMER);
+    pushReceiver = nullptr;
+    lastHistoryId = 0;
+    watchExpirationMs = 0;
+    mailboxSupervisor = nullptr;
+    fanOutsRunning = 0;
     gmailAutomation = nullptr;
     callbackServer = nullptr;
     currentProcessId = 0;
@@ -387,10 +400,38 @@ MainFrame::MainFrame(const wxString& title)
 
     // Load client secrets
     LoadClientSecrets();
+    StartMetrics();
+
+    // Khóa công khai của client, để thêm vào authorized_clients.txt của server
+    std::string transportKey = SecureSocket::clientPublicKey();
+    UpdateStatus(transportKey.empty()
+        ? wxString("Transport key unavailable: servers with a pinned key cannot be reached")
+        : wxString("Transport key: " + transportKey));
 
     Centre();
 }
 
+// Số liệu: http://127.0.0.1:9100/metrics và metrics\client.jsonl trong thư mục dữ liệu người dùng
+void MainFrame::StartMetrics() {
+    double overheadNs = Metrics::measureCounterOverheadNs();
+    Metrics::registry().gauge("metrics_counter_overhead_nanoseconds",
+        "Measured cost of one counter increment at startup").set(static_cast<int64_t>(overheadNs + 0.5));
+
+    wxString metricsDir = wxStandardPaths::Get().GetUserDataDir() + wxFILE_SEP_PATH + "metrics";
+    if (!wxDirExists(metricsDir)) {
+        wxFileName::Mkdir(metricsDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    }
+    std::string jsonlPath = (metricsDir + wxFILE_SEP_PATH + "client.jsonl").ToStdString();
+
+    if (metricsExporter.start(METRICS_PORT, jsonlPath, METRICS_DUMP_INTERVAL_SEC)) {
+        UpdateStatus(wxString::Format("Metrics on http://127.0.0.1:%d/metrics (counter overhead %.1f ns/event)",
+            METRICS_PORT, overheadNs));
+    }
+    else {
+        UpdateStatus(wxString::Format("Failed to start metrics endpoint on port %d", METRICS_PORT));
+    }
+}
+
 void MainFrame::OnButtonHover(wxMouseEvent& event)
 {
     wxButton* button = static_cast<wxButton*>(event.GetEventObject());
@@ -406,11 +447,20 @@ void MainFrame::OnButtonLeave(wxMouseEvent& event)
 }
 
 MainFrame::~MainFrame() {
+    // Thread nền của ProcessEmail dùng pool, nhật ký... của frame: chờ chúng xong trước khi hủy
+    {
+        std::unique_lock<std::mutex> lock(fanOutMutex);
+        fanOutDone.wait(lock, [this]() { return fanOutsRunning == 0; });
+    }
     Unbind(wxEVT_OAUTH_CODE, &MainFrame::OnOAuthCode, this);
+    StopPushNotifications();
+    StopMailboxSupervisor();
     delete socketClient;
+    // EmailHandler dùng tokenService, tokenService dùng oauth: giải phóng theo thứ tự đó
+    delete emailHandler;
+    delete tokenService;
     delete oauth;
     delete gmailAutomation;
-    delete emailHandler;
     delete checkEmailTimer;
     delete callbackServer;
 
@@ -426,6 +476,7 @@ void MainFrame::OnLogout(wxCommandEvent& event) {
     if (socketClient->isConnected()) {
         socketClient->disconnect();
     }
+    connectionPool.clear();
 
     // Reset trạng thái
     ResetApplicationState();
@@ -520,6 +571,7 @@ void MainFrame::ResetApplicationState() {
             checkEmailTimer->Stop();
         }
     }
+    StopPushNotifications();
 
     // Reset connection status label
     lblConnectionStatus->SetLabel("STATUS: DISCONNECTED");
@@ -558,6 +610,14 @@ void MainFrame::ResetApplicationState() {
         emailHandler = nullptr;
     }
 
+    StopMailboxSupervisor();
+
+    // Dừng thread làm mới token trước khi xóa oauth mà nó đang dùng
+    if (tokenService) {
+        delete tokenService;
+        tokenService = nullptr;
+    }
+
     // Reset oauth object
     if (oauth) {
         delete oauth; // Giải phóng bộ nhớ nếu đã có
@@ -583,6 +643,7 @@ void MainFrame::OnClose(wxCloseEvent& event)
     if (socketClient->isConnected()) {
         socketClient->disconnect();
     }
+    connectionPool.clear();
 
     // Cleanup và thoát
     ResetApplicationState();
@@ -790,10 +851,8 @@ void MainFrame::SetExistingRefreshToken(const std::string& token) {
         }
 
         refreshToken = token;
-        accessToken = oauth->getAccessToken(refreshToken);
 
-        if (!accessToken.empty()) {
-            emailHandler = new EmailHandler(accessToken);
+        if (CreateEmailHandler()) {
             UpdateStatus("Authentication successful using saved token");
             btnStartMonitoring->Enable();
             Show(); // Hiển thị MainFrame
@@ -809,6 +868,34 @@ void MainFrame::SetExistingRefreshToken(const std::string& token) {
     }
 }
 
+// Access token lấy qua TokenService: dùng lại token còn hạn (kể cả từ lần chạy trước),
+// làm mới nền trước khi hết hạn và EmailHandler tự xin token mới khi API trả 401
+bool MainFrame::CreateEmailHandler() {
+    if (!tokenService) {
+        GoogleOAuth* oauthClient = oauth;
+        tokenService = new TokenService(
+            [oauthClient](const std::string& token, int& expiresInSec) {
+                return oauthClient->getAccessToken(token, expiresInSec);
+            },
+            TokenService::defaultStatePath());
+    }
+
+    std::string account = userGmail.ToStdString();
+    tokenService->addAccount(account, refreshToken);
+    accessToken = tokenService->getAccessToken(account);
+    if (accessToken.empty()) {
+        return false;
+    }
+
+    delete emailHandler;
+    TokenService* service = tokenService;
+    emailHandler = new EmailHandler(EmailHandler::TokenSource(
+        [service, account](const std::string& rejectedToken) {
+            return service->getAccessToken(account, rejectedToken);
+        }));
+    return true;
+}
+
 void MainFrame::OnOAuthCode(wxCommandEvent& event) {
     wxString code = event.GetString();
 
@@ -825,13 +912,11 @@ void MainFrame::OnOAuthCode(wxCommandEvent& event) {
 
     tokenManager.saveRefreshToken(userGmail.ToStdString(), refreshToken);
 
-    accessToken = oauth->getAccessToken(refreshToken);
-    if (accessToken.empty()) {
+    if (!CreateEmailHandler()) {
         UpdateStatus("Unable to get access token");
         return;
     }
 
-    emailHandler = new EmailHandler(accessToken);
     UpdateStatus("Authentication successful");
     btnStartMonitoring->Enable();
 
@@ -845,230 +930,747 @@ void MainFrame::OnOAuthCode(wxCommandEvent& event) {
 }
 
 void MainFrame::OnCheckEmail(wxTimerEvent& event) {
+    if (mailboxSupervisor) {
+        // MailboxSupervisor tự poll các hộp thư; session rảnh do ConnectionPool tự heartbeat
+        return;
+    }
     if (!emailHandler) return;
 
-    EmailHandler::EmailInfo emailInfo = emailHandler->readNewestEmail();
-    if (!emailInfo.content.empty() && emailInfo.subject == "Mail Control") {
-        emailInfo.content = trim(emailInfo.content);
+    long long quotaBefore = emailHandler->getQuotaUnitsUsed();
+    // users.watch hết hạn sau tối đa 7 ngày: gia hạn trước một ngày
+    long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (pushReceiver && nowMs > watchExpirationMs - 24LL * 60 * 60 * 1000) {
+        RenewWatch();
+    }
+    bool commandFound = ProcessNewestEmail();
+    pollScheduler.recordQuota(static_cast<int>(emailHandler->getQuotaUnitsUsed() - quotaBefore));
+    pollScheduler.onPollResult(commandFound);
+
+    static Metrics::Gauge& quotaToday = Metrics::registry().gauge(
+        "gmail_quota_units_today", "Gmail API quota units used since the start of the day");
+    static Metrics::Gauge& pollInterval = Metrics::registry().gauge(
+        "gmail_poll_interval_milliseconds", "Delay until the next inbox poll");
+    quotaToday.set(pollScheduler.getStats().quotaUnitsToday);
 
-        // Tìm vị trí cuối cùng của " - " để tách lệnh và IP
-        size_t lastDashPos = emailInfo.content.rfind(" - ");
-        if (lastDashPos == std::string::npos) {
-            UpdateStatus("Invalid email format. Expected: commands - IP");
-            return;
+    // Timer một lần: khoảng chờ tiếp theo do PollScheduler quyết định
+    if (isMonitoring) {
+        int delayMs = pollScheduler.nextDelayMs();
+        pollInterval.set(delayMs);
+        checkEmailTimer->StartOnce(delayMs);
+    }
+}
+
+// Đọc email mới nhất và chạy lệnh nếu có; trả về true nếu đó là email lệnh
+bool MainFrame::ProcessNewestEmail() {
+    return ProcessEmail(emailHandler->readNewestEmail());
+}
+
+// Chạy lệnh trong một email và gửi email trả lời; false nếu không phải email lệnh
+bool MainFrame::ProcessEmail(EmailHandler::EmailInfo emailInfo, const std::string& mailboxAccount) {
+    if (!emailInfo.isCommand()) {
+        return false;
+    }
+    // Email đang chạy trên thread nền (ví dụ vừa được làm tiếp từ nhật ký rồi lại tới qua poll)
+    if (emailsInFlight.count(emailInfo.id)) {
+        return true;
+    }
+    // Trả lời từ đúng hộp thư đã nhận lệnh
+    std::string account = mailboxAccount.empty() ? userGmail.ToStdString() : mailboxAccount;
+
+    // Email làm dở từ lần chạy trước đã qua kiểm tra policy lúc nhận
+    bool resumed = commandJournal.isKnown(emailInfo.id);
+
+    // Email đã xử lý xong ở lần chạy trước (ví dụ client vừa khởi động lại): không chạy lại
+    if (!commandJournal.recordReceived(account, emailInfo)) {
+        UpdateStatus("Skipping already processed email " + emailInfo.id);
+        return true;
+    }
+
+    emailInfo.content = trim(emailInfo.content);
+
+    // Tìm vị trí cuối cùng của " - " để tách lệnh và danh sách target
+    size_t lastDashPos = emailInfo.content.rfind(" - ");
+    if (lastDashPos == std::string::npos) {
+        UpdateStatus("Invalid email format. Expected: commands - IP");
+        commandJournal.recordFinished(emailInfo.id);
+        return true;
+    }
+
+    std::string commandsStr = trim(emailInfo.content.substr(0, lastDashPos));
+    std::string targetSpec = trim(emailInfo.content.substr(lastDashPos + 3));
+
+    // Target có thể là IP, danh sách IP, dải CIDR hoặc nhóm trong inventory.json
+    inventory.load();
+    std::string targetError;
+    std::vector<Inventory::Target> targets = inventory.resolve(targetSpec, targetError);
+    if (targets.empty()) {
+        UpdateStatus("Invalid target '" + targetSpec + "': " + targetError);
+        commandJournal.recordFinished(emailInfo.id);
+        return true;
+    }
+
+    if (targets.size() == 1) {
+        UpdateStatus("Received new email with IP: " + targets[0].label());
+    }
+    else {
+        UpdateStatus("Received new email for " + std::to_string(targets.size()) +
+            " servers: " + targetSpec);
+    }
+
+    // Tách các lệnh bằng dấu chấm phẩy
+    std::vector<std::string> commands;
+    size_t pos = 0;
+    std::string delimiter = ";";
+    std::string commandsRemaining = commandsStr;
+
+    while ((pos = commandsRemaining.find(delimiter)) != std::string::npos) {
+        std::string command = trim(commandsRemaining.substr(0, pos));
+        if (!command.empty()) {
+            commands.push_back(command);
         }
+        commandsRemaining = commandsRemaining.substr(pos + 1);
+    }
+    if (!trim(commandsRemaining).empty()) {
+        commands.push_back(trim(commandsRemaining));
+    }
 
-        std::string commandsStr = trim(emailInfo.content.substr(0, lastDashPos));
-        std::string ip = trim(emailInfo.content.substr(lastDashPos + 3));
+    // Người gửi, server và lệnh phải được policy cho phép trước khi mở bất kỳ kết nối nào
+    if (!resumed) {
+        PolicyEngine::Request request;
+        request.sender = emailInfo.from;
+        request.mailboxAccount = account;
+        request.authenticationResults = emailInfo.authenticationResults;
+        for (const Inventory::Target& target : targets) {
+            request.targets.push_back({ target.ip });
+        }
+        request.commands = commands;
+
+        PolicyEngine::Decision decision = policyEngine.evaluate(request);
+        if (!decision.allowed) {
+            // Không trả lời: địa chỉ From có thể là giả mạo
+            UpdateStatus("Rejected command email: " + decision.reason);
+            commandJournal.recordFinished(emailInfo.id);
+            return true;
+        }
+    }
 
-        UpdateStatus("Received new email with IP: " + ip);
+    // Lấy đường dẫn AppData\Roaming\[AppName]
+    wxString appDataDir = wxStandardPaths::Get().GetUserDataDir();
+    if (!wxDirExists(appDataDir)) {
+        wxMkdir(appDataDir);
+    }
 
-        // Kết nối tới server
-        if (!socketClient->connect(ip, 27015)) {
-            UpdateStatus("Failed to connect to server: " + ip);
-            return;
+    // Tạo thư mục temp trong AppData
+    wxString tempDir = appDataDir + wxFILE_SEP_PATH + "temp";
+    if (!wxDirExists(tempDir)) {
+        wxMkdir(tempDir);
+    }
+
+    // Chạy lệnh và dựng trả lời trên thread nền để UI không bị treo trong lúc chờ các server;
+    // trả lời được gửi trên UI thread qua CallAfter (SendCommandReply)
+    if (!emailInfo.id.empty()) {
+        emailsInFlight.insert(emailInfo.id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(fanOutMutex);
+        fanOutsRunning++;
+    }
+    std::thread(&MainFrame::FanOutCommands, this, emailInfo, account, targets, commands,
+        tempDir, targetSpec).detach();
+    return true;
+}
+
+// Chạy trên thread nền: gửi lệnh tới các server, tối đa MAX_IN_FLIGHT_HOSTS server cùng lúc,
+// rồi gộp kết quả thành một email trả lời
+void MainFrame::FanOutCommands(EmailHandler::EmailInfo emailInfo, std::string account,
+    std::vector<Inventory::Target> targets, std::vector<std::string> commands,
+    wxString tempDir, std::string targetSpec) {
+    std::vector<HostResult> results(targets.size());
+    std::atomic<size_t> nextTarget(0);
+    size_t workerCount = std::min(targets.size(), MAX_IN_FLIGHT_HOSTS);
+    bool multiHost = targets.size() > 1;
+    auto fanOutStart = std::chrono::steady_clock::now();
+
+    // Từ lúc Gmail nhận thư tới lúc bắt đầu gửi lệnh (gồm cả chu kỳ poll)
+    if (emailInfo.internalDateMs > 0) {
+        static Metrics::Histogram& emailLatency = Metrics::registry().histogram(
+            "email_to_command_latency_milliseconds", "Time from Gmail receipt to command dispatch");
+        long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (nowMs > emailInfo.internalDateMs) {
+            emailLatency.record(static_cast<uint64_t>(nowMs - emailInfo.internalDateMs));
         }
-        UpdateStatus("Connected to server: " + ip);
-
-        // Tách các lệnh bằng dấu chấm phẩy
-        std::vector<std::string> commands;
-        std::vector<std::string> attachments;
-        size_t pos = 0;
-        std::string delimiter = ";";
-        std::string commandsRemaining = commandsStr;
-
-        while ((pos = commandsRemaining.find(delimiter)) != std::string::npos) {
-            std::string command = trim(commandsRemaining.substr(0, pos));
-            if (!command.empty()) {
-                commands.push_back(command);
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([&]() {
+            size_t index;
+            while ((index = nextTarget++) < targets.size()) {
+                std::string filePrefix;
+                if (multiHost) {
+                    filePrefix = targets[index].label() + "_";
+                    std::replace(filePrefix.begin(), filePrefix.end(), ':', '-');
+                }
+                results[index] = ExecuteCommandsOnHost(targets[index], commands,
+                    tempDir, filePrefix, emailInfo);
+            }
+            });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    long long totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - fanOutStart).count();
+
+    // Gộp kết quả của tất cả server vào một email trả lời
+    std::vector<std::string> attachments;
+    std::string replyMessage = "This is an automated reply to your email.\n";
+
+    if (!multiHost) {
+        replyMessage += "Processed commands:\n" + results[0].report;
+        replyMessage += "\nServer IP: " + targets[0].label();
+    }
+    else {
+        int hostsOk = 0;
+        std::ostringstream summary;
+        summary << "Targets: " << targetSpec << " (" << targets.size() << " servers, "
+            << totalMs << " ms)\n\nSummary:\n";
+        for (const HostResult& result : results) {
+            bool hostOk = result.connected && result.failed == 0;
+            if (hostOk) hostsOk++;
+
+            summary << "  " << std::left << std::setw(22) << result.target.label()
+                << std::setw(8) << (hostOk ? "OK" : "FAILED");
+            if (result.connected) {
+                summary << result.succeeded << "/" << (result.succeeded + result.failed)
+                    << " commands, " << result.elapsedMs << " ms\n";
+            }
+            else {
+                summary << "connection failed\n";
             }
-            commandsRemaining = commandsRemaining.substr(pos + 1);
         }
-        if (!trim(commandsRemaining).empty()) {
-            commands.push_back(trim(commandsRemaining));
+        summary << "\n" << hostsOk << "/" << targets.size() << " servers succeeded\n";
+        replyMessage += summary.str();
+
+        for (const HostResult& result : results) {
+            replyMessage += "\n== " + result.target.label() + " ==\n" + result.report;
         }
+    }
+
+    for (const HostResult& result : results) {
+        attachments.insert(attachments.end(), result.attachments.begin(), result.attachments.end());
+    }
 
-        // Lấy đường dẫn AppData\Roaming\[AppName]
-        wxString appDataDir = wxStandardPaths::Get().GetUserDataDir();
-        if (!wxDirExists(appDataDir)) {
-            wxMkdir(appDataDir);
+    if (!attachments.empty()) {
+        replyMessage += "\n\nAttached files:\n";
+        for (const auto& file : attachments) {
+            size_t lastSlash = file.find_last_of("/\\");
+            std::string fileName = (lastSlash != std::string::npos) ? file.substr(lastSlash + 1) : file;
+            replyMessage += "- " + fileName + "\n";
         }
+    }
+
+    CallAfter([this, emailInfo, account, replyMessage, attachments]() {
+        SendCommandReply(emailInfo, account, replyMessage, attachments);
+        });
+
+    // Sau điểm này không được dùng tới this: ~MainFrame chỉ chờ tới đây
+    std::lock_guard<std::mutex> lock(fanOutMutex);
+    fanOutsRunning--;
+    fanOutDone.notify_all();
+}
 
-        // Tạo thư mục temp trong AppData
-        wxString tempDir = appDataDir + wxFILE_SEP_PATH + "temp";
-        if (!wxDirExists(tempDir)) {
-            wxMkdir(tempDir);
+// Trên UI thread. Hộp thư được tra lại theo tài khoản vì supervisor có thể đã dừng trong lúc chạy lệnh
+void MainFrame::SendCommandReply(const EmailHandler::EmailInfo& emailInfo, const std::string& account,
+    const std::string& replyMessage, const std::vector<std::string>& attachments) {
+    emailsInFlight.erase(emailInfo.id);
+
+    EmailHandler* replyHandler = mailboxSupervisor ? mailboxSupervisor->getHandler(account) : nullptr;
+    if (!replyHandler && account == userGmail.ToStdString()) {
+        replyHandler = emailHandler;
+    }
+    bool success = replyHandler && replyHandler->sendReplyEmail(
+        emailInfo.from,
+        emailInfo.subject,
+        replyMessage,
+        emailInfo.threadId,
+        attachments
+    );
+
+    if (success) {
+        commandJournal.recordFinished(emailInfo.id);
+        UpdateStatus("Reply sent with " + std::to_string(attachments.size()) + " attachment(s)");
+        // Chỉ xóa file sau khi gửi mail thành công
+        for (const auto& file : attachments) {
+            wxRemoveFile(file);
         }
+    }
+    else {
+        // Email vẫn dở trong nhật ký: lần khởi động sau gửi lại trả lời mà không chạy lại lệnh
+        UpdateStatus("Failed to send reply email");
+    }
+}
 
-        std::string replyMessage = "This is an automated reply to your email.\nProcessed commands:\n";
-
-        for (const std::string& command : commands) {
-            UpdateStatus("Processing command: " + command);
-            std::string commandResult = "- " + command + ": ";
-
-            bool isValidCommand =
-                command == "list::app" ||
-                command == "list::service" ||
-                command == "list::process" ||
-                command == "help::cmd" ||
-                command == "screenshot::capture" ||
-                command == "camera::open" ||
-                command == "camera::close" ||
-                command.substr(0, 14) == "camera::record" ||
-                command.substr(0, 10) == "app::start" ||
-                command.substr(0, 9) == "app::stop" ||
-                command.substr(0, 14) == "service::start" ||
-                command.substr(0, 13) == "service::stop" ||
-                command.substr(0, 9) == "file::get" ||
-                command.substr(0, 12) == "file::delete";
-
-            if (!isValidCommand) {
-                std::string errorCommand = "error::Invalid command: " + command;
-                socketClient->sendData(errorCommand.c_str(), errorCommand.length());
-                UpdateCommandsList("[ERROR] '" + command + "'", emailInfo);
-                commandResult += "Invalid command\n";
-                replyMessage += commandResult;
-                continue;
-            }
+// Chạy trên worker thread: mọi cập nhật UI phải đi qua CallAfter
+MainFrame::HostResult MainFrame::ExecuteCommandsOnHost(const Inventory::Target& target,
+    const std::vector<std::string>& commands, const wxString& tempDir,
+    const std::string& filePrefix, const EmailHandler::EmailInfo& emailInfo) {
+    HostResult result;
+    result.target = target;
+    result.connected = false;
+    result.succeeded = 0;
+    result.failed = 0;
+    result.elapsedMs = 0;
+
+    auto hostStart = std::chrono::steady_clock::now();
+    std::string ip = target.label();
+
+    // Lấy kết nối tới server từ pool (tái sử dụng nếu còn sống)
+    SocketClient* session = connectionPool.acquire(target.ip, target.port);
+    if (!session) {
+        PostStatus("Failed to connect to server: " + ip);
+        result.report = "Failed to connect to server\n";
+        return result;
+    }
+    PostStatus("Connected to server: " + ip);
+    result.connected = true;
+    bool sessionHealthy = true;
+
+    for (size_t index = 0; index < commands.size(); index++) {
+        const std::string& command = commands[index];
+        PostStatus("Processing command: " + command + (filePrefix.empty() ? "" : " @ " + ip));
+        std::string commandResult = "- " + command + ": ";
+        wxString listEntry = filePrefix.empty() ? wxString(command) : wxString(command + " @ " + ip);
+
+        ParsedCommand parsed = parseCommand(command);
+        if (!parsed.valid() || parsed.spec->internal) {
+            std::string errorCommand = "error::Invalid command: " + command;
+            session->sendCommand(errorCommand);
+            CallAfter([this, listEntry, emailInfo]() {
+                UpdateCommandsList("[ERROR] '" + listEntry + "'", emailInfo);
+                });
+            commandResult += std::string(parsed.valid() ? "Invalid command" : parsed.error) + "\n";
+            result.report += commandResult;
+            result.failed++;
+            continue;
+        }
 
-            if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
-                UpdateStatus("Failed to send command to server: " + command);
-                commandResult += "Failed to send command\n";
-                replyMessage += commandResult;
-                continue;
+        // Bước đã có kết quả ở lần chạy trước: dùng lại kết quả, không gửi lại lệnh
+        std::string step = ip + "#" + std::to_string(index);
+        std::string journaledResult, journaledAttachment;
+        CommandJournal::StepState stepState = commandJournal.stepState(emailInfo.id, step,
+            journaledResult, journaledAttachment);
+        if (stepState == CommandJournal::StepState::Succeeded || stepState == CommandJournal::StepState::Failed) {
+            result.report += journaledResult;
+            if (!journaledAttachment.empty() && wxFileExists(journaledAttachment)) {
+                result.attachments.push_back(journaledAttachment);
             }
+            if (stepState == CommandJournal::StepState::Succeeded) result.succeeded++;
+            else result.failed++;
+            continue;
+        }
+        if (stepState == CommandJournal::StepState::InDoubt) {
+            commandResult += "Not re-run: the client stopped while this command was running, outcome unknown\n";
+            result.report += commandResult;
+            result.failed++;
+            continue;
+        }
+        // Ghi xuống đĩa trước khi gửi: client dừng sau điểm này thì lệnh không bị chạy lần hai.
+        // Không ghi được thì không gửi, vì lần chạy lại sau đó có thể chạy lệnh hai lần
+        if (!commandJournal.stepStarted(emailInfo.id, step)) {
+            PostStatus("Command journal unavailable, not sending: " + command);
+            commandResult += "Not sent: could not record the command in the journal\n";
+            commandJournal.stepDone(emailInfo.id, step, false, commandResult, "");
+            result.report += commandResult;
+            result.failed++;
+            continue;
+        }
 
-            UpdateCommandsList(command, emailInfo);
-            std::string filename = "";
+        if (session->sendCommand(command) == SOCKET_ERROR) {
+            PostStatus("Failed to send command to server: " + command);
+            sessionHealthy = false;
+            commandResult += "Failed to send command\n";
+            commandJournal.stepDone(emailInfo.id, step, false, commandResult, "");
+            result.report += commandResult;
+            result.failed++;
+            continue;
+        }
 
-            try {
-                if (command == "list::app" || command == "list::service") {
-                    filename = (command == "list::app") ? "applications.txt" : "services.txt";
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    socketClient->receiveAndSaveFile(fullPath.ToStdString());
-                    attachments.push_back(fullPath.ToStdString());
-                    commandResult += "Generated " + filename + "\n";
-                }
-                else if (command == "list::process" || command == "help::cmd") {
-                    filename = (command == "list::process") ? "processes.txt" : "help.txt";
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    socketClient->receiveAndSaveFile(fullPath.ToStdString());
-                    attachments.push_back(fullPath.ToStdString());
-                    commandResult += "Generated " + filename + "\n";
-                }
-                else if (command == "screenshot::capture" || command == "camera::open") {
-                    filename = (command == "screenshot::capture") ? "screenshot.png" : "webcam.png";
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    socketClient->receiveAndSaveImage(fullPath.ToStdString());
-                    attachments.push_back(fullPath.ToStdString());
-                    commandResult += "Generated " + filename + "\n";
-
-                    if (command == "camera::open") {
-                        isCameraOpen = true;
-                        wxButton* camButton = dynamic_cast<wxButton*>(FindWindow(ID_OPEN_CAM));
-                        if (camButton) {
-                            camButton->SetLabel("Close Camera");
-                        }
-                    }
-                }
-                else if (command == "camera::close") {
-                    isCameraOpen = false;
-                    wxButton* camButton = dynamic_cast<wxButton*>(FindWindow(ID_OPEN_CAM));
-                    if (camButton) {
-                        camButton->SetLabel("Open Camera");
+        CallAfter([this, listEntry, emailInfo]() {
+            UpdateCommandsList(listEntry, emailInfo);
+            });
+        std::string filename = "";
+        std::string attachment;
+        bool commandSucceeded = false;
+
+        // Thời gian khứ hồi của lệnh: từ lúc gửi tới khi nhận xong kết quả
+        Metrics::ScopedTimer commandTimer(Metrics::registry().histogram("client_command_duration_microseconds",
+            "Command round trip from send to result received", "command=\"" + std::string(parsed.spec->name) + "\""));
+
+        try {
+            // Tên file đính kèm: mặc định theo bảng lệnh, file::get dùng tên file gốc (hoặc <thư mục>.tar)
+            if (parsed.spec->resultKind != ResultKind::None && parsed.spec->resultKind != ResultKind::Status) {
+                filename = filePrefix + resultFileName(parsed);
+            }
+            wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
+
+            switch (parsed.spec->resultKind) {
+            case ResultKind::Text: {
+                std::string status;
+                if (!session->receiveFile(fullPath.ToStdString(), status)) {
+                    wxRemoveFile(fullPath);
+                    if (status.empty()) {
+                        // Đọc thiếu: phần còn lại của kết quả vẫn nằm trên kết nối
+                        sessionHealthy = false;
+                        status = "Result transfer interrupted";
                     }
+                    throw std::runtime_error(status);
                 }
-                else if (command.substr(0, 14) == "camera::record") {
-                    filename = "recording.avi";
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    socketClient->receiveVideoData(fullPath.ToStdString());
-                    if (!filename.empty()) {
-                        attachments.push_back(fullPath.ToStdString());
-                        commandResult += "Generated video recording\n";
+                commandResult += "Generated " + filename + "\n";
+                break;
+            }
+            case ResultKind::Image:
+                session->receiveAndSaveImage(fullPath.ToStdString());
+                commandResult += "Generated " + filename + "\n";
+                break;
+            case ResultKind::Video:
+                session->receiveVideoData(fullPath.ToStdString());
+                commandResult += "Generated video recording\n";
+                break;
+            case ResultKind::File: {
+                std::string status;
+                if (!session->receiveFile(fullPath.ToStdString(), status)) {
+                    wxRemoveFile(fullPath);
+                    if (status.empty()) {
+                        // Đứt giữa chừng: phần còn lại của file vẫn nằm trên kết nối
+                        sessionHealthy = false;
+                        status = "File transfer interrupted";
                     }
+                    throw std::runtime_error(status);
                 }
-                else if (command.substr(0, 10) == "app::start" || command.substr(0, 9) == "app::stop") {
-                    commandResult += "Application control executed\n";
-                }
-                else if (command.substr(0, 14) == "service::start" || command.substr(0, 13) == "service::stop") {
-                    commandResult += "Service control executed\n";
-                }
-                else if (command.substr(0, 9) == "file::get") {
-                    std::string filepath = command.substr(10);
-                    size_t lastSlash = filepath.find_last_of("/\\");
-                    filename = (lastSlash != std::string::npos) ? filepath.substr(lastSlash + 1) : filepath;
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    socketClient->receiveAndSaveFile(fullPath.ToStdString());
-                    attachments.push_back(fullPath.ToStdString());
-                    commandResult += "Received file: " + filename + "\n";
+                commandResult += "Received " + filename + ": " + status + "\n";
+                break;
+            }
+            case ResultKind::Stream: {
+                std::string streamSummary;
+                if (StreamRecorder::receive(*session, fullPath.ToStdString(), streamSummary)) {
+                    commandResult += streamSummary;
                 }
-                else if (command.substr(0, 12) == "file::delete") {
-                    commandResult += "File deletion executed\n";
+                else {
+                    // Stream đứt giữa chừng: dữ liệu còn lại trên kết nối không dùng được nữa
+                    commandResult += "Screen stream interrupted\n";
+                    sessionHealthy = false;
+                    wxRemoveFile(fullPath);
+                    filename.clear();
                 }
-
-                if (!filename.empty()) {
-                    wxString fullPath = tempDir + wxFILE_SEP_PATH + filename;
-                    std::string path_command = "save_path:" + fullPath.ToStdString();
-                    socketClient->sendData(path_command.c_str(), path_command.length());
+                break;
+            }
+            case ResultKind::Status: {
+                // Luôn đọc trả lời, kể cả khi chỉ để báo cáo: phần chưa đọc sẽ nằm lại trên session của pool
+                std::string status;
+                if (!session->receiveStatus(status)) {
+                    sessionHealthy = false;
+                    throw std::runtime_error("No reply from server");
                 }
+                commandResult += status + "\n";
+                break;
             }
-            catch (const std::exception& e) {
-                commandResult += "Error: " + std::string(e.what()) + "\n";
-                UpdateStatus("Error processing command: " + std::string(e.what()));
+            case ResultKind::None:
+                break;
             }
 
-            replyMessage += commandResult;
-        }
-
-        replyMessage += "\nServer IP: " + ip;
-        if (!attachments.empty()) {
-            replyMessage += "\n\nAttached files:\n";
-            for (const auto& file : attachments) {
-                size_t lastSlash = file.find_last_of("/\\");
-                std::string fileName = (lastSlash != std::string::npos) ? file.substr(lastSlash + 1) : file;
-                replyMessage += "- " + fileName + "\n";
+            if (!filename.empty()) {
+                attachment = fullPath.ToStdString();
+                result.attachments.push_back(attachment);
             }
-        }
 
-        bool success = emailHandler->sendReplyEmail(
-            emailInfo.from,
-            emailInfo.subject,
-            replyMessage,
-            emailInfo.threadId,
-            attachments
-        );
+            switch (parsed.spec->id) {
+            case CommandId::CameraOpen:
+            case CommandId::CameraClose: {
+                bool open = parsed.spec->id == CommandId::CameraOpen;
+                CallAfter([this, open]() {
+                    isCameraOpen = open;
+                    wxButton* camButton = dynamic_cast<wxButton*>(FindWindow(ID_OPEN_CAM));
+                    if (camButton) {
+                        camButton->SetLabel(open ? "Close Camera" : "Open Camera");
+                    }
+                    });
+                break;
+            }
+            case CommandId::AppStart:
+            case CommandId::AppStop:
+                commandResult += "Application control executed\n";
+                break;
+            case CommandId::ServiceStart:
+            case CommandId::ServiceStop:
+                commandResult += "Service control executed\n";
+                break;
+            default:
+                break;
+            }
 
-        if (success) {
-            UpdateStatus("Reply sent with " + std::to_string(attachments.size()) + " attachment(s)");
-            // Chỉ xóa file sau khi gửi mail thành công
-            for (const auto& file : attachments) {
-                wxRemoveFile(file);
+            if (!filename.empty()) {
+                std::string path_command = "save_path:" + fullPath.ToStdString();
+                session->sendCommand(path_command);
             }
+            result.succeeded++;
+            commandSucceeded = true;
         }
-        else {
-            UpdateStatus("Failed to send reply email");
+        catch (const std::exception& e) {
+            commandResult += "Error: " + std::string(e.what()) + "\n";
+            PostStatus("Error processing command: " + std::string(e.what()));
+            result.failed++;
         }
 
-        socketClient->disconnect();
-        UpdateStatus("Disconnected from server: " + ip);
+        commandJournal.stepDone(emailInfo.id, step, commandSucceeded, commandResult, attachment);
+        result.report += commandResult;
     }
+
+    // Trả kết nối về pool để dùng lại cho email sau
+    connectionPool.release(session, sessionHealthy);
+
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hostStart).count();
+    return result;
+}
+
+void MainFrame::PostStatus(const wxString& message) {
+    CallAfter([this, message]() {
+        UpdateStatus(message);
+        });
 }
 
 void MainFrame::OnStartMonitoring(wxCommandEvent& event) {
     if (!isMonitoring) {
         isMonitoring = true;
         btnStartMonitoring->SetLabel("Stop Monitoring");
-        checkEmailTimer->Start(2000); // Check every 2 seconds
-        UpdateStatus("Started monitoring emails");
+        // Poll đầu tiên ngay, sau đó nhịp do PollScheduler điều chỉnh
+        pollScheduler.setConfig(PollConfig());
+        if (StartMailboxSupervisor()) {
+            UpdateStatus(wxString::Format("Started monitoring %zu mailboxes", mailboxSupervisor->size()));
+            ResumeJournal();
+        }
+        else {
+            StartPushNotifications();
+            UpdateStatus("Started monitoring emails");
+            ResumeJournal();
+            CatchUpMissedEmails();
+        }
+        checkEmailTimer->StartOnce(1);
     }
     else {
         isMonitoring = false;
         btnStartMonitoring->SetLabel("Start Monitoring");
         checkEmailTimer->Stop();
+        StopPushNotifications();
+        StopMailboxSupervisor();
         UpdateStatus("Stopped monitoring emails");
     }
 }
 
+// Email lệnh còn dở khi client dừng lần trước: bước đã xong dùng lại kết quả,
+// bước đang chạy dở được báo là không rõ kết quả, bước chưa chạy được chạy tiếp, rồi gửi trả lời
+void MainFrame::ResumeJournal() {
+    std::vector<CommandJournal::Entry> entries = commandJournal.unfinished();
+    if (entries.empty()) return;
+
+    UpdateStatus(wxString::Format("Resuming %zu unfinished command email(s)", entries.size()));
+    for (const CommandJournal::Entry& entry : entries) {
+        EmailHandler* handler = entry.account == userGmail.ToStdString() ? emailHandler :
+            mailboxSupervisor ? mailboxSupervisor->getHandler(entry.account) : nullptr;
+        if (!handler) {
+            UpdateStatus("Mailbox " + entry.account + " is not monitored, leaving email " +
+                entry.email.id + " for later");
+            continue;
+        }
+        ProcessEmail(entry.email, entry.account);
+    }
+}
+
+// Poll chỉ đọc thư mới nhất nên thư lệnh đến trong lúc client tắt (trừ thư cuối) sẽ bị bỏ sót.
+// Đọc vài thư gần nhất và chạy những thư chưa có trong nhật ký, mới hơn thư cuối đã ghi nhận
+void MainFrame::CatchUpMissedEmails() {
+    long long newestKnownMs = commandJournal.newestInternalDateMs();
+    if (!emailHandler || newestKnownMs == 0) {
+        return;     // Nhật ký rỗng (lần chạy đầu): không chạy các thư cũ trong hộp thư
+    }
+
+    std::vector<std::string> messageIds;
+    if (!emailHandler->listRecentMessageIds(CATCH_UP_MESSAGES, messageIds) || messageIds.empty()) {
+        return;
+    }
+    // Danh sách mới -> cũ; chạy theo thứ tự đến
+    for (auto it = messageIds.rbegin(); it != messageIds.rend(); ++it) {
+        if (commandJournal.isKnown(*it)) continue;
+        EmailHandler::EmailInfo email = emailHandler->readEmail(*it);
+        if (email.internalDateMs > newestKnownMs) {
+            ProcessEmail(email);
+        }
+    }
+    emailHandler->setLastProcessedId(messageIds.front());
+}
+
+// Theo dõi nhiều hộp thư: EMAILPC_MAILBOXES là danh sách gmail cách nhau bởi dấu phẩy,
+// hoặc "*" cho mọi tài khoản đã lưu trong tokens.json. Tài khoản đang đăng nhập luôn có mặt.
+// Lệnh từ mọi hộp thư đi qua ProcessEmail trên UI thread như khi chỉ có một tài khoản
+bool MainFrame::StartMailboxSupervisor() {
+    std::string spec = trim(getEnvOr("EMAILPC_MAILBOXES", ""));
+    if (spec.empty() || !tokenService || mailboxSupervisor) {
+        return false;
+    }
+
+    std::string primary = userGmail.ToStdString();
+    std::vector<std::string> accounts;
+    if (spec == "*") {
+        accounts = tokenManager.getAccounts();
+    }
+    else {
+        std::stringstream list(spec);
+        std::string account;
+        while (std::getline(list, account, ',')) {
+            account = trim(account);
+            if (!account.empty()) {
+                accounts.push_back(account);
+            }
+        }
+    }
+    if (std::find(accounts.begin(), accounts.end(), primary) == accounts.end()) {
+        accounts.insert(accounts.begin(), primary);
+    }
+
+    mailboxSupervisor = new MailboxSupervisor(
+        [this](const std::string& account, const EmailHandler::EmailInfo& email) {
+            CallAfter([this, account, email]() {
+                // Supervisor có thể đã bị dừng trong lúc chờ UI thread
+                EmailHandler* handler = mailboxSupervisor ? mailboxSupervisor->getHandler(account) : nullptr;
+                if (handler) {
+                    UpdateStatus("Command email received on " + account);
+                    ProcessEmail(email, account);
+                }
+                });
+        },
+        MailboxSupervisor::defaultCheckpointPath());
+
+    TokenService* service = tokenService;
+    for (const std::string& account : accounts) {
+        std::string accountRefreshToken = account == primary ? refreshToken : tokenManager.getRefreshToken(account);
+        if (accountRefreshToken.empty()) {
+            UpdateStatus("No saved token for " + account + ", skipping it");
+            continue;
+        }
+        service->addAccount(account, accountRefreshToken);
+        mailboxSupervisor->addMailbox(account, new EmailHandler(EmailHandler::TokenSource(
+            [service, account](const std::string& rejectedToken) {
+                return service->getAccessToken(account, rejectedToken);
+            })));
+    }
+
+    mailboxSupervisor->start();
+    return true;
+}
+
+void MainFrame::StopMailboxSupervisor() {
+    if (!mailboxSupervisor) return;
+    delete mailboxSupervisor;
+    mailboxSupervisor = nullptr;
+}
+
+// Nhận thông báo push thay cho poll nhanh. Cấu hình qua biến môi trường:
+// EMAILPC_PUSH_PORT (cổng cục bộ), EMAILPC_PUSH_TOKEN (token trong URL push),
+// EMAILPC_PUSH_TOPIC (projects/<id>/topics/<name> đã cấp quyền publish cho Gmail)
+void MainFrame::StartPushNotifications() {
+    if (pushReceiver || !emailHandler) return;
+
+    int port = atoi(getEnvOr("EMAILPC_PUSH_PORT", "0").c_str());
+    std::string token = getEnvOr("EMAILPC_PUSH_TOKEN", "");
+    std::string topic = getEnvOr("EMAILPC_PUSH_TOPIC", "");
+    if (port <= 0 || token.empty() || topic.empty()) {
+        return;     // Không cấu hình push: chỉ dùng poll
+    }
+
+    pushReceiver = new PushReceiver(this, port, "/gmail/push", token);
+    if (!pushReceiver->start()) {
+        UpdateStatus(wxString::Format("Unable to start push receiver on port %d, using polling", port));
+        StopPushNotifications();
+        return;
+    }
+    Bind(wxEVT_MAIL_PUSH, &MainFrame::OnMailPush, this);
+
+    if (!RenewWatch()) {
+        UpdateStatus("Gmail watch failed, using polling");
+        StopPushNotifications();
+        return;
+    }
+
+    // Đã có push: poll chỉ còn là lưới an toàn nếu thông báo bị mất
+    PollConfig fallback;
+    fallback.baseIntervalMs = 60000;
+    fallback.maxIntervalMs = 60000;
+    fallback.burstDurationMs = 0;
+    pollScheduler.setConfig(fallback);
+    UpdateStatus(wxString::Format("Push notifications on port %d (history %llu)", port, lastHistoryId));
+}
+
+void MainFrame::StopPushNotifications() {
+    if (!pushReceiver) return;
+    Unbind(wxEVT_MAIL_PUSH, &MainFrame::OnMailPush, this);
+    delete pushReceiver;
+    pushReceiver = nullptr;
+    lastHistoryId = 0;
+    watchExpirationMs = 0;
+    pollScheduler.setConfig(PollConfig());
+}
+
+bool MainFrame::RenewWatch() {
+    std::string topic = getEnvOr("EMAILPC_PUSH_TOPIC", "");
+    unsigned long long historyId = 0;
+    if (!emailHandler->watch(topic, historyId, watchExpirationMs)) {
+        return false;
+    }
+    // Lần đầu: bắt đầu đồng bộ từ đây; gia hạn không làm mất các thay đổi chưa đồng bộ
+    if (lastHistoryId == 0) {
+        lastHistoryId = historyId;
+    }
+    return true;
+}
+
+// Đồng bộ tăng dần khi có thông báo: chỉ gọi history.list nếu historyId mới hơn lần trước
+void MainFrame::OnMailPush(wxCommandEvent& event) {
+    if (!emailHandler || !isMonitoring) return;
+
+    unsigned long long notifiedHistoryId = strtoull(event.GetString().ToStdString().c_str(), nullptr, 10);
+    if (notifiedHistoryId <= lastHistoryId) {
+        return;     // Thay đổi này đã được đồng bộ
+    }
+
+    long long quotaBefore = emailHandler->getQuotaUnitsUsed();
+    std::vector<std::string> messageIds;
+    unsigned long long latestHistoryId = 0;
+    bool commandFound = false;
+
+    if (emailHandler->listHistory(lastHistoryId, messageIds, latestHistoryId)) {
+        for (const std::string& messageId : messageIds) {
+            if (ProcessEmail(emailHandler->readEmail(messageId))) {
+                commandFound = true;
+            }
+        }
+        lastHistoryId = latestHistoryId > notifiedHistoryId ? latestHistoryId : notifiedHistoryId;
+    }
+    else {
+        // historyId quá cũ hoặc lỗi: đọc thư mới nhất như khi poll rồi bắt đầu lại từ thông báo này
+        commandFound = ProcessNewestEmail();
+        lastHistoryId = notifiedHistoryId;
+    }
+
+    pollScheduler.recordQuota(static_cast<int>(emailHandler->getQuotaUnitsUsed() - quotaBefore));
+    if (commandFound) {
+        UpdateStatus(wxString::Format("Processed push notification (history %llu)", notifiedHistoryId));
+    }
+}
+
 void MainFrame::OnListApp(wxCommandEvent& event) {
     if (!socketClient->isConnected()) {
         UpdateStatus("Error: Not connected to server");
@@ -1084,17 +1686,20 @@ void MainFrame::OnListApp(wxCommandEvent& event) {
     }
 
     // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-    if (socketClient->sendData("list::app", 9) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("list::app") == SOCKET_ERROR) {
         UpdateStatus("Failed to send list app command");
         return;
     }
 
     wxString filePath = saveFileDialog.GetPath();
-    socketClient->receiveAndSaveFile(filePath.ToStdString());
+    if (!socketClient->receiveAndSaveFile(filePath.ToStdString())) {
+        UpdateStatus("Failed to receive result from server");
+        return;
+    }
 
     // Gửi đường dẫn đến file cho server
     std::string path_command = "save_path:" + filePath.ToStdString();
-    socketClient->sendData(path_command.c_str(), path_command.length());
+    socketClient->sendCommand(path_command);
 
     UpdateStatus("Applications list saved to " + filePath);
 }
@@ -1114,17 +1719,20 @@ void MainFrame::OnListProcess(wxCommandEvent& event) {
     }
 
     // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-    if (socketClient->sendData("list::process", 13) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("list::process") == SOCKET_ERROR) {
         UpdateStatus("Failed to send list process command");
         return;
     }
 
     wxString filePath = saveFileDialog.GetPath();
-    socketClient->receiveAndSaveFile(filePath.ToStdString());
+    if (!socketClient->receiveAndSaveFile(filePath.ToStdString())) {
+        UpdateStatus("Failed to receive result from server");
+        return;
+    }
 
     // Gửi đường dẫn đến file cho server
     std::string path_command = "save_path:" + filePath.ToStdString();
-    socketClient->sendData(path_command.c_str(), path_command.length());
+    socketClient->sendCommand(path_command);
 
     UpdateStatus("Process list saved to " + filePath);
 }
@@ -1144,17 +1752,20 @@ void MainFrame::OnListService(wxCommandEvent& event) {
     }
 
     // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-    if (socketClient->sendData("list::service", 13) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("list::service") == SOCKET_ERROR) {
         UpdateStatus("Failed to send list service command");
         return;
     }
 
     wxString filePath = saveFileDialog.GetPath();
-    socketClient->receiveAndSaveFile(filePath.ToStdString());
+    if (!socketClient->receiveAndSaveFile(filePath.ToStdString())) {
+        UpdateStatus("Failed to receive result from server");
+        return;
+    }
 
     // Gửi đường dẫn đến file cho server
     std::string path_command = "save_path:" + filePath.ToStdString();
-    socketClient->sendData(path_command.c_str(), path_command.length());
+    socketClient->sendCommand(path_command);
 
     UpdateStatus("Services list saved to " + filePath);
 }
@@ -1174,7 +1785,7 @@ void MainFrame::OnScreenshot(wxCommandEvent& event) {
     }
 
     // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-    if (socketClient->sendData("screenshot::capture", 19) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("screenshot::capture") == SOCKET_ERROR) {
         UpdateStatus("Failed to send screenshot command");
         return;
     }
@@ -1184,7 +1795,7 @@ void MainFrame::OnScreenshot(wxCommandEvent& event) {
 
     // Gửi đường dẫn đến file cho server
     std::string path_command = "save_path:" + filePath.ToStdString();
-    socketClient->sendData(path_command.c_str(), path_command.length());
+    socketClient->sendCommand(path_command);
 
     UpdateStatus("Screenshot saved to " + filePath);
 }
@@ -1207,7 +1818,7 @@ void MainFrame::OnOpenCam(wxCommandEvent& event) {
         }
 
         // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-        if (socketClient->sendData("camera::open", 12) == SOCKET_ERROR) {
+        if (socketClient->sendCommand("camera::open") == SOCKET_ERROR) {
             UpdateStatus("Failed to send open cam command");
             return;
         }
@@ -1217,7 +1828,7 @@ void MainFrame::OnOpenCam(wxCommandEvent& event) {
 
         // Gửi đường dẫn đến file cho server
         std::string path_command = "save_path:" + filePath.ToStdString();
-        socketClient->sendData(path_command.c_str(), path_command.length());
+        socketClient->sendCommand(path_command);
 
         UpdateStatus("Webcam image saved to " + filePath);
 
@@ -1228,7 +1839,7 @@ void MainFrame::OnOpenCam(wxCommandEvent& event) {
     }
     else {
         // Camera close không cần save file
-        if (socketClient->sendData("camera::close", 13) == SOCKET_ERROR) {
+        if (socketClient->sendCommand("camera::close") == SOCKET_ERROR) {
             UpdateStatus("Failed to send close cam command");
             return;
         }
@@ -1277,7 +1888,7 @@ void MainFrame::OnRecordCam(wxCommandEvent& event) {
 
         // Gửi command để ghi video với thời gian ghi
         std::string command = "camera::record " + std::to_string(seconds);
-        if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
+        if (socketClient->sendCommand(command) == SOCKET_ERROR) {
             UpdateStatus("Failed to send record command");
             return;
         }
@@ -1289,7 +1900,7 @@ void MainFrame::OnRecordCam(wxCommandEvent& event) {
 
         // Gửi đường dẫn lưu file trở lại server nếu cần
         std::string path_command = "save_path:" + filePath.ToStdString();
-        socketClient->sendData(path_command.c_str(), path_command.length());
+        socketClient->sendCommand(path_command);
 
         UpdateStatus("Video recording saved to " + filePath);
 
@@ -1311,17 +1922,20 @@ void MainFrame::OnHelp(wxCommandEvent& event) {
     }
 
     // Chỉ gửi command sau khi người dùng đã chọn nơi lưu file
-    if (socketClient->sendData("help::cmd", 9) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("help::cmd") == SOCKET_ERROR) {
         UpdateStatus("Failed to send help command");
         return;
     }
 
     wxString filePath = saveFileDialog.GetPath();
-    socketClient->receiveAndSaveFile(filePath.ToStdString());
+    if (!socketClient->receiveAndSaveFile(filePath.ToStdString())) {
+        UpdateStatus("Failed to receive result from server");
+        return;
+    }
 
     // Gửi đường dẫn đến file cho server
     std::string path_command = "save_path:" + filePath.ToStdString();
-    socketClient->sendData(path_command.c_str(), path_command.length());
+    socketClient->sendCommand(path_command);
 
     UpdateStatus("Help information saved to " + filePath);
 }
@@ -1350,7 +1964,7 @@ void MainFrame::OnToggleService(wxCommandEvent& event) {
 
             // Send start_service command to server
             std::string command = "service::start " + serviceName.ToStdString();
-            if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
+            if (socketClient->sendCommand(command) == SOCKET_ERROR) {
                 UpdateStatus("Failed to send start service command");
                 return;
             }
@@ -1365,7 +1979,7 @@ void MainFrame::OnToggleService(wxCommandEvent& event) {
     else {
         // Send stop_service command with service name to server
         std::string command = "service::stop " + currentServiceName.ToStdString();
-        if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
+        if (socketClient->sendCommand(command) == SOCKET_ERROR) {
             UpdateStatus("Failed to send stop service command");
             return;
         }
@@ -1402,7 +2016,7 @@ void MainFrame::OnToggleApp(wxCommandEvent& event) {
 
             // Gửi lệnh start_app tới server
             std::string command = "app::start " + appName.ToStdString();
-            if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
+            if (socketClient->sendCommand(command) == SOCKET_ERROR) {
                 UpdateStatus("Failed to send start app command");
                 return;
             }
@@ -1417,7 +2031,7 @@ void MainFrame::OnToggleApp(wxCommandEvent& event) {
     else {
         // Gửi lệnh stop_app kèm tên ứng dụng tới server
         std::string command = "app::stop " + currentAppName.ToStdString();
-        if (socketClient->sendData(command.c_str(), command.length()) == SOCKET_ERROR) {
+        if (socketClient->sendCommand(command) == SOCKET_ERROR) {
             UpdateStatus("Failed to send stop app command");
             return;
         }
@@ -1436,7 +2050,7 @@ void MainFrame::OnShutdown(wxCommandEvent& event) {
         return;
     }
 
-    if (socketClient->sendData("system::shutdown", 16) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("system::shutdown") == SOCKET_ERROR) {
         UpdateStatus("Failed to send shutdown command");
         return;
     }
@@ -1449,7 +2063,7 @@ void MainFrame::OnRestart(wxCommandEvent& event) {
         return;
     }
 
-    if (socketClient->sendData("system::restart", 15) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("system::restart") == SOCKET_ERROR) {
         UpdateStatus("Failed to send restart command");
         return;
     }
@@ -1462,7 +2076,7 @@ void MainFrame::OnLockScreen(wxCommandEvent& event) {
         return;
     }
 
-    if (socketClient->sendData("system::lock", 12) == SOCKET_ERROR) {
+    if (socketClient->sendCommand("system::lock") == SOCKET_ERROR) {
         UpdateStatus("Failed to send lock screen command");
         return;
     }
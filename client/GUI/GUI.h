@@ -7,13 +7,26 @@
 #include <wx/artprov.h>
 #include <wx/stdpaths.h>
 #include <wx/filename.h>
+#include <set>
+#include <mutex>
+#include <condition_variable>
 
 // Custom includes
 #include "socket.h"
+#include "ConnectionPool.h"
+#include "Inventory.h"
+#include "CommandRegistry.h"
 #include "GmailAPI.h"
 #include "TokenManager.h"
+#include "TokenService.h"
 #include "handleMail.h"
 #include "OAuthServer.h"
+#include "Metrics.h"
+#include "PollScheduler.h"
+#include "PushReceiver.h"
+#include "MailboxSupervisor.h"
+#include "CommandJournal.h"
+#include "PolicyEngine.h"
 #include <Windows.h>
 
 // Constants
@@ -175,13 +188,34 @@ private:
 
     // Backend components
     SocketClient* socketClient;
+    ConnectionPool connectionPool;
+    Inventory inventory;
     GoogleOAuth* oauth;
     EmailHandler* emailHandler;
+    // Cache access token, làm mới nền trước khi hết hạn; EmailHandler lấy token qua đây
+    TokenService* tokenService;
     wxTimer* checkEmailTimer;
+    PollScheduler pollScheduler;
+    // Thông báo push của users.watch (bật khi có EMAILPC_PUSH_PORT/TOKEN/TOPIC)
+    PushReceiver* pushReceiver;
+    unsigned long long lastHistoryId;
+    long long watchExpirationMs;
+    // Theo dõi nhiều hộp thư (bật khi có EMAILPC_MAILBOXES), thay cho poll một tài khoản
+    MailboxSupervisor* mailboxSupervisor;
+    // Nhật ký email lệnh: khởi động lại không chạy lệnh hai lần, làm tiếp email còn dở
+    CommandJournal commandJournal;
+    // Email đang chạy lệnh trên thread nền (chỉ dùng trên UI thread)
+    std::set<std::string> emailsInFlight;
+    std::mutex fanOutMutex;
+    std::condition_variable fanOutDone;
+    size_t fanOutsRunning;
+    // Luật người gửi / server / lệnh (policy.json), kiểm tra trước khi kết nối tới server
+    PolicyEngine policyEngine;
     GmailUIAutomation* gmailAutomation;
     TokenManager tokenManager;
     OAuthCallbackServer* callbackServer;
     CommandPopup* currentPopup;
+    Metrics::Exporter metricsExporter;
 
     // State variables
     bool isMonitoring;
@@ -200,12 +234,51 @@ private:
     std::string refreshToken;
     std::string accessToken;
 
+    // Kết quả thực thi lệnh trên một server khi gửi tới nhiều server
+    struct HostResult {
+        Inventory::Target target;
+        bool connected;
+        int succeeded;
+        int failed;
+        long long elapsedMs;
+        std::string report;
+        std::vector<std::string> attachments;
+    };
+    static constexpr size_t MAX_IN_FLIGHT_HOSTS = 16;
+    static constexpr int CATCH_UP_MESSAGES = 10;
+    static constexpr int METRICS_PORT = 9100;
+    static constexpr int METRICS_DUMP_INTERVAL_SEC = 60;
+
     // Private methods
     void LoadClientSecrets();
     void UpdateStatus(const wxString& message);
+    void PostStatus(const wxString& message);
+    HostResult ExecuteCommandsOnHost(const Inventory::Target& target,
+        const std::vector<std::string>& commands,
+        const wxString& tempDir,
+        const std::string& filePrefix,
+        const EmailHandler::EmailInfo& emailInfo);
     void UpdateConnectionStatus();
     void UpdateCommandsList(const wxString& command, const EmailHandler::EmailInfo& emailInfo);
     void ResetApplicationState();
+    void StartMetrics();
+    bool CreateEmailHandler();
+    bool ProcessNewestEmail();
+    // Kiểm tra email trên UI thread rồi chạy lệnh trên thread nền (FanOutCommands)
+    bool ProcessEmail(EmailHandler::EmailInfo emailInfo, const std::string& mailboxAccount = "");
+    void FanOutCommands(EmailHandler::EmailInfo emailInfo, std::string account,
+        std::vector<Inventory::Target> targets, std::vector<std::string> commands,
+        wxString tempDir, std::string targetSpec);
+    void SendCommandReply(const EmailHandler::EmailInfo& emailInfo, const std::string& account,
+        const std::string& replyMessage, const std::vector<std::string>& attachments);
+    void ResumeJournal();
+    void CatchUpMissedEmails();
+    bool StartMailboxSupervisor();
+    void StopMailboxSupervisor();
+    void StartPushNotifications();
+    void StopPushNotifications();
+    bool RenewWatch();
+    void OnMailPush(wxCommandEvent& event);
 
     // Event handlers for buttons
     void OnLogout(wxCommandEvent& event);
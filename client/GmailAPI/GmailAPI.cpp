@@ -1,11 +1,12 @@
 ﻿#include <iostream>
 #include <curl/curl.h>
-#include <json/json.h>
+#include "JsonScan.h"
 #include <sstream>
 #include <TlHelp32.h>
 #include <thread>
 #include <chrono>
 #include "GmailAPI.h"
+#include "utils.h"
 
 namespace {
     size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -37,7 +38,8 @@ namespace {
 
 // GoogleOAuth Implementation
 GoogleOAuth::GoogleOAuth(const std::string& client_id, const std::string& client_secret, const std::string& redirect_uri)
-    : client_id(client_id), client_secret(client_secret), redirect_uri(redirect_uri) {}
+    : client_id(client_id), client_secret(client_secret), redirect_uri(redirect_uri),
+    token_url(getEnvOr("EMAILPC_OAUTH_TOKEN_URL", "https://oauth2.googleapis.com/token")) {}
 
 std::string GoogleOAuth::urlEncode(const std::string& str) {
     CURL* curl = curl_easy_init();
@@ -82,8 +84,8 @@ std::string GoogleOAuth::getRefreshToken(const std::string& code) {
         throw std::runtime_error("Lỗi lấy refresh token: " + std::string(curl_easy_strerror(res)));
     }
 
-    Json::Value root;
-    if (!Json::Reader().parse(response, root) || !root.isMember("refresh_token")) {
+    JsonScan::Value root;
+    if (!JsonScan::parse(response, root) || !root["refresh_token"].exists()) {
         throw std::runtime_error("Lỗi phân tích refresh token: " + response);
     }
 
@@ -91,6 +93,12 @@ std::string GoogleOAuth::getRefreshToken(const std::string& code) {
 }
 
 std::string GoogleOAuth::getAccessToken(const std::string& refresh_token) {
+    int expiresInSec = 0;
+    return getAccessToken(refresh_token, expiresInSec);
+}
+
+std::string GoogleOAuth::getAccessToken(const std::string& refresh_token, int& expiresInSec) {
+    expiresInSec = 0;
     CURL* curl = curl_easy_init();
     if (!curl) {
         return "";
@@ -102,7 +110,7 @@ std::string GoogleOAuth::getAccessToken(const std::string& refresh_token) {
         "&refresh_token=" + urlEncode(refresh_token) +
         "&grant_type=refresh_token";
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://oauth2.googleapis.com/token");
+    curl_easy_setopt(curl, CURLOPT_URL, token_url.c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postFields.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
@@ -116,13 +124,19 @@ std::string GoogleOAuth::getAccessToken(const std::string& refresh_token) {
         return "";
     }
 
-    Json::Value root;
-    if (!Json::Reader().parse(response, root)) {
+    JsonScan::Value root;
+    if (!JsonScan::parse(response, root)) {
         std::cout << "Lỗi phân tích JSON" << std::endl;
         return "";
     }
 
-    return root["access_token"].asString();
+    std::string accessToken;
+    root.forEachMember([&](std::string_view name, const JsonScan::Value& value) {
+        if (name == "access_token") accessToken = value.asString();
+        else if (name == "expires_in") expiresInSec = static_cast<int>(value.asInt64());
+        return true;
+    });
+    return accessToken;
 }
 
 // GmailUIAutomation Implementation
@@ -10,7 +10,7 @@ private:
     const std::string client_secret;
     const std::string redirect_uri;
     const std::string auth_url = "https://accounts.google.com/o/oauth2/v2/auth";
-    const std::string token_url = "https://accounts.google.com/o/oauth2/token";
+    const std::string token_url;    // EMAILPC_OAUTH_TOKEN_URL nếu có, để chạy với server giả lập
 
     std::string urlEncode(const std::string& str);
 
@@ -19,6 +19,8 @@ public:
     std::string getAuthUrl();
     std::string getRefreshToken(const std::string& code);
     std::string getAccessToken(const std::string& refresh_token);
+    // expiresInSec: thời hạn của access token theo máy chủ (expires_in), 0 nếu không rõ
+    std::string getAccessToken(const std::string& refresh_token, int& expiresInSec);
 };
 
 class GmailUIAutomation {
@@ -1,5 +1,5 @@
 ﻿#include "OAuthServer.h"
-#include <regex>
+#include "utils.h"
 #include <iostream>
 
 wxDEFINE_EVENT(wxEVT_OAUTH_CODE, wxCommandEvent);
@@ -101,12 +101,24 @@ bool OAuthCallbackServer::initializeServer() {
 }
 
 std::string OAuthCallbackServer::extractCode(const std::string& request) {
-    std::regex codeRegex("code=([^&\\s]+)");
-    std::smatch matches;
-    if (std::regex_search(request, matches, codeRegex)) {
-        return matches[1];
-    }
-    return "";
+    // Only the query of the request line "GET /?code=...&scope=... HTTP/1.1" matters
+    std::string_view requestLine(request);
+    requestLine = requestLine.substr(0, requestLine.find("\r\n"));
+    size_t targetStart = requestLine.find(' ');
+    if (targetStart == std::string_view::npos) return "";
+    std::string_view target = requestLine.substr(targetStart + 1);
+    target = target.substr(0, target.find(' '));
+
+    size_t queryStart = target.find('?');
+    if (queryStart == std::string_view::npos) return "";
+    std::string_view query = target.substr(queryStart + 1);
+    query = query.substr(0, query.find('#'));
+
+    // Google sends the code percent-encoded ("4%2F0A..."); left as is, urlEncode in the token
+    // exchange would encode it a second time
+    std::string_view code;
+    if (!findQueryParam(query, "code", code)) return "";
+    return urlDecode(code);
 }
 
 void OAuthCallbackServer::sendResponse(SOCKET clientSocket) {
@@ -0,0 +1,80 @@
+#include "HttpPool.h"
+
+HttpPool& HttpPool::shared() {
+    static HttpPool pool;
+    return pool;
+}
+
+HttpPool::HttpPool() : stats{ 0, 0 } {
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &HttpPool::lockShare);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &HttpPool::unlockShare);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+}
+
+HttpPool::~HttpPool() {
+    for (CURL* curl : idleHandles) {
+        curl_easy_cleanup(curl);
+    }
+    idleHandles.clear();
+    if (share) {
+        curl_share_cleanup(share);
+    }
+}
+
+void HttpPool::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<HttpPool*>(userptr)->shareLocks[data].lock();
+}
+
+void HttpPool::unlockShare(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<HttpPool*>(userptr)->shareLocks[data].unlock();
+}
+
+CURL* HttpPool::acquire() {
+    CURL* curl = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!idleHandles.empty()) {
+            curl = idleHandles.back();
+            idleHandles.pop_back();
+            stats.reused++;
+        }
+    }
+
+    if (curl) {
+        // Xóa option của lần dùng trước nhưng giữ kết nối đang mở
+        curl_easy_reset(curl);
+    }
+    else {
+        curl = curl_easy_init();
+        if (!curl) return nullptr;
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stats.created++;
+    }
+
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+    return curl;
+}
+
+void HttpPool::release(CURL* curl) {
+    if (!curl) return;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (idleHandles.size() < MAX_IDLE_HANDLES) {
+            idleHandles.push_back(curl);
+            return;
+        }
+    }
+    curl_easy_cleanup(curl);
+}
+
+HttpPool::Stats HttpPool::getStats() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return stats;
+}
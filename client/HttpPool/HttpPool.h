@@ -0,0 +1,41 @@
+#pragma once
+#include <curl/curl.h>
+#include <mutex>
+#include <vector>
+
+// Pool CURL easy handle dùng chung cho mọi hộp thư.
+// - Handle được trả lại pool thay vì curl_easy_cleanup, nên kết nối HTTP/TLS tới Gmail được giữ và dùng lại
+// - Mọi handle gắn vào một CURLSH chung: cache DNS và phiên TLS dùng chung giữa các tài khoản
+// Không chia sẻ CURL_LOCK_DATA_CONNECT: libcurl không hỗ trợ dùng chung connection cache giữa nhiều thread.
+class HttpPool {
+public:
+    static const size_t MAX_IDLE_HANDLES = 16;
+
+    static HttpPool& shared();
+
+    // Handle sạch (đã curl_easy_reset) gắn với share; nullptr nếu không tạo được
+    CURL* acquire();
+    void release(CURL* curl);
+
+    struct Stats {
+        long long created;
+        long long reused;
+    };
+    Stats getStats();
+
+private:
+    HttpPool();
+    ~HttpPool();
+    HttpPool(const HttpPool&) = delete;
+    HttpPool& operator=(const HttpPool&) = delete;
+
+    static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+    CURLSH* share;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+    std::mutex poolMutex;
+    std::vector<CURL*> idleHandles;
+    Stats stats;
+};
@@ -0,0 +1,200 @@
+#include "Inventory.h"
+#include <iostream>
+#include <sstream>
+#include <set>
+#include "utils.h"
+#include "AppData.h"
+
+Inventory::Inventory() {
+    INVENTORY_FILE = getInventoryFilePath();
+    load();
+}
+
+std::string Inventory::getInventoryFilePath() {
+    return AppData::path("inventory.json");
+}
+
+bool Inventory::load() {
+    groups.clear();
+
+    std::ifstream file(INVENTORY_FILE);
+    if (!file.is_open()) {
+        return false;  // Không có inventory: chỉ dùng được IP/CIDR trực tiếp
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        std::cerr << "Cannot parse inventory file: " << errs << std::endl;
+        return false;
+    }
+
+    const Json::Value& groupsJson = root["groups"];
+    for (const auto& name : groupsJson.getMemberNames()) {
+        std::vector<std::string>& members = groups[name];
+        for (const auto& member : groupsJson[name]) {
+            members.push_back(trim(member.asString()));
+        }
+    }
+    return true;
+}
+
+std::vector<Inventory::Target> Inventory::resolve(const std::string& spec, std::string& error) const {
+    std::vector<Target> targets;
+
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (item.empty()) continue;
+        if (!resolveItem(item, 0, targets, error)) {
+            return {};
+        }
+    }
+
+    // Bỏ target trùng nhưng giữ nguyên thứ tự xuất hiện
+    std::set<std::string> seen;
+    std::vector<Target> unique;
+    for (const Target& target : targets) {
+        if (seen.insert(target.label()).second) {
+            unique.push_back(target);
+        }
+    }
+
+    if (unique.empty() && error.empty()) {
+        error = "No target specified";
+    }
+    return unique;
+}
+
+bool Inventory::resolveItem(const std::string& item, int depth,
+    std::vector<Target>& targets, std::string& error) const {
+    if (targets.size() > MAX_TARGETS) {
+        error = "Too many targets (limit " + std::to_string(MAX_TARGETS) + ")";
+        return false;
+    }
+
+    // Tách port nếu có dạng host:port
+    std::string host = item;
+    int port = DEFAULT_SERVER_PORT;
+    size_t colonPos = item.rfind(':');
+    if (colonPos != std::string::npos) {
+        host = item.substr(0, colonPos);
+        try {
+            port = std::stoi(item.substr(colonPos + 1));
+        }
+        catch (const std::exception&) {
+            error = "Invalid port in target: " + item;
+            return false;
+        }
+        if (port <= 0 || port > 65535) {
+            error = "Invalid port in target: " + item;
+            return false;
+        }
+    }
+
+    if (host.find('/') != std::string::npos) {
+        return expandCidr(host, port, targets, error);
+    }
+
+    unsigned long address;
+    if (parseIPv4(host, address)) {
+        targets.push_back({ formatIPv4(address), port });
+        return true;
+    }
+
+    auto it = groups.find(item);
+    if (it == groups.end()) {
+        error = "Unknown target or group: " + item;
+        return false;
+    }
+    if (depth >= MAX_GROUP_DEPTH) {
+        error = "Group nesting too deep: " + item;
+        return false;
+    }
+
+    for (const std::string& member : it->second) {
+        if (!resolveItem(member, depth + 1, targets, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Inventory::expandCidr(const std::string& item, int port,
+    std::vector<Target>& targets, std::string& error) const {
+    size_t slashPos = item.find('/');
+    unsigned long network;
+    int prefix;
+
+    try {
+        prefix = std::stoi(item.substr(slashPos + 1));
+    }
+    catch (const std::exception&) {
+        error = "Invalid CIDR prefix: " + item;
+        return false;
+    }
+
+    if (!parseIPv4(item.substr(0, slashPos), network) || prefix < 0 || prefix > 32) {
+        error = "Invalid CIDR range: " + item;
+        return false;
+    }
+
+    unsigned long long hostCount = 1ULL << (32 - prefix);
+    if (targets.size() + hostCount > MAX_TARGETS) {
+        error = "CIDR range too large: " + item;
+        return false;
+    }
+
+    unsigned long mask = prefix == 0 ? 0 : 0xFFFFFFFFUL << (32 - prefix);
+    unsigned long first = network & mask;
+    unsigned long last = first + (unsigned long)(hostCount - 1);
+
+    // Bỏ địa chỉ network và broadcast, trừ /31 và /32
+    if (prefix < 31) {
+        first++;
+        last--;
+    }
+
+    for (unsigned long address = first; address <= last; address++) {
+        targets.push_back({ formatIPv4(address), port });
+        if (address == 0xFFFFFFFFUL) break;
+    }
+    return true;
+}
+
+bool Inventory::parseIPv4(const std::string& text, unsigned long& address) {
+    unsigned long result = 0;
+    int octets = 0;
+    size_t pos = 0;
+
+    while (octets < 4) {
+        size_t start = pos;
+        unsigned long value = 0;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' && pos - start < 3) {
+            value = value * 10 + (text[pos] - '0');
+            pos++;
+        }
+        if (pos == start || value > 255) return false;
+
+        result = (result << 8) | value;
+        octets++;
+
+        if (octets < 4) {
+            if (pos >= text.size() || text[pos] != '.') return false;
+            pos++;
+        }
+    }
+
+    if (pos != text.size()) return false;
+    address = result;
+    return true;
+}
+
+std::string Inventory::formatIPv4(unsigned long address) {
+    return std::to_string((address >> 24) & 0xFF) + "." +
+        std::to_string((address >> 16) & 0xFF) + "." +
+        std::to_string((address >> 8) & 0xFF) + "." +
+        std::to_string(address & 0xFF);
+}
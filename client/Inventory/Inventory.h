@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <json/json.h>
+#include <fstream>
+#include <windows.h>
+#include <ShlObj.h>
+#include <KnownFolders.h>
+
+#define DEFAULT_SERVER_PORT 27015
+
+// Danh sách máy chủ cục bộ (inventory.json) dùng để mở rộng phần target của email.
+// Một target có thể là IP, IP:port, dải CIDR hoặc tên nhóm, phân cách bằng dấu phẩy.
+//
+// Ví dụ inventory.json:
+// {
+//     "groups": {
+//         "lab": ["192.168.1.10", "192.168.1.11:27016"],
+//         "office": ["10.0.0.0/28", "lab"]
+//     }
+// }
+class Inventory {
+public:
+    struct Target {
+        std::string ip;
+        int port;
+
+        std::string label() const {
+            return port == DEFAULT_SERVER_PORT ? ip : ip + ":" + std::to_string(port);
+        }
+    };
+
+    Inventory();
+
+    bool load();
+    std::vector<Target> resolve(const std::string& spec, std::string& error) const;
+
+private:
+    static const int MAX_TARGETS = 1024;
+    static const int MAX_GROUP_DEPTH = 8;
+
+    std::string getInventoryFilePath();
+    bool resolveItem(const std::string& item, int depth,
+        std::vector<Target>& targets, std::string& error) const;
+    bool expandCidr(const std::string& item, int port,
+        std::vector<Target>& targets, std::string& error) const;
+    static bool parseIPv4(const std::string& text, unsigned long& address);
+    static std::string formatIPv4(unsigned long address);
+
+    std::map<std::string, std::vector<std::string>> groups;
+    std::string INVENTORY_FILE;
+};
@@ -0,0 +1,247 @@
+#include "JsonScan.h"
+#include <charconv>
+#include <cstring>
+
+namespace JsonScan {
+
+static size_t skipWhitespace(std::string_view json, size_t pos) {
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\n' || json[pos] == '\r' || json[pos] == '\t')) {
+        pos++;
+    }
+    return pos;
+}
+
+// pos trỏ vào dấu nháy mở; trả vị trí ngay sau dấu nháy đóng
+static size_t skipString(std::string_view json, size_t pos) {
+    const char* data = json.data();
+    size_t searchFrom = pos + 1;
+    while (searchFrom < json.size()) {
+        const char* quote = static_cast<const char*>(memchr(data + searchFrom, '"', json.size() - searchFrom));
+        if (!quote) {
+            return std::string_view::npos;
+        }
+        size_t quotePos = quote - data;
+        // Dấu nháy bị escape nếu đứng sau một số lẻ dấu '\'
+        size_t backslashes = 0;
+        while (quotePos - backslashes > pos + 1 && data[quotePos - backslashes - 1] == '\\') {
+            backslashes++;
+        }
+        if (backslashes % 2 == 0) {
+            return quotePos + 1;
+        }
+        searchFrom = quotePos + 1;
+    }
+    return std::string_view::npos;
+}
+
+size_t skipValue(std::string_view json, size_t pos) {
+    pos = skipWhitespace(json, pos);
+    if (pos >= json.size()) {
+        return std::string_view::npos;
+    }
+
+    char first = json[pos];
+    if (first == '"') {
+        return skipString(json, pos);
+    }
+
+    if (first == '{' || first == '[') {
+        // Ngăn xếp ký tự đóng đang chờ; chuỗi bên trong được nhảy qua nguyên khối
+        std::string closers;
+        size_t i = pos;
+        while (i < json.size()) {
+            char c = json[i];
+            if (c == '"') {
+                i = skipString(json, i);
+                if (i == std::string_view::npos) return i;
+                continue;
+            }
+            if (c == '{') closers.push_back('}');
+            else if (c == '[') closers.push_back(']');
+            else if (c == '}' || c == ']') {
+                if (closers.empty() || closers.back() != c) {
+                    return std::string_view::npos;
+                }
+                closers.pop_back();
+                if (closers.empty()) {
+                    return i + 1;
+                }
+            }
+            i++;
+        }
+        return std::string_view::npos;
+    }
+
+    // Số hoặc true/false/null
+    size_t end = pos;
+    while (end < json.size() && !strchr(",}] \t\r\n", json[end])) {
+        end++;
+    }
+    return end > pos ? end : std::string_view::npos;
+}
+
+bool parse(std::string_view json, Value& root) {
+    size_t start = skipWhitespace(json, 0);
+    size_t end = skipValue(json, start);
+    if (end == std::string_view::npos || skipWhitespace(json, end) != json.size()) {
+        return false;
+    }
+    root = Value(json.substr(start, end - start));
+    return true;
+}
+
+Value Value::operator[](std::string_view key) const {
+    size_t pos = 0;
+    std::string_view name;
+    Value member;
+    while (nextMember(pos, name, member)) {
+        if (name == key) {
+            return member;
+        }
+    }
+    return Value();
+}
+
+bool Value::nextMember(size_t& pos, std::string_view& name, Value& member) const {
+    if (!isObject()) {
+        return false;
+    }
+    pos = skipWhitespace(text, pos == 0 ? 1 : pos);
+    if (pos >= text.size() || text[pos] != '"') {
+        return false;   // '}' (hết member) hoặc JSON hỏng
+    }
+    size_t nameEnd = skipString(text, pos);
+    if (nameEnd == std::string_view::npos) return false;
+    // Tên member của Gmail/OAuth không có escape: so sánh nguyên văn
+    name = text.substr(pos + 1, nameEnd - pos - 2);
+
+    pos = skipWhitespace(text, nameEnd);
+    if (pos >= text.size() || text[pos] != ':') return false;
+    pos = skipWhitespace(text, pos + 1);
+    size_t valueEnd = skipValue(text, pos);
+    if (valueEnd == std::string_view::npos) return false;
+    member = Value(text.substr(pos, valueEnd - pos));
+
+    pos = skipWhitespace(text, valueEnd);
+    if (pos < text.size() && text[pos] == ',') {
+        pos++;
+    }
+    return true;
+}
+
+bool Value::nextElement(size_t& pos, Value& element) const {
+    if (!isArray()) {
+        return false;
+    }
+    pos = skipWhitespace(text, pos == 0 ? 1 : pos);
+    if (pos >= text.size() || text[pos] == ']') {
+        return false;
+    }
+    size_t end = skipValue(text, pos);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    element = Value(text.substr(pos, end - pos));
+
+    pos = skipWhitespace(text, end);
+    if (pos < text.size() && text[pos] == ',') {
+        pos++;
+    }
+    return true;
+}
+
+std::string_view Value::stringBody() const {
+    return isString() && text.size() >= 2 ? text.substr(1, text.size() - 2) : std::string_view();
+}
+
+static void appendUtf8(std::string& out, unsigned long codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+static unsigned long readHex4(std::string_view body, size_t pos) {
+    unsigned long value = 0;
+    if (pos + 4 > body.size()) return 0xFFFD;
+    auto result = std::from_chars(body.data() + pos, body.data() + pos + 4, value, 16);
+    return result.ptr == body.data() + pos + 4 ? value : 0xFFFD;
+}
+
+std::string Value::asString() const {
+    if (!isString()) {
+        if (!exists() || text == "null") return "";
+        return std::string(text);
+    }
+
+    std::string_view body = stringBody();
+    size_t escape = body.find('\\');
+    if (escape == std::string_view::npos) {
+        return std::string(body);   // Trường hợp thường gặp (base64, id): sao chép một lần
+    }
+
+    std::string out(body.substr(0, escape));
+    out.reserve(body.size());
+    for (size_t i = escape; i < body.size(); i++) {
+        char c = body[i];
+        if (c != '\\' || i + 1 >= body.size()) {
+            out += c;
+            continue;
+        }
+        char next = body[++i];
+        switch (next) {
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+            unsigned long codePoint = readHex4(body, i + 1);
+            i += 4;
+            // Cặp surrogate UTF-16 cho ký tự ngoài BMP (emoji...)
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 6 < body.size() &&
+                body[i + 1] == '\\' && body[i + 2] == 'u') {
+                unsigned long low = readHex4(body, i + 3);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+            }
+            appendUtf8(out, codePoint);
+            break;
+        }
+        default: out += next; break;   // \" \\ \/
+        }
+    }
+    return out;
+}
+
+long long Value::asInt64() const {
+    std::string_view digits = isString() ? stringBody() : text;
+    long long value = 0;
+    std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    return value;
+}
+
+unsigned long long Value::asUInt64() const {
+    std::string_view digits = isString() ? stringBody() : text;
+    unsigned long long value = 0;
+    std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    return value;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Đọc JSON theo yêu cầu, không dựng cây Json::Value.
+// Value chỉ là một đoạn (string_view) của buffer gốc; tra cứu member/phần tử đi tuần tự và bỏ qua
+// các giá trị không cần (chuỗi dài như body base64 được nhảy qua bằng memchr, không sao chép).
+// Buffer gốc phải sống lâu hơn mọi Value lấy từ nó.
+// Chỉ kiểm tra cấu trúc (ngoặc, chuỗi), không kiểm tra chặt cú pháp số/literal như jsoncpp.
+namespace JsonScan {
+
+class Value {
+public:
+    Value() = default;
+
+    bool exists() const { return !text.empty(); }
+    bool isObject() const { return !text.empty() && text.front() == '{'; }
+    bool isArray() const { return !text.empty() && text.front() == '['; }
+    bool isString() const { return !text.empty() && text.front() == '"'; }
+
+    // Member của object; Value rỗng nếu không có hoặc không phải object
+    Value operator[](std::string_view key) const;
+
+    // Gọi f(Value) cho từng phần tử của mảng; f trả false để dừng sớm
+    template <typename F>
+    void forEach(F f) const {
+        size_t pos = 0;
+        Value element;
+        while (nextElement(pos, element)) {
+            if (!f(element)) return;
+        }
+    }
+
+    // Gọi f(name, Value) cho từng member của object, một lượt duyệt; f trả false để dừng sớm.
+    // Dùng khi cần nhiều member của cùng một object (mỗi operator[] là một lượt duyệt riêng)
+    template <typename F>
+    void forEachMember(F f) const {
+        size_t pos = 0;
+        std::string_view name;
+        Value member;
+        while (nextMember(pos, name, member)) {
+            if (!f(name, member)) return;
+        }
+    }
+
+    // Chuỗi đã bỏ escape (\n, \uXXXX...); số/literal trả nguyên văn; rỗng nếu không có
+    std::string asString() const;
+    // Số, hoặc chuỗi chứa số (Gmail gửi historyId, internalDate dưới dạng chuỗi); 0 nếu không đọc được
+    long long asInt64() const;
+    unsigned long long asUInt64() const;
+
+    // Đoạn văn bản JSON gốc của giá trị
+    std::string_view raw() const { return text; }
+    // Nội dung giữa hai dấu nháy, chưa bỏ escape; dùng cho chuỗi không bao giờ có escape
+    // (base64url, mimeType) để khỏi sao chép
+    std::string_view stringBody() const;
+
+private:
+    friend bool parse(std::string_view json, Value& root);
+    explicit Value(std::string_view text) : text(text) {}
+
+    bool nextElement(size_t& pos, Value& element) const;
+    bool nextMember(size_t& pos, std::string_view& name, Value& member) const;
+
+    std::string_view text;
+};
+
+// Kiểm tra cấu trúc toàn bộ văn bản và trả về giá trị gốc; false nếu JSON hỏng
+bool parse(std::string_view json, Value& root);
+
+// Vị trí ngay sau giá trị bắt đầu tại pos (đã bỏ khoảng trắng phía trước); npos nếu hỏng
+size_t skipValue(std::string_view json, size_t pos);
+
+}
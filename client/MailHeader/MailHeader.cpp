@@ -0,0 +1,441 @@
+#include "MailHeader.h"
+#include "MimeWalker.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace MailHeader {
+
+static bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// pos trỏ vào dấu nháy mở; trả vị trí ngay sau dấu nháy đóng, npos nếu không đóng
+static size_t skipQuoted(std::string_view text, size_t pos) {
+    for (size_t i = pos + 1; i < text.size(); i++) {
+        if (text[i] == '\\') {
+            i++;
+        }
+        else if (text[i] == '"') {
+            return i + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// pos trỏ vào '('; comment có thể lồng nhau và chứa escape
+static size_t skipComment(std::string_view text, size_t pos) {
+    int depth = 0;
+    for (size_t i = pos; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '\\') {
+            i++;
+        }
+        else if (c == '(') {
+            depth++;
+        }
+        else if (c == ')' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+static std::string_view trimWhitespace(std::string_view text) {
+    while (!text.empty() && isWhitespace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isWhitespace(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+static bool isAtext(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || strchr("!#$%&'*+-/=?^_`{|}~", c) != nullptr ||
+        static_cast<unsigned char>(c) >= 0x80;   // SMTPUTF8 (RFC 6532)
+}
+
+bool isValidAddrSpec(std::string_view addrSpec) {
+    size_t at = addrSpec.rfind('@');
+    if (at == std::string_view::npos || at == 0 || at + 1 == addrSpec.size()) {
+        return false;
+    }
+    std::string_view local = addrSpec.substr(0, at);
+    std::string_view domain = addrSpec.substr(at + 1);
+
+    if (local.front() == '"') {
+        if (skipQuoted(local, 0) != local.size()) return false;
+    }
+    else {
+        if (local.front() == '.' || local.back() == '.') return false;
+        for (size_t i = 0; i < local.size(); i++) {
+            char c = local[i];
+            if (c == '.' ? local[i - 1] == '.' : !isAtext(c)) return false;
+        }
+    }
+
+    if (domain.front() == '[') {
+        return domain.back() == ']' && domain.find_first_of("[]\\", 1) == domain.size() - 1;
+    }
+    if (domain.front() == '.' || domain.back() == '.' || domain.front() == '-') return false;
+    for (size_t i = 0; i < domain.size(); i++) {
+        char c = domain[i];
+        bool ok = std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+            static_cast<unsigned char>(c) >= 0x80 || (c == '.' && domain[i - 1] != '.');
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool AddressParser::next(Address& address) {
+    while (pos < text.size()) {
+        // Một phần tử của address-list: từ pos tới ',' (hoặc ';' đóng group) ở ngoài dấu nháy, comment, <>
+        size_t contentStart = std::string_view::npos, contentEnd = 0;   // Phần ngoài comment
+        size_t nameStart = std::string_view::npos, nameEnd = 0;         // Phần trước '<'
+        size_t commentStart = std::string_view::npos, commentEnd = 0;   // Comment đầu tiên
+        size_t angleOpen = std::string_view::npos, angleClose = std::string_view::npos;
+        bool closesGroup = false;
+        bool broken = false;
+
+        size_t i = pos;
+        while (i < text.size()) {
+            char c = text[i];
+            if (isWhitespace(c)) {
+                i++;
+                continue;
+            }
+            if (c == '(') {
+                size_t end = skipComment(text, i);
+                if (end == std::string_view::npos) { broken = true; i = text.size(); break; }
+                if (commentStart == std::string_view::npos) {
+                    commentStart = i + 1;
+                    commentEnd = end - 1;
+                }
+                i = end;
+                continue;
+            }
+            if (c == ',') {
+                break;
+            }
+            if (c == ';' && !group.empty()) {
+                closesGroup = true;
+                break;
+            }
+            if (c == ':' && group.empty() && angleOpen == std::string_view::npos &&
+                contentStart != std::string_view::npos) {
+                // "ten nhom:" mở một group; các mailbox phía sau thuộc group này
+                group = text.substr(contentStart, contentEnd - contentStart);
+                contentStart = std::string_view::npos;
+                commentStart = std::string_view::npos;
+                i++;
+                continue;
+            }
+
+            size_t tokenEnd;
+            if (c == '"') {
+                tokenEnd = skipQuoted(text, i);
+            }
+            else if (c == '<') {
+                if (angleOpen != std::string_view::npos) { broken = true; }
+                nameStart = contentStart;
+                nameEnd = contentEnd;
+                angleOpen = i;
+                // addr-spec trong <> có thể có local-part trong dấu nháy
+                tokenEnd = std::string_view::npos;
+                for (size_t j = i + 1; j < text.size(); j++) {
+                    if (text[j] == '"') {
+                        j = skipQuoted(text, j);
+                        if (j == std::string_view::npos) break;
+                        j--;
+                    }
+                    else if (text[j] == '>') {
+                        tokenEnd = j + 1;
+                        break;
+                    }
+                }
+                if (tokenEnd != std::string_view::npos) angleClose = tokenEnd - 1;
+            }
+            else {
+                tokenEnd = i + 1;
+            }
+            if (tokenEnd == std::string_view::npos) { broken = true; i = text.size(); break; }
+
+            if (contentStart == std::string_view::npos) contentStart = i;
+            contentEnd = tokenEnd;
+            i = tokenEnd;
+        }
+
+        pos = i < text.size() ? i + 1 : text.size();
+        std::string_view currentGroup = group;
+        if (closesGroup) {
+            group = std::string_view();
+        }
+        if (contentStart == std::string_view::npos) {
+            continue;   // Phần tử rỗng: ",," hoặc group rỗng "undisclosed-recipients:;"
+        }
+
+        if (broken) {
+            error = true;
+            continue;
+        }
+
+        Address candidate;
+        candidate.group = currentGroup;
+        if (angleOpen != std::string_view::npos) {
+            if (nameStart != std::string_view::npos) {
+                candidate.displayName = text.substr(nameStart, nameEnd - nameStart);
+            }
+            std::string_view spec = trimWhitespace(text.substr(angleOpen + 1, angleClose - angleOpen - 1));
+            // Bỏ source route cũ "<@relay1,@relay2:user@host>"
+            if (!spec.empty() && spec.front() == '@') {
+                size_t colon = spec.find(':');
+                spec = colon == std::string_view::npos ? std::string_view() : spec.substr(colon + 1);
+            }
+            candidate.addrSpec = spec;
+            // Không được có gì ngoài comment sau '>'
+            broken = contentEnd != angleClose + 1;
+        }
+        else {
+            // "user@host (Name)": comment đóng vai display name
+            candidate.addrSpec = text.substr(contentStart, contentEnd - contentStart);
+            if (commentStart != std::string_view::npos) {
+                candidate.displayName = text.substr(commentStart, commentEnd - commentStart);
+            }
+        }
+
+        if (broken || !isValidAddrSpec(candidate.addrSpec)) {
+            error = true;
+            continue;
+        }
+        address = candidate;
+        return true;
+    }
+    return false;
+}
+
+bool firstMailbox(std::string_view header, Address& address) {
+    AddressParser parser(header);
+    return parser.next(address);
+}
+
+std::string decodeDisplayName(std::string_view displayName) {
+    std::string out;
+    out.reserve(displayName.size());
+    bool pendingSpace = false;
+    for (size_t i = 0; i < displayName.size(); i++) {
+        char c = displayName[i];
+        if (isWhitespace(c)) {
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (c == '(') {
+            size_t end = skipComment(displayName, i);
+            i = (end == std::string_view::npos ? displayName.size() : end) - 1;
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            out += ' ';
+            pendingSpace = false;
+        }
+        if (c == '"') {
+            size_t end = skipQuoted(displayName, i);
+            size_t quotedEnd = end == std::string_view::npos ? displayName.size() : end - 1;
+            for (size_t j = i + 1; j < quotedEnd; j++) {
+                if (displayName[j] == '\\' && j + 1 < quotedEnd) j++;
+                out += displayName[j];
+            }
+            i = end == std::string_view::npos ? displayName.size() : end - 1;
+        }
+        else if (c == '\\' && i + 1 < displayName.size()) {
+            out += displayName[++i];
+        }
+        else {
+            out += c;
+        }
+    }
+    // Nhiều chương trình đặt encoded-word cả trong dấu nháy, dù RFC 2047 không cho phép
+    return decodeEncodedWords(out);
+}
+
+static std::string toLower(std::string_view text) {
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+bool parseAuthenticationResults(std::string_view value, AuthenticationResults& results) {
+    results = AuthenticationResults();
+
+    // Bỏ comment "(...)" trước, phần còn lại chỉ là token cách nhau bởi khoảng trắng và ';'
+    std::string text;
+    text.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '(') {
+            size_t end = skipComment(value, i);
+            if (end == std::string_view::npos) break;
+            text += ' ';
+            i = end - 1;
+        }
+        else if (value[i] == '"') {
+            size_t end = skipQuoted(value, i);
+            if (end == std::string_view::npos) return false;
+            text.append(value.substr(i, end - i));
+            i = end - 1;
+        }
+        else {
+            text += value[i];
+        }
+    }
+
+    std::string_view rest(text);
+    bool first = true;
+    while (!rest.empty()) {
+        size_t semicolon = rest.find(';');
+        std::string_view statement = trimWhitespace(rest.substr(0, semicolon));
+        rest = semicolon == std::string_view::npos ? std::string_view() : rest.substr(semicolon + 1);
+
+        if (first) {
+            // authserv-id [version]
+            results.authservId = toLower(statement.substr(0, statement.find_first_of(" \t\r\n")));
+            first = false;
+            if (results.authservId.empty()) return false;
+            continue;
+        }
+
+        // method[/version]=result rồi các property ptype.name=value
+        std::string method, result, domain;
+        while (!statement.empty()) {
+            size_t tokenEnd = statement.find_first_of(" \t\r\n");
+            std::string_view token = statement.substr(0, tokenEnd);
+            statement = tokenEnd == std::string_view::npos ? std::string_view() : trimWhitespace(statement.substr(tokenEnd));
+
+            size_t equals = token.find('=');
+            if (equals == std::string_view::npos) continue;
+            std::string key = toLower(token.substr(0, equals));
+            std::string_view tokenValue = token.substr(equals + 1);
+            if (tokenValue.size() >= 2 && tokenValue.front() == '"' && tokenValue.back() == '"') {
+                tokenValue = tokenValue.substr(1, tokenValue.size() - 2);
+            }
+
+            if (method.empty()) {
+                method = key.substr(0, key.find('/'));
+                result = toLower(tokenValue);
+            }
+            else if (key == "header.d") {
+                domain = toLower(tokenValue);
+            }
+            else if (key == "header.i" && domain.empty()) {
+                size_t at = tokenValue.rfind('@');
+                domain = toLower(at == std::string_view::npos ? tokenValue : tokenValue.substr(at + 1));
+            }
+        }
+
+        if (method == "dkim") {
+            if (result == "pass") {
+                results.dkim = "pass";
+                if (!domain.empty()) results.dkimPassDomains.push_back(domain);
+            }
+            else if (results.dkim.empty()) {
+                results.dkim = result;
+            }
+        }
+        else if (method == "spf" && results.spf.empty()) results.spf = result;
+        else if (method == "dmarc" && results.dmarc.empty()) results.dmarc = result;
+        else if (method == "arc" && results.arc.empty()) results.arc = result;
+    }
+    return !results.authservId.empty();
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Giải mã một encoded-word bắt đầu tại pos ("=?"); trả vị trí sau "?=", npos nếu không hợp lệ
+static size_t decodeWord(std::string_view text, size_t pos, std::string& out) {
+    size_t charsetEnd = text.find('?', pos + 2);
+    if (charsetEnd == std::string_view::npos || charsetEnd + 2 >= text.size() || text[charsetEnd + 2] != '?') {
+        return std::string_view::npos;
+    }
+    char encoding = static_cast<char>(std::toupper(static_cast<unsigned char>(text[charsetEnd + 1])));
+    size_t dataStart = charsetEnd + 3;
+    size_t dataEnd = text.find("?=", dataStart);
+    if ((encoding != 'B' && encoding != 'Q') || dataEnd == std::string_view::npos) {
+        return std::string_view::npos;
+    }
+    std::string_view data = text.substr(dataStart, dataEnd - dataStart);
+    if (data.find_first_of(" \t\r\n") != std::string_view::npos) {
+        return std::string_view::npos;
+    }
+
+    // RFC 2231: "utf-8*vi" mang thêm ngôn ngữ sau dấu '*'
+    std::string_view charsetName = text.substr(pos + 2, charsetEnd - pos - 2);
+    charsetName = charsetName.substr(0, charsetName.find('*'));
+    std::string charset(charsetName);
+    std::transform(charset.begin(), charset.end(), charset.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    std::string bytes;
+    if (encoding == 'B') {
+        bytes = base64_decode(data);
+    }
+    else {
+        bytes.reserve(data.size());
+        for (size_t i = 0; i < data.size(); i++) {
+            int high = data[i] == '=' && i + 2 < data.size() ? hexValue(data[i + 1]) : -1;
+            int low = high >= 0 ? hexValue(data[i + 2]) : -1;
+            if (data[i] == '_') {
+                bytes += ' ';
+            }
+            else if (low >= 0) {
+                bytes += static_cast<char>(high * 16 + low);
+                i += 2;
+            }
+            else {
+                bytes += data[i];
+            }
+        }
+    }
+    out += MimeWalker::toUtf8(bytes, charset);
+    return dataEnd + 2;
+}
+
+std::string decodeEncodedWords(std::string_view text) {
+    size_t first = text.find("=?");
+    if (first == std::string_view::npos) {
+        return std::string(text);
+    }
+
+    std::string out(text.substr(0, first));
+    size_t i = first;
+    size_t afterWord = std::string_view::npos;   // Vị trí ngay sau encoded-word gần nhất
+    while (i < text.size()) {
+        size_t start = text.find("=?", i);
+        if (start == std::string_view::npos) {
+            out.append(text.substr(i));
+            break;
+        }
+
+        std::string_view between = text.substr(i, start - i);
+        std::string decoded;
+        size_t end = decodeWord(text, start, decoded);
+        if (end == std::string_view::npos) {
+            out.append(text.substr(i, start + 2 - i));
+            i = start + 2;
+            afterWord = std::string_view::npos;
+            continue;
+        }
+        // Chỉ có khoảng trắng giữa hai encoded-word: bỏ khoảng trắng đó
+        if (!(afterWord == i && trimWhitespace(between).empty())) {
+            out.append(between);
+        }
+        out += decoded;
+        i = end;
+        afterWord = end;
+    }
+    return out;
+}
+
+}
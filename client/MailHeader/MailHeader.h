@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Tách header địa chỉ theo RFC 5322 (From, To, Cc, Reply-To) mà không dùng std::regex.
+// Parser không cấp phát: mọi trường của Address là view vào chuỗi header, nên header phải sống lâu hơn chúng.
+// Hiểu display name, quoted string ("Nguyen, An"), comment (có lồng nhau), group ("team: a@x, b@y;")
+// và dạng cũ "user@host (Name)". Chỉ chuỗi hiển thị mới cần giải mã (decodeDisplayName, có cấp phát).
+namespace MailHeader {
+
+struct Address {
+    std::string_view displayName;   // Nguyên văn: có thể còn dấu nháy, escape, encoded-word
+    std::string_view addrSpec;      // local@domain, đã bỏ <> và khoảng trắng
+    std::string_view group;         // Tên group chứa địa chỉ, rỗng nếu không có
+};
+
+class AddressParser {
+public:
+    explicit AddressParser(std::string_view header) : text(header), pos(0), error(false) {}
+
+    // Mailbox hợp lệ kế tiếp; phần tử sai cú pháp bị bỏ qua và đánh dấu failed()
+    bool next(Address& address);
+    bool failed() const { return error; }
+
+private:
+    std::string_view text;
+    size_t pos;
+    std::string_view group;
+    bool error;
+};
+
+// Mailbox hợp lệ đầu tiên (From thường chỉ có một)
+bool firstMailbox(std::string_view header, Address& address);
+
+// local-part "@" domain: local là dot-atom hoặc quoted string, domain là tên miền hoặc [literal]
+bool isValidAddrSpec(std::string_view addrSpec);
+
+// Display name để hiển thị: bỏ dấu nháy, escape, comment, gộp khoảng trắng, giải mã encoded-word
+std::string decodeDisplayName(std::string_view displayName);
+
+// Kết quả xác thực trong một header Authentication-Results (RFC 8601), vd
+// "mx.google.com; dkim=pass header.i=@example.com; spf=pass ...; dmarc=pass header.from=example.com".
+// Kết quả (pass, fail, none...) đã chuyển chữ thường; rỗng nếu header không có phương thức đó
+struct AuthenticationResults {
+    std::string authservId;                     // Máy chủ đã kiểm tra, vd mx.google.com
+    std::string dkim;                           // "pass" nếu có ít nhất một chữ ký hợp lệ, nếu không là kết quả đầu tiên
+    std::vector<std::string> dkimPassDomains;   // header.d (hoặc domain của header.i) của các chữ ký dkim=pass
+    std::string spf;
+    std::string dmarc;
+    std::string arc;
+};
+bool parseAuthenticationResults(std::string_view value, AuthenticationResults& results);
+
+// Giải mã encoded-word RFC 2047 (=?charset?B|Q?...?=) trong header không cấu trúc như Subject.
+// Khoảng trắng giữa hai encoded-word liền nhau bị bỏ; encoded-word hỏng được giữ nguyên
+std::string decodeEncodedWords(std::string_view text);
+
+}
@@ -0,0 +1,213 @@
+#include "MailboxSupervisor.h"
+#include "Metrics.h"
+#include "AppData.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+MailboxSupervisor::Mailbox::Mailbox(const std::string& account, EmailHandler* handler,
+    const PollConfig& config, PollScheduler::Clock clock)
+    : account(account), handler(handler), scheduler(config, clock), stats{ account, 0, 0, 0, 0, "" }
+{
+}
+
+MailboxSupervisor::MailboxSupervisor(CommandCallback onCommand, const std::string& checkpointPath,
+    int workerCount, const PollConfig& config, Clock clock)
+    : onCommand(onCommand), checkpointPath(checkpointPath), workerCount(workerCount > 0 ? workerCount : 1),
+    config(config), clock(clock), nextSeq(0), running(false), checkpoints(Json::objectValue)
+{
+    loadCheckpoints();
+}
+
+MailboxSupervisor::~MailboxSupervisor() {
+    stop();
+}
+
+long long MailboxSupervisor::now() {
+    if (clock) {
+        return clock();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string MailboxSupervisor::defaultCheckpointPath() {
+    return AppData::path("mailboxes.json");
+}
+
+void MailboxSupervisor::addMailbox(const std::string& account, EmailHandler* handler) {
+    std::lock_guard<std::mutex> checkpointLock(checkpointMutex);
+    std::string lastMessageId = checkpoints.get(account, Json::Value(Json::objectValue))
+        .get("last_message_id", "").asString();
+    if (!lastMessageId.empty()) {
+        // Thư này đã được xử lý ở lần chạy trước
+        handler->setLastProcessedId(lastMessageId);
+    }
+
+    mailboxes.emplace_back(new Mailbox(account, handler, config, clock));
+    mailboxes.back()->stats.lastMessageId = lastMessageId;
+}
+
+EmailHandler* MailboxSupervisor::getHandler(const std::string& account) {
+    for (const auto& mailbox : mailboxes) {
+        if (mailbox->account == account) {
+            return mailbox->handler.get();
+        }
+    }
+    return nullptr;
+}
+
+void MailboxSupervisor::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running || mailboxes.empty()) return;
+    running = true;
+
+    // Rải lần poll đầu trong một chu kỳ cơ bản để các tài khoản không cùng gọi Gmail một lúc
+    long long startMs = now();
+    for (size_t i = 0; i < mailboxes.size(); i++) {
+        long long offsetMs = static_cast<long long>(config.baseIntervalMs) * i / mailboxes.size();
+        queue.push({ startMs + offsetMs, nextSeq++, i });
+    }
+
+    static Metrics::Gauge& monitored = Metrics::registry().gauge(
+        "mailboxes_monitored", "Mailboxes polled by the mailbox supervisor");
+    monitored.set(static_cast<long long>(mailboxes.size()));
+
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&MailboxSupervisor::workerLoop, this);
+    }
+}
+
+void MailboxSupervisor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queue = decltype(queue)();
+}
+
+void MailboxSupervisor::workerLoop() {
+    static Metrics::Histogram& pollLag = Metrics::registry().histogram(
+        "mailbox_poll_lag_milliseconds", "How late a mailbox poll started after it was due");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (queue.empty()) {
+            // Mọi hộp thư đang được worker khác poll
+            wake.wait(lock);
+            continue;
+        }
+
+        Due next = queue.top();
+        long long nowMs = now();
+        if (next.dueMs > nowMs) {
+            wake.wait_for(lock, std::chrono::milliseconds(next.dueMs - nowMs));
+            continue;
+        }
+        queue.pop();
+        pollLag.record(static_cast<uint64_t>(nowMs - next.dueMs));
+
+        lock.unlock();
+        int delayMs = pollMailbox(*mailboxes[next.index]);
+        lock.lock();
+
+        queue.push({ now() + delayMs, nextSeq++, next.index });
+        wake.notify_one();
+    }
+}
+
+int MailboxSupervisor::pollMailbox(Mailbox& mailbox) {
+    static Metrics::Counter& polls = Metrics::registry().counter(
+        "mailbox_polls_total", "Inbox polls made by the mailbox supervisor");
+    polls.add();
+
+    EmailHandler& handler = *mailbox.handler;
+    long long quotaBefore = handler.getQuotaUnitsUsed();
+    std::string previousId = handler.getLastProcessedId();
+
+    EmailHandler::EmailInfo email = handler.readNewestEmail();
+    bool commandFound = email.isCommand();
+
+    std::string lastId = handler.getLastProcessedId();
+    if (lastId != previousId) {
+        // Lưu trước khi chạy lệnh: khởi động lại giữa chừng không chạy lệnh hai lần
+        saveCheckpoint(mailbox.account, lastId);
+    }
+    if (commandFound && onCommand) {
+        onCommand(mailbox.account, email);
+    }
+
+    std::lock_guard<std::mutex> lock(mailbox.stateMutex);
+    mailbox.scheduler.recordQuota(static_cast<int>(handler.getQuotaUnitsUsed() - quotaBefore));
+    mailbox.scheduler.onPollResult(commandFound);
+
+    PollStats pollStats = mailbox.scheduler.getStats();
+    mailbox.stats.polls = pollStats.polls;
+    mailbox.stats.commandsFound = pollStats.commandsFound;
+    mailbox.stats.quotaUnitsToday = pollStats.quotaUnitsToday;
+    mailbox.stats.lastMessageId = lastId;
+
+    int delayMs = mailbox.scheduler.nextDelayMs();
+    mailbox.stats.currentIntervalMs = delayMs;
+    return delayMs;
+}
+
+std::vector<MailboxStats> MailboxSupervisor::getStats() {
+    std::vector<MailboxStats> result;
+    for (const auto& mailbox : mailboxes) {
+        std::lock_guard<std::mutex> lock(mailbox->stateMutex);
+        result.push_back(mailbox->stats);
+    }
+    return result;
+}
+
+// Checkpoint: JSON {account: {"last_message_id": "..."}}; chỉ chứa id thư, không có token
+void MailboxSupervisor::loadCheckpoints() {
+    if (checkpointPath.empty()) return;
+    std::ifstream file(checkpointPath);
+    if (!file.is_open()) return;
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (Json::parseFromStream(readerBuilder, file, &root, &errs) && root.isObject()) {
+        checkpoints = root;
+    }
+    else {
+        std::cerr << "Ignoring unreadable mailbox checkpoints: " << checkpointPath << std::endl;
+    }
+}
+
+void MailboxSupervisor::saveCheckpoint(const std::string& account, const std::string& messageId) {
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    checkpoints[account]["last_message_id"] = messageId;
+    if (checkpointPath.empty()) return;
+
+    // Ghi file tạm rồi thay thế để không bao giờ để lại file dở dang
+    std::string tempPath = checkpointPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Unable to write mailbox checkpoints: " << tempPath << std::endl;
+            return;
+        }
+        file << Json::StyledWriter().write(checkpoints);
+    }
+#ifdef _WIN32
+    MoveFileExA(tempPath.c_str(), checkpointPath.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    std::rename(tempPath.c_str(), checkpointPath.c_str());
+#endif
+}
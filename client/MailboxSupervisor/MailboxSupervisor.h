@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "handleMail.h"
+#include "PollScheduler.h"
+
+struct MailboxStats {
+    std::string account;
+    long long polls;
+    long long commandsFound;
+    long long quotaUnitsToday;
+    int currentIntervalMs;
+    std::string lastMessageId;
+};
+
+// Theo dõi nhiều hộp thư Gmail cùng lúc trên một nhóm worker thread dùng chung.
+// - Mỗi tài khoản có PollScheduler riêng (nhịp thích ứng + quota theo người dùng của Gmail)
+// - Worker luôn lấy hộp thư đến hạn sớm nhất, mỗi hộp thư tối đa một poll đang chạy:
+//   khi quá tải, các hộp thư được poll lần lượt vòng tròn, không tài khoản nào bị bỏ đói
+// - Id thư cuối của từng tài khoản được lưu vào checkpointPath sau mỗi thay đổi
+// Email lệnh được chuyển cho onCommand (trên worker thread) cùng EmailHandler của tài khoản
+// để trả lời; việc chạy lệnh do người nhận quyết định (MainFrame chạy tuần tự trên UI thread).
+class MailboxSupervisor {
+public:
+    using CommandCallback = std::function<void(const std::string& account, const EmailHandler::EmailInfo& email)>;
+    // Thời gian đơn điệu (ms); thay được để chạy với đồng hồ ảo
+    using Clock = std::function<long long()>;
+
+    static const int DEFAULT_WORKERS = 8;
+
+    // checkpointPath rỗng: không lưu checkpoint
+    MailboxSupervisor(CommandCallback onCommand, const std::string& checkpointPath,
+        int workerCount = DEFAULT_WORKERS, const PollConfig& config = PollConfig(), Clock clock = nullptr);
+    ~MailboxSupervisor();
+    MailboxSupervisor(const MailboxSupervisor&) = delete;
+    MailboxSupervisor& operator=(const MailboxSupervisor&) = delete;
+
+    // Nhận quyền sở hữu handler. Chỉ gọi trước start()
+    void addMailbox(const std::string& account, EmailHandler* handler);
+
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Handler của một tài khoản (để gửi trả lời), nullptr nếu không có
+    EmailHandler* getHandler(const std::string& account);
+    size_t size() const { return mailboxes.size(); }
+
+    std::vector<MailboxStats> getStats();
+
+    // %APPDATA%\EmailPCControl\mailboxes.json
+    static std::string defaultCheckpointPath();
+
+private:
+    struct Mailbox {
+        std::string account;
+        std::unique_ptr<EmailHandler> handler;
+        std::mutex stateMutex;          // Bảo vệ scheduler và stats (getStats đọc từ thread khác)
+        PollScheduler scheduler;
+        MailboxStats stats;
+
+        Mailbox(const std::string& account, EmailHandler* handler, const PollConfig& config,
+            PollScheduler::Clock clock);
+    };
+
+    // Lịch poll: hộp thư đến hạn sớm nhất trước; seq phá hòa theo thứ tự vào hàng
+    struct Due {
+        long long dueMs;
+        unsigned long long seq;
+        size_t index;
+        bool operator>(const Due& other) const {
+            return dueMs != other.dueMs ? dueMs > other.dueMs : seq > other.seq;
+        }
+    };
+
+    long long now();
+    void workerLoop();
+    // Poll một hộp thư, trả về khoảng chờ tới lần poll sau
+    int pollMailbox(Mailbox& mailbox);
+    void loadCheckpoints();
+    void saveCheckpoint(const std::string& account, const std::string& messageId);
+
+    CommandCallback onCommand;
+    std::string checkpointPath;
+    int workerCount;
+    PollConfig config;
+    Clock clock;
+
+    std::vector<std::unique_ptr<Mailbox>> mailboxes;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> queue;
+    unsigned long long nextSeq;
+    std::atomic<bool> running;
+    std::vector<std::thread> workers;
+
+    std::mutex checkpointMutex;
+    Json::Value checkpoints;
+};
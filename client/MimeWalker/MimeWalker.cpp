@@ -0,0 +1,363 @@
+#include "MimeWalker.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace MimeWalker {
+
+static std::string toLower(std::string_view text) {
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+static bool endsWithNoCase(const std::string& text, std::string_view suffix) {
+    return text.size() >= suffix.size() &&
+        toLower(std::string_view(text).substr(text.size() - suffix.size())) == suffix;
+}
+
+static void appendUtf8(std::string& out, unsigned long codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x110000) {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+std::string_view Part::inlineData() const {
+    return body["data"].stringBody();
+}
+
+std::string Part::attachmentId() const {
+    return body["attachmentId"].asString();
+}
+
+long long Part::size() const {
+    return body["size"].asInt64();
+}
+
+std::string headerParam(std::string_view headerValue, std::string_view name) {
+    size_t pos = headerValue.find(';');
+    while (pos != std::string_view::npos) {
+        size_t start = pos + 1;
+        while (start < headerValue.size() && (headerValue[start] == ' ' || headerValue[start] == '\t')) {
+            start++;
+        }
+        size_t equals = headerValue.find('=', start);
+        if (equals == std::string_view::npos) {
+            break;
+        }
+        std::string_view paramName = headerValue.substr(start, equals - start);
+        while (!paramName.empty() && (paramName.back() == ' ' || paramName.back() == '\t')) {
+            paramName.remove_suffix(1);
+        }
+
+        bool wanted = toLower(paramName) == name;
+        size_t valueStart = equals + 1;
+        if (valueStart < headerValue.size() && headerValue[valueStart] == '"') {
+            // Quoted string: \x là ký tự x (filename="a \"b\".txt")
+            std::string value;
+            size_t i = valueStart + 1;
+            for (; i < headerValue.size() && headerValue[i] != '"'; i++) {
+                if (headerValue[i] == '\\' && i + 1 < headerValue.size()) i++;
+                if (wanted) value += headerValue[i];
+            }
+            if (wanted) return value;
+            pos = headerValue.find(';', i);
+        }
+        else {
+            size_t valueEnd = headerValue.find(';', valueStart);
+            pos = valueEnd;
+            if (valueEnd == std::string_view::npos) valueEnd = headerValue.size();
+            while (valueEnd > valueStart && (headerValue[valueEnd - 1] == ' ' || headerValue[valueEnd - 1] == '\t')) {
+                valueEnd--;
+            }
+            if (wanted) return std::string(headerValue.substr(valueStart, valueEnd - valueStart));
+        }
+    }
+    return "";
+}
+
+static bool walkPart(const JsonScan::Value& node, int depth, const std::function<bool(const Part&)>& visit) {
+    Part part;
+    part.node = node;
+    part.depth = depth;
+
+    JsonScan::Value headers, children;
+    node.forEachMember([&](std::string_view name, const JsonScan::Value& value) {
+        if (name == "mimeType") part.mimeType = toLower(value.stringBody());
+        else if (name == "filename") part.filename = value.asString();
+        else if (name == "headers") headers = value;
+        else if (name == "parts") children = value;
+        else if (name == "body") part.body = value;
+        return true;
+    });
+
+    headers.forEach([&](const JsonScan::Value& header) {
+        std::string name = toLower(header["name"].stringBody());
+        if (name == "content-type") {
+            part.charset = toLower(headerParam(header["value"].asString(), "charset"));
+        }
+        else if (name == "content-transfer-encoding") {
+            part.transferEncoding = toLower(trim(header["value"].asString()));
+        }
+        else if (name == "content-disposition") {
+            std::string disposition = header["value"].asString();
+            if (toLower(trim(disposition)).compare(0, 10, "attachment") == 0) {
+                part.attachment = true;
+            }
+            if (part.filename.empty()) {
+                part.filename = headerParam(disposition, "filename");
+            }
+        }
+        return true;
+    });
+    if (!part.filename.empty()) {
+        part.attachment = true;
+    }
+
+    if (!visit(part)) {
+        return false;
+    }
+    if (depth >= MAX_DEPTH) {
+        return true;
+    }
+
+    bool keepGoing = true;
+    children.forEach([&](const JsonScan::Value& child) {
+        keepGoing = walkPart(child, depth + 1, visit);
+        return keepGoing;
+    });
+    return keepGoing;
+}
+
+void walk(const JsonScan::Value& payload, const std::function<bool(const Part&)>& visit) {
+    if (payload.isObject()) {
+        walkPart(payload, 0, visit);
+    }
+}
+
+Selection select(const JsonScan::Value& payload) {
+    Selection selection;
+    walk(payload, [&](const Part& part) {
+        if (part.isMultipart()) {
+            return true;
+        }
+        if (part.attachment) {
+            if (endsWithNoCase(part.filename, ".txt")) {
+                selection.commandFiles.push_back(part);
+            }
+            return true;
+        }
+        // text/plain đầu tiên thắng; text/html chỉ dùng khi thư không có text/plain
+        if (part.mimeType == "text/plain" && !(selection.hasText && selection.text.mimeType == "text/plain")) {
+            selection.text = part;
+            selection.hasText = true;
+        }
+        else if (part.mimeType == "text/html" && !selection.hasText) {
+            selection.text = part;
+            selection.hasText = true;
+        }
+        return true;
+    });
+    return selection;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+std::string decodeQuotedPrintable(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c != '=') {
+            out += c;
+            continue;
+        }
+        // Soft line break: "=" ở cuối dòng nối hai dòng lại
+        if (i + 1 < text.size() && text[i + 1] == '\n') {
+            i += 1;
+            continue;
+        }
+        if (i + 2 < text.size() && text[i + 1] == '\r' && text[i + 2] == '\n') {
+            i += 2;
+            continue;
+        }
+        int high = i + 1 < text.size() ? hexValue(text[i + 1]) : -1;
+        int low = i + 2 < text.size() ? hexValue(text[i + 2]) : -1;
+        if (high < 0 || low < 0) {
+            out += c;   // "=" không đúng cú pháp: giữ nguyên
+            continue;
+        }
+        out += static_cast<char>(high * 16 + low);
+        i += 2;
+    }
+    return out;
+}
+
+// Mã Unicode của byte 0x80-0x9F trong windows-1252 (các byte còn lại trùng với iso-8859-1)
+static const unsigned short CP1252_HIGH[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+#ifdef _WIN32
+static unsigned int codePageFor(const std::string& charset) {
+    static const struct { const char* name; unsigned int codePage; } known[] = {
+        { "windows-1250", 1250 }, { "windows-1251", 1251 }, { "windows-1253", 1253 },
+        { "windows-1254", 1254 }, { "windows-1255", 1255 }, { "windows-1256", 1256 },
+        { "windows-1257", 1257 }, { "windows-1258", 1258 },
+        { "iso-8859-2", 28592 }, { "iso-8859-5", 28595 }, { "iso-8859-7", 28597 },
+        { "iso-8859-15", 28605 }, { "koi8-r", 20866 }, { "shift_jis", 932 },
+        { "gb2312", 936 }, { "gbk", 936 }, { "big5", 950 }, { "euc-kr", 949 },
+        { "ks_c_5601-1987", 949 }, { "iso-2022-jp", 50220 }
+    };
+    for (const auto& entry : known) {
+        if (charset == entry.name) return entry.codePage;
+    }
+    return 0;
+}
+#endif
+
+std::string toUtf8(std::string_view text, const std::string& charset) {
+    if (charset.empty() || charset == "utf-8" || charset == "utf8" ||
+        charset == "us-ascii" || charset == "ascii") {
+        return std::string(text);
+    }
+
+    // Như trình duyệt: iso-8859-1 được đọc theo windows-1252
+    if (charset == "iso-8859-1" || charset == "latin1" || charset == "windows-1252" || charset == "cp1252") {
+        std::string out;
+        out.reserve(text.size() + text.size() / 4);
+        for (unsigned char c : text) {
+            appendUtf8(out, c >= 0x80 && c < 0xA0 ? CP1252_HIGH[c - 0x80] : c);
+        }
+        return out;
+    }
+
+#ifdef _WIN32
+    unsigned int codePage = codePageFor(charset);
+    if (codePage != 0 && !text.empty()) {
+        int wideLength = MultiByteToWideChar(codePage, 0, text.data(), static_cast<int>(text.size()), nullptr, 0);
+        if (wideLength > 0) {
+            std::wstring wide(wideLength, L'\0');
+            MultiByteToWideChar(codePage, 0, text.data(), static_cast<int>(text.size()), &wide[0], wideLength);
+            int utf8Length = WideCharToMultiByte(CP_UTF8, 0, wide.data(), wideLength, nullptr, 0, nullptr, nullptr);
+            std::string out(utf8Length, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, wide.data(), wideLength, &out[0], utf8Length, nullptr, nullptr);
+            return out;
+        }
+    }
+#endif
+    return std::string(text);
+}
+
+std::string htmlToText(std::string_view html) {
+    static const struct { const char* entity; const char* text; } entities[] = {
+        { "&nbsp;", " " }, { "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" },
+        { "&quot;", "\"" }, { "&#39;", "'" }, { "&apos;", "'" }
+    };
+
+    std::string out;
+    out.reserve(html.size());
+    for (size_t i = 0; i < html.size(); i++) {
+        char c = html[i];
+        if (c == '<') {
+            size_t close = html.find('>', i);
+            if (close == std::string_view::npos) break;
+            std::string tag = toLower(html.substr(i + 1, close - i - 1));
+            size_t nameEnd = tag.find_first_of(" \t\r\n/", tag[0] == '/' ? 1 : 0);
+            std::string name = tag.substr(0, nameEnd);
+
+            if (name == "style" || name == "script" || name == "head") {
+                // Bỏ cả nội dung của thẻ
+                std::string lowerRest = toLower(html.substr(close));
+                size_t end = lowerRest.find("</" + name);
+                if (end == std::string::npos) break;
+                close = html.find('>', close + end);
+                if (close == std::string_view::npos) break;
+            }
+            else if (name == "br" || name == "p" || name == "/p" || name == "div" || name == "/div" ||
+                name == "/tr" || name == "li") {
+                if (!out.empty() && out.back() != '\n') out += '\n';
+            }
+            i = close;
+            continue;
+        }
+        if (c == '&') {
+            bool replaced = false;
+            for (const auto& entry : entities) {
+                size_t length = strlen(entry.entity);
+                if (html.compare(i, length, entry.entity) == 0) {
+                    out += entry.text;
+                    i += length - 1;
+                    replaced = true;
+                    break;
+                }
+            }
+            // &#NNN; và &#xHH;
+            if (!replaced && i + 2 < html.size() && html[i + 1] == '#') {
+                size_t semicolon = html.find(';', i);
+                if (semicolon != std::string_view::npos && semicolon - i <= 10) {
+                    bool hex = html[i + 2] == 'x' || html[i + 2] == 'X';
+                    std::string digits(html.substr(i + (hex ? 3 : 2), semicolon - i - (hex ? 3 : 2)));
+                    char* end = nullptr;
+                    unsigned long codePoint = strtoul(digits.c_str(), &end, hex ? 16 : 10);
+                    if (!digits.empty() && end && *end == '\0') {
+                        appendUtf8(out, codePoint);
+                        i = semicolon;
+                        replaced = true;
+                    }
+                }
+            }
+            if (replaced) continue;
+        }
+        if (c == '\r' || c == '\n') {
+            // Xuống dòng trong mã HTML chỉ là khoảng trắng
+            if (!out.empty() && out.back() != ' ' && out.back() != '\n') out += ' ';
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string decodeText(const Part& part, std::string_view base64Data) {
+    std::string text = base64_decode(base64Data);
+    if (part.transferEncoding == "quoted-printable") {
+        text = decodeQuotedPrintable(text);
+    }
+    text = toUtf8(text, part.charset);
+    if (part.mimeType == "text/html") {
+        text = htmlToText(text);
+    }
+    return text;
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "JsonScan.h"
+
+// Duyệt cây MIME trong payload của Gmail API (messages.get?format=full).
+// Thư trả lời từ điện thoại thường lồng text/plain trong multipart/alternative bên trong multipart/mixed,
+// nên phải đi hết cây chứ không chỉ một tầng payload.parts.
+// Part chỉ giữ JsonScan::Value (view vào buffer JSON gốc): không sao chép cây con hay body base64.
+namespace MimeWalker {
+
+// Giới hạn độ sâu lồng nhau để thư cố tình lồng vô hạn không làm tràn stack
+static const int MAX_DEPTH = 32;
+
+struct Part {
+    JsonScan::Value node;           // Object part trong JSON
+    JsonScan::Value body;           // {"size", "data"?, "attachmentId"?}
+    std::string mimeType;           // Chữ thường, vd "text/plain"
+    std::string filename;
+    std::string charset;            // Tham số charset của Content-Type, chữ thường; rỗng nếu không có
+    std::string transferEncoding;   // Content-Transfer-Encoding, chữ thường
+    bool attachment = false;        // Có filename hoặc Content-Disposition: attachment
+    int depth = 0;                  // 0 = payload
+
+    bool isMultipart() const { return mimeType.compare(0, 10, "multipart/") == 0; }
+    // Dữ liệu base64url nằm sẵn trong thư (rỗng nếu Gmail chỉ trả attachmentId)
+    std::string_view inlineData() const;
+    std::string attachmentId() const;
+    long long size() const;
+};
+
+// Gọi visit cho từng part theo thứ tự trong thư (cha trước con); visit trả false để dừng
+void walk(const JsonScan::Value& payload, const std::function<bool(const Part&)>& visit);
+
+// Nội dung nên đọc của một thư
+struct Selection {
+    bool hasText = false;
+    Part text;                          // text/plain đầu tiên không phải file đính kèm, nếu không có thì text/html
+    std::vector<Part> commandFiles;     // File .txt đính kèm (có thể chứa lệnh)
+};
+Selection select(const JsonScan::Value& payload);
+
+// base64url -> bỏ transfer encoding -> UTF-8; text/html được chuyển thành văn bản thường
+std::string decodeText(const Part& part, std::string_view base64Data);
+
+std::string decodeQuotedPrintable(std::string_view text);
+// Chuyển từ charset của part sang UTF-8. utf-8/us-ascii giữ nguyên; iso-8859-1 và windows-1252
+// chuyển được ở mọi nơi, charset khác dùng MultiByteToWideChar trên Windows; không biết thì giữ nguyên
+std::string toUtf8(std::string_view text, const std::string& charset);
+// Bỏ thẻ HTML, đổi <br>/<p>/<div> thành xuống dòng và giải mã vài entity thường gặp
+std::string htmlToText(std::string_view html);
+
+// Giá trị (đã bỏ dấu nháy) của một tham số trong header dạng "type; name=value", vd charset, filename.
+// name phải là chữ thường
+std::string headerParam(std::string_view headerValue, std::string_view name);
+
+}
@@ -0,0 +1,451 @@
+#include "PolicyEngine.h"
+#include "MailHeader.h"
+#include "CommandRegistry.h"
+#include "Metrics.h"
+#include "AppData.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+static_assert(COMMAND_COUNT < 31, "Command mask has no room for the unknown-command bit");
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+static Metrics::Counter& decisionCounter(const char* decision) {
+    return Metrics::registry().counter("policy_decisions_total",
+        "Command emails allowed or rejected by the sender policy", std::string("decision=\"") + decision + "\"");
+}
+
+PolicyEngine::PolicyEngine(const std::string& path, Clock clock)
+    : path(path), clock(clock), policy(builtInPolicy()), loadedWriteTime(-1), loadedSize(-1), usingString(false)
+{
+    reloadIfChanged();
+}
+
+std::string PolicyEngine::defaultPath() {
+    return AppData::path("policy.json");
+}
+
+long long PolicyEngine::now() {
+    if (clock) {
+        return clock();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::shared_ptr<PolicyEngine::CompiledPolicy> PolicyEngine::builtInPolicy() {
+    // Chưa cấu hình: chỉ chính chủ hộp thư được ra lệnh
+    auto builtIn = std::make_shared<CompiledPolicy>();
+    Rule self{ 0, true, AuthRequirement::NotFail, true, {}, 0xFFFFFFFFul, false, RateLimit() };
+    builtIn->rules.push_back(self);
+    builtIn->self.push_back(0);
+    return builtIn;
+}
+
+void PolicyEngine::reloadIfChanged() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.empty() || usingString) return;
+
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        if (loadedSize != -1) {
+            // policy.json bị xóa: quay về luật mặc định
+            policy = builtInPolicy();
+            loadedWriteTime = -1;
+            loadedSize = -1;
+        }
+        return;
+    }
+    if (static_cast<long long>(info.st_mtime) == loadedWriteTime && static_cast<long long>(info.st_size) == loadedSize) {
+        return;     // Dùng lại luật đã biên dịch
+    }
+    loadedWriteTime = static_cast<long long>(info.st_mtime);
+    loadedSize = static_cast<long long>(info.st_size);
+
+    std::ifstream file(path);
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string error;
+    std::shared_ptr<CompiledPolicy> compiled;
+    if (!file.is_open()) {
+        error = "cannot open file";
+    }
+    else if (!Json::parseFromStream(readerBuilder, file, &root, &error)) {
+        error = "invalid JSON: " + error;
+    }
+    else {
+        compiled = compile(root, error);
+    }
+
+    if (!compiled) {
+        // Giữ luật đang dùng; chỉ báo một lần cho mỗi lần file đổi
+        std::cerr << "Ignoring " << path << ": " << error << std::endl;
+        return;
+    }
+    policy = compiled;
+}
+
+bool PolicyEngine::loadFromString(const std::string& json, std::string& error) {
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    if (!reader->parse(json.data(), json.data() + json.size(), &root, &error)) {
+        error = "invalid JSON: " + error;
+        return false;
+    }
+    std::shared_ptr<CompiledPolicy> compiled = compile(root, error);
+    if (!compiled) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    policy = compiled;
+    usingString = true;
+    return true;
+}
+
+size_t PolicyEngine::ruleCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return policy->rules.size();
+}
+
+bool PolicyEngine::parseRateLimit(const Json::Value& value, RateLimit& limit) {
+    if (!value.isObject()) return false;
+    limit.perMinute = value.get("per_minute", limit.perMinute).asDouble();
+    limit.burst = value.get("burst", limit.burst).asDouble();
+    return limit.perMinute > 0 && limit.burst >= 1;
+}
+
+std::shared_ptr<PolicyEngine::CompiledPolicy> PolicyEngine::compile(const Json::Value& root, std::string& error) {
+    if (!root.isObject() || !root["rules"].isArray()) {
+        error = "expected an object with a \"rules\" array";
+        return nullptr;
+    }
+
+    auto compiled = std::make_shared<CompiledPolicy>();
+    compiled->authservId = toLower(root.get("authserv_id", compiled->authservId).asString());
+    std::string defaultAction = root.get("default", "deny").asString();
+    if (defaultAction != "allow" && defaultAction != "deny") {
+        error = "\"default\" must be \"allow\" or \"deny\"";
+        return nullptr;
+    }
+    compiled->defaultAllow = defaultAction == "allow";
+    if (root.isMember("rate_limit") && !parseRateLimit(root["rate_limit"], compiled->rateLimit)) {
+        error = "invalid \"rate_limit\"";
+        return nullptr;
+    }
+
+    const Json::Value& rules = root["rules"];
+    compiled->rules.reserve(rules.size());
+    for (Json::ArrayIndex i = 0; i < rules.size(); i++) {
+        if (!compileRule(rules[i], i, *compiled, error)) {
+            error = "rule " + std::to_string(i + 1) + ": " + error;
+            return nullptr;
+        }
+    }
+    return compiled;
+}
+
+bool PolicyEngine::compileRule(const Json::Value& value, size_t order, CompiledPolicy& policy, std::string& error) {
+    if (!value.isObject() || !value["senders"].isArray() || value["senders"].empty()) {
+        error = "\"senders\" must be a non-empty array";
+        return false;
+    }
+
+    Rule rule{ order, true, AuthRequirement::None, false, {}, 0, false, RateLimit() };
+
+    std::string action = value.get("action", "allow").asString();
+    if (action != "allow" && action != "deny") {
+        error = "\"action\" must be \"allow\" or \"deny\"";
+        return false;
+    }
+    rule.allow = action == "allow";
+
+    std::string auth = value.get("auth", "none").asString();
+    if (auth == "pass") rule.auth = AuthRequirement::Pass;
+    else if (auth == "not_fail") rule.auth = AuthRequirement::NotFail;
+    else if (auth != "none") {
+        error = "\"auth\" must be \"pass\", \"not_fail\" or \"none\"";
+        return false;
+    }
+
+    if (!value.isMember("targets")) {
+        rule.anyTarget = true;
+    }
+    else if (!value["targets"].isArray()) {
+        error = "\"targets\" must be an array";
+        return false;
+    }
+    for (const Json::Value& target : value["targets"]) {
+        std::string text = target.asString();
+        if (text == "*") {
+            rule.anyTarget = true;
+            continue;
+        }
+        size_t slash = text.find('/');
+        int prefix = 32;
+        if (slash != std::string::npos) {
+            char* end = nullptr;
+            prefix = static_cast<int>(strtol(text.c_str() + slash + 1, &end, 10));
+            if (*end != '\0' || slash + 1 == text.size() || prefix < 0 || prefix > 32) {
+                error = "invalid target " + text;
+                return false;
+            }
+        }
+        unsigned long address;
+        if (!parseIPv4(text.substr(0, slash), address)) {
+            error = "invalid target " + text;
+            return false;
+        }
+        unsigned long mask = prefix == 0 ? 0 : (0xFFFFFFFFul << (32 - prefix)) & 0xFFFFFFFFul;
+        rule.networks.push_back({ address & mask, mask });
+    }
+
+    if (!value.isMember("commands")) {
+        rule.commandMask = 0xFFFFFFFFul;
+    }
+    else if (!value["commands"].isArray()) {
+        error = "\"commands\" must be an array";
+        return false;
+    }
+    static const struct { const char* name; CommandClass commandClass; } classes[] = {
+        { "introspection", CommandClass::Introspection }, { "transfer", CommandClass::Transfer },
+        { "device", CommandClass::Device }, { "control", CommandClass::Control }, { "power", CommandClass::Power }
+    };
+    for (const Json::Value& command : value["commands"]) {
+        std::string name = toLower(command.asString());
+        if (name == "*") {
+            rule.commandMask = 0xFFFFFFFFul;
+            continue;
+        }
+        if (const CommandSpec* spec = findCommand(name)) {
+            rule.commandMask |= 1ul << static_cast<int>(spec->id);
+            continue;
+        }
+        bool isClass = false;
+        for (const auto& entry : classes) {
+            if (name != entry.name) continue;
+            isClass = true;
+            for (const CommandSpec& spec : COMMAND_TABLE) {
+                if (spec.commandClass == entry.commandClass) {
+                    rule.commandMask |= 1ul << static_cast<int>(spec.id);
+                }
+            }
+        }
+        if (!isClass) {
+            error = "unknown command or command class " + name;
+            return false;
+        }
+    }
+
+    if (value.isMember("rate_limit")) {
+        rule.rateLimit = policy.rateLimit;
+        if (!parseRateLimit(value["rate_limit"], rule.rateLimit)) {
+            error = "invalid \"rate_limit\"";
+            return false;
+        }
+        rule.hasRateLimit = true;
+    }
+
+    size_t index = policy.rules.size();
+    for (const Json::Value& sender : value["senders"]) {
+        std::string pattern = toLower(sender.asString());
+        if (pattern == "$self") policy.self.push_back(index);
+        else if (pattern == "*") policy.anySender.push_back(index);
+        else if (pattern.compare(0, 4, "*@*.") == 0 && pattern.size() > 4) policy.bySubdomain[pattern.substr(4)].push_back(index);
+        else if (pattern.compare(0, 2, "*@") == 0 && pattern.size() > 2) policy.byDomain[pattern.substr(2)].push_back(index);
+        else if (MailHeader::isValidAddrSpec(pattern)) policy.byAddress[pattern].push_back(index);
+        else {
+            error = "invalid sender pattern " + pattern;
+            return false;
+        }
+    }
+    policy.rules.push_back(rule);
+    return true;
+}
+
+bool PolicyEngine::parseIPv4(const std::string& text, unsigned long& address) {
+    unsigned long result = 0;
+    int parts = 0;
+    size_t pos = 0;
+    while (parts < 4) {
+        size_t end = text.find('.', pos);
+        std::string part = text.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        if (part.empty() || part.size() > 3 || part.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        unsigned long octet = std::stoul(part);
+        if (octet > 255) return false;
+        result = (result << 8) | octet;
+        parts++;
+        if (end == std::string::npos) break;
+        pos = end + 1;
+    }
+    if (parts != 4 || text.find('.', pos) != std::string::npos) return false;
+    address = result;
+    return true;
+}
+
+bool PolicyEngine::authSatisfied(AuthRequirement requirement, const std::string& senderDomain,
+    const std::string& authenticationResults, const std::string& authservId) {
+    if (requirement == AuthRequirement::None) {
+        return true;
+    }
+
+    // Header của máy chủ khác (hoặc do người gửi chèn vào) không được tính
+    MailHeader::AuthenticationResults results;
+    bool trusted = MailHeader::parseAuthenticationResults(authenticationResults, results) &&
+        results.authservId == authservId;
+
+    bool alignedDkim = false;
+    if (trusted) {
+        for (const std::string& domain : results.dkimPassDomains) {
+            if (senderDomain == domain ||
+                (senderDomain.size() > domain.size() &&
+                    senderDomain.compare(senderDomain.size() - domain.size(), domain.size(), domain) == 0 &&
+                    senderDomain[senderDomain.size() - domain.size() - 1] == '.')) {
+                alignedDkim = true;
+                break;
+            }
+        }
+    }
+
+    if (requirement == AuthRequirement::Pass) {
+        return trusted && (alignedDkim || results.dmarc == "pass" || results.arc == "pass");
+    }
+
+    // NotFail: thư nội bộ của Gmail (gửi cho chính mình) không có header nào, vẫn được chấp nhận
+    if (!trusted) {
+        return true;
+    }
+    if (results.dmarc == "fail") {
+        return false;
+    }
+    return alignedDkim || (results.dkim != "fail" && results.spf != "fail");
+}
+
+bool PolicyEngine::takeToken(const std::string& sender, const RateLimit& limit) {
+    long long nowMs = now();
+    if (buckets.size() >= MAX_TRACKED_SENDERS && buckets.find(sender) == buckets.end()) {
+        // Bỏ các bucket đã đầy lại (người gửi im lặng đủ lâu); tính theo giới hạn hiện tại nên
+        // bucket của luật có giới hạn khác có thể bị bỏ sớm, tức là chỉ nới lỏng chứ không chặn nhầm
+        for (auto it = buckets.begin(); it != buckets.end();) {
+            double refill = (nowMs - it->second.updatedMs) * limit.perMinute / 60000.0;
+            it = it->second.tokens + refill >= limit.burst ? buckets.erase(it) : std::next(it);
+        }
+    }
+
+    auto inserted = buckets.emplace(sender, Bucket{ limit.burst, nowMs });
+    Bucket& bucket = inserted.first->second;
+    bucket.tokens = std::min(limit.burst, bucket.tokens + (nowMs - bucket.updatedMs) * limit.perMinute / 60000.0);
+    bucket.updatedMs = nowMs;
+    if (bucket.tokens < 1) {
+        return false;
+    }
+    bucket.tokens -= 1;
+    return true;
+}
+
+PolicyEngine::Decision PolicyEngine::evaluate(const Request& request) {
+    static Metrics::Counter& allowed = decisionCounter("allow");
+    static Metrics::Counter& denied = decisionCounter("deny");
+    static Metrics::Counter& rateLimited = decisionCounter("rate_limited");
+
+    reloadIfChanged();
+    std::shared_ptr<CompiledPolicy> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = policy;
+    }
+
+    std::string sender = toLower(request.sender);
+    size_t at = sender.rfind('@');
+    if (at == std::string::npos || request.targets.empty() || request.commands.empty()) {
+        denied.add();
+        return { false, "Nothing to authorize for sender '" + request.sender + "'" };
+    }
+    std::string domain = sender.substr(at + 1);
+
+    // Luật ứng viên theo người gửi, giữ thứ tự khai báo
+    std::vector<size_t> candidates;
+    auto collect = [&](const std::unordered_map<std::string, std::vector<size_t>>& index, const std::string& key) {
+        auto it = index.find(key);
+        if (it != index.end()) candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    };
+    collect(current->byAddress, sender);
+    collect(current->byDomain, domain);
+    for (size_t dot = domain.find('.'); dot != std::string::npos; dot = domain.find('.', dot + 1)) {
+        collect(current->bySubdomain, domain.substr(dot + 1));
+    }
+    if (sender == toLower(request.mailboxAccount)) {
+        candidates.insert(candidates.end(), current->self.begin(), current->self.end());
+    }
+    candidates.insert(candidates.end(), current->anySender.begin(), current->anySender.end());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Điều kiện xác thực không phụ thuộc server/lệnh: lọc một lần
+    std::vector<const Rule*> rules;
+    rules.reserve(candidates.size());
+    for (size_t index : candidates) {
+        const Rule& rule = current->rules[index];
+        if (authSatisfied(rule.auth, domain, request.authenticationResults, current->authservId)) {
+            rules.push_back(&rule);
+        }
+    }
+
+    std::vector<unsigned long> commandBits;
+    commandBits.reserve(request.commands.size());
+    for (const std::string& command : request.commands) {
+        ParsedCommand parsed = parseCommand(command);
+        commandBits.push_back(1ul << (parsed.valid() ? static_cast<int>(parsed.spec->id) : UNKNOWN_COMMAND_BIT));
+    }
+
+    const Rule* limitRule = nullptr;
+    for (const Target& target : request.targets) {
+        unsigned long address = 0;
+        bool hasAddress = parseIPv4(target.ip, address);
+        for (size_t i = 0; i < commandBits.size(); i++) {
+            const Rule* match = nullptr;
+            for (const Rule* rule : rules) {
+                if (!(rule->commandMask & commandBits[i])) continue;
+                bool targetMatches = rule->anyTarget;
+                for (size_t n = 0; !targetMatches && hasAddress && n < rule->networks.size(); n++) {
+                    targetMatches = (address & rule->networks[n].second) == rule->networks[n].first;
+                }
+                if (targetMatches) {
+                    match = rule;
+                    break;
+                }
+            }
+
+            bool allow = match ? match->allow : current->defaultAllow;
+            if (!allow) {
+                denied.add();
+                std::string by = match ? "rule " + std::to_string(match->order + 1) : "the default policy";
+                return { false, "'" + request.commands[i] + "' on " + target.ip + " from " + request.sender +
+                    " denied by " + by };
+            }
+            if (match && match->hasRateLimit && !limitRule) {
+                limitRule = match;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!takeToken(sender, limitRule ? limitRule->rateLimit : current->rateLimit)) {
+        rateLimited.add();
+        return { false, "Too many command emails from " + request.sender };
+    }
+    allowed.add();
+    return { true, "" };
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <json/json.h>
+
+// Quyết định một email lệnh có được chạy hay không, trước khi mở bất kỳ kết nối nào tới server.
+// Luật đọc từ policy.json (%APPDATA%\EmailPCControl\policy.json), biên dịch một lần và giữ lại
+// tới khi file thay đổi. Ví dụ:
+// {
+//     "authserv_id": "mx.google.com",
+//     "default": "deny",
+//     "rate_limit": { "per_minute": 6, "burst": 3 },
+//     "rules": [
+//         { "senders": ["$self"], "auth": "not_fail" },
+//         { "senders": ["*@company.com"], "auth": "pass",
+//           "targets": ["192.168.1.0/24"], "commands": ["introspection", "screenshot::capture"] },
+//         { "senders": ["intern@company.com"], "commands": ["power"], "action": "deny" }
+//     ]
+// }
+// - senders: địa chỉ, "*@domain", "*@*.domain" (mọi subdomain), "$self" (chính hộp thư nhận lệnh), "*"
+// - auth: "pass" = DKIM hợp lệ của domain người gửi (hoặc domain cha) hoặc DMARC/ARC pass;
+//         "not_fail" = không có kết quả fail nào; "none" (mặc định) = không kiểm tra
+// - targets: IP, dải CIDR hoặc "*" (mặc định); commands: tên lệnh, nhóm lệnh hoặc "*" (mặc định)
+// Với mỗi cặp (server, lệnh) trong email, luật đầu tiên khớp quyết định; không luật nào khớp thì dùng
+// "default". Email chỉ được chạy khi mọi cặp đều được phép, sau đó còn bị giới hạn tần suất theo người gửi.
+// Không có policy.json: chỉ nhận lệnh từ chính hộp thư, không có kết quả xác thực fail.
+class PolicyEngine {
+public:
+    using Clock = std::function<long long()>;   // Mili giây đơn điệu; thay được khi đo/kiểm tra
+
+    struct Target {
+        std::string ip;
+    };
+
+    struct Request {
+        std::string sender;                 // addr-spec của From
+        std::string mailboxAccount;         // Hộp thư nhận email (cho "$self")
+        std::string authenticationResults;  // Header Authentication-Results trên cùng
+        std::vector<Target> targets;
+        std::vector<std::string> commands;  // Dòng lệnh, vd "file::get C:\\a.txt"
+    };
+
+    struct Decision {
+        bool allowed;
+        std::string reason;     // Lý do từ chối, để ghi log
+    };
+
+    struct RateLimit {
+        double perMinute = 6;
+        double burst = 3;
+    };
+
+    // path rỗng: chỉ dùng luật mặc định (hoặc luật nạp bằng loadFromString)
+    explicit PolicyEngine(const std::string& path = defaultPath(), Clock clock = nullptr);
+
+    // %APPDATA%\EmailPCControl\policy.json
+    static std::string defaultPath();
+
+    // Biên dịch lại nếu policy.json đổi từ lần trước (so thời điểm sửa và kích thước)
+    void reloadIfChanged();
+    // Dùng luật trong chuỗi JSON thay cho file; false nếu sai cú pháp (giữ luật cũ)
+    bool loadFromString(const std::string& json, std::string& error);
+
+    Decision evaluate(const Request& request);
+
+    size_t ruleCount();
+
+private:
+    static const int UNKNOWN_COMMAND_BIT = 31;      // Lệnh không có trong bảng: chỉ "*" khớp
+    static const size_t MAX_TRACKED_SENDERS = 10000;
+
+    enum class AuthRequirement { None, NotFail, Pass };
+
+    struct Rule {
+        size_t order;
+        bool allow;
+        AuthRequirement auth;
+        bool anyTarget;
+        std::vector<std::pair<unsigned long, unsigned long>> networks;   // (địa chỉ, mask)
+        unsigned long commandMask;
+        bool hasRateLimit;
+        RateLimit rateLimit;
+    };
+
+    // Luật đã biên dịch, chỉ đọc sau khi dựng; được thay nguyên khối khi policy.json đổi
+    struct CompiledPolicy {
+        std::string authservId = "mx.google.com";
+        bool defaultAllow = false;
+        RateLimit rateLimit;
+        std::vector<Rule> rules;
+        // Chỉ mục theo người gửi: tra bằng bảng băm rồi mới kiểm tra từng luật ứng viên
+        std::unordered_map<std::string, std::vector<size_t>> byAddress;
+        std::unordered_map<std::string, std::vector<size_t>> byDomain;       // "*@domain"
+        std::unordered_map<std::string, std::vector<size_t>> bySubdomain;    // "*@*.domain"
+        std::vector<size_t> self;
+        std::vector<size_t> anySender;
+    };
+
+    struct Bucket {
+        double tokens;
+        long long updatedMs;
+    };
+
+    static std::shared_ptr<CompiledPolicy> builtInPolicy();
+    static std::shared_ptr<CompiledPolicy> compile(const Json::Value& root, std::string& error);
+    static bool compileRule(const Json::Value& value, size_t order, CompiledPolicy& policy, std::string& error);
+    static bool parseRateLimit(const Json::Value& value, RateLimit& limit);
+    static bool parseIPv4(const std::string& text, unsigned long& address);
+    static bool authSatisfied(AuthRequirement requirement, const std::string& senderDomain,
+        const std::string& authenticationResults, const std::string& authservId);
+
+    bool takeToken(const std::string& sender, const RateLimit& limit);
+    long long now();
+
+    std::string path;
+    Clock clock;
+    std::mutex mutex;
+    std::shared_ptr<CompiledPolicy> policy;
+    long long loadedWriteTime;
+    long long loadedSize;
+    bool usingString;
+    std::unordered_map<std::string, Bucket> buckets;
+};
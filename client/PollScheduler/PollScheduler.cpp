@@ -0,0 +1,128 @@
+#include "PollScheduler.h"
+#include <algorithm>
+#include <chrono>
+
+static const long long DAY_MS = 24LL * 60 * 60 * 1000;
+static const long long QUOTA_WINDOW_MS = 1000;
+
+PollScheduler::PollScheduler(const PollConfig& config, Clock clock, unsigned int seed)
+    : config(config), clock(clock), random(seed),
+    currentIntervalMs(config.baseIntervalMs), idleStreak(0), burstUntilMs(0),
+    dayStartMs(0), quotaUnitsToday(0), pollsToday(0),
+    polls(0), commandsFound(0), quotaDelays(0)
+{
+    dayStartMs = now();
+}
+
+long long PollScheduler::now() {
+    if (clock) {
+        return clock();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PollScheduler::rollDay(long long nowMs) {
+    while (nowMs - dayStartMs >= DAY_MS) {
+        dayStartMs += DAY_MS;
+        quotaUnitsToday = 0;
+        pollsToday = 0;
+    }
+}
+
+int PollScheduler::unitsInLastSecond(long long nowMs) {
+    while (!recentQuota.empty() && nowMs - recentQuota.front().timeMs >= QUOTA_WINDOW_MS) {
+        recentQuota.pop_front();
+    }
+    int total = 0;
+    for (const QuotaEvent& event : recentQuota) {
+        total += event.units;
+    }
+    return total;
+}
+
+int PollScheduler::nextDelayMs() {
+    long long nowMs = now();
+    int interval = inBurst(nowMs) ? config.burstIntervalMs : currentIntervalMs;
+
+    // Jitter đều trong ±jitterRatio
+    std::uniform_real_distribution<double> jitter(-config.jitterRatio, config.jitterRatio);
+    int delay = static_cast<int>(interval * (1.0 + jitter(random)));
+    delay = std::max(delay, 1);
+
+    // Nếu cửa sổ 1 giây tại thời điểm poll vẫn còn quá nhiều quota (vừa gửi nhiều thư trả lời),
+    // lùi tới khi các sự kiện cũ trượt ra khỏi cửa sổ
+    long long pollAt = nowMs + delay;
+    int used = unitsInLastSecond(nowMs);
+    if (used + config.pollQuotaUnits > config.quotaUnitsPerSecond) {
+        int remaining = used;
+        for (const QuotaEvent& event : recentQuota) {
+            if (remaining + config.pollQuotaUnits <= config.quotaUnitsPerSecond) break;
+            long long freeAt = event.timeMs + QUOTA_WINDOW_MS;
+            if (freeAt > pollAt) {
+                pollAt = freeAt;
+                quotaDelays++;
+            }
+            remaining -= event.units;
+        }
+    }
+    return static_cast<int>(pollAt - nowMs);
+}
+
+void PollScheduler::onPollResult(bool commandFound) {
+    long long nowMs = now();
+    rollDay(nowMs);
+    polls++;
+    pollsToday++;
+
+    if (commandFound) {
+        commandsFound++;
+        idleStreak = 0;
+        currentIntervalMs = config.baseIntervalMs;
+        burstUntilMs = nowMs + config.burstDurationMs;
+        return;
+    }
+
+    // Trong burst vẫn giữ nhịp nhanh; hết burst mới bắt đầu đếm số lần rỗng
+    if (inBurst(nowMs)) return;
+
+    idleStreak++;
+    if (idleStreak > config.idlePollsBeforeBackoff) {
+        double next = currentIntervalMs * config.backoffFactor;
+        currentIntervalMs = static_cast<int>(std::min(next, static_cast<double>(config.maxIntervalMs)));
+    }
+}
+
+void PollScheduler::recordQuota(int units) {
+    long long nowMs = now();
+    rollDay(nowMs);
+    quotaUnitsToday += units;
+    recentQuota.push_back({ nowMs, units });
+    unitsInLastSecond(nowMs);   // Dọn các sự kiện đã ra khỏi cửa sổ
+}
+
+void PollScheduler::reset() {
+    currentIntervalMs = config.baseIntervalMs;
+    idleStreak = 0;
+    burstUntilMs = 0;
+}
+
+void PollScheduler::setConfig(const PollConfig& newConfig) {
+    config = newConfig;
+    reset();
+}
+
+PollStats PollScheduler::getStats() {
+    long long nowMs = now();
+    rollDay(nowMs);
+
+    PollStats stats;
+    stats.polls = polls;
+    stats.commandsFound = commandsFound;
+    stats.quotaUnitsToday = quotaUnitsToday;
+    stats.pollsToday = pollsToday;
+    stats.quotaDelays = quotaDelays;
+    stats.currentIntervalMs = inBurst(nowMs) ? config.burstIntervalMs : currentIntervalMs;
+    stats.inBurst = inBurst(nowMs);
+    return stats;
+}
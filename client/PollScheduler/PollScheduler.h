@@ -0,0 +1,85 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <random>
+
+struct PollConfig {
+    int burstIntervalMs = 1000;         // Sau khi vừa có lệnh: người dùng thường gửi tiếp
+    int baseIntervalMs = 2000;
+    int maxIntervalMs = 30000;          // Hộp thư im lặng lâu: tối đa 30 giây mới kiểm tra
+    int burstDurationMs = 120000;
+    int idlePollsBeforeBackoff = 15;    // Giữ nhịp cơ bản khoảng 30 giây rồi mới giãn ra
+    double backoffFactor = 1.5;
+    double jitterRatio = 0.1;           // ±10% để nhiều client không poll cùng lúc
+
+    // Giới hạn của Gmail API: 250 quota unit / người dùng / giây
+    int quotaUnitsPerSecond = 250;
+    int pollQuotaUnits = 5;             // messages.list
+};
+
+struct PollStats {
+    long long polls;
+    long long commandsFound;
+    long long quotaUnitsToday;
+    long long pollsToday;
+    long long quotaDelays;              // Số lần phải lùi lịch vì sắp vượt quota theo giây
+    int currentIntervalMs;
+    bool inBurst;
+};
+
+// Lịch poll hộp thư thích ứng: giãn dần khi không có thư, chuyển sang nhịp nhanh
+// một lúc sau khi nhận lệnh, thêm jitter và không vượt quota theo giây của Gmail.
+// Chỉ dùng trên một thread (UI thread của MainFrame).
+class PollScheduler {
+public:
+    // Trả về thời gian đơn điệu tính bằng mili giây; thay được để chạy với đồng hồ ảo
+    using Clock = std::function<long long()>;
+
+    explicit PollScheduler(const PollConfig& config = PollConfig(), Clock clock = nullptr,
+        unsigned int seed = std::random_device{}());
+
+    // Khoảng chờ tới lần poll tiếp theo, đã tính jitter và quota
+    int nextDelayMs();
+
+    // Gọi sau mỗi lần poll; commandFound = có email lệnh mới.
+    // Quota của lần poll được ghi riêng qua recordQuota
+    void onPollResult(bool commandFound);
+
+    // Ghi nhận quota đã dùng (list, get, send...) để tính giới hạn theo giây và theo ngày
+    void recordQuota(int units);
+
+    // Bỏ trạng thái giãn cách, ví dụ khi bắt đầu theo dõi lại
+    void reset();
+    // Đổi cấu hình (ví dụ chỉ poll dự phòng khi đã có push), rồi reset
+    void setConfig(const PollConfig& newConfig);
+
+    PollStats getStats();
+
+private:
+    struct QuotaEvent {
+        long long timeMs;
+        int units;
+    };
+
+    long long now();
+    bool inBurst(long long nowMs) const { return nowMs < burstUntilMs; }
+    void rollDay(long long nowMs);
+    int unitsInLastSecond(long long nowMs);
+
+    PollConfig config;
+    Clock clock;
+    std::mt19937 random;
+
+    int currentIntervalMs;
+    int idleStreak;
+    long long burstUntilMs;
+
+    std::deque<QuotaEvent> recentQuota;
+    long long dayStartMs;
+    long long quotaUnitsToday;
+    long long pollsToday;
+
+    long long polls;
+    long long commandsFound;
+    long long quotaDelays;
+};
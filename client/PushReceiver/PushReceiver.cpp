@@ -0,0 +1,294 @@
+#include "PushReceiver.h"
+#include "utils.h"
+#include "Metrics.h"
+#include "JsonScan.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+wxDEFINE_EVENT(wxEVT_MAIL_PUSH, wxCommandEvent);
+
+static Metrics::Counter& pushCounter(const char* result) {
+    return Metrics::registry().counter("push_notifications_total",
+        "Push notifications received, by outcome", std::string("result=\"") + result + "\"");
+}
+
+PushReceiver::PushReceiver(wxEvtHandler* eventHandler, int port, const std::string& path, const std::string& token)
+    : eventHandler(eventHandler), port(port), path(path), token(token),
+    listenSocket(INVALID_SOCKET), running(false), highestHistoryId(0), stats{ 0, 0, 0, 0, 0 }
+{
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+}
+
+PushReceiver::~PushReceiver() {
+    stop();
+    WSACleanup();
+}
+
+bool PushReceiver::start() {
+    if (running) return false;
+
+    listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        return false;
+    }
+
+    // Chỉ nghe trên loopback; nếu cần nhận từ Pub/Sub thật thì đặt reverse proxy HTTPS phía trước
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<u_short>(port));
+
+    u_long nonBlocking = 1;
+    if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(listenSocket, SOMAXCONN) == SOCKET_ERROR ||
+        ioctlsocket(listenSocket, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+        std::cerr << "Push receiver cannot listen on port " << port << ": " << WSAGetLastError() << std::endl;
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    running = true;
+    worker = std::thread(&PushReceiver::run, this);
+    return true;
+}
+
+void PushReceiver::stop() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (auto& item : connections) {
+        closesocket(item.first);
+    }
+    connections.clear();
+    if (listenSocket != INVALID_SOCKET) {
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+    }
+}
+
+PushReceiverStats PushReceiver::getStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+void PushReceiver::run() {
+    while (running) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(listenSocket, &readSet);
+        for (const auto& item : connections) {
+            FD_SET(item.first, &readSet);
+        }
+
+        timeval timeout = { 0, 250000 };   // Kiểm tra cờ running 4 lần mỗi giây
+        int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+        if (ready == SOCKET_ERROR) {
+            std::cerr << "Push receiver select failed: " << WSAGetLastError() << std::endl;
+            break;
+        }
+
+        if (FD_ISSET(listenSocket, &readSet)) {
+            acceptConnections();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = connections.begin(); it != connections.end();) {
+            bool done = false;
+            if (FD_ISSET(it->first, &readSet)) {
+                done = readConnection(it->first, it->second);
+            }
+            else if (now - it->second.lastActivity > std::chrono::milliseconds(IDLE_TIMEOUT_MS)) {
+                done = true;    // Kết nối treo: không giữ chỗ mãi
+            }
+
+            if (done) {
+                closesocket(it->first);
+                it = connections.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+}
+
+void PushReceiver::acceptConnections() {
+    while (true) {
+        SOCKET client = accept(listenSocket, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            return;     // WSAEWOULDBLOCK: đã nhận hết kết nối đang chờ
+        }
+        // select() của Winsock giới hạn FD_SETSIZE socket
+        if (connections.size() >= MAX_CONNECTIONS) {
+            closesocket(client);
+            continue;
+        }
+
+        u_long nonBlocking = 1;
+        ioctlsocket(client, FIONBIO, &nonBlocking);
+        Connection& connection = connections[client];
+        connection.lastActivity = std::chrono::steady_clock::now();
+    }
+}
+
+bool PushReceiver::readConnection(SOCKET socket, Connection& connection) {
+    char buffer[4096];
+    int received = recv(socket, buffer, sizeof(buffer), 0);
+    if (received == 0) return true;
+    if (received == SOCKET_ERROR) {
+        return WSAGetLastError() != WSAEWOULDBLOCK;
+    }
+    connection.buffer.append(buffer, received);
+    connection.lastActivity = std::chrono::steady_clock::now();
+
+    if (connection.buffer.size() > MAX_REQUEST_SIZE) {
+        sendStatus(socket, Verdict::Rejected);
+        return true;
+    }
+
+    size_t headerEnd = connection.buffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return false;   // Chưa đủ header
+    }
+
+    // Content-Length, không phân biệt hoa thường
+    std::string headers = connection.buffer.substr(0, headerEnd);
+    std::string lowerHeaders = headers;
+    std::transform(lowerHeaders.begin(), lowerHeaders.end(), lowerHeaders.begin(), ::tolower);
+    size_t contentLength = 0;
+    size_t lengthPos = lowerHeaders.find("\r\ncontent-length:");
+    if (lengthPos != std::string::npos) {
+        contentLength = strtoul(headers.c_str() + lengthPos + 17, nullptr, 10);
+    }
+    if (connection.buffer.size() < headerEnd + 4 + contentLength) {
+        return false;   // Chưa đủ body
+    }
+
+    unsigned long long historyId = 0;
+    Verdict verdict = handleRequest(connection.buffer.substr(0, headerEnd + 4 + contentLength), historyId);
+    sendStatus(socket, verdict);
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.received++;
+        switch (verdict) {
+        case Verdict::Accepted: stats.accepted++; break;
+        case Verdict::Rejected: stats.rejected++; break;
+        case Verdict::Duplicate: stats.duplicates++; break;
+        case Verdict::Stale: stats.stale++; break;
+        }
+    }
+
+    if (verdict == Verdict::Accepted) {
+        static Metrics::Counter& accepted = pushCounter("accepted");
+        accepted.add();
+        wxCommandEvent event(wxEVT_MAIL_PUSH);
+        event.SetString(std::to_string(historyId));
+        wxPostEvent(eventHandler, event);
+    }
+    else {
+        static Metrics::Counter& ignored = pushCounter("ignored");
+        ignored.add();
+    }
+    return true;
+}
+
+PushReceiver::Verdict PushReceiver::handleRequest(const std::string& request, unsigned long long& historyId) {
+    // Dòng đầu: POST /path?query HTTP/1.1
+    size_t methodEnd = request.find(' ');
+    size_t targetEnd = methodEnd == std::string::npos ? std::string::npos : request.find(' ', methodEnd + 1);
+    if (targetEnd == std::string::npos || request.compare(0, methodEnd, "POST") != 0) {
+        return Verdict::Rejected;
+    }
+    std::string target = request.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    size_t queryStart = target.find('?');
+    std::string requestPath = target.substr(0, queryStart);
+    std::string query = queryStart == std::string::npos ? "" : target.substr(queryStart + 1);
+    if (requestPath != path) {
+        return Verdict::Rejected;
+    }
+
+    // Pub/Sub push cho phép gắn token bí mật vào URL của subscription
+    std::string candidate;
+    size_t tokenPos = ("&" + query).find("&token=");
+    if (tokenPos != std::string::npos) {
+        size_t valueStart = tokenPos + 6;
+        size_t valueEnd = query.find('&', valueStart);
+        candidate = query.substr(valueStart, valueEnd == std::string::npos ? std::string::npos : valueEnd - valueStart);
+    }
+    if (!tokenMatches(candidate)) {
+        return Verdict::Rejected;
+    }
+
+    // Chỉ cần vài trường: đọc tại chỗ bằng JsonScan, không dựng cây
+    JsonScan::Value root;
+    std::string body = request.substr(request.find("\r\n\r\n") + 4);
+    if (!JsonScan::parse(body, root) || !root["message"].isObject()) {
+        return Verdict::Rejected;
+    }
+
+    JsonScan::Value message = root["message"];
+    std::string messageId = message["messageId"].asString();
+    if (messageId.empty()) messageId = message["message_id"].asString();
+    if (messageId.empty()) {
+        return Verdict::Rejected;
+    }
+
+    JsonScan::Value data;
+    std::string decoded = base64_decode(message["data"].asString());
+    if (!JsonScan::parse(decoded, data)) {
+        return Verdict::Rejected;
+    }
+    // historyId là số trong thông báo của Gmail, nhưng chấp nhận cả dạng chuỗi
+    historyId = data["historyId"].asUInt64();
+    if (historyId == 0) {
+        return Verdict::Rejected;
+    }
+
+    if (!rememberMessageId(messageId)) {
+        return Verdict::Duplicate;
+    }
+    // Thông báo đến trễ/lệch thứ tự: lần đồng bộ cho historyId lớn hơn đã bao gồm nó
+    if (historyId <= highestHistoryId) {
+        return Verdict::Stale;
+    }
+    highestHistoryId = historyId;
+    return Verdict::Accepted;
+}
+
+bool PushReceiver::rememberMessageId(const std::string& messageId) {
+    if (!seenIds.insert(messageId).second) {
+        return false;
+    }
+    seenOrder.push_back(messageId);
+    if (seenOrder.size() > DEDUP_CAPACITY) {
+        seenIds.erase(seenOrder.front());
+        seenOrder.pop_front();
+    }
+    return true;
+}
+
+bool PushReceiver::tokenMatches(const std::string& candidate) const {
+    if (token.empty() || candidate.size() != token.size()) {
+        return false;
+    }
+    // So sánh thời gian hằng để không lộ token qua thời gian phản hồi
+    unsigned char diff = 0;
+    for (size_t i = 0; i < token.size(); i++) {
+        diff |= static_cast<unsigned char>(token[i] ^ candidate[i]);
+    }
+    return diff == 0;
+}
+
+void PushReceiver::sendStatus(SOCKET socket, Verdict verdict) {
+    // Trùng và cũ vẫn trả 2xx để Pub/Sub không gửi lại
+    const char* response = verdict == Verdict::Rejected
+        ? "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+        : "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n";
+    send(socket, response, (int)strlen(response), 0);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include <deque>
+#include <unordered_set>
+#include <WinSock2.h>
+#include <wx/event.h>
+
+// Thông báo đã qua kiểm tra; GetString() = historyId (thập phân)
+wxDECLARE_EVENT(wxEVT_MAIL_PUSH, wxCommandEvent);
+
+struct PushReceiverStats {
+    long long received;
+    long long accepted;
+    long long rejected;         // Sai token, sai đường dẫn hoặc body không hợp lệ
+    long long duplicates;       // Pub/Sub gửi lại cùng messageId
+    long long stale;            // historyId không mới hơn thông báo đã nhận
+};
+
+// Nhận thông báo kiểu Pub/Sub push của Gmail users.watch qua HTTP trên một cổng cục bộ.
+// Một thread, nhiều kết nối cùng lúc bằng select + socket non-blocking.
+// Mỗi request: POST <path>?token=<secret> với body
+//   {"message":{"data":"<base64 {emailAddress, historyId}>","messageId":"..."},"subscription":"..."}
+// Trả lời 204 ngay (Pub/Sub chỉ cần 2xx), sau đó post wxEVT_MAIL_PUSH nếu historyId mới hơn.
+// Việc đồng bộ (history.list) do MainFrame làm trên UI thread.
+class PushReceiver {
+public:
+    static const int MAX_CONNECTIONS = 32;
+    static const size_t MAX_REQUEST_SIZE = 64 * 1024;
+    static const int IDLE_TIMEOUT_MS = 5000;
+    static const size_t DEDUP_CAPACITY = 1024;
+
+    PushReceiver(wxEvtHandler* eventHandler, int port, const std::string& path, const std::string& token);
+    ~PushReceiver();
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    PushReceiverStats getStats();
+
+private:
+    struct Connection {
+        std::string buffer;
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+
+    enum class Verdict { Accepted, Rejected, Duplicate, Stale };
+
+    // historyId chỉ có giá trị khi Verdict::Accepted
+    Verdict handleRequest(const std::string& request, unsigned long long& historyId);
+
+    void run();
+    void acceptConnections();
+    // true nếu đã nhận đủ request (hoặc request hỏng) và kết nối cần đóng
+    bool readConnection(SOCKET socket, Connection& connection);
+    bool rememberMessageId(const std::string& messageId);
+    static void sendStatus(SOCKET socket, Verdict verdict);
+    bool tokenMatches(const std::string& candidate) const;
+
+    wxEvtHandler* eventHandler;
+    int port;
+    std::string path;
+    std::string token;
+
+    SOCKET listenSocket;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::map<SOCKET, Connection> connections;
+
+    // Chống trùng: tập messageId gần nhất, bỏ cái cũ nhất khi đầy
+    std::unordered_set<std::string> seenIds;
+    std::deque<std::string> seenOrder;
+    unsigned long long highestHistoryId;
+
+    std::mutex statsMutex;
+    PushReceiverStats stats;
+};
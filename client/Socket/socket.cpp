@@ -1,10 +1,54 @@
 ﻿#include "socket.h"
 #include <iostream>
 #include <fstream>
+#include <mstcpip.h>
+#include "Metrics.h"
+#include "SecureSocket.h"
+#include "CommandRegistry.h"
 
-SocketClient::SocketClient() : clientSocket(INVALID_SOCKET), isInitialized(false) {
-    WSADATA wsaData;
-    isInitialized = (WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+// Đếm byte qua socket của mọi phiên (counter không khóa, chi phí vài ns mỗi lần gọi).
+// Đi qua SecureSocket: với server đã ghim khóa thì dữ liệu được mã hóa, số byte đếm là byte lệnh/kết quả
+static Metrics::Counter& sentBytes = Metrics::registry().counter(
+    "client_socket_sent_bytes_total", "Bytes sent to servers");
+static Metrics::Counter& receivedBytes = Metrics::registry().counter(
+    "client_socket_received_bytes_total", "Bytes received from servers");
+
+static int sendCounted(SOCKET socketHandle, const char* data, int size, int flags) {
+    int result = SecureSocket::send(socketHandle, data, size, flags);
+    if (result > 0) sentBytes.add(result);
+    return result;
+}
+
+static int recvCounted(SOCKET socketHandle, char* buffer, int size, int flags) {
+    int result = SecureSocket::recv(socketHandle, buffer, size, flags);
+    if (result > 0) receivedBytes.add(result);
+    return result;
+}
+
+mutex SocketClient::winsockMutex;
+int SocketClient::winsockUsers = 0;
+
+bool SocketClient::acquireWinsock() {
+    lock_guard<mutex> lock(winsockMutex);
+    if (winsockUsers == 0) {
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            return false;
+        }
+    }
+    winsockUsers++;
+    return true;
+}
+
+void SocketClient::releaseWinsock() {
+    lock_guard<mutex> lock(winsockMutex);
+    if (winsockUsers > 0 && --winsockUsers == 0) {
+        WSACleanup();
+    }
+}
+
+SocketClient::SocketClient() : clientSocket(INVALID_SOCKET), isInitialized(false), serverPort(0), connected(false) {
+    isInitialized = acquireWinsock();
     if (!isInitialized) {
         cerr << "Failed to initialize Winsock" << endl;
     }
@@ -47,6 +91,21 @@ bool SocketClient::connect(const string& serverIP, int port) {
         return false;
     }
 
+    // save_path không có trả lời: lệnh gửi ngay sau nó không được chờ server ACK (delayed ACK 40-200 ms)
+    BOOL noDelay = TRUE;
+    if (setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay)) == SOCKET_ERROR) {
+        cerr << "Failed to disable Nagle: " << WSAGetLastError() << endl;
+    }
+
+    // Bắt tay mã hóa nếu server đã được ghim trong server_keys.txt
+    if (!SecureSocket::connectClient(clientSocket, serverIP, port)) {
+        closesocket(clientSocket);
+        clientSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    this->serverIP = serverIP;
+    serverPort = port;
     connected = true;  // Set trạng thái connected khi kết nối thành công
     return true;
 }
@@ -56,6 +115,7 @@ bool SocketClient::disconnect() {
         return true;  // Socket đã đóng rồi
     }
 
+    SecureSocket::detach(clientSocket);
     if (closesocket(clientSocket) == SOCKET_ERROR) {
         return false;
     }
@@ -67,41 +127,129 @@ bool SocketClient::disconnect() {
 
 int SocketClient::sendData(const char* data, int dataSize) {
     if (clientSocket == INVALID_SOCKET) return SOCKET_ERROR;
-    return send(clientSocket, data, dataSize, 0);
+    return sendCounted(clientSocket, data, dataSize, 0);
 }
 
 int SocketClient::receiveData(char* buffer, int bufferSize) {
     if (clientSocket == INVALID_SOCKET) return SOCKET_ERROR;
-    return recv(clientSocket, buffer, bufferSize, 0);
+    return recvCounted(clientSocket, buffer, bufferSize, 0);
 }
 
-void SocketClient::sendCommand(const string& command) {
-    if (clientSocket == INVALID_SOCKET) return;
-    send(clientSocket, command.c_str(), command.size(), 0);
+// Đọc đủ size byte (recv có thể trả về ít hơn yêu cầu)
+bool SocketClient::receiveExact(char* buffer, int size) {
+    if (clientSocket == INVALID_SOCKET) return false;
+
+    int totalReceived = 0;
+    while (totalReceived < size) {
+        int bytesReceived = recvCounted(clientSocket, buffer + totalReceived, size - totalReceived, 0);
+        if (bytesReceived <= 0) {
+            return false;
+        }
+        totalReceived += bytesReceived;
+    }
+    return true;
 }
 
-void SocketClient::receiveAndSaveFile(const string& filename) {
-    if (clientSocket == INVALID_SOCKET) return;
+int SocketClient::sendCommand(const string& command) {
+    if (clientSocket == INVALID_SOCKET || command.size() > MAX_COMMAND_SIZE) return SOCKET_ERROR;
 
-    string data;
-    char buffer[BUFFER_SIZE];
-    int bytesReceived;
+    // Độ dài và nội dung trong cùng một lần send
+    uint32_t length = htonl((uint32_t)command.size());
+    string frame((const char*)&length, sizeof(length));
+    frame += command;
+
+    int totalSent = 0;
+    while (totalSent < (int)frame.size()) {
+        int sent = sendCounted(clientSocket, frame.data() + totalSent, (int)frame.size() - totalSent, 0);
+        if (sent == SOCKET_ERROR) return SOCKET_ERROR;
+        totalSent += sent;
+    }
+    return totalSent;
+}
+
+// Server gửi kết quả văn bản với kích thước đứng trước, nên không dừng ở lần recv ngắn đầu tiên
+// (bỏ lại phần còn lại trên kết nối) và không chờ mãi khi kết quả dài đúng bội số của bộ đệm
+bool SocketClient::receiveAndSaveFile(const string& filename) {
+    string status;
+    return receiveFile(filename, status);
+}
+
+// Khung: int64 kích thước (-1 = lỗi), đúng chừng đó byte dữ liệu, rồi message trạng thái (int32 độ dài + nội dung).
+// Đọc theo kích thước chứ không dừng ở lần recv ngắn đầu tiên, và ghi thẳng ra file từng khối
+// nên file lớn hoặc file tar nhiều file không phải giữ cả trong bộ nhớ
+bool SocketClient::receiveFile(const string& filename, string& status) {
+    status.clear();
+    if (clientSocket == INVALID_SOCKET) return false;
+
+    long long fileSize = 0;
+    if (!receiveExact((char*)&fileSize, sizeof(fileSize))) {
+        cerr << "Error receiving file size." << endl;
+        return false;
+    }
 
-    do {
-        bytesReceived = recv(clientSocket, buffer, BUFFER_SIZE, 0);
-        if (bytesReceived > 0) {
-            data.append(buffer, bytesReceived);
+    bool saved = true;
+    if (fileSize >= 0) {
+        ofstream outFile(filename, ios::binary | ios::trunc);
+        saved = outFile.is_open();
+        if (!saved) {
+            cerr << "Unable to open file for writing: " << filename << endl;
         }
-    } while (bytesReceived == BUFFER_SIZE);
 
-    saveToFile(filename, data);
+        // Vẫn đọc hết dữ liệu khi không ghi được file để kết nối không bị lệch khung
+        vector<char> buffer(64 * 1024);
+        long long remaining = fileSize;
+        while (remaining > 0) {
+            int chunk = remaining < (long long)buffer.size() ? (int)remaining : (int)buffer.size();
+            int bytesReceived = recvCounted(clientSocket, buffer.data(), chunk, 0);
+            if (bytesReceived <= 0) {
+                cerr << "Error receiving file data." << endl;
+                return false;
+            }
+            if (saved) outFile.write(buffer.data(), bytesReceived);
+            remaining -= bytesReceived;
+        }
+        saved = saved && outFile.good();
+    }
+
+    string message;
+    if (!receiveStatus(message)) {
+        return false;
+    }
+
+    status = message;
+    if (fileSize >= 0 && !saved) {
+        status = "Unable to save " + filename;
+        return false;
+    }
+    if (fileSize >= 0) {
+        cout << "Data saved to " << filename << endl;
+    }
+    return fileSize >= 0;
+}
+
+bool SocketClient::receiveStatus(string& status) {
+    status.clear();
+    if (clientSocket == INVALID_SOCKET) return false;
+
+    int messageSize = 0;
+    if (!receiveExact((char*)&messageSize, sizeof(messageSize)) || messageSize < 0 || messageSize > (1 << 20)) {
+        cerr << "Error receiving status message." << endl;
+        return false;
+    }
+    string message(messageSize, '\0');
+    if (messageSize > 0 && !receiveExact(&message[0], messageSize)) {
+        cerr << "Error receiving status message." << endl;
+        return false;
+    }
+    status = message;
+    return true;
 }
 
 void SocketClient::receiveVideoData(const string& filename) {
     if (clientSocket == INVALID_SOCKET) return;
 
     int dataSize;
-    if (recv(clientSocket, (char*)&dataSize, sizeof(dataSize), 0) != sizeof(dataSize)) {
+    if (recvCounted(clientSocket, (char*)&dataSize, sizeof(dataSize), 0) != sizeof(dataSize)) {
         cerr << "Error receiving video data size." << endl;
         return;
     }
@@ -111,7 +259,7 @@ void SocketClient::receiveVideoData(const string& filename) {
     int bytesReceived;
     int totalBytesReceived = 0;
     while (totalBytesReceived < dataSize) {
-        bytesReceived = recv(clientSocket, buffer, min(BUFFER_SIZE, dataSize - totalBytesReceived), 0);
+        bytesReceived = recvCounted(clientSocket, buffer, min(BUFFER_SIZE, dataSize - totalBytesReceived), 0);
         if (bytesReceived <= 0) {
             cerr << "Error receiving video data." << endl;
             return;
@@ -127,13 +275,13 @@ void SocketClient::receiveAndSaveImage(const string& filename) {
     if (clientSocket == INVALID_SOCKET) return;
 
     int imageSize;
-    recv(clientSocket, (char*)&imageSize, sizeof(imageSize), 0);
+    recvCounted(clientSocket, (char*)&imageSize, sizeof(imageSize), 0);
 
     vector<char> imageData(imageSize);
     int totalReceived = 0;
 
     while (totalReceived < imageSize) {
-        int bytesReceived = recv(clientSocket, imageData.data() + totalReceived,
+        int bytesReceived = recvCounted(clientSocket, imageData.data() + totalReceived,
             imageSize - totalReceived, 0);
         if (bytesReceived <= 0) break;
         totalReceived += bytesReceived;
@@ -144,15 +292,73 @@ void SocketClient::receiveAndSaveImage(const string& filename) {
 
 void SocketClient::cleanup() {
     if (clientSocket != INVALID_SOCKET) {
+        SecureSocket::detach(clientSocket);
         closesocket(clientSocket);
         clientSocket = INVALID_SOCKET;
     }
     if (isInitialized) {
-        WSACleanup();
+        releaseWinsock();
         isInitialized = false;
     }
 }
 
 bool SocketClient::isConnected() const {
     return clientSocket != INVALID_SOCKET;
+}
+
+bool SocketClient::setKeepAlive(unsigned long idleMs, unsigned long intervalMs) {
+    if (clientSocket == INVALID_SOCKET) return false;
+
+    BOOL enable = TRUE;
+    if (setsockopt(clientSocket, SOL_SOCKET, SO_KEEPALIVE, (const char*)&enable, sizeof(enable)) == SOCKET_ERROR) {
+        return false;
+    }
+
+    tcp_keepalive settings;
+    settings.onoff = 1;
+    settings.keepalivetime = idleMs;
+    settings.keepaliveinterval = intervalMs;
+
+    DWORD bytesReturned = 0;
+    return WSAIoctl(clientSocket, SIO_KEEPALIVE_VALS, &settings, sizeof(settings),
+        nullptr, 0, &bytesReturned, nullptr, nullptr) == 0;
+}
+
+// Kiểm tra session rảnh còn dùng được không. Session rảnh không được có gì để đọc: socket đọc được
+// nghĩa là server đã đóng kết nối, hoặc còn byte của lệnh trước mà client chưa đọc (khung đã lệch).
+// Không đọc bỏ phần thừa, vì không biết nó kết thúc ở đâu; người gọi đóng session.
+bool SocketClient::isStale() {
+    if (clientSocket == INVALID_SOCKET) return true;
+
+    // Phần đã giải mã nằm trong SecureSocket, select() không thấy
+    if (SecureSocket::buffered(clientSocket) > 0) {
+        cerr << "Unexpected data on idle session to " << serverIP << endl;
+        return true;
+    }
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(clientSocket, &readSet);
+    timeval timeout = { 0, 0 };
+    return select(0, &readSet, nullptr, nullptr, &timeout) != 0;
+}
+
+bool SocketClient::sendHeartbeat(int timeoutMs) {
+    if (isStale()) return false;
+
+    if (sendCommand("ping::heartbeat") == SOCKET_ERROR) {
+        return false;
+    }
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(clientSocket, &readSet);
+    timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    if (SecureSocket::buffered(clientSocket) == 0 && select(0, &readSet, nullptr, nullptr, &timeout) <= 0) {
+        return false;
+    }
+
+    char buffer[16];
+    int bytesReceived = recvCounted(clientSocket, buffer, sizeof(buffer), 0);
+    return bytesReceived == 4 && string(buffer, bytesReceived) == "pong";
 }
\ No newline at end of file
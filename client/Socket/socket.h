@@ -3,6 +3,7 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <vector>
+#include <mutex>
 using namespace std;
 #define BUFFER_SIZE 4096
 
@@ -10,8 +11,16 @@ class SocketClient {
 private:
     SOCKET clientSocket;
     bool isInitialized;
+    string serverIP;
+    int serverPort;
     void saveToFile(const string& filename, const string& data);
 
+    // Winsock is started once per process and shared by every SocketClient
+    static mutex winsockMutex;
+    static int winsockUsers;
+    static bool acquireWinsock();
+    static void releaseWinsock();
+
 public:
     SocketClient();
     ~SocketClient();
@@ -20,12 +29,28 @@ public:
     bool disconnect();
     int sendData(const char* data, int dataSize);
     int receiveData(char* buffer, int bufferSize);
-    void sendCommand(const string& command);
-    void receiveAndSaveFile(const string& filename);
+    bool receiveExact(char* buffer, int size);
+    // Gửi một message theo khung lệnh (uint32 độ dài + nội dung, xem MAX_COMMAND_SIZE);
+    // sendData chỉ dùng cho dữ liệu thô như ack của screen::stream
+    int sendCommand(const string& command);
+    // Kết quả ResultKind::Text, cùng khung với receiveFile; false khi không nhận hoặc không lưu được
+    bool receiveAndSaveFile(const string& filename);
+    // Kết quả ResultKind::File (file::get, file::list). false với status rỗng: kết nối lỗi giữa chừng;
+    // false với status: server báo lỗi (không tìm thấy...), kết nối vẫn dùng tiếp được
+    bool receiveFile(const string& filename, string& status);
+    // Message trạng thái (int32 độ dài + nội dung), vd kết quả file::delete. false: kết nối lỗi giữa chừng
+    bool receiveStatus(string& status);
     void receiveVideoData(const string& filename);
     void receiveAndSaveImage(const string& filename);
     void cleanup();
     bool isConnected() const;
 
+    // Session helpers used by ConnectionPool
+    bool setKeepAlive(unsigned long idleMs, unsigned long intervalMs);
+    bool isStale();
+    bool sendHeartbeat(int timeoutMs);
+    const string& getServerIP() const { return serverIP; }
+    int getServerPort() const { return serverPort; }
+
     bool connected;
 };
\ No newline at end of file
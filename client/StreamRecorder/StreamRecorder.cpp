@@ -0,0 +1,316 @@
+#include "StreamRecorder.h"
+#include <wx/image.h>
+#include <wx/mstream.h>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+using namespace ScreenStream;
+
+MjpegAviWriter::MjpegAviWriter() {
+}
+
+MjpegAviWriter::~MjpegAviWriter() {
+    close();
+}
+
+void MjpegAviWriter::put16(uint16_t value) {
+    char bytes[2] = { static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+    file.write(bytes, 2);
+}
+
+void MjpegAviWriter::put32(uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    file.write(bytes, 4);
+}
+
+void MjpegAviWriter::putFourcc(const char* fourcc) {
+    file.write(fourcc, 4);
+}
+
+void MjpegAviWriter::patch32(std::streampos position, uint32_t value) {
+    std::streampos current = file.tellp();
+    file.seekp(position);
+    put32(value);
+    file.seekp(current);
+}
+
+bool MjpegAviWriter::open(const std::string& path, int width, int height, int frameIntervalMs) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file for writing: " << path << std::endl;
+        return false;
+    }
+    index.clear();
+
+    const uint32_t AVIF_HASINDEX = 0x10;
+
+    putFourcc("RIFF");
+    riffSizePos = file.tellp();
+    put32(0);
+    putFourcc("AVI ");
+
+    // hdrl = "hdrl" + avih (8 + 56) + strl (8 + 4 + strh (8 + 56) + strf (8 + 40))
+    putFourcc("LIST");
+    put32(4 + 64 + 12 + 64 + 48);
+    putFourcc("hdrl");
+
+    putFourcc("avih");
+    put32(56);
+    put32(static_cast<uint32_t>(frameIntervalMs) * 1000);  // dwMicroSecPerFrame
+    put32(0);                   // dwMaxBytesPerSec
+    put32(0);                   // dwPaddingGranularity
+    put32(AVIF_HASINDEX);
+    totalFramesPos = file.tellp();
+    put32(0);                   // dwTotalFrames, ghi lại khi đóng
+    put32(0);                   // dwInitialFrames
+    put32(1);                   // dwStreams
+    put32(0);                   // dwSuggestedBufferSize
+    put32(width);
+    put32(height);
+    for (int i = 0; i < 4; i++) put32(0);
+
+    putFourcc("LIST");
+    put32(4 + 64 + 48);
+    putFourcc("strl");
+
+    // Tốc độ = dwRate / dwScale frame/giây: dùng mili giây để phát đúng thời lượng thật
+    putFourcc("strh");
+    put32(56);
+    putFourcc("vids");
+    putFourcc("MJPG");
+    put32(0);                   // dwFlags
+    put16(0);                   // wPriority
+    put16(0);                   // wLanguage
+    put32(0);                   // dwInitialFrames
+    put32(frameIntervalMs);     // dwScale
+    put32(1000);                // dwRate
+    put32(0);                   // dwStart
+    lengthPos = file.tellp();
+    put32(0);                   // dwLength, ghi lại khi đóng
+    put32(0);                   // dwSuggestedBufferSize
+    put32(0xFFFFFFFF);          // dwQuality
+    put32(0);                   // dwSampleSize
+    put16(0);
+    put16(0);
+    put16(static_cast<uint16_t>(width));
+    put16(static_cast<uint16_t>(height));
+
+    putFourcc("strf");
+    put32(40);
+    put32(40);                  // biSize
+    put32(width);
+    put32(height);
+    put16(1);                   // biPlanes
+    put16(24);                  // biBitCount
+    putFourcc("MJPG");
+    put32(static_cast<uint32_t>(width) * height * 3);
+    put32(0);
+    put32(0);
+    put32(0);
+    put32(0);
+
+    putFourcc("LIST");
+    moviSizePos = file.tellp();
+    put32(0);
+    moviStart = file.tellp();
+    putFourcc("movi");
+
+    return file.good();
+}
+
+bool MjpegAviWriter::addFrame(const std::vector<uint8_t>& jpeg) {
+    if (!file.is_open()) return false;
+
+    IndexEntry entry;
+    entry.offset = static_cast<uint32_t>(file.tellp() - moviStart);
+    entry.size = static_cast<uint32_t>(jpeg.size());
+
+    putFourcc("00dc");
+    put32(entry.size);
+    file.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+    if (jpeg.size() % 2 != 0) {
+        file.put(0);            // Chunk RIFF luôn căn theo 2 byte
+    }
+
+    index.push_back(entry);
+    return file.good();
+}
+
+bool MjpegAviWriter::close() {
+    if (!file.is_open()) return false;
+
+    const uint32_t AVIIF_KEYFRAME = 0x10;
+    std::streampos indexPos = file.tellp();
+    patch32(moviSizePos, static_cast<uint32_t>(indexPos - moviStart));
+
+    putFourcc("idx1");
+    put32(static_cast<uint32_t>(index.size() * 16));
+    for (const IndexEntry& entry : index) {
+        putFourcc("00dc");
+        put32(AVIIF_KEYFRAME);
+        put32(entry.offset);
+        put32(entry.size);
+    }
+
+    std::streampos endPos = file.tellp();
+    patch32(riffSizePos, static_cast<uint32_t>(endPos) - 8);
+    patch32(totalFramesPos, static_cast<uint32_t>(index.size()));
+    patch32(lengthPos, static_cast<uint32_t>(index.size()));
+
+    bool ok = file.good();
+    file.close();
+    return ok;
+}
+
+// Mã hóa canvas (đã thu nhỏ) thành JPEG cho clip
+static bool encodeClipFrame(const wxImage& canvas, int clipWidth, int clipHeight, std::vector<uint8_t>& jpeg) {
+    wxImage frame = (canvas.GetWidth() == clipWidth && canvas.GetHeight() == clipHeight)
+        ? canvas : canvas.Scale(clipWidth, clipHeight, wxIMAGE_QUALITY_NORMAL);
+    frame.SetOption(wxIMAGE_OPTION_QUALITY, StreamRecorder::CLIP_QUALITY);
+
+    wxMemoryOutputStream output;
+    if (!frame.SaveFile(output, wxBITMAP_TYPE_JPEG)) {
+        return false;
+    }
+    jpeg.resize(output.GetSize());
+    output.CopyTo(jpeg.data(), jpeg.size());
+    return true;
+}
+
+bool StreamRecorder::receive(SocketClient& session, const std::string& outputPath, std::string& summary) {
+    MjpegAviWriter writer;
+    wxImage canvas;
+    std::vector<char> payload;
+    std::vector<uint8_t> clipJpeg;
+    bool canvasChanged = false;
+
+    uint64_t bytesReceived = 0;
+    long long framesReceived = 0;
+    long long tilesReceived = 0;
+    int clipWidth = 0;
+    int clipHeight = 0;
+    int sampleIntervalMs = 1000 / CLIP_FPS;
+    long long nextSampleMs = 0;
+    StreamEndInfo endInfo = {};
+    bool ended = false;
+
+    while (!ended) {
+        StreamMessageHeader header;
+        if (!session.receiveExact(reinterpret_cast<char*>(&header), sizeof(header))) {
+            std::cerr << "Error receiving stream header." << std::endl;
+            break;
+        }
+        if (header.magic != MESSAGE_MAGIC || header.payloadSize > MAX_PAYLOAD_SIZE) {
+            std::cerr << "Invalid stream message." << std::endl;
+            break;
+        }
+
+        payload.resize(header.payloadSize);
+        if (header.payloadSize > 0 && !session.receiveExact(payload.data(), (int)header.payloadSize)) {
+            std::cerr << "Error receiving stream payload." << std::endl;
+            break;
+        }
+        bytesReceived += sizeof(header) + header.payloadSize;
+
+        switch (static_cast<MessageType>(header.type)) {
+        case MessageType::Start: {
+            if (payload.size() < sizeof(StreamStartInfo)) return false;
+            StreamStartInfo info;
+            memcpy(&info, payload.data(), sizeof(info));
+
+            canvas.Create(info.width, info.height, true);
+            canvasChanged = true;
+
+            // Clip giữ kích thước của lần Start đầu tiên; stream dài thì lấy mẫu thưa hơn
+            if (!writer.isOpen()) {
+                clipWidth = info.width > CLIP_MAX_WIDTH ? CLIP_MAX_WIDTH : info.width;
+                clipHeight = static_cast<int>(static_cast<long long>(info.height) * clipWidth / info.width);
+                clipHeight -= clipHeight % 2;
+                long long spreadMs = static_cast<long long>(info.durationMs) / MAX_CLIP_FRAMES;
+                if (spreadMs > sampleIntervalMs) sampleIntervalMs = static_cast<int>(spreadMs);
+                writer.open(outputPath, clipWidth, clipHeight, sampleIntervalMs);
+            }
+            break;
+        }
+
+        case MessageType::Frame: {
+            if (payload.size() < sizeof(StreamFrameInfo) || !canvas.IsOk()) return false;
+            StreamFrameInfo info;
+            memcpy(&info, payload.data(), sizeof(info));
+
+            size_t offset = sizeof(info);
+            for (int i = 0; i < info.tileCount; i++) {
+                StreamTileInfo tileInfo;
+                if (offset + sizeof(tileInfo) > payload.size()) return false;
+                memcpy(&tileInfo, payload.data() + offset, sizeof(tileInfo));
+                offset += sizeof(tileInfo);
+                if (offset + tileInfo.jpegSize > payload.size()) return false;
+
+                wxMemoryInputStream tileStream(payload.data() + offset, tileInfo.jpegSize);
+                wxImage tile;
+                if (tile.LoadFile(tileStream, wxBITMAP_TYPE_JPEG)) {
+                    canvas.Paste(tile, tileInfo.x, tileInfo.y);
+                    canvasChanged = true;
+                }
+                offset += tileInfo.jpegSize;
+                tilesReceived++;
+            }
+            framesReceived++;
+
+            StreamAck ack = { ACK_MAGIC, info.sequence, bytesReceived };
+            if (session.sendData(reinterpret_cast<const char*>(&ack), sizeof(ack)) == SOCKET_ERROR) {
+                return false;
+            }
+
+            // Lấy mẫu theo thời gian thật; màn hình đứng yên thì lặp lại frame trước
+            while (writer.isOpen() && info.timestampMs >= nextSampleMs &&
+                writer.getFrameCount() < (uint32_t)MAX_CLIP_FRAMES) {
+                if (canvasChanged || clipJpeg.empty()) {
+                    if (!encodeClipFrame(canvas, clipWidth, clipHeight, clipJpeg)) break;
+                    canvasChanged = false;
+                }
+                writer.addFrame(clipJpeg);
+                nextSampleMs += sampleIntervalMs;
+            }
+            break;
+        }
+
+        case MessageType::End: {
+            if (payload.size() >= sizeof(StreamEndInfo)) {
+                memcpy(&endInfo, payload.data(), sizeof(endInfo));
+            }
+            StreamAck ack = { ACK_MAGIC, END_SEQUENCE, bytesReceived };
+            session.sendData(reinterpret_cast<const char*>(&ack), sizeof(ack));
+            ended = true;
+            break;
+        }
+
+        default:
+            std::cerr << "Unknown stream message type: " << (int)header.type << std::endl;
+            return false;
+        }
+    }
+
+    uint32_t clipFrames = writer.getFrameCount();
+    writer.close();
+    if (!ended) {
+        return false;
+    }
+
+    std::ostringstream text;
+    text.setf(std::ios::fixed);
+    text.precision(1);
+    double seconds = endInfo.durationMs / 1000.0;
+    text << "Screen stream: " << framesReceived << " frames, " << tilesReceived << " tiles in " << seconds << " s";
+    if (seconds > 0) {
+        text << " (" << framesReceived / seconds << " fps, " << bytesReceived / 1024.0 / seconds << " KB/s)";
+    }
+    text << ", " << endInfo.framesSkipped << " frames skipped by server\n";
+    text << "Summary clip: " << clipFrames << " frames\n";
+    summary = text.str();
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "socket.h"
+#include "ScreenStream.h"
+
+// Ghi file AVI Motion-JPEG: mỗi frame là một ảnh JPEG, không cần codec ngoài để phát
+class MjpegAviWriter {
+public:
+    MjpegAviWriter();
+    ~MjpegAviWriter();
+
+    bool open(const std::string& path, int width, int height, int frameIntervalMs);
+    bool addFrame(const std::vector<uint8_t>& jpeg);
+    bool close();
+    bool isOpen() const { return file.is_open(); }
+    uint32_t getFrameCount() const { return static_cast<uint32_t>(index.size()); }
+
+private:
+    struct IndexEntry {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+    void putFourcc(const char* fourcc);
+    void patch32(std::streampos position, uint32_t value);
+
+    std::ofstream file;
+    std::vector<IndexEntry> index;
+    std::streampos riffSizePos;
+    std::streampos totalFramesPos;
+    std::streampos lengthPos;
+    std::streampos moviSizePos;
+    std::streampos moviStart;
+};
+
+// Nhận stream của lệnh screen::stream: ghép các tile JPEG thành frame đầy đủ,
+// gửi ack cho server sau mỗi frame và ghi một clip tóm tắt (tối đa MAX_CLIP_FRAMES frame,
+// thu nhỏ về CLIP_MAX_WIDTH) để đính kèm email.
+class StreamRecorder {
+public:
+    static const int CLIP_FPS = 5;
+    static const int MAX_CLIP_FRAMES = 150;
+    static const int CLIP_MAX_WIDTH = 960;
+    static const int CLIP_QUALITY = 70;
+
+    // summary: mô tả ngắn (số frame, fps, băng thông) để đưa vào email trả lời
+    static bool receive(SocketClient& session, const std::string& outputPath, std::string& summary);
+};
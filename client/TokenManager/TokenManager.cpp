@@ -58,6 +58,14 @@ std::string TokenManager::getRefreshToken(const std::string& gmail) {
     return (it != tokenStore.end()) ? it->second : "";
 }
 
+std::vector<std::string> TokenManager::getAccounts() {
+    std::vector<std::string> accounts;
+    for (const auto& pair : tokenStore) {
+        accounts.push_back(pair.first);
+    }
+    return accounts;
+}
+
 bool TokenManager::isTokenValid(const std::string& gmail, GoogleOAuth* oauth) {
     auto refreshToken = getRefreshToken(gmail);
     if (refreshToken.empty()) {
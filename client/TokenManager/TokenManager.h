@@ -1,41 +1,25 @@
 #pragma once
 #include <string>
 #include <map>
+#include <vector>
 #include <json/json.h>
 #include <fstream>
 #include "GmailAPI.h"
 #include <iostream>
-#include <ShlObj.h>
-#include <KnownFolders.h>
+#include "AppData.h"
 
 class TokenManager {
 public:
     TokenManager();
     void saveRefreshToken(const std::string& gmail, const std::string& refreshToken);
     std::string getRefreshToken(const std::string& gmail);
+    std::vector<std::string> getAccounts();
     bool isTokenValid(const std::string& gmail, GoogleOAuth* oauth);
     void removeToken(const std::string& gmail);
 
 private:
     std::string getTokenFilePath() {
-        PWSTR appDataPath = nullptr;
-        std::string tokenPath;
-
-        // Get the AppData\Roaming path
-        if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_RoamingAppData, 0, nullptr, &appDataPath))) {
-            std::wstring widePath(appDataPath);
-            std::string path(widePath.begin(), widePath.end());
-
-            // Create application directory if it doesn't exist
-            std::string appDir = path + "\\EmailPCControl";
-            CreateDirectoryA(appDir.c_str(), nullptr);
-
-            // Set the full path for tokens.json
-            tokenPath = appDir + "\\tokens.json";
-            CoTaskMemFree(appDataPath);
-        }
-
-        return tokenPath;
+        return AppData::path("tokens.json");
     }
 
     std::map<std::string, std::string> tokenStore;
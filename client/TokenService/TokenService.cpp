@@ -0,0 +1,251 @@
+#include "TokenService.h"
+#include "Metrics.h"
+#include "AppData.h"
+#include <json/json.h>
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#ifdef _WIN32
+#include <windows.h>
+#include <wincrypt.h>
+#pragma comment(lib, "Crypt32.lib")
+#endif
+
+TokenService::TokenService(Refresher refresher, const std::string& statePath, Clock clock)
+    : refresher(refresher), statePath(statePath), clock(clock), stopping(false), stats{ 0, 0, 0, 0, 0 }
+{
+    loadState();
+    worker = std::thread(&TokenService::backgroundLoop, this);
+}
+
+TokenService::~TokenService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+long long TokenService::now() {
+    if (clock) {
+        return clock();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string TokenService::defaultStatePath() {
+    return AppData::path("access_tokens.bin");
+}
+
+void TokenService::addAccount(const std::string& account, const std::string& refreshToken) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Account& entry = accounts[account];
+        if (entry.refreshToken != refreshToken && !entry.refreshToken.empty()) {
+            // Refresh token mới (đăng nhập lại): token cũ không còn đáng tin
+            entry.accessToken.clear();
+            entry.expiresAtMs = 0;
+        }
+        entry.refreshToken = refreshToken;
+        entry.retryAtMs = 0;
+    }
+    changed.notify_all();   // Thread nền tính lại thời điểm làm mới
+}
+
+void TokenService::removeAccount(const std::string& account) {
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.erase(account);
+    saveStateLocked();
+    changed.notify_all();
+}
+
+std::string TokenService::getAccessToken(const std::string& account, const std::string& rejectedToken) {
+    static Metrics::Histogram& waitTime = Metrics::registry().histogram(
+        "oauth_token_wait_microseconds", "Time callers spend waiting for an access token");
+    Metrics::ScopedTimer timer(waitTime);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto usable = [&](const Account& entry) {
+        return !entry.accessToken.empty() && entry.accessToken != rejectedToken &&
+            entry.expiresAtMs - now() > MIN_VALIDITY_SEC * 1000LL;
+    };
+
+    auto it = accounts.find(account);
+    if (it == accounts.end()) {
+        return "";
+    }
+    if (usable(it->second)) {
+        stats.hits++;
+        return it->second.accessToken;
+    }
+
+    if (it->second.refreshing) {
+        // Đã có thread khác đang làm mới: chờ kết quả của lần đó
+        stats.coalesced++;
+        changed.wait(lock, [&]() {
+            auto current = accounts.find(account);
+            return stopping || current == accounts.end() || !current->second.refreshing;
+        });
+    }
+    else {
+        refreshLocked(lock, account);
+    }
+
+    it = accounts.find(account);
+    if (it != accounts.end() && usable(it->second)) {
+        return it->second.accessToken;
+    }
+    return "";
+}
+
+bool TokenService::refreshLocked(std::unique_lock<std::mutex>& lock, const std::string& account) {
+    auto it = accounts.find(account);
+    if (it == accounts.end() || it->second.refreshToken.empty()) {
+        return false;
+    }
+    it->second.refreshing = true;
+    std::string refreshToken = it->second.refreshToken;
+
+    stats.refreshes++;
+    lock.unlock();
+    int expiresInSec = 0;
+    std::string accessToken = refresher(refreshToken, expiresInSec);
+    lock.lock();
+
+    bool ok = !accessToken.empty();
+    it = accounts.find(account);
+    if (it != accounts.end()) {
+        Account& entry = it->second;
+        entry.refreshing = false;
+        if (ok) {
+            entry.accessToken = accessToken;
+            entry.expiresAtMs = now() + (expiresInSec > 0 ? expiresInSec : DEFAULT_EXPIRES_SEC) * 1000LL;
+            entry.retryAtMs = 0;
+            saveStateLocked();
+        }
+        else {
+            stats.failures++;
+            entry.retryAtMs = now() + RETRY_DELAY_SEC * 1000LL;
+        }
+    }
+    changed.notify_all();
+    return ok;
+}
+
+void TokenService::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        long long nowMs = now();
+        long long wakeAtMs = LLONG_MAX;
+        std::string due;
+
+        for (const auto& item : accounts) {
+            const Account& entry = item.second;
+            if (entry.refreshing || entry.refreshToken.empty()) continue;
+
+            long long refreshAtMs = entry.expiresAtMs - PROACTIVE_MARGIN_SEC * 1000LL;
+            if (refreshAtMs < entry.retryAtMs) refreshAtMs = entry.retryAtMs;
+            if (refreshAtMs <= nowMs) {
+                due = item.first;
+                break;
+            }
+            if (refreshAtMs < wakeAtMs) wakeAtMs = refreshAtMs;
+        }
+
+        if (!due.empty()) {
+            if (refreshLocked(lock, due)) {
+                stats.proactive++;
+            }
+            continue;
+        }
+
+        if (wakeAtMs == LLONG_MAX) {
+            changed.wait(lock);
+        }
+        else {
+            changed.wait_for(lock, std::chrono::milliseconds(wakeAtMs - nowMs));
+        }
+    }
+}
+
+TokenService::Stats TokenService::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+// Trạng thái: JSON {account: {"access_token", "expires_at"}}, mã hóa DPAPI theo người dùng Windows.
+// Refresh token vẫn do TokenManager giữ; ở đây chỉ lưu access token để khỏi làm mới khi khởi động lại
+void TokenService::loadState() {
+    if (statePath.empty()) return;
+    std::ifstream file(statePath, std::ios::binary);
+    if (!file.is_open()) return;
+    std::string sealed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string plain;
+#ifdef _WIN32
+    DATA_BLOB input = { static_cast<DWORD>(sealed.size()), reinterpret_cast<BYTE*>(&sealed[0]) };
+    DATA_BLOB output = {};
+    if (sealed.empty() || !CryptUnprotectData(&input, nullptr, nullptr, nullptr, nullptr,
+        CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        std::cerr << "Unable to decrypt token state, ignoring it" << std::endl;
+        return;
+    }
+    plain.assign(reinterpret_cast<char*>(output.pbData), output.cbData);
+    SecureZeroMemory(output.pbData, output.cbData);
+    LocalFree(output.pbData);
+#else
+    return;     // Không có DPAPI: không đọc trạng thái chưa mã hóa
+#endif
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    if (!reader->parse(plain.data(), plain.data() + plain.size(), &root, nullptr) || !root.isObject()) return;
+
+    long long nowMs = now();
+    for (const auto& account : root.getMemberNames()) {
+        long long expiresAtMs = root[account]["expires_at"].asInt64();
+        if (expiresAtMs <= nowMs) continue;
+        Account& entry = accounts[account];
+        entry.accessToken = root[account]["access_token"].asString();
+        entry.expiresAtMs = expiresAtMs;
+    }
+}
+
+void TokenService::saveStateLocked() {
+    if (statePath.empty()) return;
+
+    Json::Value root(Json::objectValue);
+    for (const auto& item : accounts) {
+        if (item.second.accessToken.empty()) continue;
+        root[item.first]["access_token"] = item.second.accessToken;
+        root[item.first]["expires_at"] = static_cast<Json::Int64>(item.second.expiresAtMs);
+    }
+    std::string plain = Json::FastWriter().write(root);
+
+#ifdef _WIN32
+    DATA_BLOB input = { static_cast<DWORD>(plain.size()), reinterpret_cast<BYTE*>(&plain[0]) };
+    DATA_BLOB output = {};
+    if (!CryptProtectData(&input, L"EmailPCControl access tokens", nullptr, nullptr, nullptr,
+        CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        std::cerr << "Unable to encrypt token state: " << GetLastError() << std::endl;
+        return;
+    }
+
+    // Ghi file tạm rồi thay thế để không bao giờ để lại file dở dang
+    std::string tempPath = statePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (file.is_open()) {
+        file.write(reinterpret_cast<const char*>(output.pbData), output.cbData);
+        file.close();
+        MoveFileExA(tempPath.c_str(), statePath.c_str(), MOVEFILE_REPLACE_EXISTING);
+    }
+    LocalFree(output.pbData);
+#endif
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+// Cache access token theo tài khoản kèm thời hạn:
+// - getAccessToken trả token còn hạn ngay, không gọi OAuth
+// - thread nền làm mới trước khi hết hạn (PROACTIVE_MARGIN_SEC)
+// - nhiều thread cùng cần làm mới một tài khoản thì chỉ một request OAuth được gửi (single-flight)
+// - trạng thái được mã hóa bằng DPAPI và lưu lại, khởi động lại không cần làm mới nếu token còn hạn
+class TokenService {
+public:
+    // Đổi refresh token lấy access token; expiresInSec = 0 nếu máy chủ không trả thời hạn
+    using Refresher = std::function<std::string(const std::string& refreshToken, int& expiresInSec)>;
+    // Thời gian thực (epoch ms); thay được để chạy với đồng hồ ảo
+    using Clock = std::function<long long()>;
+
+    static const int PROACTIVE_MARGIN_SEC = 300;    // Làm mới khi còn dưới 5 phút
+    static const int MIN_VALIDITY_SEC = 60;         // Dưới 1 phút thì người gọi phải chờ làm mới
+    static const int DEFAULT_EXPIRES_SEC = 3600;
+    static const int RETRY_DELAY_SEC = 30;          // Làm mới nền thất bại: thử lại sau
+
+    // statePath rỗng: không lưu trạng thái
+    TokenService(Refresher refresher, const std::string& statePath, Clock clock = nullptr);
+    ~TokenService();
+    TokenService(const TokenService&) = delete;
+    TokenService& operator=(const TokenService&) = delete;
+
+    void addAccount(const std::string& account, const std::string& refreshToken);
+    void removeAccount(const std::string& account);
+
+    // Access token còn hạn, làm mới nếu cần (chặn tới khi xong). Rỗng nếu không làm mới được.
+    // rejectedToken: token vừa bị API trả 401; nếu cache vẫn giữ token đó thì bắt buộc làm mới
+    std::string getAccessToken(const std::string& account, const std::string& rejectedToken = "");
+
+    // Mặc định của %APPDATA%\EmailPCControl\access_tokens.bin
+    static std::string defaultStatePath();
+
+    struct Stats {
+        long long hits;
+        long long refreshes;        // Số request OAuth thực sự được gửi
+        long long coalesced;        // Số lần chờ một lần làm mới đang chạy thay vì gửi request mới
+        long long proactive;        // Làm mới bởi thread nền
+        long long failures;
+    };
+    Stats getStats();
+
+private:
+    struct Account {
+        std::string refreshToken;
+        std::string accessToken;
+        long long expiresAtMs = 0;
+        bool refreshing = false;
+        long long retryAtMs = 0;    // Không làm mới nền trước thời điểm này sau khi thất bại
+    };
+
+    long long now();
+    // Gọi khi đang giữ lock; mở lock trong lúc gọi OAuth
+    bool refreshLocked(std::unique_lock<std::mutex>& lock, const std::string& account);
+    void backgroundLoop();
+    void loadState();
+    void saveStateLocked();
+
+    Refresher refresher;
+    std::string statePath;
+    Clock clock;
+
+    std::mutex mutex;
+    std::condition_variable changed;    // Làm mới xong, thêm tài khoản, hoặc dừng
+    std::map<std::string, Account> accounts;
+    bool stopping;
+    Stats stats;
+    std::thread worker;
+};
@@ -1,10 +1,40 @@
-#include "HandleMail.h"
+#include "handleMail.h"
 #include "utils.h" // Cho base64_encode v base64_decode
+#include "Metrics.h"
+#include "HttpPool.h"
+#include "JsonScan.h"
+#include "MimeWalker.h"
+#include "MailHeader.h"
 #include <iostream>
+#include <cstdlib>
 
 using namespace std;
 
-EmailHandler::EmailHandler(const string& token) : access_token(token) {}
+EmailHandler::EmailHandler(const string& token)
+    : EmailHandler(TokenSource([token](const string&) { return token; })) {}
+
+EmailHandler::EmailHandler(TokenSource tokenSource)
+    : token_source(tokenSource), api_base(getEnvOr(GMAIL_API_BASE_ENV, GMAIL_API_BASE_DEFAULT)), quota_units_used(0) {}
+
+// Times one Gmail API call; labels must be registered up front so the hot path stays lock-free
+static CURLcode performTimed(CURL* curl, Metrics::Histogram& latency, Metrics::Counter& errors) {
+    Metrics::ScopedTimer timer(latency);
+    CURLcode res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        errors.add();
+    }
+    return res;
+}
+
+static Metrics::Histogram& gmailLatency(const char* endpoint) {
+    return Metrics::registry().histogram("gmail_request_duration_microseconds",
+        "Gmail API request latency", string("endpoint=\"") + endpoint + "\"");
+}
+
+static Metrics::Counter& gmailErrors(const char* endpoint) {
+    return Metrics::registry().counter("gmail_request_errors_total",
+        "Gmail API requests that failed at the transport level", string("endpoint=\"") + endpoint + "\"");
+}
 
 size_t EmailHandler::WriteCallback(void* contents, size_t size, size_t nmemb, string* s) {
     size_t newLength = size * nmemb;
@@ -18,10 +48,11 @@ size_t EmailHandler::WriteCallback(void* contents, size_t size, size_t nmemb, st
 }
 
 string EmailHandler::extractEmail(const string& from) {
-    regex emailRegex(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})");
-    smatch match;
-    if (regex_search(from, match, emailRegex)) {
-        return match.str();
+    // RFC 5322 tokenizer: the address comes from <...> (or the bare addr-spec), never from the
+    // display name, so '"boss@company.com" <someone@else.com>' yields someone@else.com
+    MailHeader::Address address;
+    if (MailHeader::firstMailbox(from, address)) {
+        return string(address.addrSpec);
     }
     return from;
 }
@@ -40,33 +71,11 @@ string EmailHandler::formatDate(const string& date) {
 }
 
 string EmailHandler::fetchEmailContent(const string& messageId) {
-    CURL* curl;
-    CURLcode res;
     string readBuffer;
-
-    curl = curl_easy_init();
-    if (curl) {
-        string url = "https://www.googleapis.com/gmail/v1/users/me/messages/" + messageId + "?format=full";
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + access_token).c_str());
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
-
-        if (res != CURLE_OK) {
-            cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
-            return "";
-        }
-    }
-    else {
-        cerr << "Failed to initialize cURL." << endl;
+    long status = apiRequest("/messages/" + messageId + "?format=full", "messages.get",
+        QUOTA_MESSAGES_GET, nullptr, readBuffer);
+    if (status != 200) {
+        cerr << "messages.get failed with HTTP " << status << endl;
         return "";
     }
 
@@ -74,95 +83,110 @@ string EmailHandler::fetchEmailContent(const string& messageId) {
 }
 
 EmailHandler::EmailInfo EmailHandler::decodeEmailContent(const string& emailContent) {
-    Json::Value emailDetail;
-    Json::CharReaderBuilder readerBuilder;
-    istringstream emailStream(emailContent);
-    string errs;
     EmailInfo info;
 
-    if (!Json::parseFromStream(readerBuilder, emailStream, &emailDetail, &errs)) {
-        cerr << "Cannot parse email JSON content: " << errs << endl;
+    // Only a handful of fields are needed: scan the response buffer in place instead of
+    // building a Json::Value tree (attachment data is skipped, never copied)
+    JsonScan::Value emailDetail;
+    if (!JsonScan::parse(emailContent, emailDetail)) {
+        cerr << "Cannot parse email JSON content" << endl;
         return info;
     }
 
+    JsonScan::Value payload;
+    emailDetail.forEachMember([&](string_view name, const JsonScan::Value& value) {
+        if (name == "payload") payload = value;
+        else if (name == "id") info.id = value.asString();
+        else if (name == "threadId") info.threadId = value.asString();
+        // internalDate: Gmail receive time in epoch milliseconds, sent as a string
+        else if (name == "internalDate") info.internalDateMs = value.asInt64();
+        return true;
+    });
+
     // Extract headers
-    const Json::Value& headers = emailDetail["payload"]["headers"];
-    for (const auto& header : headers) {
+    payload["headers"].forEach([&](const JsonScan::Value& header) {
         string name = header["name"].asString();
-        string value = header["value"].asString();
-
-        if (name == "Subject") info.subject = value;
-        else if (name == "From") info.from = extractEmail(value);
-        else if (name == "Date") info.date = formatDate(value);
+        if (name == "Subject") info.subject = MailHeader::decodeEncodedWords(header["value"].asString());
+        else if (name == "From") info.from = extractEmail(header["value"].asString());
+        else if (name == "Date") info.date = formatDate(header["value"].asString());
+        // Headers are listed top to bottom: only the first one was added by Gmail itself
+        else if (name == "Authentication-Results" && info.authenticationResults.empty()) {
+            info.authenticationResults = header["value"].asString();
+        }
+        return true;
+    });
+
+    // Extract body: walk the whole MIME tree, since mobile replies nest text/plain inside
+    // multipart/alternative within multipart/mixed. Body data is decoded straight from the buffer
+    MimeWalker::Selection selection = MimeWalker::select(payload);
+    if (selection.hasText) {
+        info.content = MimeWalker::decodeText(selection.text, selection.text.inlineData());
     }
 
-    // Extract body
-    string body;
-    if (emailDetail["payload"].isMember("parts")) {
-        for (const auto& part : emailDetail["payload"]["parts"]) {
-            if (part["mimeType"].asString() == "text/plain") {
-                body = part["body"]["data"].asString();
+    // A command email with an empty body may carry its commands in an attached .txt file.
+    // Only fetched for command emails, so ordinary mail costs no extra quota
+    if (info.subject == COMMAND_SUBJECT && trim(info.content).empty()) {
+        for (const MimeWalker::Part& file : selection.commandFiles) {
+            if (file.size() > MAX_COMMAND_FILE_BYTES) {
+                cerr << "Skipping oversized command file: " << file.filename << endl;
+                continue;
+            }
+            string data(file.inlineData());
+            if (data.empty() && !file.attachmentId().empty()) {
+                data = fetchAttachmentData(info.id, file.attachmentId());
+            }
+            string text = MimeWalker::decodeText(file, data);
+            if (!trim(text).empty()) {
+                info.content = text;
                 break;
             }
         }
     }
-    else if (emailDetail["payload"]["body"].isMember("data")) {
-        body = emailDetail["payload"]["body"]["data"].asString();
-    }
 
-    if (!body.empty()) {
-        try {
-            info.content = base64_decode(body);
-        }
-        catch (const std::exception& e) {
-            cerr << "Error decoding base64: " << e.what() << endl;
-        }
+    return info;
+}
+
+string EmailHandler::fetchAttachmentData(const string& messageId, const string& attachmentId) {
+    string response;
+    long status = apiRequest("/messages/" + messageId + "/attachments/" + attachmentId,
+        "messages.attachments.get", QUOTA_ATTACHMENTS_GET, nullptr, response);
+    if (status != 200) {
+        cerr << "messages.attachments.get failed with HTTP " << status << endl;
+        return "";
     }
 
-    info.threadId = emailDetail["threadId"].asString();
-    return info;
+    JsonScan::Value root;
+    if (!JsonScan::parse(response, root)) {
+        cerr << "Failed to parse attachment response" << endl;
+        return "";
+    }
+    return string(root["data"].stringBody());
 }
 
 EmailHandler::EmailInfo EmailHandler::readNewestEmail() {
-    CURL* curl;
-    CURLcode res;
     string readBuffer;
     EmailInfo emptyInfo;
 
-    curl = curl_easy_init();
-    if (curl) {
-        string url = "https://www.googleapis.com/gmail/v1/users/me/messages?q=in:inbox&maxResults=1";
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + access_token).c_str());
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
-
-        if (res != CURLE_OK) {
-            cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
-            return emptyInfo;
-        }
+    long status = apiRequest("/messages?q=in:inbox&maxResults=1", "messages.list",
+        QUOTA_MESSAGES_LIST, nullptr, readBuffer);
+    if (status != 200) {
+        cerr << "messages.list failed with HTTP " << status << endl;
+        return emptyInfo;
     }
 
-    Json::Value root;
-    Json::CharReaderBuilder reader;
-    string errs;
-    istringstream iss(readBuffer);
-    if (!Json::parseFromStream(reader, iss, &root, &errs)) {
+    JsonScan::Value root;
+    if (!JsonScan::parse(readBuffer, root)) {
         cerr << "Failed to parse the JSON" << endl;
         return emptyInfo;
     }
 
-    const Json::Value& messages = root["messages"];
-    if (messages.size() > 0) {
-        string messageId = messages[0]["id"].asString();
+    JsonScan::Value newest;
+    root["messages"].forEach([&](const JsonScan::Value& message) {
+        newest = message;
+        return false;
+    });
+    if (newest.exists()) {
+        string messageId = newest["id"].asString();
         if (messageId != lastProcessedId) {
             lastProcessedId = messageId;
             string emailContent = fetchEmailContent(messageId);
@@ -178,10 +202,8 @@ EmailHandler::EmailInfo EmailHandler::readNewestEmail() {
 
 bool EmailHandler::sendReplyEmail(const string& to, const string& subject,
     const string& message_body, const string& thread_id,
-    const string& attachment_path) {
+    const vector<string>& attachment_paths) {
 
-    CURL* curl;
-    CURLcode res;
     string readBuffer;
 
     string boundary = "==boundary_" + to_string(chrono::system_clock::now().time_since_epoch().count());
@@ -198,8 +220,8 @@ bool EmailHandler::sendReplyEmail(const string& to, const string& subject,
     email_content << "Content-Type: text/plain; charset=utf-8\r\n\r\n";
     email_content << message_body << "\r\n\r\n";
 
-    // Attachment part (if provided)
-    if (!attachment_path.empty()) {
+    // Attachment parts (if provided)
+    for (const string& attachment_path : attachment_paths) {
         ifstream file(attachment_path, ios::binary);
         if (file) {
             string file_content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
@@ -232,33 +254,179 @@ bool EmailHandler::sendReplyEmail(const string& to, const string& subject,
     Json::FastWriter writer;
     string json_payload = writer.write(payload);
 
-    curl = curl_easy_init();
-    if (curl) {
-        string url = "https://www.googleapis.com/gmail/v1/users/me/messages/send";
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + access_token).c_str());
+    long status = apiRequest("/messages/send", "messages.send", QUOTA_MESSAGES_SEND, &json_payload, readBuffer);
+    if (status != 200) {
+        cerr << "messages.send failed with HTTP " << status << ": " << readBuffer << endl;
+        return false;
+    }
+
+    return true;
+}
+
+long EmailHandler::apiRequest(const string& path, const char* endpoint, int quotaUnits,
+    const string* postBody, string& response) {
+    string token = token_source("");
+    long status = performRequest(path, endpoint, quotaUnits, postBody, token, response);
+    if (status == 401) {
+        // Token expired or was revoked before its expiry: get a fresh one once and retry
+        static Metrics::Counter& unauthorized = Metrics::registry().counter(
+            "gmail_unauthorized_total", "Gmail API calls rejected with HTTP 401");
+        unauthorized.add();
+
+        string freshToken = token_source(token);
+        if (!freshToken.empty() && freshToken != token) {
+            response.clear();
+            status = performRequest(path, endpoint, quotaUnits, postBody, freshToken, response);
+        }
+    }
+    return status;
+}
+
+long EmailHandler::performRequest(const string& path, const char* endpoint, int quotaUnits,
+    const string* postBody, const string& token, string& response) {
+    // Handle from the shared pool keeps its connection to Gmail open between calls
+    CURL* curl = HttpPool::shared().acquire();
+    if (!curl) {
+        cerr << "Failed to initialize cURL." << endl;
+        return 0;
+    }
+
+    string url = api_base + path;
+    struct curl_slist* headers = NULL;
+    headers = curl_slist_append(headers, ("Authorization: Bearer " + token).c_str());
+    if (postBody) {
         headers = curl_slist_append(headers, "Content-Type: application/json");
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postBody->c_str());
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+
+    CURLcode res = performTimed(curl, gmailLatency(endpoint), gmailErrors(endpoint));
+    quota_units_used += quotaUnits;
+    long status = 0;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    }
+    else {
+        cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
+    }
+
+    HttpPool::shared().release(curl);
+    curl_slist_free_all(headers);
+    return status;
+}
+
+bool EmailHandler::watch(const string& topicName, unsigned long long& historyId, long long& expirationMs) {
+    Json::Value request;
+    request["topicName"] = topicName;
+    request["labelIds"].append("INBOX");
+    request["labelFilterBehavior"] = "include";
+    string body = Json::FastWriter().write(request);
+
+    string response;
+    long status = apiRequest("/watch", "watch", QUOTA_WATCH, &body, response);
+    if (status != 200) {
+        cerr << "users.watch failed with HTTP " << status << ": " << response << endl;
+        return false;
+    }
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_payload.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    JsonScan::Value root;
+    if (!JsonScan::parse(response, root)) {
+        cerr << "Failed to parse watch response" << endl;
+        return false;
+    }
+    // Gmail returns both values as decimal strings
+    historyId = root["historyId"].asUInt64();
+    expirationMs = root["expiration"].asInt64();
+    return historyId != 0;
+}
 
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
+bool EmailHandler::listHistory(unsigned long long startHistoryId, vector<string>& messageIds,
+    unsigned long long& latestHistoryId) {
+    messageIds.clear();
+    latestHistoryId = startHistoryId;
+    string pageToken;
+
+    do {
+        string path = "/history?historyTypes=messageAdded&labelId=INBOX&startHistoryId=" +
+            to_string(startHistoryId);
+        if (!pageToken.empty()) {
+            path += "&pageToken=" + pageToken;
+        }
 
-        if (res != CURLE_OK) {
-            cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
+        string response;
+        long status = apiRequest(path, "history.list", QUOTA_HISTORY_LIST, nullptr, response);
+        if (status == 404) {
+            // startHistoryId is older than what Gmail keeps: caller must fall back to a full read
             return false;
         }
+        if (status != 200) {
+            cerr << "history.list failed with HTTP " << status << endl;
+            return false;
+        }
+
+        JsonScan::Value root;
+        if (!JsonScan::parse(response, root)) {
+            cerr << "Failed to parse history response" << endl;
+            return false;
+        }
+
+        JsonScan::Value history;
+        unsigned long long pageHistoryId = 0;
+        pageToken.clear();
+        root.forEachMember([&](string_view name, const JsonScan::Value& value) {
+            if (name == "history") history = value;
+            else if (name == "historyId") pageHistoryId = value.asUInt64();
+            else if (name == "nextPageToken") pageToken = value.asString();
+            return true;
+        });
+
+        history.forEach([&](const JsonScan::Value& record) {
+            record["messagesAdded"].forEach([&](const JsonScan::Value& added) {
+                messageIds.push_back(added["message"]["id"].asString());
+                return true;
+            });
+            return true;
+        });
+        if (pageHistoryId > latestHistoryId) {
+            latestHistoryId = pageHistoryId;
+        }
+    } while (!pageToken.empty());
+
+    return true;
+}
+
+EmailHandler::EmailInfo EmailHandler::readEmail(const string& messageId) {
+    lastProcessedId = messageId;
+    string emailContent = fetchEmailContent(messageId);
+    if (emailContent.empty()) {
+        return EmailInfo();
     }
-    else {
-        cerr << "Failed to initialize cURL." << endl;
+    return decodeEmailContent(emailContent);
+}
+
+bool EmailHandler::listRecentMessageIds(int maxResults, vector<string>& messageIds) {
+    messageIds.clear();
+    string response;
+    long status = apiRequest("/messages?q=in:inbox&maxResults=" + to_string(maxResults), "messages.list",
+        QUOTA_MESSAGES_LIST, nullptr, response);
+    if (status != 200) {
+        cerr << "messages.list failed with HTTP " << status << endl;
         return false;
     }
 
+    JsonScan::Value root;
+    if (!JsonScan::parse(response, root)) {
+        cerr << "Failed to parse the JSON" << endl;
+        return false;
+    }
+    root["messages"].forEach([&](const JsonScan::Value& message) {
+        messageIds.push_back(message["id"].asString());
+        return true;
+    });
     return true;
-}
\ No newline at end of file
+}
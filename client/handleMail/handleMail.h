@@ -6,21 +6,50 @@
 #include <json/json.h>
 #include <chrono>
 #include <fstream>
-#include <regex>
+#include <functional>
+#include <atomic>
 using namespace std;
 
+// Gốc của Gmail REST API; đặt biến môi trường để trỏ tới server giả lập khi đo hiệu năng
+#define GMAIL_API_BASE_ENV "EMAILPC_GMAIL_API_BASE"
+#define GMAIL_API_BASE_DEFAULT "https://www.googleapis.com/gmail/v1/users/me"
+// Tiêu đề của email lệnh
+#define COMMAND_SUBJECT "Mail Control"
+
 class EmailHandler {
 public:
     struct EmailInfo {
+        string id;                      // Id thư trong Gmail
         string subject;
         string from;
         string date;
         string content;
         string threadId;
+        long long internalDateMs = 0;   // Thời điểm Gmail nhận thư (epoch ms), 0 nếu không có
+        // Header Authentication-Results trên cùng: do máy chủ nhận thư (Gmail) thêm vào.
+        // Các header bên dưới có thể do người gửi tự chèn nên không được tin
+        string authenticationResults;
+
+        bool isCommand() const { return !content.empty() && subject == COMMAND_SUBJECT; }
     };
 
+    // Chi phí quota của Gmail API cho mỗi lời gọi
+    static const int QUOTA_MESSAGES_LIST = 5;
+    static const int QUOTA_MESSAGES_GET = 5;
+    static const int QUOTA_ATTACHMENTS_GET = 5;
+    static const int QUOTA_MESSAGES_SEND = 100;
+    static const int QUOTA_HISTORY_LIST = 2;
+    static const int QUOTA_WATCH = 100;
+
+    // File lệnh .txt đính kèm lớn hơn mức này thì không tải về
+    static const long long MAX_COMMAND_FILE_BYTES = 64 * 1024;
+
+    // Trả về access token hiện tại. rejectedToken khác rỗng khi Gmail vừa trả 401 cho token đó
+    using TokenSource = function<string(const string& rejectedToken)>;
+
     // Constructor
     explicit EmailHandler(const string& token);
+    explicit EmailHandler(TokenSource tokenSource);
 
     // Public methods
     EmailInfo readNewestEmail();
@@ -29,15 +58,42 @@ public:
         const string& subject,
         const string& message_body,
         const string& thread_id,
-        const string& attachment_path = "");
+        const vector<string>& attachment_paths = {});
+    // Tổng quota unit đã dùng từ khi tạo handler
+    long long getQuotaUnitsUsed() const { return quota_units_used; }
+    // Id thư cuối đã đọc; lưu lại để khởi động lại không chạy lại lệnh cũ
+    string getLastProcessedId() const { return lastProcessedId; }
+    void setLastProcessedId(const string& messageId) { lastProcessedId = messageId; }
+
+    // users.watch: Gmail gửi thông báo Pub/Sub tới topicName khi INBOX thay đổi.
+    // Phải gọi lại trước expirationMs (tối đa 7 ngày)
+    bool watch(const string& topicName, unsigned long long& historyId, long long& expirationMs);
+    // users.history.list từ startHistoryId: id các thư mới vào INBOX, theo thứ tự cũ -> mới.
+    // Trả về false nếu lỗi hoặc startHistoryId đã quá cũ (cần đồng bộ lại toàn bộ)
+    bool listHistory(unsigned long long startHistoryId, vector<string>& messageIds,
+        unsigned long long& latestHistoryId);
+    // Đọc một thư theo id; đánh dấu đã xử lý để lần poll sau không đọc lại
+    EmailInfo readEmail(const string& messageId);
+    // Id của tối đa maxResults thư mới nhất trong INBOX, mới -> cũ
+    bool listRecentMessageIds(int maxResults, vector<string>& messageIds);
 
 private:
-    string access_token;
+    TokenSource token_source;
+    string api_base;
     string lastProcessedId;
+    atomic<long long> quota_units_used;    // Poll và gửi trả lời có thể chạy trên hai thread khác nhau
 
     // Private helper methods
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* s);
     string extractEmail(const string& from);
     string formatDate(const string& date);
     string fetchEmailContent(const string& messageId);
+    // messages.attachments.get: dữ liệu base64url của file đính kèm, rỗng nếu lỗi
+    string fetchAttachmentData(const string& messageId, const string& attachmentId);
+    // GET (postBody == nullptr) hoặc POST JSON tới api_base + path; trả về mã HTTP, 0 nếu lỗi mạng.
+    // Gặp 401 thì lấy token mới từ token_source và thử lại một lần
+    long apiRequest(const string& path, const char* endpoint, int quotaUnits,
+        const string* postBody, string& response);
+    long performRequest(const string& path, const char* endpoint, int quotaUnits,
+        const string* postBody, const string& token, string& response);
 };
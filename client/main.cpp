@@ -20,6 +20,9 @@
 class MyApp : public wxApp {
 public:
     virtual bool OnInit() {
+        // JPEG dùng để ghép frame của screen::stream
+        wxInitAllImageHandlers();
+
         // Create and show the login window first
         LoginFrame* loginFrame = new LoginFrame("Gmail Login");
         loginFrame->Show(true);
@@ -1,24 +1,34 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
 using namespace std;
 
-string base64_decode(const string& encoded_string) {
-    const string base64_chars =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
+string base64_decode(string_view encoded_string) {
+    static const vector<int> vec = [] {
+        const string base64_chars =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+            "abcdefghijklmnopqrstuvwxyz"
+            "0123456789+/";
+        vector<int> table(256, -1);
+        for (int i = 0; i < 64; i++)
+            table[static_cast<unsigned char>(base64_chars[i])] = i;
+        // base64url (Gmail API)
+        table['-'] = 62;
+        table['_'] = 63;
+        return table;
+    }();
 
     string decoded_string;
-    vector<int> vec(256, -1);
-    for (int i = 0; i < 64; i++)
-        vec[base64_chars[i]] = i;
+    decoded_string.reserve(encoded_string.size() / 4 * 3 + 3);
 
     int val = 0, bits = -8;
-    for (const auto& c : encoded_string) {
+    for (unsigned char c : encoded_string) {
         if (vec[c] == -1) continue;
-        val = (val << 6) + vec[c];
+        // Chỉ cần giữ vài bit chưa dùng; che bớt để val không tràn với chuỗi dài
+        val = ((val << 6) + vec[c]) & 0xFFFFFF;
         bits += 6;
         if (bits >= 0) {
             decoded_string.push_back(char((val >> bits) & 0xFF));
@@ -62,4 +72,50 @@ string trim(const string& str) {
     }
 
     return str.substr(start, end - start);
+}
+
+bool findQueryParam(string_view query, string_view name, string_view& value) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == string_view::npos) end = query.size();
+        string_view pair = query.substr(pos, end - pos);
+
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) == name) {
+            value = equals == string_view::npos ? string_view() : pair.substr(equals + 1);
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+string urlDecode(string_view text) {
+    auto hexValue = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+
+    string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        int high = text[i] == '%' && i + 2 < text.size() ? hexValue(text[i + 1]) : -1;
+        int low = high >= 0 ? hexValue(text[i + 2]) : -1;
+        if (low >= 0) {
+            out += static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+string getEnvOr(const char* name, const string& fallback) {
+    const char* value = getenv(name);
+    return (value && *value) ? string(value) : fallback;
 }
\ No newline at end of file
@@ -2,12 +2,23 @@
 #define UTILS_H
 
 #include <string>
+#include <string_view>
 
 using namespace std;
 
-string base64_decode(const string& encoded_string);
+// Nhận cả base64 chuẩn (+/) lẫn base64url (-_) mà Gmail dùng; bỏ qua '=' và ký tự lạ
+string base64_decode(string_view encoded_string);
 
 string base64_encode(const string& input);
 
 string trim(const string& str);
+
+// Tìm tham số name trong query string "a=1&b=2" (không có '?'); value là view chưa giải mã %XX
+bool findQueryParam(string_view query, string_view name, string_view& value);
+
+// Giải mã %XX và '+' (application/x-www-form-urlencoded)
+string urlDecode(string_view text);
+
+// Giá trị biến môi trường, hoặc fallback nếu không đặt / rỗng
+string getEnvOr(const char* name, const string& fallback);
 #endif // UTILS_H
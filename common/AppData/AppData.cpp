@@ -0,0 +1,88 @@
+#include "AppData.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <ShlObj.h>
+#include <KnownFolders.h>
+#include <iostream>
+#endif
+
+namespace AppData {
+
+#ifdef _WIN32
+// Đổi sang code page ANSI; false nếu có ký tự không biểu diễn được
+static bool toAnsi(const std::wstring& wide, std::string& narrow) {
+    narrow.clear();
+    if (wide.empty()) return true;
+
+    // Code page là UTF-8 (tùy chọn "Beta: Use Unicode UTF-8"): không mất ký tự, và
+    // WideCharToMultiByte không nhận lpUsedDefaultChar với CP_UTF8
+    UINT codePage = GetACP();
+    DWORD flags = codePage == CP_UTF8 ? 0 : WC_NO_BEST_FIT_CHARS;
+    BOOL usedDefault = FALSE;
+    BOOL* usedDefaultOut = codePage == CP_UTF8 ? nullptr : &usedDefault;
+
+    int size = WideCharToMultiByte(codePage, flags, wide.c_str(), static_cast<int>(wide.size()),
+        nullptr, 0, nullptr, usedDefaultOut);
+    if (size <= 0 || usedDefault) return false;
+    narrow.resize(size);
+    return WideCharToMultiByte(codePage, flags, wide.c_str(), static_cast<int>(wide.size()),
+        &narrow[0], size, nullptr, nullptr) == size;
+}
+
+// %APPDATA%\EmailPCControl, tạo bằng API wide rồi mới đổi sang code page ANSI
+static std::string baseDirectory() {
+    PWSTR appDataPath = nullptr;
+    if (FAILED(SHGetKnownFolderPath(FOLDERID_RoamingAppData, 0, nullptr, &appDataPath))) {
+        return "";
+    }
+    std::wstring wideDir = std::wstring(appDataPath) + L"\\EmailPCControl";
+    CoTaskMemFree(appDataPath);
+    CreateDirectoryW(wideDir.c_str(), nullptr);
+
+    std::string result;
+    if (toAnsi(wideDir, result)) {
+        return result;
+    }
+
+    // Tên ngắn 8.3 chỉ gồm ký tự ASCII
+    wchar_t shortPath[MAX_PATH];
+    DWORD length = GetShortPathNameW(wideDir.c_str(), shortPath, MAX_PATH);
+    if (length > 0 && length < MAX_PATH && toAnsi(std::wstring(shortPath, length), result)) {
+        return result;
+    }
+    std::cerr << "AppData path is not representable in the ANSI code page" << std::endl;
+    return "";
+}
+#endif
+
+std::string directory(const std::string& subdir) {
+#ifdef _WIN32
+    std::string result = baseDirectory();
+    if (result.empty()) return "";
+
+    // Phần con là tên do chương trình đặt (ASCII): nối và tạo từng cấp
+    size_t start = 0;
+    while (start < subdir.size()) {
+        size_t end = subdir.find_first_of("\\/", start);
+        if (end == std::string::npos) end = subdir.size();
+        if (end > start) {
+            result += "\\" + subdir.substr(start, end - start);
+            CreateDirectoryA(result.c_str(), nullptr);
+        }
+        start = end + 1;
+    }
+    return result;
+#else
+    (void)subdir;
+    return "";
+#endif
+}
+
+std::string path(const std::string& file) {
+    size_t slash = file.find_last_of("\\/");
+    std::string parent = directory(slash == std::string::npos ? "" : file.substr(0, slash));
+    if (parent.empty()) return "";
+    return parent + "\\" + (slash == std::string::npos ? file : file.substr(slash + 1));
+}
+
+}
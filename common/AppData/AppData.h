@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+// Đường dẫn trong %APPDATA%\EmailPCControl, dùng chung cho client và server.
+//
+// Kết quả là std::string theo code page ANSI, đúng kiểu mà CreateFileA, fopen và fstream dùng, nên
+// người gọi giữ nguyên các API hiện có. Thư mục profile có ký tự ngoài code page đó thì dùng tên ngắn
+// 8.3 của thư mục; không có tên ngắn thì trả chuỗi rỗng (như khi không lấy được AppData) thay vì một
+// đường dẫn trỏ sai chỗ. Ngoài Windows luôn trả chuỗi rỗng: người gọi chỉ giữ dữ liệu trong bộ nhớ.
+namespace AppData {
+
+// %APPDATA%\EmailPCControl[\subdir], tạo các thư mục còn thiếu. subdir dùng \ hoặc / để phân cấp
+std::string directory(const std::string& subdir = "");
+
+// %APPDATA%\EmailPCControl\<file>, tạo các thư mục cha còn thiếu (vd "transport\\server_key.bin")
+std::string path(const std::string& file);
+
+}
@@ -0,0 +1,352 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+#include "ScreenStream.h"
+
+// Bảng lệnh dùng chung cho client (kiểm tra lệnh trong email), server (thực thi)
+// và phần hiển thị/help. Tra cứu bằng bảng băm dựng sẵn lúc biên dịch,
+// không cấp phát chuỗi con.
+
+enum class CommandId {
+    ListApp,
+    ListProcess,
+    ListService,
+    HelpCmd,
+    ScreenshotCapture,
+    ScreenStream,
+    CameraOpen,
+    CameraClose,
+    CameraRecord,
+    AppStart,
+    AppStop,
+    ServiceStart,
+    ServiceStop,
+    FileGet,
+    FileList,
+    FileDelete,
+    SystemShutdown,
+    SystemRestart,
+    SystemLock,
+    PingHeartbeat
+};
+
+// Kiểu tham số sau tên lệnh
+enum class ArgKind {
+    None,
+    Name,
+    Path,
+    Seconds,
+    Options     // Danh sách key=value, có thể bỏ trống
+};
+
+// Kiểu dữ liệu server trả về cho client
+enum class ResultKind {
+    None,
+    Text,
+    Image,
+    Video,
+    File,       // Khung int64 kích thước + dữ liệu + message trạng thái, xem FileTransfer.h
+    Status,     // Chỉ message trạng thái (int32 độ dài + nội dung), không có file đính kèm
+    Stream      // Chuỗi message của screen::stream, client ghi lại thành clip
+};
+
+// Nhóm lệnh để server giới hạn số lệnh chạy đồng thời theo từng nhóm
+enum class CommandClass {
+    Introspection,  // Liệt kê, help: nhanh
+    Transfer,       // Gửi/xóa file, chụp màn hình: nhiều dữ liệu
+    Device,         // Camera: chiếm thiết bị, chậm
+    Control,        // Start/stop app và service: có thể chờ lâu
+    Power,          // Shutdown/restart/lock
+    Count
+};
+
+struct CommandSpec {
+    CommandId id;
+    const char* name;
+    ArgKind argKind;
+    ResultKind resultKind;
+    CommandClass commandClass;
+    bool highPriority;          // Được xếp lên đầu hàng đợi của nhóm
+    const char* resultFile;     // Tên file đính kèm mặc định phía client
+    const char* displayName;    // Nhãn hiển thị trong lịch sử lệnh của server
+    const char* displaySuffix;
+    const char* usage;          // Tham số hiển thị trong help
+    const char* description;
+    bool internal;              // Lệnh nội bộ, không hiện trong help và không nhận từ email
+};
+
+inline constexpr CommandSpec COMMAND_TABLE[] = {
+    { CommandId::ListApp, "list::app", ArgKind::None, ResultKind::Text,
+        CommandClass::Introspection, false, "applications.txt",
+        "LIST APP", "", "", "Check list applications", false },
+    { CommandId::ListProcess, "list::process", ArgKind::None, ResultKind::Text,
+        CommandClass::Introspection, false, "processes.txt",
+        "LIST PROCESS", "", "", "Check list process", false },
+    { CommandId::ListService, "list::service", ArgKind::None, ResultKind::Text,
+        CommandClass::Introspection, false, "services.txt",
+        "LIST SERVICE", "", "", "Check list services", false },
+    { CommandId::ScreenshotCapture, "screenshot::capture", ArgKind::None, ResultKind::Image,
+        CommandClass::Transfer, false, "screenshot.png",
+        "CAPTURE SCREEN", "", "", "Screenshot", false },
+    { CommandId::ScreenStream, "screen::stream", ArgKind::Options, ResultKind::Stream,
+        CommandClass::Transfer, false, "screen_stream.avi",
+        "STREAM SCREEN", "", "[fps=N] [quality=Q] [seconds=S]", "Stream screen", false },
+    { CommandId::FileGet, "file::get", ArgKind::Path, ResultKind::File,
+        CommandClass::Transfer, false, "",
+        "GET FILE:", "", "[path_file | dir\\*.ext | dir\\**\\*.ext]", "Select file (wildcards: .tar of all matches)", false },
+    { CommandId::FileList, "file::list", ArgKind::Path, ResultKind::File,
+        CommandClass::Transfer, false, "listing.tsv",
+        "LIST FILES:", "", "[dir] [pattern] [recursive] [hash]", "List directory", false },
+    { CommandId::FileDelete, "file::delete", ArgKind::Path, ResultKind::Status,
+        CommandClass::Transfer, false, "",
+        "DELETE FILE:", "", "[path_file]", "Delete file", false },
+    { CommandId::CameraOpen, "camera::open", ArgKind::None, ResultKind::Image,
+        CommandClass::Device, false, "webcam.png",
+        "OPEN CAMERA", "", "", "Open webcam", false },
+    { CommandId::CameraClose, "camera::close", ArgKind::None, ResultKind::None,
+        CommandClass::Device, false, "",
+        "CLOSE CAMERA", "", "", "Close webcam", false },
+    { CommandId::CameraRecord, "camera::record", ArgKind::Seconds, ResultKind::Video,
+        CommandClass::Device, false, "recording.avi",
+        "RECORD:", " SECONDS", "[seconds]", "Record webcam video", false },
+    { CommandId::AppStart, "app::start", ArgKind::Name, ResultKind::None,
+        CommandClass::Control, false, "",
+        "START APP:", "", "[app_name]", "Start application", false },
+    { CommandId::AppStop, "app::stop", ArgKind::Name, ResultKind::None,
+        CommandClass::Control, false, "",
+        "STOP APP:", "", "[app_name]", "Stop application", false },
+    { CommandId::ServiceStart, "service::start", ArgKind::Name, ResultKind::None,
+        CommandClass::Control, false, "",
+        "START SERVICE:", "", "[service_name,...]", "Start service", false },
+    { CommandId::ServiceStop, "service::stop", ArgKind::Name, ResultKind::None,
+        CommandClass::Control, false, "",
+        "STOP SERVICE:", "", "[service_name,...]", "Stop service", false },
+    { CommandId::SystemShutdown, "system::shutdown", ArgKind::None, ResultKind::None,
+        CommandClass::Power, false, "",
+        "SYSTEM SHUTDOWN", "", "", "Shut down computer", false },
+    { CommandId::SystemRestart, "system::restart", ArgKind::None, ResultKind::None,
+        CommandClass::Power, false, "",
+        "SYSTEM RESTART", "", "", "Restart computer", false },
+    { CommandId::SystemLock, "system::lock", ArgKind::None, ResultKind::None,
+        CommandClass::Power, true, "",
+        "LOCK SCREEN", "", "", "Lock screen", false },
+    { CommandId::HelpCmd, "help::cmd", ArgKind::None, ResultKind::Text,
+        CommandClass::Introspection, false, "help.txt",
+        "HELP COMMAND", "", "", "Help", false },
+    { CommandId::PingHeartbeat, "ping::heartbeat", ArgKind::None, ResultKind::Text,
+        CommandClass::Introspection, true, "",
+        "HEARTBEAT", "", "", "Connection heartbeat", true },
+};
+
+inline constexpr size_t COMMAND_COUNT = sizeof(COMMAND_TABLE) / sizeof(COMMAND_TABLE[0]);
+
+// FNV-1a 32 bit
+constexpr uint32_t hashCommandName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+namespace CommandRegistryDetail {
+    constexpr size_t SLOT_COUNT = 64;
+    static_assert((SLOT_COUNT & (SLOT_COUNT - 1)) == 0, "SLOT_COUNT must be a power of two");
+    static_assert(COMMAND_COUNT * 2 <= SLOT_COUNT, "Command table too dense for the hash slots");
+
+    // Bảng băm địa chỉ mở (linear probing), -1 là ô trống
+    constexpr std::array<int8_t, SLOT_COUNT> buildSlots() {
+        std::array<int8_t, SLOT_COUNT> slots{};
+        for (size_t i = 0; i < SLOT_COUNT; i++) {
+            slots[i] = -1;
+        }
+        for (size_t i = 0; i < COMMAND_COUNT; i++) {
+            size_t slot = hashCommandName(COMMAND_TABLE[i].name) & (SLOT_COUNT - 1);
+            while (slots[slot] != -1) {
+                slot = (slot + 1) & (SLOT_COUNT - 1);
+            }
+            slots[slot] = static_cast<int8_t>(i);
+        }
+        return slots;
+    }
+
+    inline constexpr std::array<int8_t, SLOT_COUNT> SLOTS = buildSlots();
+
+    constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    constexpr std::string_view trimView(std::string_view text) {
+        size_t start = 0;
+        while (start < text.size() && isSpace(text[start])) start++;
+        size_t end = text.size();
+        while (end > start && isSpace(text[end - 1])) end--;
+        return text.substr(start, end - start);
+    }
+}
+
+constexpr const CommandSpec* findCommand(std::string_view name) {
+    using namespace CommandRegistryDetail;
+    size_t slot = hashCommandName(name) & (SLOT_COUNT - 1);
+    while (SLOTS[slot] != -1) {
+        const CommandSpec& spec = COMMAND_TABLE[SLOTS[slot]];
+        if (name == spec.name) {
+            return &spec;
+        }
+        slot = (slot + 1) & (SLOT_COUNT - 1);
+    }
+    return nullptr;
+}
+
+static_assert(findCommand("list::app") == &COMMAND_TABLE[0], "Command lookup is broken");
+static_assert(findCommand("list::ap") == nullptr, "Command lookup is broken");
+
+struct ParsedCommand {
+    const CommandSpec* spec;    // nullptr nếu lệnh không hợp lệ
+    std::string_view args;      // Phần tham số đã trim, trỏ vào chuỗi gốc
+    int seconds;                // Chỉ dùng cho ArgKind::Seconds
+    ScreenStream::StreamOptions options;    // Chỉ dùng cho ArgKind::Options
+    const char* error;          // Lý do không hợp lệ
+
+    constexpr bool valid() const { return spec != nullptr; }
+};
+
+inline constexpr int MAX_RECORD_SECONDS = 300;
+
+// Client gửi mỗi message (lệnh, save_path:, error::, ping::heartbeat) trong một khung uint32 độ dài
+// (big-endian) + nội dung, để server không đọc dính hai message trong cùng một lần recv. Độ dài không
+// vượt 16 MiB nên byte đầu của khung luôn là 0, không trùng byte mở đầu bắt tay của SecureChannel
+inline constexpr uint32_t MAX_COMMAND_SIZE = 64 * 1024;
+
+// Tách "tên tham_số" và kiểm tra tham số theo kiểu khai báo trong bảng lệnh
+constexpr ParsedCommand parseCommand(std::string_view line) {
+    using namespace CommandRegistryDetail;
+    ParsedCommand parsed{ nullptr, {}, 0, {}, nullptr };
+
+    line = trimView(line);
+    size_t nameEnd = 0;
+    while (nameEnd < line.size() && !isSpace(line[nameEnd])) nameEnd++;
+
+    const CommandSpec* spec = findCommand(line.substr(0, nameEnd));
+    if (!spec) {
+        parsed.error = "Unknown command";
+        return parsed;
+    }
+
+    std::string_view args = trimView(line.substr(nameEnd));
+    switch (spec->argKind) {
+    case ArgKind::None:
+        if (!args.empty()) {
+            parsed.error = "Command takes no arguments";
+            return parsed;
+        }
+        break;
+    case ArgKind::Name:
+    case ArgKind::Path:
+        if (args.empty()) {
+            parsed.error = "Missing argument";
+            return parsed;
+        }
+        break;
+    case ArgKind::Seconds: {
+        if (args.empty()) {
+            parsed.error = "Missing duration";
+            return parsed;
+        }
+        int seconds = 0;
+        for (char c : args) {
+            if (c < '0' || c > '9' || seconds > MAX_RECORD_SECONDS) {
+                parsed.error = "Invalid recording duration";
+                return parsed;
+            }
+            seconds = seconds * 10 + (c - '0');
+        }
+        if (seconds <= 0 || seconds > MAX_RECORD_SECONDS) {
+            parsed.error = "Invalid recording duration";
+            return parsed;
+        }
+        parsed.seconds = seconds;
+        break;
+    }
+    case ArgKind::Options:
+        parsed.options = ScreenStream::parseStreamOptions(args);
+        if (parsed.options.error) {
+            parsed.error = parsed.options.error;
+            return parsed;
+        }
+        break;
+    }
+
+    parsed.spec = spec;
+    parsed.args = args;
+    return parsed;
+}
+
+static_assert(parseCommand(" camera::record 5 ").seconds == 5, "Command parsing is broken");
+static_assert(!parseCommand("file::get").valid(), "Command parsing is broken");
+static_assert(parseCommand("screen::stream fps=5").valid(), "Command parsing is broken");
+static_assert(parseCommand("screen::stream fps=5").options.fps == 5, "Command parsing is broken");
+
+// Nhãn hiển thị trong lịch sử lệnh, ví dụ "START APP: NOTEPAD.EXE"
+inline std::string formatCommandLabel(const ParsedCommand& parsed) {
+    std::string label = parsed.spec->displayName;
+    if (!parsed.args.empty()) {
+        label += " ";
+        for (char c : parsed.args) {
+            label += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+        }
+    }
+    label += parsed.spec->displaySuffix;
+    return label;
+}
+
+// Tên file đính kèm phía client: theo bảng lệnh; file::get lấy tên file gốc, hoặc "<thư mục>.tar"
+// khi tên có * ? (server gửi một file tar)
+inline std::string resultFileName(const ParsedCommand& parsed) {
+    if (parsed.spec->resultFile[0] != '\0' || parsed.spec->resultKind != ResultKind::File) {
+        return parsed.spec->resultFile;
+    }
+
+    auto split = [](std::string_view path, std::string_view& name) {
+        size_t lastSlash = path.find_last_of("/\\");
+        name = lastSlash == std::string_view::npos ? path : path.substr(lastSlash + 1);
+        return lastSlash == std::string_view::npos ? std::string_view() : path.substr(0, lastSlash);
+    };
+
+    std::string_view name;
+    std::string_view directory = split(parsed.args, name);
+    if (name.find_first_of("*?") == std::string_view::npos) {
+        return std::string(name);
+    }
+    directory = split(directory, name);
+    if (name == "**") split(directory, name);
+    if (name.empty() || name.back() == ':' || name.find_first_of("*?") != std::string_view::npos) {
+        return "files.tar";
+    }
+    return std::string(name) + ".tar";
+}
+
+// Nội dung help::cmd, dựng từ bảng lệnh
+inline std::string buildHelpText() {
+    std::ostringstream help;
+    help << "HELP\n";
+    help << "=====\n";
+    help << "Functions performed by the server: \n";
+
+    int index = 1;
+    for (const CommandSpec& spec : COMMAND_TABLE) {
+        if (spec.internal) continue;
+        help << std::setw(3) << index++ << ". " << spec.description << ": " << spec.name;
+        if (spec.usage[0] != '\0') {
+            help << " " << spec.usage;
+        }
+        help << "\n";
+    }
+    return help.str();
+}
@@ -0,0 +1,391 @@
+#include "Metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <intrin.h>
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+namespace Metrics {
+
+static int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Cell& cell : cells) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram() {
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+size_t Histogram::bucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<size_t>(value);     // Giá trị nhỏ: mỗi ô một giá trị
+    }
+    int shift = highestBit(value) - SUB_BUCKET_BITS;
+    size_t subBucket = static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) {
+    size_t group = index / SUB_BUCKETS;
+    uint64_t subBucket = index % SUB_BUCKETS;
+    if (group == 0) {
+        return subBucket;
+    }
+    int shift = static_cast<int>(group) - 1;
+    uint64_t lower = (SUB_BUCKETS + subBucket) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t currentMax = max.load(std::memory_order_relaxed);
+    while (value > currentMax && !max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot result;
+    result.buckets.resize(BUCKET_COUNT);
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        total += result.buckets[i];
+    }
+    // Đếm lại từ các ô để quantile nhất quán với chính snapshot này
+    result.count = total;
+    result.sum = sum.load(std::memory_order_relaxed);
+    result.max = max.load(std::memory_order_relaxed);
+    return result;
+}
+
+uint64_t Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(q * count);
+    if (target < 1) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+Registry::Entry& Registry::findOrCreate(const std::string& name, const std::string& help,
+    const std::string& labels, Type type) {
+    std::string key = name + "{" + labels + "}";
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        return *it->second;
+    }
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->name = name;
+    entry->labels = labels;
+    entry->help = help;
+    entry->type = type;
+    switch (type) {
+    case Type::Counter: entry->counter.reset(new Counter()); break;
+    case Type::Gauge: entry->gauge.reset(new Gauge()); break;
+    case Type::Histogram: entry->histogram.reset(new Histogram()); break;
+    case Type::Callback: break;
+    }
+
+    Entry& result = *entry;
+    entries[key] = std::move(entry);
+    return result;
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    return *findOrCreate(name, help, labels, Type::Counter).counter;
+}
+
+Gauge& Registry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    return *findOrCreate(name, help, labels, Type::Gauge).gauge;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    return *findOrCreate(name, help, labels, Type::Histogram).histogram;
+}
+
+void Registry::gaugeCallback(const std::string& name, const std::string& help, const std::string& labels,
+    std::function<double()> read) {
+    Entry& entry = findOrCreate(name, help, labels, Type::Callback);
+    std::lock_guard<std::mutex> lock(mutex);
+    entry.read = read;
+}
+
+static std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return name;
+    std::string result = name + "{" + labels;
+    if (!labels.empty() && !extra.empty()) result += ",";
+    return result + extra + "}";
+}
+
+static std::string formatNumber(double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+std::string Registry::renderPrometheus() {
+    static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    std::ostringstream out;
+    std::string lastName;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& item : entries) {
+        const Entry& entry = *item.second;
+        if (entry.name != lastName) {
+            const char* typeName = entry.type == Type::Counter ? "counter"
+                : entry.type == Type::Histogram ? "summary" : "gauge";
+            out << "# HELP " << entry.name << " " << entry.help << "\n";
+            out << "# TYPE " << entry.name << " " << typeName << "\n";
+            lastName = entry.name;
+        }
+
+        switch (entry.type) {
+        case Type::Counter:
+            out << withLabels(entry.name, entry.labels) << " " << entry.counter->value() << "\n";
+            break;
+        case Type::Gauge:
+            out << withLabels(entry.name, entry.labels) << " " << entry.gauge->value() << "\n";
+            break;
+        case Type::Callback:
+            out << withLabels(entry.name, entry.labels) << " " << formatNumber(entry.read ? entry.read() : 0) << "\n";
+            break;
+        case Type::Histogram: {
+            Histogram::Snapshot snapshot = entry.histogram->snapshot();
+            for (double q : QUANTILES) {
+                out << withLabels(entry.name, entry.labels, "quantile=\"" + formatNumber(q) + "\"")
+                    << " " << snapshot.quantile(q) << "\n";
+            }
+            out << withLabels(entry.name + "_sum", entry.labels) << " " << snapshot.sum << "\n";
+            out << withLabels(entry.name + "_count", entry.labels) << " " << snapshot.count << "\n";
+            break;
+        }
+        }
+    }
+    return out.str();
+}
+
+static std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string Registry::renderJsonLine() {
+    long long timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::ostringstream out;
+    out << "{\"ts\":" << timestampMs << ",\"metrics\":{";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool first = true;
+    for (const auto& item : entries) {
+        const Entry& entry = *item.second;
+        if (!first) out << ",";
+        first = false;
+        out << "\"" << escapeJson(withLabels(entry.name, entry.labels)) << "\":";
+
+        switch (entry.type) {
+        case Type::Counter: out << entry.counter->value(); break;
+        case Type::Gauge: out << entry.gauge->value(); break;
+        case Type::Callback: out << formatNumber(entry.read ? entry.read() : 0); break;
+        case Type::Histogram: {
+            Histogram::Snapshot snapshot = entry.histogram->snapshot();
+            out << "{\"count\":" << snapshot.count << ",\"sum\":" << snapshot.sum
+                << ",\"p50\":" << snapshot.quantile(0.5) << ",\"p90\":" << snapshot.quantile(0.9)
+                << ",\"p99\":" << snapshot.quantile(0.99) << ",\"max\":" << snapshot.max << "}";
+            break;
+        }
+        }
+    }
+    out << "}}\n";
+    return out.str();
+}
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+double measureCounterOverheadNs(size_t iterations) {
+    Counter counter;
+    counter.add();  // Khởi tạo thread_local trước khi đo
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        counter.add();
+    }
+    auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    return iterations > 0 ? static_cast<double>(elapsedNs) / iterations : 0;
+}
+
+#ifdef _WIN32
+Exporter::Exporter()
+    : listener(INVALID_SOCKET), running(false), dumpIntervalSec(60), winsockStarted(false)
+{
+}
+
+Exporter::~Exporter() {
+    stop();
+}
+
+bool Exporter::start(int port, const std::string& path, int intervalSec) {
+    if (running) return true;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return false;
+    }
+    winsockStarted = true;
+
+    SOCKET socketHandle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socketHandle == INVALID_SOCKET) {
+        stop();
+        return false;
+    }
+
+    // Chỉ nghe trên loopback: số liệu không lộ ra mạng
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<u_short>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    if (bind(socketHandle, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(socketHandle, 4) == SOCKET_ERROR) {
+        closesocket(socketHandle);
+        stop();
+        return false;
+    }
+
+    listener = socketHandle;
+    jsonlPath = path;
+    dumpIntervalSec = intervalSec > 0 ? intervalSec : 60;
+    running = true;
+    thread = std::thread(&Exporter::run, this);
+    return true;
+}
+
+void Exporter::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (listener != INVALID_SOCKET) {
+        closesocket(static_cast<SOCKET>(listener));
+        listener = INVALID_SOCKET;
+    }
+    if (winsockStarted) {
+        dump();     // Dòng cuối khi tắt chương trình
+        WSACleanup();
+        winsockStarted = false;
+    }
+}
+
+void Exporter::run() {
+    auto nextDump = std::chrono::steady_clock::now() + std::chrono::seconds(dumpIntervalSec);
+    SOCKET socketHandle = static_cast<SOCKET>(listener);
+
+    while (running) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(socketHandle, &readSet);
+        timeval timeout = { 0, 500000 };
+
+        if (select(0, &readSet, nullptr, nullptr, &timeout) > 0) {
+            SOCKET client = accept(socketHandle, nullptr, nullptr);
+            if (client != INVALID_SOCKET) {
+                serve(client);
+                closesocket(client);
+            }
+        }
+
+        if (std::chrono::steady_clock::now() >= nextDump) {
+            dump();
+            nextDump += std::chrono::seconds(dumpIntervalSec);
+        }
+    }
+}
+
+void Exporter::serve(uintptr_t clientHandle) {
+    SOCKET client = static_cast<SOCKET>(clientHandle);
+    DWORD timeoutMs = 1000;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
+
+    // Chỉ cần dòng đầu của request
+    char buffer[1024];
+    int received = recv(client, buffer, sizeof(buffer) - 1, 0);
+    if (received <= 0) return;
+    std::string request(buffer, received);
+
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+        body = registry().renderPrometheus();
+    }
+    else {
+        status = "404 Not Found";
+        body = "Not found\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int result = send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+        if (result <= 0) break;
+        sent += result;
+    }
+}
+
+void Exporter::dump() {
+    if (jsonlPath.empty()) return;
+    std::ofstream file(jsonlPath, std::ios::app | std::ios::binary);
+    if (file.is_open()) {
+        file << registry().renderJsonLine();
+    }
+}
+#endif
+
+}
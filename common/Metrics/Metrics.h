@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Số liệu đo cho client và server: counter, gauge, histogram không khóa ở đường ghi.
+// Đăng ký một lần (có khóa), sau đó giữ tham chiếu và ghi trực tiếp:
+//
+//   static Metrics::Histogram& latency = Metrics::registry().histogram(
+//       "gmail_request_duration_microseconds", "Gmail API latency", "endpoint=\"messages.list\"");
+//   Metrics::ScopedTimer timer(latency);
+//
+// Xuất ra dạng text của Prometheus qua HTTP trên localhost và ghi JSONL định kỳ (Exporter).
+namespace Metrics {
+
+constexpr size_t CACHE_LINE = 64;
+constexpr size_t COUNTER_STRIPES = 16;
+
+// Mỗi thread ghi vào một ô riêng của counter để không tranh nhau cache line
+inline size_t threadStripe() {
+    static std::atomic<size_t> nextStripe{ 0 };
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % COUNTER_STRIPES;
+    return stripe;
+}
+
+class Counter {
+public:
+    void add(uint64_t value = 1) {
+        cells[threadStripe()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<uint64_t> value{ 0 };
+    };
+    Cell cells[COUNTER_STRIPES];
+};
+
+class Gauge {
+public:
+    void set(int64_t newValue) { current.store(newValue, std::memory_order_relaxed); }
+    void add(int64_t delta) { current.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    alignas(CACHE_LINE) std::atomic<int64_t> current{ 0 };
+};
+
+// Histogram log-tuyến tính kiểu HDR: mỗi bậc lũy thừa 2 chia thành 16 ô,
+// sai số tương đối tối đa 1/16 trên toàn dải uint64, ghi bằng vài phép atomic.
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        std::vector<uint64_t> buckets;
+
+        uint64_t quantile(double q) const;
+    };
+
+    Histogram();
+    void record(uint64_t value);
+    Snapshot snapshot() const;
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    alignas(CACHE_LINE) std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+// Ghi thời gian sống của đối tượng (micro giây) vào histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram(histogram), startTime(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count()));
+    }
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+class Registry {
+public:
+    // labels dạng Prometheus không có ngoặc, ví dụ: command="list::app"
+    // Trả về cùng một đối tượng cho cùng name + labels; tham chiếu sống tới hết chương trình
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+    // Giá trị lấy lúc xuất, dùng cho số liệu đã có sẵn ở nơi khác (ví dụ độ dài hàng đợi)
+    void gaugeCallback(const std::string& name, const std::string& help, const std::string& labels,
+        std::function<double()> read);
+
+    std::string renderPrometheus();
+    std::string renderJsonLine();
+
+private:
+    enum class Type { Counter, Gauge, Histogram, Callback };
+
+    struct Entry {
+        std::string name;
+        std::string labels;
+        std::string help;
+        Type type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> read;
+    };
+
+    Entry& findOrCreate(const std::string& name, const std::string& help, const std::string& labels, Type type);
+
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Entry>> entries;  // Khóa name{labels}: cùng tên nằm liền nhau
+};
+
+Registry& registry();
+
+// Đo chi phí một lần Counter::add (nano giây) trên thread hiện tại
+double measureCounterOverheadNs(size_t iterations = 1000000);
+
+#ifdef _WIN32
+// Phục vụ GET /metrics trên 127.0.0.1:port và ghi một dòng JSONL mỗi dumpIntervalSec giây
+class Exporter {
+public:
+    Exporter();
+    ~Exporter();
+
+    bool start(int port, const std::string& jsonlPath, int dumpIntervalSec);
+    void stop();
+
+private:
+    void run();
+    void serve(uintptr_t client);
+    void dump();
+
+    uintptr_t listener;         // SOCKET; giữ winsock ngoài header
+    std::thread thread;
+    std::atomic<bool> running;
+    std::string jsonlPath;
+    int dumpIntervalSec;
+    bool winsockStarted;
+};
+#endif
+
+}
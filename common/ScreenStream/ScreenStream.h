@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// Giao thức của lệnh screen::stream, dùng chung cho server (gửi) và client (nhận).
+//
+// Server -> client: chuỗi message, mỗi message gồm StreamMessageHeader + payload
+//   Start: StreamStartInfo
+//   Frame: StreamFrameInfo, theo sau là tileCount x (StreamTileInfo + dữ liệu JPEG)
+//   End:   StreamEndInfo
+// Client -> server: StreamAck sau mỗi Frame, báo tổng số byte đã nhận; sau End là một
+//   StreamAck với sequence = END_SEQUENCE để server biết không còn ack nào trên kết nối.
+// Server dùng (byte đã gửi - byte đã được ack) để biết còn bao nhiêu dữ liệu đang nằm
+// trong bộ đệm gửi/đường truyền và điều chỉnh tốc độ (AIMD).
+// Mọi số nguyên là little-endian (cả hai phía đều chạy Windows x86/x64).
+
+namespace ScreenStream {
+
+constexpr uint32_t MESSAGE_MAGIC = 0x52545353;  // "SSTR"
+constexpr uint32_t ACK_MAGIC = 0x4B435353;      // "SSCK"
+constexpr uint16_t TILE_SIZE = 64;
+constexpr uint32_t END_SEQUENCE = 0xFFFFFFFFu;
+
+constexpr int DEFAULT_FPS = 10;
+constexpr int MAX_FPS = 30;
+constexpr int DEFAULT_QUALITY = 70;
+constexpr int MIN_QUALITY = 10;
+constexpr int MAX_QUALITY = 95;
+constexpr int DEFAULT_SECONDS = 10;
+constexpr int MAX_SECONDS = 300;
+
+// Giới hạn để client từ chối message hỏng thay vì cấp phát bừa
+constexpr uint32_t MAX_PAYLOAD_SIZE = 64u * 1024 * 1024;
+
+enum class MessageType : uint8_t {
+    Start = 1,
+    Frame = 2,
+    End = 3
+};
+
+#pragma pack(push, 1)
+struct StreamMessageHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t payloadSize;
+};
+
+struct StreamStartInfo {
+    uint16_t width;
+    uint16_t height;
+    uint16_t tileSize;
+    uint8_t fps;
+    uint8_t quality;
+    uint32_t durationMs;
+};
+
+struct StreamFrameInfo {
+    uint32_t sequence;
+    uint32_t timestampMs;       // Tính từ lúc bắt đầu stream
+    uint16_t tileCount;
+    uint8_t quality;            // Chất lượng JPEG đã dùng cho frame này
+    uint8_t flags;              // FRAME_FLAG_*
+};
+
+struct StreamTileInfo {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint32_t jpegSize;
+};
+
+struct StreamEndInfo {
+    uint32_t framesSent;
+    uint32_t framesSkipped;     // Bỏ do nghẽn
+    uint32_t durationMs;
+    uint64_t bytesSent;
+};
+
+struct StreamAck {
+    uint32_t magic;
+    uint32_t sequence;
+    uint64_t bytesReceived;     // Tổng byte client đã nhận kể từ Start
+};
+#pragma pack(pop)
+
+constexpr uint8_t FRAME_FLAG_KEY = 0x01;        // Frame chứa toàn bộ tile
+constexpr uint8_t FRAME_FLAG_REFINE = 0x02;     // Có tile gửi lại với chất lượng cao hơn
+
+static_assert(sizeof(StreamMessageHeader) == 12, "Unexpected stream header layout");
+static_assert(sizeof(StreamAck) == 16, "Unexpected stream ack layout");
+
+struct StreamOptions {
+    int fps;
+    int quality;
+    int seconds;
+    const char* error;          // nullptr nếu hợp lệ
+};
+
+// Đọc "fps=N quality=Q seconds=S" (thứ tự bất kỳ, có thể bỏ trống).
+// Giá trị ngoài khoảng cho phép bị chặn về biên thay vì báo lỗi.
+constexpr StreamOptions parseStreamOptions(std::string_view args) {
+    StreamOptions options{ DEFAULT_FPS, DEFAULT_QUALITY, DEFAULT_SECONDS, nullptr };
+
+    size_t pos = 0;
+    while (pos < args.size()) {
+        while (pos < args.size() && (args[pos] == ' ' || args[pos] == '\t')) pos++;
+        if (pos >= args.size()) break;
+
+        size_t end = pos;
+        while (end < args.size() && args[end] != ' ' && args[end] != '\t') end++;
+        std::string_view token = args.substr(pos, end - pos);
+        pos = end;
+
+        size_t equals = token.find('=');
+        if (equals == std::string_view::npos || equals + 1 >= token.size()) {
+            options.error = "Expected key=value";
+            return options;
+        }
+
+        std::string_view key = token.substr(0, equals);
+        int value = 0;
+        for (char c : token.substr(equals + 1)) {
+            if (c < '0' || c > '9' || value > 100000) {
+                options.error = "Invalid number";
+                return options;
+            }
+            value = value * 10 + (c - '0');
+        }
+
+        if (key == "fps") options.fps = value;
+        else if (key == "quality") options.quality = value;
+        else if (key == "seconds") options.seconds = value;
+        else {
+            options.error = "Unknown option";
+            return options;
+        }
+    }
+
+    options.fps = options.fps < 1 ? 1 : (options.fps > MAX_FPS ? MAX_FPS : options.fps);
+    options.quality = options.quality < MIN_QUALITY ? MIN_QUALITY
+        : (options.quality > MAX_QUALITY ? MAX_QUALITY : options.quality);
+    options.seconds = options.seconds < 1 ? 1 : (options.seconds > MAX_SECONDS ? MAX_SECONDS : options.seconds);
+    return options;
+}
+
+static_assert(parseStreamOptions("fps=15 quality=50").fps == 15, "Stream option parsing is broken");
+static_assert(parseStreamOptions("").quality == DEFAULT_QUALITY, "Stream option parsing is broken");
+static_assert(parseStreamOptions("fps=99").fps == MAX_FPS, "Stream option parsing is broken");
+static_assert(parseStreamOptions("speed=1").error != nullptr, "Stream option parsing is broken");
+
+}
@@ -0,0 +1,261 @@
+#include "NoiseCrypto.h"
+#include <cstring>
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+
+namespace NoiseCrypto {
+
+// Mở provider một lần cho cả tiến trình; handle thuật toán của CNG dùng chung được giữa các thread
+struct Providers {
+    BCRYPT_ALG_HANDLE sha256 = nullptr;
+    BCRYPT_ALG_HANDLE hmac = nullptr;
+    BCRYPT_ALG_HANDLE aesGcm = nullptr;
+    BCRYPT_ALG_HANDLE x25519 = nullptr;
+
+    Providers() {
+        BCryptOpenAlgorithmProvider(&sha256, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+        BCryptOpenAlgorithmProvider(&hmac, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_ALG_HANDLE_HMAC_FLAG);
+
+        if (BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&aesGcm, BCRYPT_AES_ALGORITHM, nullptr, 0))) {
+            if (!BCRYPT_SUCCESS(BCryptSetProperty(aesGcm, BCRYPT_CHAINING_MODE,
+                (PUCHAR)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0))) {
+                BCryptCloseAlgorithmProvider(aesGcm, 0);
+                aesGcm = nullptr;
+            }
+        }
+
+        if (BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&x25519, BCRYPT_ECDH_ALGORITHM, nullptr, 0))) {
+            if (!BCRYPT_SUCCESS(BCryptSetProperty(x25519, BCRYPT_ECC_CURVE_NAME,
+                (PUCHAR)BCRYPT_ECC_CURVE_25519, sizeof(BCRYPT_ECC_CURVE_25519), 0))) {
+                BCryptCloseAlgorithmProvider(x25519, 0);
+                x25519 = nullptr;   // Windows cũ hơn 10 1709
+            }
+        }
+    }
+
+    ~Providers() {
+        if (sha256) BCryptCloseAlgorithmProvider(sha256, 0);
+        if (hmac) BCryptCloseAlgorithmProvider(hmac, 0);
+        if (aesGcm) BCryptCloseAlgorithmProvider(aesGcm, 0);
+        if (x25519) BCryptCloseAlgorithmProvider(x25519, 0);
+    }
+};
+
+static Providers& providers() {
+    static Providers instance;
+    return instance;
+}
+
+bool randomBytes(uint8_t* out, size_t size) {
+    return BCRYPT_SUCCESS(BCryptGenRandom(nullptr, out, static_cast<ULONG>(size), BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+}
+
+bool sha256(const uint8_t* data, size_t size, Key& digest) {
+    if (!providers().sha256) return false;
+    return BCRYPT_SUCCESS(BCryptHash(providers().sha256, nullptr, 0,
+        const_cast<PUCHAR>(data), static_cast<ULONG>(size), digest.data(), static_cast<ULONG>(digest.size())));
+}
+
+bool hmacSha256(const Key& key, const uint8_t* data, size_t size, Key& mac) {
+    if (!providers().hmac) return false;
+    return BCRYPT_SUCCESS(BCryptHash(providers().hmac, const_cast<PUCHAR>(key.data()), static_cast<ULONG>(key.size()),
+        const_cast<PUCHAR>(data), static_cast<ULONG>(size), mac.data(), static_cast<ULONG>(mac.size())));
+}
+
+// Blob khóa Curve25519 của CNG: BCRYPT_ECCKEY_BLOB, rồi X, Y (Y luôn 0) và d với khóa bí mật
+static const size_t ECC_HEADER = sizeof(BCRYPT_ECCKEY_BLOB);
+
+KeyPair::KeyPair() : handle(nullptr) {
+    publicBytes.fill(0);
+}
+
+KeyPair::~KeyPair() {
+    reset();
+}
+
+KeyPair::KeyPair(KeyPair&& other) noexcept : handle(other.handle), publicBytes(other.publicBytes) {
+    other.handle = nullptr;
+}
+
+KeyPair& KeyPair::operator=(KeyPair&& other) noexcept {
+    if (this != &other) {
+        reset();
+        handle = other.handle;
+        publicBytes = other.publicBytes;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+void KeyPair::reset() {
+    if (handle) {
+        BCryptDestroyKey(static_cast<BCRYPT_KEY_HANDLE>(handle));
+        handle = nullptr;
+    }
+}
+
+static bool exportPublic(BCRYPT_KEY_HANDLE key, Key& publicBytes) {
+    uint8_t blob[ECC_HEADER + 2 * KEY_SIZE];
+    ULONG written = 0;
+    if (!BCRYPT_SUCCESS(BCryptExportKey(key, nullptr, BCRYPT_ECCPUBLIC_BLOB, blob, sizeof(blob), &written, 0)) ||
+        written != sizeof(blob) || reinterpret_cast<BCRYPT_ECCKEY_BLOB*>(blob)->cbKey != KEY_SIZE) {
+        return false;
+    }
+    memcpy(publicBytes.data(), blob + ECC_HEADER, KEY_SIZE);
+    return true;
+}
+
+bool KeyPair::generate() {
+    reset();
+    if (!providers().x25519) return false;
+
+    BCRYPT_KEY_HANDLE key = nullptr;
+    if (!BCRYPT_SUCCESS(BCryptGenerateKeyPair(providers().x25519, &key, 255, 0))) return false;
+    if (!BCRYPT_SUCCESS(BCryptFinalizeKeyPair(key, 0)) || !exportPublic(key, publicBytes)) {
+        BCryptDestroyKey(key);
+        return false;
+    }
+    handle = key;
+    return true;
+}
+
+bool KeyPair::importPrivate(const std::vector<uint8_t>& secret) {
+    reset();
+    if (!providers().x25519 || secret.size() != ECC_HEADER + 3 * KEY_SIZE) return false;
+
+    BCRYPT_KEY_HANDLE key = nullptr;
+    if (!BCRYPT_SUCCESS(BCryptImportKeyPair(providers().x25519, nullptr, BCRYPT_ECCPRIVATE_BLOB, &key,
+        const_cast<PUCHAR>(secret.data()), static_cast<ULONG>(secret.size()), 0))) {
+        return false;
+    }
+    if (!exportPublic(key, publicBytes)) {
+        BCryptDestroyKey(key);
+        return false;
+    }
+    handle = key;
+    return true;
+}
+
+std::vector<uint8_t> KeyPair::exportPrivate() const {
+    std::vector<uint8_t> blob(ECC_HEADER + 3 * KEY_SIZE);
+    ULONG written = 0;
+    if (!handle || !BCRYPT_SUCCESS(BCryptExportKey(static_cast<BCRYPT_KEY_HANDLE>(handle), nullptr,
+        BCRYPT_ECCPRIVATE_BLOB, blob.data(), static_cast<ULONG>(blob.size()), &written, 0))) {
+        return {};
+    }
+    blob.resize(written);
+    return blob;
+}
+
+bool KeyPair::dh(const Key& remotePublic, Key& shared) const {
+    if (!handle) return false;
+
+    uint8_t blob[ECC_HEADER + 2 * KEY_SIZE] = {};
+    BCRYPT_ECCKEY_BLOB* header = reinterpret_cast<BCRYPT_ECCKEY_BLOB*>(blob);
+    header->dwMagic = BCRYPT_ECDH_PUBLIC_GENERIC_MAGIC;
+    header->cbKey = KEY_SIZE;
+    memcpy(blob + ECC_HEADER, remotePublic.data(), KEY_SIZE);
+
+    BCRYPT_KEY_HANDLE remote = nullptr;
+    if (!BCRYPT_SUCCESS(BCryptImportKeyPair(providers().x25519, nullptr, BCRYPT_ECCPUBLIC_BLOB, &remote,
+        blob, sizeof(blob), 0))) {
+        return false;
+    }
+
+    BCRYPT_SECRET_HANDLE secret = nullptr;
+    bool ok = false;
+    if (BCRYPT_SUCCESS(BCryptSecretAgreement(static_cast<BCRYPT_KEY_HANDLE>(handle), remote, &secret, 0))) {
+        ULONG written = 0;
+        ok = BCRYPT_SUCCESS(BCryptDeriveKey(secret, BCRYPT_KDF_RAW_SECRET, nullptr,
+            shared.data(), static_cast<ULONG>(shared.size()), &written, 0)) && written == KEY_SIZE;
+        BCryptDestroySecret(secret);
+    }
+    BCryptDestroyKey(remote);
+
+    uint8_t accumulated = 0;
+    for (uint8_t byte : shared) accumulated |= byte;
+    return ok && accumulated != 0;
+}
+
+Aead::Aead() : handle(nullptr) {
+}
+
+Aead::~Aead() {
+    reset();
+}
+
+void Aead::reset() {
+    if (handle) {
+        BCryptDestroyKey(static_cast<BCRYPT_KEY_HANDLE>(handle));
+        handle = nullptr;
+    }
+}
+
+bool Aead::setKey(const Key& key) {
+    reset();
+    if (!providers().aesGcm) return false;
+
+    BCRYPT_KEY_HANDLE newKey = nullptr;
+    if (!BCRYPT_SUCCESS(BCryptGenerateSymmetricKey(providers().aesGcm, &newKey, nullptr, 0,
+        const_cast<PUCHAR>(key.data()), static_cast<ULONG>(key.size()), 0))) {
+        return false;
+    }
+    handle = newKey;
+    return true;
+}
+
+static void encodeNonce(uint64_t counter, uint8_t nonce[12]) {
+    memset(nonce, 0, 4);
+    for (int i = 0; i < 8; i++) {
+        nonce[4 + i] = static_cast<uint8_t>(counter >> (56 - 8 * i));
+    }
+}
+
+bool Aead::seal(uint64_t nonce, const uint8_t* ad, size_t adSize,
+    const uint8_t* plain, size_t size, uint8_t* out) {
+    if (!handle) return false;
+
+    uint8_t nonceBytes[12];
+    encodeNonce(nonce, nonceBytes);
+
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+    BCRYPT_INIT_AUTH_MODE_INFO(info);
+    info.pbNonce = nonceBytes;
+    info.cbNonce = sizeof(nonceBytes);
+    info.pbAuthData = const_cast<PUCHAR>(ad);
+    info.cbAuthData = static_cast<ULONG>(adSize);
+    info.pbTag = out + size;
+    info.cbTag = TAG_SIZE;
+
+    ULONG written = 0;
+    return BCRYPT_SUCCESS(BCryptEncrypt(static_cast<BCRYPT_KEY_HANDLE>(handle),
+        const_cast<PUCHAR>(plain), static_cast<ULONG>(size), &info, nullptr, 0,
+        out, static_cast<ULONG>(size), &written, 0)) && written == size;
+}
+
+bool Aead::open(uint64_t nonce, const uint8_t* ad, size_t adSize,
+    const uint8_t* cipher, size_t size, uint8_t* out) {
+    if (!handle || size < TAG_SIZE) return false;
+    size_t plainSize = size - TAG_SIZE;
+
+    uint8_t nonceBytes[12];
+    encodeNonce(nonce, nonceBytes);
+
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+    BCRYPT_INIT_AUTH_MODE_INFO(info);
+    info.pbNonce = nonceBytes;
+    info.cbNonce = sizeof(nonceBytes);
+    info.pbAuthData = const_cast<PUCHAR>(ad);
+    info.cbAuthData = static_cast<ULONG>(adSize);
+    info.pbTag = const_cast<PUCHAR>(cipher + plainSize);
+    info.cbTag = TAG_SIZE;
+
+    // BCryptDecrypt trả STATUS_AUTH_TAG_MISMATCH khi dữ liệu bị sửa
+    ULONG written = 0;
+    return BCRYPT_SUCCESS(BCryptDecrypt(static_cast<BCRYPT_KEY_HANDLE>(handle),
+        const_cast<PUCHAR>(cipher), static_cast<ULONG>(plainSize), &info, nullptr, 0,
+        out, static_cast<ULONG>(plainSize), &written, 0)) && written == plainSize;
+}
+
+}
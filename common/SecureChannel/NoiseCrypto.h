@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Các hàm mật mã mà SecureChannel cần cho Noise_*_25519_AESGCM_SHA256: X25519, AES-256-GCM, SHA-256/HMAC.
+// Cài đặt bằng Windows CNG (bcrypt.dll, Windows 10 1709 trở lên cho Curve25519) nên không thêm thư viện ngoài.
+namespace NoiseCrypto {
+
+static const size_t KEY_SIZE = 32;
+static const size_t HASH_SIZE = 32;
+static const size_t TAG_SIZE = 16;
+
+using Key = std::array<uint8_t, KEY_SIZE>;
+
+bool randomBytes(uint8_t* out, size_t size);
+bool sha256(const uint8_t* data, size_t size, Key& digest);
+bool hmacSha256(const Key& key, const uint8_t* data, size_t size, Key& mac);
+
+// Cặp khóa X25519. Khóa bí mật chỉ rời đối tượng qua exportPrivate (để lưu khóa tĩnh)
+class KeyPair {
+public:
+    KeyPair();
+    ~KeyPair();
+    KeyPair(KeyPair&& other) noexcept;
+    KeyPair& operator=(KeyPair&& other) noexcept;
+    KeyPair(const KeyPair&) = delete;
+    KeyPair& operator=(const KeyPair&) = delete;
+
+    bool generate();
+    // Dạng lưu trữ do exportPrivate trả về (không dùng chung được giữa các backend)
+    bool importPrivate(const std::vector<uint8_t>& secret);
+    std::vector<uint8_t> exportPrivate() const;
+
+    bool valid() const { return handle != nullptr; }
+    const Key& publicKey() const { return publicBytes; }
+    // false nếu khóa của bên kia không hợp lệ hoặc kết quả toàn số 0 (điểm bậc thấp)
+    bool dh(const Key& remotePublic, Key& shared) const;
+
+private:
+    void reset();
+
+    void* handle;
+    Key publicBytes;
+};
+
+// AES-256-GCM với nonce 96 bit = 32 bit 0 + bộ đếm 64 bit big-endian (theo Noise).
+// Giữ handle khóa giữa các lần gọi để mỗi record không phải dựng lại khóa
+class Aead {
+public:
+    Aead();
+    ~Aead();
+    Aead(const Aead&) = delete;
+    Aead& operator=(const Aead&) = delete;
+
+    bool setKey(const Key& key);
+    bool hasKey() const { return handle != nullptr; }
+    // out: size + TAG_SIZE byte
+    bool seal(uint64_t nonce, const uint8_t* ad, size_t adSize,
+        const uint8_t* plain, size_t size, uint8_t* out);
+    // size gồm cả tag; out: size - TAG_SIZE byte. false nếu tag sai
+    bool open(uint64_t nonce, const uint8_t* ad, size_t adSize,
+        const uint8_t* cipher, size_t size, uint8_t* out);
+
+private:
+    void reset();
+
+    void* handle;
+};
+
+}
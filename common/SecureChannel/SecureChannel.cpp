@@ -0,0 +1,646 @@
+#include "SecureChannel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const char* KK_PROTOCOL = "Noise_KK_25519_AESGCM_SHA256";
+static const char* NNPSK0_PROTOCOL = "Noise_NNpsk0_25519_AESGCM_SHA256";
+static const char PROLOGUE[] = "EmailPCControl/1";
+static const char RESUMPTION_LABEL[] = "EmailPCControl resumption";
+
+static const size_t FRAME_HEADER = 3;
+static const size_t MAX_FRAME_BODY = 0xFFFF;
+static const size_t RECORDS_PER_WRITE = 4;      // Gộp tối đa 64 KB dữ liệu vào một lần gửi
+static const size_t INBOUND_SIZE = 64 * 1024;   // Đọc trước từ socket: nhiều record nhỏ chỉ tốn một lần recv
+// Client coi vé hết hạn sớm hơn server một chút để không gửi 0-RTT bằng vé vừa hết hạn
+static const long long TICKET_EXPIRY_MARGIN_MS = 60 * 1000;
+
+using NoiseCrypto::KEY_SIZE;
+using NoiseCrypto::TAG_SIZE;
+
+long long SecureChannel::steadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// HKDF của Noise: temp = HMAC(ck, ikm); out1 = HMAC(temp, 0x01); outN = HMAC(temp, outN-1 || N)
+bool SecureChannel::hkdf(const Key& chainingKey, const uint8_t* ikm, size_t size, Key* outputs, int count) {
+    Key temp;
+    if (!NoiseCrypto::hmacSha256(chainingKey, ikm, size, temp)) return false;
+
+    uint8_t input[KEY_SIZE + 1];
+    for (int i = 0; i < count; i++) {
+        size_t inputSize = 0;
+        if (i > 0) {
+            memcpy(input, outputs[i - 1].data(), KEY_SIZE);
+            inputSize = KEY_SIZE;
+        }
+        input[inputSize++] = static_cast<uint8_t>(i + 1);
+        if (!NoiseCrypto::hmacSha256(temp, input, inputSize, outputs[i])) return false;
+    }
+    return true;
+}
+
+bool SecureChannel::Handshake::initialize(const char* protocolName) {
+    size_t length = strlen(protocolName);
+    if (length <= NoiseCrypto::HASH_SIZE) {
+        h.fill(0);
+        memcpy(h.data(), protocolName, length);
+    }
+    else if (!NoiseCrypto::sha256(reinterpret_cast<const uint8_t*>(protocolName), length, h)) {
+        return false;
+    }
+    ck = h;
+    cipher.nonce = 0;
+    return true;
+}
+
+bool SecureChannel::Handshake::mixHash(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> input(h.begin(), h.end());
+    input.insert(input.end(), data, data + size);
+    return NoiseCrypto::sha256(input.data(), input.size(), h);
+}
+
+bool SecureChannel::Handshake::mixKey(const uint8_t* ikm, size_t size) {
+    Key outputs[2];
+    if (!hkdf(ck, ikm, size, outputs, 2)) return false;
+    ck = outputs[0];
+    cipher.nonce = 0;
+    return cipher.aead.setKey(outputs[1]);
+}
+
+bool SecureChannel::Handshake::mixKeyAndHash(const uint8_t* ikm, size_t size) {
+    Key outputs[3];
+    if (!hkdf(ck, ikm, size, outputs, 3)) return false;
+    ck = outputs[0];
+    if (!mixHash(outputs[1].data(), KEY_SIZE)) return false;
+    cipher.nonce = 0;
+    return cipher.aead.setKey(outputs[2]);
+}
+
+bool SecureChannel::Handshake::encryptAndHash(const uint8_t* plain, size_t size, std::vector<uint8_t>& out) {
+    if (cipher.aead.hasKey()) {
+        out.resize(size + TAG_SIZE);
+        if (!cipher.aead.seal(cipher.nonce++, h.data(), h.size(), plain, size, out.data())) return false;
+    }
+    else {
+        out.assign(plain, plain + size);
+    }
+    return mixHash(out.data(), out.size());
+}
+
+bool SecureChannel::Handshake::decryptAndHash(const uint8_t* cipherText, size_t size, std::vector<uint8_t>& out) {
+    if (cipher.aead.hasKey()) {
+        if (size < TAG_SIZE) return false;
+        out.resize(size - TAG_SIZE);
+        if (!cipher.aead.open(cipher.nonce++, h.data(), h.size(), cipherText, size, out.data())) return false;
+    }
+    else {
+        out.assign(cipherText, cipherText + size);
+    }
+    return mixHash(cipherText, size);
+}
+
+// Prologue gắn phần gửi rõ (key id hoặc ticket id) vào bản băm bắt tay: sửa nó thì bắt tay hỏng
+bool SecureChannel::Handshake::mixPrologue(const uint8_t* clearId, size_t size) {
+    std::vector<uint8_t> prologue(PROLOGUE, PROLOGUE + sizeof(PROLOGUE) - 1);
+    prologue.insert(prologue.end(), clearId, clearId + size);
+    return mixHash(prologue.data(), prologue.size());
+}
+
+SecureChannel::TicketCache::TicketCache(Clock clock) : clock(clock ? clock : Clock(steadyNowMs)) {
+}
+
+void SecureChannel::TicketCache::store(const std::string& server, const Ticket& ticket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::deque<Ticket>& list = tickets[server];
+    list.push_back(ticket);
+    while (list.size() > MAX_PER_SERVER) list.pop_front();
+}
+
+bool SecureChannel::TicketCache::take(const std::string& server, Ticket& ticket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tickets.find(server);
+    if (it == tickets.end()) return false;
+
+    long long now = clock();
+    std::deque<Ticket>& list = it->second;
+    while (!list.empty()) {
+        // Vé mới nhất trước: sống lâu nhất
+        ticket = list.back();
+        list.pop_back();
+        if (ticket.expiresMs > now) return true;
+    }
+    tickets.erase(it);
+    return false;
+}
+
+void SecureChannel::TicketCache::clear(const std::string& server) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tickets.erase(server);
+}
+
+SecureChannel::TicketStore::TicketStore(Clock clock) : clock(clock ? clock : Clock(steadyNowMs)) {
+}
+
+bool SecureChannel::TicketStore::issue(const Key& psk, const Key& clientKey, uint8_t id[TICKET_ID_SIZE]) {
+    if (!NoiseCrypto::randomBytes(id, TICKET_ID_SIZE)) return false;
+    std::string name(reinterpret_cast<const char*>(id), TICKET_ID_SIZE);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    long long now = clock();
+    // Bỏ vé hết hạn, và vé cũ nhất khi đầy; mục trong expiry của vé đã đổi thì chỉ còn là mục rác
+    while (!expiry.empty() && (expiry.front().first <= now || entries.size() >= MAX_TICKETS ||
+        entries.find(expiry.front().second) == entries.end())) {
+        entries.erase(expiry.front().second);
+        expiry.pop_front();
+    }
+
+    entries[name] = Entry{ psk, clientKey, now + TICKET_LIFETIME_MS };
+    expiry.emplace_back(now + TICKET_LIFETIME_MS, name);
+    return true;
+}
+
+bool SecureChannel::TicketStore::redeem(const uint8_t id[TICKET_ID_SIZE], Key& psk, Key& clientKey) {
+    std::string name(reinterpret_cast<const char*>(id), TICKET_ID_SIZE);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it == entries.end()) return false;
+
+    Entry entry = it->second;
+    entries.erase(it);     // Dùng một lần: gói 0-RTT bị phát lại sẽ không còn vé
+    if (entry.expiresMs <= clock()) return false;
+
+    psk = entry.psk;
+    clientKey = entry.clientKey;
+    return true;
+}
+
+size_t SecureChannel::TicketStore::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void SecureChannel::Keyring::keyId(const Key& publicKey, uint8_t id[KEY_ID_SIZE]) {
+    Key digest;
+    NoiseCrypto::sha256(publicKey.data(), publicKey.size(), digest);
+    memcpy(id, digest.data(), KEY_ID_SIZE);
+}
+
+void SecureChannel::Keyring::add(const Key& publicKey) {
+    uint8_t id[KEY_ID_SIZE];
+    keyId(publicKey, id);
+    keys[std::string(reinterpret_cast<const char*>(id), KEY_ID_SIZE)] = publicKey;
+}
+
+bool SecureChannel::Keyring::find(const uint8_t id[KEY_ID_SIZE], Key& publicKey) const {
+    auto it = keys.find(std::string(reinterpret_cast<const char*>(id), KEY_ID_SIZE));
+    if (it == keys.end()) return false;
+    publicKey = it->second;
+    return true;
+}
+
+bool SecureChannel::Keyring::contains(const Key& publicKey) const {
+    uint8_t id[KEY_ID_SIZE];
+    keyId(publicKey, id);
+    Key found;
+    return find(id, found) && found == publicKey;
+}
+
+SecureChannel::SecureChannel(Io io)
+    : io(std::move(io))
+    , state(State::Idle)
+    , handshakeMode(Mode::None)
+    , localStatic(nullptr)
+    , ticketCache(nullptr)
+    , readOffset(0)
+    , inboundStart(0)
+    , inboundEnd(0)
+{
+    remoteStatic.fill(0);
+    resumptionPsk.fill(0);
+}
+
+bool SecureChannel::sendFrame(uint8_t type, const std::vector<uint8_t>& body) {
+    if (body.size() > MAX_FRAME_BODY) return false;
+    std::vector<uint8_t> frame(FRAME_HEADER + body.size());
+    frame[0] = type;
+    frame[1] = static_cast<uint8_t>(body.size() >> 8);
+    frame[2] = static_cast<uint8_t>(body.size());
+    std::copy(body.begin(), body.end(), frame.begin() + FRAME_HEADER);
+    return io.sendAll(frame.data(), frame.size());
+}
+
+bool SecureChannel::readExact(uint8_t* buffer, size_t size, bool& closed) {
+    size_t received = 0;
+    while (received < size) {
+        if (inboundStart == inboundEnd) {
+            int result;
+            if (size - received >= INBOUND_SIZE) {
+                result = io.recvSome(buffer + received, size - received);
+            }
+            else {
+                inbound.resize(INBOUND_SIZE);
+                result = io.recvSome(inbound.data(), INBOUND_SIZE);
+            }
+            if (result <= 0) {
+                // Chỉ coi là đóng bình thường khi chưa đọc byte nào của frame
+                closed = result == 0 && received == 0;
+                return false;
+            }
+            if (size - received >= INBOUND_SIZE) {
+                received += result;
+                continue;
+            }
+            inboundStart = 0;
+            inboundEnd = result;
+        }
+
+        size_t count = std::min(size - received, inboundEnd - inboundStart);
+        memcpy(buffer + received, inbound.data() + inboundStart, count);
+        inboundStart += count;
+        received += count;
+    }
+    return true;
+}
+
+bool SecureChannel::readFrame(uint8_t& type, std::vector<uint8_t>& body, bool& closed) {
+    closed = false;
+    uint8_t header[FRAME_HEADER];
+    if (!readExact(header, FRAME_HEADER, closed)) return false;
+
+    type = header[0];
+    body.resize((static_cast<size_t>(header[1]) << 8) | header[2]);
+    bool truncated = false;
+    return body.empty() || readExact(body.data(), body.size(), truncated);
+}
+
+bool SecureChannel::deriveResumptionPsk(const Handshake& handshake) {
+    return hkdf(handshake.ck, reinterpret_cast<const uint8_t*>(RESUMPTION_LABEL),
+        sizeof(RESUMPTION_LABEL) - 1, &resumptionPsk, 1);
+}
+
+// Split() của Noise: khóa thứ nhất cho chiều initiator -> responder
+bool SecureChannel::finish(Handshake& handshake, bool initiator, Mode completedMode) {
+    Key keys[2];
+    if (!deriveResumptionPsk(handshake) || !hkdf(handshake.ck, nullptr, 0, keys, 2)) return false;
+    if (!sendCipher.aead.setKey(keys[initiator ? 0 : 1]) || !recvCipher.aead.setKey(keys[initiator ? 1 : 0])) {
+        return false;
+    }
+    sendCipher.nonce = 0;
+    recvCipher.nonce = 0;
+    handshakeMode = completedMode;
+    state = State::Open;
+    return true;
+}
+
+// Payload cuối bắt tay từ server: ticket id + thời hạn (giây, big-endian)
+bool SecureChannel::writeTicket(TicketStore* tickets, std::vector<uint8_t>& payload) {
+    payload.clear();
+    if (!tickets) return true;     // Server không cấp vé: client cứ bắt tay đầy đủ
+
+    uint8_t id[TICKET_ID_SIZE];
+    if (!tickets->issue(resumptionPsk, remoteStatic, id)) return true;
+
+    uint32_t lifetime = static_cast<uint32_t>(TicketStore::TICKET_LIFETIME_MS / 1000);
+    payload.assign(id, id + TICKET_ID_SIZE);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        payload.push_back(static_cast<uint8_t>(lifetime >> shift));
+    }
+    return true;
+}
+
+bool SecureChannel::readTicket(const std::vector<uint8_t>& payload) {
+    if (payload.size() != TICKET_ID_SIZE + 4 || !ticketCache) return true;
+
+    Ticket ticket;
+    memcpy(ticket.id, payload.data(), TICKET_ID_SIZE);
+    uint32_t lifetime = 0;
+    for (size_t i = TICKET_ID_SIZE; i < payload.size(); i++) {
+        lifetime = (lifetime << 8) | payload[i];
+    }
+    ticket.psk = resumptionPsk;
+    ticket.expiresMs = steadyNowMs() + static_cast<long long>(lifetime) * 1000 - TICKET_EXPIRY_MARGIN_MS;
+    ticketCache->store(server, ticket);
+    return true;
+}
+
+bool SecureChannel::connect(const NoiseCrypto::KeyPair& localStatic, const Key& serverStatic,
+    TicketCache* cache, const std::string& server) {
+    this->localStatic = &localStatic;
+    remoteStatic = serverStatic;
+    ticketCache = cache;
+    this->server = server;
+
+    if (cache && cache->take(server, pendingTicket)) {
+        state = State::ResumeReady;
+        return true;
+    }
+    if (!clientFull()) {
+        state = State::Broken;
+        return false;
+    }
+    return true;
+}
+
+// -> e, es, ss   <- e, ee, se   (cả hai khóa tĩnh đã biết trước)
+bool SecureChannel::clientFull() {
+    uint8_t keyId[KEY_ID_SIZE];
+    Keyring::keyId(localStatic->publicKey(), keyId);
+
+    Handshake handshake;
+    NoiseCrypto::KeyPair e;
+    Key shared;
+    std::vector<uint8_t> cipherText;
+    if (!handshake.initialize(KK_PROTOCOL) || !handshake.mixPrologue(keyId, KEY_ID_SIZE) ||
+        !handshake.mixHash(localStatic->publicKey().data(), KEY_SIZE) ||
+        !handshake.mixHash(remoteStatic.data(), KEY_SIZE) ||
+        !e.generate() || !handshake.mixHash(e.publicKey().data(), KEY_SIZE) ||
+        !e.dh(remoteStatic, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !localStatic->dh(remoteStatic, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !handshake.encryptAndHash(nullptr, 0, cipherText)) {
+        return false;
+    }
+
+    std::vector<uint8_t> body(keyId, keyId + KEY_ID_SIZE);
+    body.insert(body.end(), e.publicKey().begin(), e.publicKey().end());
+    body.insert(body.end(), cipherText.begin(), cipherText.end());
+    if (!sendFrame(FULL_INIT, body)) return false;
+
+    uint8_t type;
+    bool closed;
+    if (!readFrame(type, frameBody, closed) || type != FULL_RESPONSE || frameBody.size() < KEY_SIZE + TAG_SIZE) {
+        return false;
+    }
+
+    Key re;
+    std::copy(frameBody.begin(), frameBody.begin() + KEY_SIZE, re.begin());
+    std::vector<uint8_t> payload;
+    if (!handshake.mixHash(re.data(), KEY_SIZE) ||
+        !e.dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !localStatic->dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !handshake.decryptAndHash(frameBody.data() + KEY_SIZE, frameBody.size() - KEY_SIZE, payload) ||
+        !finish(handshake, true, Mode::Full)) {
+        return false;
+    }
+    return readTicket(payload);
+}
+
+// -> psk, e (+ dữ liệu 0-RTT)   <- e, ee
+bool SecureChannel::clientSendResume(const uint8_t* early, size_t size) {
+    Handshake& handshake = resumeHandshake;
+    std::vector<uint8_t> cipherText;
+    if (!handshake.initialize(NNPSK0_PROTOCOL) ||
+        !handshake.mixPrologue(pendingTicket.id, TICKET_ID_SIZE) ||
+        !handshake.mixKeyAndHash(pendingTicket.psk.data(), KEY_SIZE) ||
+        !ephemeral.generate() || !handshake.mixHash(ephemeral.publicKey().data(), KEY_SIZE) ||
+        !handshake.mixKey(ephemeral.publicKey().data(), KEY_SIZE) ||
+        !handshake.encryptAndHash(early, size, cipherText)) {
+        state = State::Broken;
+        return false;
+    }
+
+    std::vector<uint8_t> body(pendingTicket.id, pendingTicket.id + TICKET_ID_SIZE);
+    body.insert(body.end(), ephemeral.publicKey().begin(), ephemeral.publicKey().end());
+    body.insert(body.end(), cipherText.begin(), cipherText.end());
+    if (!sendFrame(RESUME_INIT, body)) {
+        state = State::Broken;
+        return false;
+    }
+
+    earlyData.assign(early, early + size);
+    state = State::ResumeSent;
+    return true;
+}
+
+bool SecureChannel::clientFinishResume() {
+    uint8_t type;
+    bool closed;
+    if (!readFrame(type, frameBody, closed)) {
+        state = State::Broken;
+        return false;
+    }
+
+    if (type == RESUME_REJECT) {
+        // Server không nhận vé (đã khởi động lại, vé hết hạn): bắt tay đầy đủ rồi gửi lại dữ liệu 0-RTT
+        if (!clientFull() || (!earlyData.empty() && !sendRecords(earlyData.data(), earlyData.size()))) {
+            state = State::Broken;
+            return false;
+        }
+        earlyData.clear();
+        return true;
+    }
+
+    Handshake& handshake = resumeHandshake;
+    Key re;
+    Key shared;
+    std::vector<uint8_t> payload;
+    if (type != RESUME_RESPONSE || frameBody.size() < KEY_SIZE + TAG_SIZE) {
+        state = State::Broken;
+        return false;
+    }
+    std::copy(frameBody.begin(), frameBody.begin() + KEY_SIZE, re.begin());
+    if (!handshake.mixHash(re.data(), KEY_SIZE) || !handshake.mixKey(re.data(), KEY_SIZE) ||
+        !ephemeral.dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !handshake.decryptAndHash(frameBody.data() + KEY_SIZE, frameBody.size() - KEY_SIZE, payload) ||
+        !finish(handshake, true, Mode::Resumed)) {
+        state = State::Broken;
+        return false;
+    }
+    earlyData.clear();
+    return readTicket(payload);
+}
+
+bool SecureChannel::accept(const NoiseCrypto::KeyPair& localStatic, const Keyring& clients, TicketStore* tickets) {
+    this->localStatic = &localStatic;
+
+    // Tối đa hai tin nhắn: RESUME_INIT bị từ chối rồi FULL_INIT
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint8_t type;
+        bool closed;
+        if (!readFrame(type, frameBody, closed)) break;
+
+        if (type == FULL_INIT) {
+            std::vector<uint8_t> body;
+            body.swap(frameBody);
+            if (serverFull(body, clients, tickets)) return true;
+            break;
+        }
+        if (type != RESUME_INIT || attempt > 0) break;
+
+        std::vector<uint8_t> body;
+        body.swap(frameBody);
+        bool rejected = false;
+        if (serverResume(body, clients, tickets, rejected)) return true;
+        if (!rejected || !sendFrame(RESUME_REJECT, {})) break;
+    }
+    state = State::Broken;
+    return false;
+}
+
+bool SecureChannel::serverFull(const std::vector<uint8_t>& body, const Keyring& clients, TicketStore* tickets) {
+    if (body.size() != KEY_ID_SIZE + KEY_SIZE + TAG_SIZE) return false;
+
+    const uint8_t* keyId = body.data();
+    if (!clients.find(keyId, remoteStatic)) return false;      // Client chưa được ghim
+
+    Handshake handshake;
+    Key re;
+    Key shared;
+    std::copy(body.begin() + KEY_ID_SIZE, body.begin() + KEY_ID_SIZE + KEY_SIZE, re.begin());
+    std::vector<uint8_t> payload;
+    if (!handshake.initialize(KK_PROTOCOL) || !handshake.mixPrologue(keyId, KEY_ID_SIZE) ||
+        !handshake.mixHash(remoteStatic.data(), KEY_SIZE) ||
+        !handshake.mixHash(localStatic->publicKey().data(), KEY_SIZE) ||
+        !handshake.mixHash(re.data(), KEY_SIZE) ||
+        !localStatic->dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !localStatic->dh(remoteStatic, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !handshake.decryptAndHash(body.data() + KEY_ID_SIZE + KEY_SIZE, TAG_SIZE, payload)) {
+        return false;
+    }
+
+    NoiseCrypto::KeyPair e;
+    std::vector<uint8_t> cipherText;
+    if (!e.generate() || !handshake.mixHash(e.publicKey().data(), KEY_SIZE) ||
+        !e.dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !e.dh(remoteStatic, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !deriveResumptionPsk(handshake) || !writeTicket(tickets, payload) ||
+        !handshake.encryptAndHash(payload.data(), payload.size(), cipherText)) {
+        return false;
+    }
+
+    std::vector<uint8_t> response(e.publicKey().begin(), e.publicKey().end());
+    response.insert(response.end(), cipherText.begin(), cipherText.end());
+    return sendFrame(FULL_RESPONSE, response) && finish(handshake, false, Mode::Full);
+}
+
+bool SecureChannel::serverResume(const std::vector<uint8_t>& body, const Keyring& clients, TicketStore* tickets,
+    bool& rejected) {
+    rejected = false;
+    if (body.size() < TICKET_ID_SIZE + KEY_SIZE + TAG_SIZE) return false;
+
+    // Vé cấp trước khi client bị gỡ khỏi authorized_clients.txt không còn giá trị: bắt client bắt tay
+    // đầy đủ, bước đó sẽ từ chối khóa không còn được ghim
+    Key psk;
+    if (!tickets || !tickets->redeem(body.data(), psk, remoteStatic) || !clients.contains(remoteStatic)) {
+        rejected = true;
+        return false;
+    }
+
+    Handshake handshake;
+    Key re;
+    Key shared;
+    std::copy(body.begin() + TICKET_ID_SIZE, body.begin() + TICKET_ID_SIZE + KEY_SIZE, re.begin());
+    std::vector<uint8_t> early;
+    if (!handshake.initialize(NNPSK0_PROTOCOL) || !handshake.mixPrologue(body.data(), TICKET_ID_SIZE) ||
+        !handshake.mixKeyAndHash(psk.data(), KEY_SIZE) ||
+        !handshake.mixHash(re.data(), KEY_SIZE) || !handshake.mixKey(re.data(), KEY_SIZE) ||
+        !handshake.decryptAndHash(body.data() + TICKET_ID_SIZE + KEY_SIZE,
+            body.size() - TICKET_ID_SIZE - KEY_SIZE, early)) {
+        return false;
+    }
+
+    NoiseCrypto::KeyPair e;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> cipherText;
+    if (!e.generate() || !handshake.mixHash(e.publicKey().data(), KEY_SIZE) ||
+        !handshake.mixKey(e.publicKey().data(), KEY_SIZE) ||
+        !e.dh(re, shared) || !handshake.mixKey(shared.data(), KEY_SIZE) ||
+        !deriveResumptionPsk(handshake) || !writeTicket(tickets, payload) ||
+        !handshake.encryptAndHash(payload.data(), payload.size(), cipherText)) {
+        return false;
+    }
+
+    std::vector<uint8_t> response(e.publicKey().begin(), e.publicKey().end());
+    response.insert(response.end(), cipherText.begin(), cipherText.end());
+    if (!sendFrame(RESUME_RESPONSE, response) || !finish(handshake, false, Mode::Resumed)) return false;
+
+    readBuffer.swap(early);
+    readOffset = 0;
+    return true;
+}
+
+bool SecureChannel::sendRecords(const uint8_t* data, size_t size) {
+    // Bộ đệm giữ lại giữa các lần gửi, cấp một lần đủ cho RECORDS_PER_WRITE record
+    sendBuffer.resize(RECORDS_PER_WRITE * (FRAME_HEADER + MAX_RECORD + TAG_SIZE));
+    size_t offset = 0;
+    while (offset < size) {
+        size_t used = 0;
+        for (size_t records = 0; records < RECORDS_PER_WRITE && offset < size; records++) {
+            size_t chunk = std::min(MAX_RECORD, size - offset);
+            size_t body = chunk + TAG_SIZE;
+            uint8_t* frame = sendBuffer.data() + used;
+            frame[0] = RECORD;
+            frame[1] = static_cast<uint8_t>(body >> 8);
+            frame[2] = static_cast<uint8_t>(body);
+            if (sendCipher.nonce == UINT64_MAX ||
+                !sendCipher.aead.seal(sendCipher.nonce++, nullptr, 0, data + offset, chunk, frame + FRAME_HEADER)) {
+                return false;
+            }
+            used += FRAME_HEADER + body;
+            offset += chunk;
+        }
+        if (!io.sendAll(sendBuffer.data(), used)) return false;
+    }
+    return true;
+}
+
+int SecureChannel::send(const uint8_t* data, size_t size) {
+    if (size > static_cast<size_t>(INT32_MAX)) return -1;
+
+    size_t sent = 0;
+    if (state == State::ResumeReady) {
+        // 0-RTT: phần đầu của lần gửi đầu tiên đi cùng tin nhắn nối lại, server chạy lệnh ngay khi nhận.
+        // Vẫn chờ trả lời bắt tay (đến cùng lúc với kết quả lệnh) trước khi trả về: server từ chối vé thì
+        // lệnh được gửi lại ngay, kể cả lệnh không đọc kết quả như system::shutdown
+        sent = std::min(size, MAX_RECORD);
+        if (!clientSendResume(data, sent) || !clientFinishResume()) return -1;
+        if (sent == size) return static_cast<int>(size);
+    }
+    if (state != State::Open) return -1;
+
+    if (!sendRecords(data + sent, size - sent)) {
+        state = State::Broken;
+        return -1;
+    }
+    return static_cast<int>(size);
+}
+
+int SecureChannel::recv(uint8_t* buffer, size_t size) {
+    while (decrypted() == 0) {
+        if (state == State::ResumeReady && !clientSendResume(nullptr, 0)) return -1;
+        if (state == State::ResumeSent && !clientFinishResume()) return -1;
+        if (state != State::Open) return -1;
+
+        uint8_t type;
+        bool closed;
+        if (!readFrame(type, frameBody, closed)) {
+            if (closed) return 0;
+            state = State::Broken;
+            return -1;
+        }
+        if (type != RECORD || frameBody.size() < TAG_SIZE || recvCipher.nonce == UINT64_MAX) {
+            state = State::Broken;
+            return -1;
+        }
+
+        // Record vừa chỗ trong buffer của người gọi (đọc file, khung hình): giải mã thẳng vào đó
+        size_t plainSize = frameBody.size() - TAG_SIZE;
+        bool direct = plainSize > 0 && plainSize <= size;
+        readBuffer.resize(direct ? 0 : plainSize);
+        readOffset = 0;
+        if (!recvCipher.aead.open(recvCipher.nonce++, nullptr, 0, frameBody.data(), frameBody.size(),
+            direct ? buffer : readBuffer.data())) {
+            readBuffer.clear();
+            state = State::Broken;
+            return -1;
+        }
+        if (direct) return static_cast<int>(plainSize);
+    }
+
+    size_t count = std::min(size, decrypted());
+    memcpy(buffer, readBuffer.data() + readOffset, count);
+    readOffset += count;
+    return static_cast<int>(count);
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "NoiseCrypto.h"
+
+// Kênh mã hóa và xác thực hai chiều giữa client và server, nằm dưới framing lệnh hiện có.
+//
+// Bắt tay đầy đủ: Noise_KK_25519_AESGCM_SHA256. Hai bên đã ghim khóa tĩnh của nhau (server_keys.txt,
+// authorized_clients.txt), nên kẻ đứng giữa không có khóa bí mật thì không hoàn tất được bắt tay.
+// Sau bắt tay server cấp một vé (ticket) dùng một lần kèm khóa PSK suy ra từ phiên.
+//
+// Bắt tay nối lại: Noise_NNpsk0_25519_AESGCM_SHA256 với PSK của vé: chỉ 1 phép DH mỗi bên thay vì 4,
+// vẫn có forward secrecy nhờ khóa tạm. Lệnh đầu tiên đi luôn trong tin nhắn bắt tay (0-RTT); vì mỗi vé
+// chỉ đổi được một lần nên gửi lại nguyên gói tin cũ sẽ bị từ chối. Server không còn vé (khởi động lại,
+// hết hạn) hoặc khóa của client trong vé đã bị gỡ khỏi authorized_clients.txt thì trả RESUME_REJECT
+// và client bắt tay đầy đủ ngay trên kết nối đó, gửi lại lệnh đầu.
+//
+// Trên dây mọi thứ là frame [type:1][length:2 big-endian][body]. Byte đầu 0x01/0x03 của kết nối
+// không bao giờ là byte đầu của một khung lệnh (luôn là 0, xem MAX_COMMAND_SIZE), nhờ đó server
+// phân biệt được client không mã hóa.
+class SecureChannel {
+public:
+    using Key = NoiseCrypto::Key;
+    using Clock = std::function<long long()>;   // Mili giây đơn điệu
+
+    static constexpr size_t MAX_RECORD = 16384;     // Byte dữ liệu tối đa trong một record
+    static constexpr size_t TICKET_ID_SIZE = 16;
+    static constexpr size_t KEY_ID_SIZE = 8;
+
+    enum FrameType : uint8_t {
+        FULL_INIT = 0x01,
+        FULL_RESPONSE = 0x02,
+        RESUME_INIT = 0x03,
+        RESUME_RESPONSE = 0x04,
+        RESUME_REJECT = 0x05,
+        RECORD = 0x17,
+    };
+
+    // Gửi đủ size byte; nhận tối đa size byte như recv (>0, 0 = đóng, <0 = lỗi)
+    struct Io {
+        std::function<bool(const uint8_t* data, size_t size)> sendAll;
+        std::function<int(uint8_t* buffer, size_t size)> recvSome;
+    };
+
+    struct Ticket {
+        uint8_t id[TICKET_ID_SIZE];
+        Key psk;
+        long long expiresMs;
+    };
+
+    // Vé client đang giữ, theo từng server; mỗi vé bị lấy ra khi dùng
+    class TicketCache {
+    public:
+        explicit TicketCache(Clock clock = nullptr);
+        void store(const std::string& server, const Ticket& ticket);
+        bool take(const std::string& server, Ticket& ticket);
+        void clear(const std::string& server);
+
+    private:
+        static constexpr size_t MAX_PER_SERVER = 8;
+        Clock clock;
+        std::mutex mutex;
+        std::map<std::string, std::deque<Ticket>> tickets;
+    };
+
+    // Vé server đã cấp: đổi được đúng một lần, hết hạn sau TICKET_LIFETIME_MS, chỉ nằm trong bộ nhớ
+    class TicketStore {
+    public:
+        static constexpr long long TICKET_LIFETIME_MS = 12LL * 60 * 60 * 1000;
+        static constexpr size_t MAX_TICKETS = 10000;
+
+        explicit TicketStore(Clock clock = nullptr);
+        bool issue(const Key& psk, const Key& clientKey, uint8_t id[TICKET_ID_SIZE]);
+        bool redeem(const uint8_t id[TICKET_ID_SIZE], Key& psk, Key& clientKey);
+        size_t size();
+
+    private:
+        struct Entry {
+            Key psk;
+            Key clientKey;
+            long long expiresMs;
+        };
+        Clock clock;
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::deque<std::pair<long long, std::string>> expiry;    // Theo thứ tự cấp (hạn tăng dần)
+    };
+
+    // Khóa tĩnh của các client được phép, tra theo key id (8 byte đầu SHA-256 của khóa công khai)
+    class Keyring {
+    public:
+        void add(const Key& publicKey);
+        bool find(const uint8_t id[KEY_ID_SIZE], Key& publicKey) const;
+        bool contains(const Key& publicKey) const;
+        size_t size() const { return keys.size(); }
+        static void keyId(const Key& publicKey, uint8_t id[KEY_ID_SIZE]);
+
+    private:
+        std::unordered_map<std::string, Key> keys;
+    };
+
+    enum class Mode { None, Full, Resumed };
+
+    // Dùng như một socket: tối đa một thread gửi và một thread nhận cùng lúc
+    explicit SecureChannel(Io io);
+
+    // Client: có vé còn hạn thì chỉ chuẩn bị nối lại, tin nhắn bắt tay đi cùng lần send() đầu tiên (0-RTT);
+    // không thì bắt tay đầy đủ ngay. server là khóa tra vé trong cache (vd "ip:port")
+    bool connect(const NoiseCrypto::KeyPair& localStatic, const Key& serverStatic,
+        TicketCache* cache, const std::string& server);
+    // Server: đọc tin nhắn bắt tay đầu tiên và trả lời; dữ liệu 0-RTT được đưa vào bộ đệm đọc
+    bool accept(const NoiseCrypto::KeyPair& localStatic, const Keyring& clients, TicketStore* tickets);
+
+    // Trả size hoặc -1. Mỗi lần gọi là một hoặc vài record, gửi bằng một lần sendAll
+    int send(const uint8_t* data, size_t size);
+    // Như recv: >0 byte, 0 khi bên kia đóng đúng ranh giới record, -1 khi lỗi hoặc dữ liệu bị sửa
+    int recv(uint8_t* buffer, size_t size);
+    // Byte đã nhận từ socket nhưng chưa trả cho người gọi (đã giải mã hoặc còn nằm trong bộ đệm đọc trước);
+    // select() trên socket không thấy được phần này
+    size_t buffered() const { return readBuffer.size() - readOffset + inboundEnd - inboundStart; }
+
+    Mode mode() const { return handshakeMode; }
+    const Key& remoteKey() const { return remoteStatic; }
+
+private:
+    struct CipherState {
+        NoiseCrypto::Aead aead;
+        uint64_t nonce = 0;
+    };
+
+    // SymmetricState của Noise
+    struct Handshake {
+        Key ck;
+        Key h;
+        CipherState cipher;
+
+        bool initialize(const char* protocolName);
+        bool mixPrologue(const uint8_t* clearId, size_t size);
+        bool mixHash(const uint8_t* data, size_t size);
+        bool mixKey(const uint8_t* ikm, size_t size);
+        bool mixKeyAndHash(const uint8_t* ikm, size_t size);
+        bool encryptAndHash(const uint8_t* plain, size_t size, std::vector<uint8_t>& out);
+        bool decryptAndHash(const uint8_t* cipher, size_t size, std::vector<uint8_t>& out);
+    };
+
+    enum class State { Idle, ResumeReady, ResumeSent, Open, Broken };
+
+    static bool hkdf(const Key& chainingKey, const uint8_t* ikm, size_t size, Key* outputs, int count);
+    static long long steadyNowMs();
+
+    bool sendFrame(uint8_t type, const std::vector<uint8_t>& body);
+    bool readFrame(uint8_t& type, std::vector<uint8_t>& body, bool& closed);
+    bool readExact(uint8_t* buffer, size_t size, bool& closed);
+
+    bool clientFull();
+    bool clientSendResume(const uint8_t* early, size_t size);
+    bool clientFinishResume();
+    bool serverFull(const std::vector<uint8_t>& body, const Keyring& clients, TicketStore* tickets);
+    bool serverResume(const std::vector<uint8_t>& body, const Keyring& clients, TicketStore* tickets, bool& rejected);
+    bool deriveResumptionPsk(const Handshake& handshake);
+    bool finish(Handshake& handshake, bool initiator, Mode completedMode);
+    bool readTicket(const std::vector<uint8_t>& payload);
+    bool writeTicket(TicketStore* tickets, std::vector<uint8_t>& payload);
+
+    bool sendRecords(const uint8_t* data, size_t size);
+    size_t decrypted() const { return readBuffer.size() - readOffset; }
+
+    Io io;
+    std::atomic<State> state;
+    Mode handshakeMode;
+    const NoiseCrypto::KeyPair* localStatic;
+    Key remoteStatic;
+    TicketCache* ticketCache;
+    std::string server;
+    Ticket pendingTicket;               // Vé đang dùng để nối lại (client)
+    Handshake resumeHandshake;          // Bắt tay nối lại đang chờ RESUME_RESPONSE
+    NoiseCrypto::KeyPair ephemeral;
+    std::vector<uint8_t> earlyData;     // Giữ lại để gửi lại nếu server từ chối vé
+    Key resumptionPsk;
+
+    CipherState sendCipher;
+    CipherState recvCipher;
+    std::vector<uint8_t> readBuffer;
+    size_t readOffset;
+    std::vector<uint8_t> frameBody;
+    std::vector<uint8_t> inbound;       // Byte đọc trước từ socket, chưa tách thành frame
+    size_t inboundStart;
+    size_t inboundEnd;
+    std::vector<uint8_t> sendBuffer;
+};
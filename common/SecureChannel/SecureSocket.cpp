@@ -0,0 +1,301 @@
+#include "SecureSocket.h"
+#include "SecureChannel.h"
+#include "Metrics.h"
+#include "AppData.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <windows.h>
+#include <wincrypt.h>
+#pragma comment(lib, "crypt32.lib")
+
+namespace SecureSocket {
+
+// %APPDATA%\EmailPCControl\transport\<file>
+static std::string transportPath(const std::string& file) {
+    return AppData::path("transport\\" + file);
+}
+
+static std::string toHex(const SecureChannel::Key& key) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t byte : key) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0x0F];
+    }
+    return hex;
+}
+
+static bool fromHex(const std::string& hex, SecureChannel::Key& key) {
+    if (hex.size() != key.size() * 2) return false;
+    for (size_t i = 0; i < key.size(); i++) {
+        int value = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = hex[i * 2 + j];
+            int digit = (c >= '0' && c <= '9') ? c - '0' :
+                (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0) return false;
+            value = value * 16 + digit;
+        }
+        key[i] = static_cast<uint8_t>(value);
+    }
+    return true;
+}
+
+// Khóa tĩnh lưu dạng DPAPI (chỉ tài khoản Windows đã tạo nó giải mã được). Chưa có file thì tạo mới
+static bool loadOrCreateKey(const std::string& path, NoiseCrypto::KeyPair& key) {
+    if (path.empty()) return false;
+
+    std::ifstream in(path, std::ios::binary);
+    if (in.is_open()) {
+        std::vector<char> stored((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        DATA_BLOB input = { static_cast<DWORD>(stored.size()), reinterpret_cast<BYTE*>(stored.data()) };
+        DATA_BLOB output = {};
+        if (!CryptUnprotectData(&input, nullptr, nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+            std::cerr << "Unable to decrypt transport key " << path << ": " << GetLastError() << std::endl;
+            return false;
+        }
+        std::vector<uint8_t> secret(output.pbData, output.pbData + output.cbData);
+        SecureZeroMemory(output.pbData, output.cbData);
+        LocalFree(output.pbData);
+
+        bool ok = key.importPrivate(secret);
+        SecureZeroMemory(secret.data(), secret.size());
+        if (!ok) std::cerr << "Invalid transport key: " << path << std::endl;
+        return ok;
+    }
+
+    std::vector<uint8_t> secret;
+    if (!key.generate() || (secret = key.exportPrivate()).empty()) {
+        std::cerr << "Unable to generate transport key (Curve25519 needs Windows 10 1709 or later)" << std::endl;
+        return false;
+    }
+
+    DATA_BLOB input = { static_cast<DWORD>(secret.size()), secret.data() };
+    DATA_BLOB output = {};
+    bool saved = false;
+    if (CryptProtectData(&input, L"EmailPCControl transport key", nullptr, nullptr, nullptr,
+        CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(output.pbData), output.cbData);
+        saved = out.good();
+        LocalFree(output.pbData);
+    }
+    SecureZeroMemory(secret.data(), secret.size());
+
+    if (!saved) {
+        // Vẫn dùng được cho lần chạy này, nhưng lần sau khóa sẽ khác và bên kia phải ghim lại
+        std::cerr << "Unable to save transport key: " << path << std::endl;
+    }
+    return true;
+}
+
+// Đọc một lần cho cả tiến trình
+static const NoiseCrypto::KeyPair* identity(bool server) {
+    struct Identity {
+        NoiseCrypto::KeyPair key;
+        bool loaded;
+        explicit Identity(const char* file) : loaded(loadOrCreateKey(transportPath(file), key)) {}
+    };
+    if (server) {
+        static Identity serverIdentity("server_key.bin");
+        return serverIdentity.loaded ? &serverIdentity.key : nullptr;
+    }
+    static Identity clientIdentity("client_key.bin");
+    return clientIdentity.loaded ? &clientIdentity.key : nullptr;
+}
+
+std::string clientPublicKey() {
+    const NoiseCrypto::KeyPair* key = identity(false);
+    return key ? toHex(key->publicKey()) : "";
+}
+
+std::string serverPublicKey() {
+    const NoiseCrypto::KeyPair* key = identity(true);
+    return key ? toHex(key->publicKey()) : "";
+}
+
+// Đọc lại mỗi lần kết nối (file nhỏ) để sửa file ghim không cần khởi động lại
+static std::vector<std::vector<std::string>> readPinFile(const std::string& file) {
+    std::vector<std::vector<std::string>> lines;
+    std::ifstream in(transportPath(file));
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::vector<std::string> words;
+        std::string word;
+        while (fields >> word) words.push_back(word);
+        if (!words.empty() && words[0][0] != '#') lines.push_back(words);
+    }
+    return lines;
+}
+
+static bool findServerPin(const std::string& serverIP, SecureChannel::Key& key) {
+    bool found = false;
+    for (const std::vector<std::string>& words : readPinFile("server_keys.txt")) {
+        if (words.size() < 2) continue;
+        if (words[0] == serverIP) return fromHex(words[1], key);
+        if (words[0] == "*" && !found) found = fromHex(words[1], key);
+    }
+    return found;
+}
+
+static SecureChannel::Keyring loadAuthorizedClients() {
+    SecureChannel::Keyring clients;
+    for (const std::vector<std::string>& words : readPinFile("authorized_clients.txt")) {
+        SecureChannel::Key key;
+        if (fromHex(words[0], key)) clients.add(key);
+    }
+    return clients;
+}
+
+// Vé nối lại phiên: client nhớ vé theo server, server nhớ vé đã cấp (chỉ trong bộ nhớ)
+static SecureChannel::TicketCache& ticketCache() {
+    static SecureChannel::TicketCache cache;
+    return cache;
+}
+
+static SecureChannel::TicketStore& ticketStore() {
+    static SecureChannel::TicketStore store;
+    return store;
+}
+
+static std::mutex channelsMutex;
+static std::unordered_map<SOCKET, std::shared_ptr<SecureChannel>> channels;
+
+static std::shared_ptr<SecureChannel> channelFor(SOCKET socket) {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    auto it = channels.find(socket);
+    return it == channels.end() ? nullptr : it->second;
+}
+
+static std::shared_ptr<SecureChannel> makeChannel(SOCKET socket) {
+    SecureChannel::Io io;
+    io.sendAll = [socket](const uint8_t* data, size_t size) {
+        size_t sent = 0;
+        while (sent < size) {
+            int result = ::send(socket, reinterpret_cast<const char*>(data) + sent,
+                static_cast<int>(size - sent), 0);
+            if (result == SOCKET_ERROR || result == 0) return false;
+            sent += result;
+        }
+        return true;
+    };
+    io.recvSome = [socket](uint8_t* buffer, size_t size) {
+        return ::recv(socket, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0);
+    };
+    return std::make_shared<SecureChannel>(io);
+}
+
+static void recordHandshake(const char* mode, std::chrono::steady_clock::time_point start) {
+    std::string labels = std::string("mode=\"") + mode + "\"";
+    Metrics::registry().counter("transport_handshakes_total",
+        "Connections by transport setup (full, resumable, resumed, plaintext, failed)", labels).add();
+    Metrics::registry().histogram("transport_handshake_duration_microseconds",
+        "Time to set up the transport of a connection", labels).record(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+bool connectClient(SOCKET socket, const std::string& serverIP, int port) {
+    auto start = std::chrono::steady_clock::now();
+
+    SecureChannel::Key serverKey;
+    if (!findServerPin(serverIP, serverKey)) {
+        recordHandshake("plaintext", start);
+        return true;
+    }
+
+    const NoiseCrypto::KeyPair* local = identity(false);
+    if (!local) {
+        recordHandshake("failed", start);
+        return false;
+    }
+
+    std::shared_ptr<SecureChannel> channel = makeChannel(socket);
+    if (!channel->connect(*local, serverKey, &ticketCache(), serverIP + ":" + std::to_string(port))) {
+        std::cerr << "Secure handshake with " << serverIP << " failed (wrong pinned key, or this client "
+            "is not in the server's authorized_clients.txt)" << std::endl;
+        recordHandshake("failed", start);
+        return false;
+    }
+
+    // Có vé thì bắt tay nối lại đi cùng lệnh đầu tiên, nên ở đây chưa tính là "resumed"
+    recordHandshake(channel->mode() == SecureChannel::Mode::Full ? "full" : "resumable", start);
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    channels[socket] = channel;
+    return true;
+}
+
+bool acceptServer(SOCKET socket, std::string& description) {
+    auto start = std::chrono::steady_clock::now();
+
+    char first = 0;
+    if (::recv(socket, &first, 1, MSG_PEEK) != 1) {
+        description = "closed before sending anything";
+        return false;
+    }
+
+    SecureChannel::Keyring clients = loadAuthorizedClients();
+    if (first != SecureChannel::FULL_INIT && first != SecureChannel::RESUME_INIT) {
+        if (clients.size() > 0) {
+            description = "unencrypted connection rejected (authorized_clients.txt is set)";
+            recordHandshake("failed", start);
+            return false;
+        }
+        description = "unencrypted (no authorized_clients.txt)";
+        recordHandshake("plaintext", start);
+        return true;
+    }
+
+    const NoiseCrypto::KeyPair* local = identity(true);
+    std::shared_ptr<SecureChannel> channel = makeChannel(socket);
+    if (!local || !channel->accept(*local, clients, &ticketStore())) {
+        description = "secure handshake failed (unknown client key or tampered handshake)";
+        recordHandshake("failed", start);
+        return false;
+    }
+
+    bool resumed = channel->mode() == SecureChannel::Mode::Resumed;
+    description = std::string(resumed ? "encrypted, resumed" : "encrypted") +
+        ", client key " + toHex(channel->remoteKey()).substr(0, 16);
+    recordHandshake(resumed ? "resumed" : "full", start);
+
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    channels[socket] = channel;
+    return true;
+}
+
+int send(SOCKET socket, const char* data, int size, int flags) {
+    std::shared_ptr<SecureChannel> channel = channelFor(socket);
+    if (!channel) return ::send(socket, data, size, flags);
+    if (size <= 0) return 0;
+    int result = channel->send(reinterpret_cast<const uint8_t*>(data), static_cast<size_t>(size));
+    return result < 0 ? SOCKET_ERROR : result;
+}
+
+int recv(SOCKET socket, char* buffer, int size, int flags) {
+    std::shared_ptr<SecureChannel> channel = channelFor(socket);
+    if (!channel) return ::recv(socket, buffer, size, flags);
+    if (size <= 0) return 0;
+    int result = channel->recv(reinterpret_cast<uint8_t*>(buffer), static_cast<size_t>(size));
+    return result < 0 ? SOCKET_ERROR : result;
+}
+
+size_t buffered(SOCKET socket) {
+    std::shared_ptr<SecureChannel> channel = channelFor(socket);
+    return channel ? channel->buffered() : 0;
+}
+
+void detach(SOCKET socket) {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    channels.erase(socket);
+}
+
+}
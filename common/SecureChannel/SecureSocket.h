@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <winsock2.h>
+
+// Gắn SecureChannel vào socket lệnh. Mọi chỗ gửi/nhận trên socket giữa client và server gọi
+// SecureSocket::send/recv thay cho ::send/::recv; socket chưa gắn kênh thì đi thẳng xuống Winsock,
+// nên framing lệnh (độ dài 4/8 byte, ack của screen::stream...) giữ nguyên ở cả hai chế độ.
+//
+// Khóa nằm trong %APPDATA%\EmailPCControl\transport\:
+// - client_key.bin / server_key.bin: khóa X25519 tĩnh, tạo ở lần chạy đầu, bảo vệ bằng DPAPI
+// - server_keys.txt (client): mỗi dòng "<ip hoặc *> <khóa công khai hex của server>"
+// - authorized_clients.txt (server): mỗi dòng "<khóa công khai hex của client> [tên]"
+// Dòng bắt đầu bằng # là chú thích. Khóa công khai của mỗi bên được ghi ra log khi khởi động.
+// Client không có khóa ghim cho server thì kết nối không mã hóa như trước; server đã có
+// authorized_clients.txt thì từ chối mọi kết nối không mã hóa hoặc từ client chưa được ghim.
+namespace SecureSocket {
+
+// Sau ::connect: bắt tay nếu server đã được ghim. false thì phải đóng socket
+bool connectClient(SOCKET socket, const std::string& serverIP, int port);
+// Sau accept: nhận diện bắt tay qua byte đầu. false thì phải đóng socket; description để ghi log
+bool acceptServer(SOCKET socket, std::string& description);
+
+// Như ::send/::recv (flags chỉ dùng cho socket không mã hóa). send trả size khi gửi đủ
+int send(SOCKET socket, const char* data, int size, int flags);
+int recv(SOCKET socket, char* buffer, int size, int flags);
+// Byte đã giải mã còn chờ đọc: select() báo không có gì vẫn có thể còn dữ liệu ở đây
+size_t buffered(SOCKET socket);
+// Gọi trước closesocket
+void detach(SOCKET socket);
+
+// Khóa công khai (hex) để dán vào file ghim của bên kia; rỗng nếu không tạo/đọc được khóa
+std::string clientPublicKey();
+std::string serverPublicKey();
+
+}
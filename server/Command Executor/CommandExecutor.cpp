@@ -1,4 +1,10 @@
 ﻿#include "CommandExecutor.h"
+#include "CommandRegistry.h"
+#include "ServiceControl.h"
+#include "Metrics.h"
+#include "SecureSocket.h"
+#include "FileTransfer.h"
+#include "AppData.h"
 
 Command::Command() {
     InitializeGDIPlus(gdiplusToken);
@@ -19,62 +25,47 @@ void Command::ShutdownGDIPlus(ULONG_PTR gdiplusToken) {
 
 void Command::SendMessages(SOCKET clientSocket, const std::string& message) {
     int messageSize = message.size();
-    send(clientSocket, (char*)&messageSize, sizeof(messageSize), 0);
-    send(clientSocket, message.c_str(), messageSize, 0);
+    SecureSocket::send(clientSocket, (char*)&messageSize, sizeof(messageSize), 0);
+    SecureSocket::send(clientSocket, message.c_str(), messageSize, 0);
 }
 
-void Command::sendFile(SOCKET clientSocket, const std::string& fileName) {
-    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        std::cout << "[ERROR] Unable to open file: " << fileName << std::endl;
-        SendMessages(clientSocket, "Unable to open file.");
-        return;
-    }
-
-    std::streamsize fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::cout << "[INFO] Sending file size: " << fileSize << " bytes" << std::endl;
-    send(clientSocket, (char*)&fileSize, sizeof(fileSize), 0);
-
-    char buffer[DEFAULT_BUFLEN];
-    std::streamsize totalSent = 0;
-
-    while (totalSent < fileSize) {
-        file.read(buffer, DEFAULT_BUFLEN);
-        int bytesRead = file.gcount();
-
-        int bytesSent = 0;
-        while (bytesSent < bytesRead) {
-            int result = send(clientSocket, buffer + bytesSent, bytesRead - bytesSent, 0);
-            if (result == SOCKET_ERROR) {
-                std::cout << "[ERROR] Failed to send file. WSA Error: " << WSAGetLastError() << std::endl;
-                SendMessages(clientSocket, "Error occurred while sending file.");
-                file.close();
-                return;
+// Gửi hết size byte: socket không mã hóa có thể chỉ nhận một phần mỗi lần send
+static FileTransfer::Sink socketSink(SOCKET clientSocket) {
+    static Metrics::Counter& sentBytes = Metrics::registry().counter(
+        "server_socket_sent_bytes_total", "Bytes sent to clients");
+
+    return [clientSocket](const char* data, size_t size) {
+        size_t sent = 0;
+        while (sent < size) {
+            int result = SecureSocket::send(clientSocket, data + sent, static_cast<int>(size - sent), 0);
+            if (result == SOCKET_ERROR || result == 0) {
+                std::cout << "[ERROR] Failed to send file data. WSA Error: " << WSAGetLastError() << std::endl;
+                sentBytes.add(sent);
+                return false;
             }
-            bytesSent += result;
+            sent += result;
         }
-        totalSent += bytesSent;
-        std::cout << "[INFO] Progress: " << totalSent << "/" << fileSize << " bytes sent" << std::endl;
-    }
+        sentBytes.add(sent);
+        return true;
+    };
+}
 
-    file.close();
-    std::cout << "[SUCCESS] File sent successfully: " << fileName << std::endl;
-    SendMessages(clientSocket, "File sent successfully.");
+bool Command::handleGetFile(SOCKET clientSocket, const std::string& path, std::string& summary) {
+    std::cout << "[INFO] Processing file request: " << path << std::endl;
+    bool sent = FileTransfer::sendPath(socketSink(clientSocket), path, summary);
+    std::cout << (sent ? "[SUCCESS] " : "[ERROR] ") << summary << std::endl;
+    return sent;
 }
 
-void Command::handleGetFile(SOCKET clientSocket, const std::string& fileName) {
-    std::ifstream checkFile(fileName);
-    if (!checkFile.good()) {
-        std::cout << "[ERROR] File does not exist: " << fileName << std::endl;
-        SendMessages(clientSocket, "File not found.");
-        return;
-    }
-    checkFile.close();
+bool Command::handleListFiles(SOCKET clientSocket, const std::string& args, std::string& summary) {
+    FileTransfer::ListOptions options = FileTransfer::parseListArgs(args);
+    bool sent = FileTransfer::sendListing(socketSink(clientSocket), options, summary);
+    std::cout << (sent ? "[SUCCESS] " : "[ERROR] ") << summary << std::endl;
+    return sent;
+}
 
-    std::cout << "[INFO] Processing file request: " << fileName << std::endl;
-    sendFile(clientSocket, fileName);
+bool Command::sendText(SOCKET clientSocket, const std::string& text) {
+    return FileTransfer::sendBuffer(socketSink(clientSocket), text.data(), text.size(), "");
 }
 
 void Command::handleDeleteFile(SOCKET clientSocket, const string& fileName) {
@@ -105,22 +96,24 @@ void Command::handleDeleteFile(SOCKET clientSocket, const string& fileName) {
     }
 }
 
-bool Command::IsVisibleWindow(DWORD processID) {
+// Duyệt cửa sổ một lần cho cả danh sách process, thay vì duyệt lại toàn bộ cửa sổ cho từng process
+unordered_set<DWORD> Command::GetVisibleWindowProcessIds() {
+    unordered_set<DWORD> processIds;
     HWND hwnd = GetTopWindow(NULL);
     while (hwnd) {
-        DWORD windowProcessID;
-        GetWindowThreadProcessId(hwnd, &windowProcessID);
-
-        if (windowProcessID == processID && IsWindowVisible(hwnd)) {
-            return true;
+        if (IsWindowVisible(hwnd)) {
+            DWORD windowProcessID;
+            GetWindowThreadProcessId(hwnd, &windowProcessID);
+            processIds.insert(windowProcessID);
         }
         hwnd = GetNextWindow(hwnd, GW_HWNDNEXT);
     }
-    return false;
+    return processIds;
 }
 
 vector<wstring> Command::GetRunningApplications() {
     set<wstring> applications;
+    unordered_set<DWORD> visibleProcessIds = GetVisibleWindowProcessIds();
     HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
 
     if (hSnapshot != INVALID_HANDLE_VALUE) {
@@ -129,7 +122,7 @@ vector<wstring> Command::GetRunningApplications() {
 
         if (Process32FirstW(hSnapshot, &pe32)) {
             do {
-                if (IsVisibleWindow(pe32.th32ProcessID)) {
+                if (visibleProcessIds.count(pe32.th32ProcessID) > 0) {
                     applications.insert(wstring(pe32.szExeFile));
                 }
             } while (Process32NextW(hSnapshot, &pe32));
@@ -265,6 +258,11 @@ int Command::GetEncoderClsid(const WCHAR* format, CLSID* pClsid) {
 }
 
 vector<BYTE> Command::captureScreenWithGDIPlus(int& width, int& height) {
+    // Chụp + mã hóa PNG bằng GDI+, cũng dùng cho ảnh camera
+    static Metrics::Histogram& captureTime = Metrics::registry().histogram(
+        "screenshot_encode_microseconds", "Screen capture and image encoding time");
+    Metrics::ScopedTimer timer(captureTime);
+
     HDC hScreenDC = GetDC(nullptr);
     HDC hMemoryDC = CreateCompatibleDC(hScreenDC);
 
@@ -303,18 +301,23 @@ vector<BYTE> Command::captureScreenWithGDIPlus(int& width, int& height) {
 }
 
 void Command::sendImage(SOCKET clientSocket, const vector<BYTE>& image) {
+    static Metrics::Counter& sentBytes = Metrics::registry().counter(
+        "server_socket_sent_bytes_total", "Bytes sent to clients");
+
     int imageSize = image.size();
-    send(clientSocket, (char*)&imageSize, sizeof(imageSize), 0);
+    SecureSocket::send(clientSocket, (char*)&imageSize, sizeof(imageSize), 0);
 
     int bytesSent = 0;
     while (bytesSent < imageSize) {
-        int result = send(clientSocket, (char*)image.data() + bytesSent, imageSize - bytesSent, 0);
+        int result = SecureSocket::send(clientSocket, (char*)image.data() + bytesSent, imageSize - bytesSent, 0);
         if (result == SOCKET_ERROR) {
             cerr << "Error data.\n";
+            sentBytes.add(bytesSent);
             return;
         }
         bytesSent += result;
     }
+    sentBytes.add(sizeof(imageSize) + bytesSent);
 
     cout << "Success send image with size: " << imageSize << " bytes\n";
 }
@@ -340,26 +343,7 @@ void Command::lockScreen() {
 }
 
 string Command::help() {
-    string helps = "HELP\n";
-    helps += "=====\n";
-    helps += "Functions performed by the server: \n";
-    helps += "  1. Check list applications: list::app\n";
-    helps += "  2. Check list process: list::process\n";
-    helps += "  3. Check list services: list::service\n";
-    helps += "  4. Screenshot: screenshot::capture\n";
-    helps += "  5. Select file: file::get [path_file]\n";
-    helps += "  6. Delete file: file::delete [path_file]\n";
-    helps += "  7. Open webcam: camera::open\n";
-    helps += "  8. Close webcam: camera::close\n";
-    helps += "  9. Start application: app::start [app_name]\n";
-    helps += " 10. Stop application: app::stop [app_name]\n";
-    helps += " 11. Start service: service::start [service_name]\n";
-    helps += " 12. Stop service: service::stop [service_name]\n";
-    helps += " 13. Shut down computer: system::shutdown\n";
-    helps += " 14. Restart computer: system::restart\n";
-    helps += " 15. Lock screen: system::lock\n";
-    helps += " 16. Help: help::cmd\n";
-    return helps;
+    return buildHelpText();
 }
 
 void Command::startApplication(const string& appName) {
@@ -512,20 +496,11 @@ std::vector<BYTE> Command::recordVideo(int seconds) {
     std::cout << "Recording completed: " << frameCount << " frames captured" << std::endl;
 
     // Get AppData path for temporary storage
-    PWSTR appDataPath = nullptr;
-    if (FAILED(SHGetKnownFolderPath(FOLDERID_RoamingAppData, 0, nullptr, &appDataPath))) {
+    std::string videoPath = AppData::path("temp\\temp_recording.avi");
+    if (videoPath.empty()) {
         throw std::runtime_error("Failed to get AppData path");
     }
 
-    // Create temporary file path
-    std::wstring widePath(appDataPath);
-    std::string appDataStr(widePath.begin(), widePath.end());
-    std::string appDir = appDataStr + "\\EmailPCControl\\temp";
-    CreateDirectoryA((appDataStr + "\\EmailPCControl").c_str(), nullptr);
-    CreateDirectoryA(appDir.c_str(), nullptr);
-    std::string videoPath = appDir + "\\temp_recording.avi";
-    CoTaskMemFree(appDataPath);
-
     // Save frames to video file
     cv::VideoWriter video(videoPath,
         cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
@@ -577,159 +552,14 @@ std::vector<BYTE> Command::recordVideo(int seconds) {
     return buffer;
 }
 
-void Command::startService(const string& serviceName) {
-    SC_HANDLE schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_ALL_ACCESS);
-    if (schSCManager == NULL) {
-        DWORD error = GetLastError();
-        string response = "Failed to open Service Control Manager. Error code: " + to_string(error);
-        cout << response << endl;
-        return;
-    }
-
-    SC_HANDLE schService = OpenServiceA(
-        schSCManager,
-        serviceName.c_str(),
-        SERVICE_START | SERVICE_QUERY_STATUS
-    );
-
-    if (schService == NULL) {
-        DWORD error = GetLastError();
-        string response = "Failed to open service " + serviceName + ". Error code: " + to_string(error);
-        cout << response << endl;
-        CloseServiceHandle(schSCManager);
-        return;
-    }
-
-    // Check current service status
-    SERVICE_STATUS_PROCESS ssp;
-    DWORD bytesNeeded;
-    if (QueryServiceStatusEx(
-        schService,
-        SC_STATUS_PROCESS_INFO,
-        (LPBYTE)&ssp,
-        sizeof(SERVICE_STATUS_PROCESS),
-        &bytesNeeded)) {
-
-        if (ssp.dwCurrentState != SERVICE_STOPPED) {
-            cout << "Service " << serviceName << " is already running or pending." << endl;
-            CloseServiceHandle(schService);
-            CloseServiceHandle(schSCManager);
-            return;
-        }
-    }
-
-    // Try to start the service
-    if (StartServiceA(schService, 0, NULL)) {
-        cout << "Service " << serviceName << " start command sent successfully." << endl;
-
-        // Wait for the service to start
-        int attempts = 0;
-        while (attempts < 10) {
-            if (QueryServiceStatusEx(
-                schService,
-                SC_STATUS_PROCESS_INFO,
-                (LPBYTE)&ssp,
-                sizeof(SERVICE_STATUS_PROCESS),
-                &bytesNeeded)) {
-
-                if (ssp.dwCurrentState == SERVICE_RUNNING) {
-                    cout << "Service " << serviceName << " started successfully." << endl;
-                    break;
-                }
-                else if (ssp.dwCurrentState == SERVICE_STOPPED) {
-                    cout << "Service " << serviceName << " failed to start." << endl;
-                    break;
-                }
-            }
-            Sleep(1000);  // Wait 1 second before checking again
-            attempts++;
-        }
-    }
-    else {
-        DWORD error = GetLastError();
-        string response = "Failed to start service " + serviceName + ". Error code: " + to_string(error);
-        cout << response << endl;
-    }
-
-    CloseServiceHandle(schService);
-    CloseServiceHandle(schSCManager);
+bool Command::startService(const string& serviceNames, string& report) {
+    vector<ServiceControl::Result> results = ServiceControl::run(ServiceControl::Action::Start, serviceNames);
+    report = ServiceControl::formatReport(ServiceControl::Action::Start, results);
+    return ServiceControl::allSucceeded(results);
 }
 
-void Command::stopService(const string& serviceName) {
-    SC_HANDLE schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_ALL_ACCESS);
-    if (schSCManager == NULL) {
-        DWORD error = GetLastError();
-        string response = "Failed to open Service Control Manager. Error code: " + to_string(error);
-        cout << response << endl;
-        return;
-    }
-
-    SC_HANDLE schService = OpenServiceA(
-        schSCManager,
-        serviceName.c_str(),
-        SERVICE_STOP | SERVICE_QUERY_STATUS
-    );
-
-    if (schService == NULL) {
-        DWORD error = GetLastError();
-        string response = "Failed to open service " + serviceName + ". Error code: " + to_string(error);
-        cout << response << endl;
-        CloseServiceHandle(schSCManager);
-        return;
-    }
-
-    // Check current service status
-    SERVICE_STATUS_PROCESS ssp;
-    DWORD bytesNeeded;
-    if (QueryServiceStatusEx(
-        schService,
-        SC_STATUS_PROCESS_INFO,
-        (LPBYTE)&ssp,
-        sizeof(SERVICE_STATUS_PROCESS),
-        &bytesNeeded)) {
-
-        if (ssp.dwCurrentState == SERVICE_STOPPED) {
-            cout << "Service " << serviceName << " is already stopped." << endl;
-            CloseServiceHandle(schService);
-            CloseServiceHandle(schSCManager);
-            return;
-        }
-    }
-
-    // Try to stop the service
-    SERVICE_STATUS status;
-    if (ControlService(schService, SERVICE_CONTROL_STOP, &status)) {
-        cout << "Service " << serviceName << " stop command sent successfully." << endl;
-
-        // Wait for the service to stop
-        int attempts = 0;
-        while (attempts < 10) {
-            if (QueryServiceStatusEx(
-                schService,
-                SC_STATUS_PROCESS_INFO,
-                (LPBYTE)&ssp,
-                sizeof(SERVICE_STATUS_PROCESS),
-                &bytesNeeded)) {
-
-                if (ssp.dwCurrentState == SERVICE_STOPPED) {
-                    cout << "Service " << serviceName << " stopped successfully." << endl;
-                    break;
-                }
-                else if (ssp.dwCurrentState == SERVICE_RUNNING) {
-                    cout << "Service " << serviceName << " failed to stop." << endl;
-                    break;
-                }
-            }
-            Sleep(1000);  // Wait 1 second before checking again
-            attempts++;
-        }
-    }
-    else {
-        DWORD error = GetLastError();
-        string response = "Failed to stop service " + serviceName + ". Error code: " + to_string(error);
-        cout << response << endl;
-    }
-
-    CloseServiceHandle(schService);
-    CloseServiceHandle(schSCManager);
+bool Command::stopService(const string& serviceNames, string& report) {
+    vector<ServiceControl::Result> results = ServiceControl::run(ServiceControl::Action::Stop, serviceNames);
+    report = ServiceControl::formatReport(ServiceControl::Action::Stop, results);
+    return ServiceControl::allSucceeded(results);
 }
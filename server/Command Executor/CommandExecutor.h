@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_set>
 #include <sstream>
 #include <fstream>
 #include <iomanip>
@@ -34,7 +35,7 @@ private:
     ULONG_PTR gdiplusToken;
 
     // Helper functions
-    bool IsVisibleWindow(DWORD processID);
+    unordered_set<DWORD> GetVisibleWindowProcessIds();
     int GetEncoderClsid(const WCHAR* format, CLSID* pClsid);
     void InitializeGDIPlus(ULONG_PTR& gdiplusToken);
     void ShutdownGDIPlus(ULONG_PTR gdiplusToken);
@@ -77,16 +78,21 @@ public:
     string help();
 
     void SendMessages(SOCKET clientSocket, const std::string& message);
-    void sendFile(SOCKET clientSocket, const std::string& fileName);
-    void handleGetFile(SOCKET clientSocket, const std::string& fileName);
+    // Kết quả ResultKind::Text theo khung của FileTransfer (int64 kích thước + nội dung + trạng thái)
+    bool sendText(SOCKET clientSocket, const std::string& text);
+    // file::get (một file, hoặc nhiều file theo * ? thành một file tar) và file::list, xem FileTransfer.h.
+    // summary để ghi log; false khi không gửi được gì hoặc kết nối lỗi
+    bool handleGetFile(SOCKET clientSocket, const std::string& path, std::string& summary);
+    bool handleListFiles(SOCKET clientSocket, const std::string& args, std::string& summary);
     void handleDeleteFile(SOCKET clientSocket, const string& fileName);
 
     //Start/Stop app
     void startApplication(const string& appName);
     void stopApplication(const string& appName);
 
-    //Start/Stop service
-    void startService(const string& serviceName);
-    void stopService(const string& serviceName);
+    //Start/Stop service: nhận nhiều tên phân cách bằng dấu phẩy, trả về báo cáo từng service
+    // Trả về true nếu mọi service đều thành công
+    bool startService(const string& serviceNames, string& report);
+    bool stopService(const string& serviceNames, string& report);
 };
 
@@ -0,0 +1,143 @@
+#include "CommandScheduler.h"
+
+CommandScheduler::CommandScheduler() : running(false) {
+    // Số worker cho từng nhóm lệnh
+    lanes[static_cast<size_t>(CommandClass::Introspection)].workerCount = 4;
+    lanes[static_cast<size_t>(CommandClass::Transfer)].workerCount = 2;
+    lanes[static_cast<size_t>(CommandClass::Device)].workerCount = 1;
+    lanes[static_cast<size_t>(CommandClass::Control)].workerCount = 2;
+    lanes[static_cast<size_t>(CommandClass::Power)].workerCount = 1;
+
+    for (size_t i = 0; i < LANE_COUNT; i++) {
+        Lane& lane = lanes[i];
+        lane.priorityWorkerCount = 1;
+        lane.stats = LaneStats{ 0, 0, 0, 0, 0, 0 };
+        // Phân bố thời gian chờ trong hàng đợi để xem p99 theo nhóm, không chỉ trung bình/max
+        lane.waitTime = &Metrics::registry().histogram("server_command_queue_wait_microseconds",
+            "Time a command waits in its class queue before a worker picks it up",
+            std::string("class=\"") + className(static_cast<CommandClass>(i)) + "\"");
+    }
+}
+
+CommandScheduler::~CommandScheduler() {
+    stop();
+}
+
+void CommandScheduler::start() {
+    if (running) return;
+    running = true;
+
+    for (Lane& lane : lanes) {
+        for (size_t i = 0; i < lane.workerCount; i++) {
+            lane.workers.emplace_back(&CommandScheduler::workerLoop, this, std::ref(lane), false);
+        }
+        for (size_t i = 0; i < lane.priorityWorkerCount; i++) {
+            lane.workers.emplace_back(&CommandScheduler::workerLoop, this, std::ref(lane), true);
+        }
+    }
+}
+
+void CommandScheduler::stop() {
+    if (!running.exchange(false)) return;
+
+    for (Lane& lane : lanes) {
+        // Khóa để worker đang chuẩn bị wait không bỏ lỡ thông báo
+        { std::lock_guard<std::mutex> lock(lane.mutex); }
+        lane.cv.notify_all();
+    }
+    for (Lane& lane : lanes) {
+        for (std::thread& worker : lane.workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        lane.workers.clear();
+
+        // Lệnh còn trong hàng đợi sẽ không chạy nữa; future của chúng nhận broken_promise
+        lane.highPriority.clear();
+        lane.normal.clear();
+        lane.stats.queued = 0;
+    }
+}
+
+std::future<void> CommandScheduler::submit(CommandClass commandClass, bool highPriority, std::function<void()> task) {
+    Lane& lane = lanes[static_cast<size_t>(commandClass)];
+
+    Task item{ std::packaged_task<void()>(std::move(task)), std::chrono::steady_clock::now() };
+    std::future<void> result = item.work.get_future();
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        // stop() đặt running = false trước khi khóa từng lane rồi xóa hàng đợi, nên lệnh đã vào hàng
+        // đợi ở đây cũng nhận broken_promise; sau đó thì từ chối luôn
+        if (!running) {
+            std::promise<void> rejected;
+            rejected.set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            return rejected.get_future();
+        }
+        if (highPriority) {
+            lane.highPriority.push_back(std::move(item));
+        }
+        else {
+            lane.normal.push_back(std::move(item));
+        }
+        lane.stats.queued++;
+        if (lane.stats.queued > lane.stats.maxQueued) {
+            lane.stats.maxQueued = lane.stats.queued;
+        }
+    }
+    // Worker thường và worker ưu tiên chờ trên cùng một cv: notify_one có thể đánh thức nhầm loại
+    lane.cv.notify_all();
+    return result;
+}
+
+void CommandScheduler::workerLoop(Lane& lane, bool priorityOnly) {
+    while (true) {
+        Task item;
+        {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            lane.cv.wait(lock, [this, &lane, priorityOnly]() {
+                return !running || !lane.highPriority.empty() || (!priorityOnly && !lane.normal.empty());
+                });
+            if (!running) return;
+
+            std::deque<Task>& queue = lane.highPriority.empty() ? lane.normal : lane.highPriority;
+            item = std::move(queue.front());
+            queue.pop_front();
+
+            long long waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - item.enqueuedAt).count();
+            long long waitMs = waitUs / 1000;
+            lane.waitTime->record(static_cast<uint64_t>(waitUs));
+            lane.stats.queued--;
+            lane.stats.running++;
+            lane.stats.totalWaitMs += waitMs;
+            if (waitMs > lane.stats.maxWaitMs) {
+                lane.stats.maxWaitMs = waitMs;
+            }
+        }
+
+        // Ngoại lệ của lệnh được chuyển về future của người gửi
+        item.work();
+
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.stats.running--;
+        lane.stats.completed++;
+    }
+}
+
+CommandScheduler::LaneStats CommandScheduler::getStats(CommandClass commandClass) {
+    Lane& lane = lanes[static_cast<size_t>(commandClass)];
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    return lane.stats;
+}
+
+const char* CommandScheduler::className(CommandClass commandClass) {
+    switch (commandClass) {
+    case CommandClass::Introspection: return "introspection";
+    case CommandClass::Transfer: return "transfer";
+    case CommandClass::Device: return "device";
+    case CommandClass::Control: return "control";
+    case CommandClass::Power: return "power";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include "CommandRegistry.h"
+#include "Metrics.h"
+
+// Thực thi lệnh trên các nhóm worker riêng theo CommandClass, để lệnh chậm
+// (service::start, camera::record...) không chặn lệnh của nhóm khác.
+class CommandScheduler {
+public:
+    struct LaneStats {
+        size_t queued;
+        size_t running;
+        size_t maxQueued;
+        long long completed;
+        long long totalWaitMs;
+        long long maxWaitMs;
+    };
+
+    CommandScheduler();
+    ~CommandScheduler();
+
+    void start();
+    void stop();
+
+    // Lệnh ưu tiên cao (ví dụ system::lock) có worker riêng trong nhóm: không phải chờ lệnh đang chạy
+    // (system::shutdown đang chờ, camera::record 300 giây...). Sau stop() thì future trả về
+    // future_error (broken_promise) ngay, không chờ mãi
+    std::future<void> submit(CommandClass commandClass, bool highPriority, std::function<void()> task);
+
+    LaneStats getStats(CommandClass commandClass);
+    static const char* className(CommandClass commandClass);
+
+private:
+    struct Task {
+        std::packaged_task<void()> work;
+        std::chrono::steady_clock::time_point enqueuedAt;
+    };
+
+    struct Lane {
+        size_t workerCount;         // Worker thường, lấy lệnh ưu tiên trước rồi tới lệnh thường
+        size_t priorityWorkerCount; // Worker chỉ chạy lệnh ưu tiên cao
+        std::deque<Task> highPriority;
+        std::deque<Task> normal;
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable cv;
+        LaneStats stats;
+        Metrics::Histogram* waitTime;
+    };
+
+    void workerLoop(Lane& lane, bool priorityOnly);
+
+    static const size_t LANE_COUNT = static_cast<size_t>(CommandClass::Count);
+    Lane lanes[LANE_COUNT];
+    std::atomic<bool> running;
+};
@@ -0,0 +1,620 @@
+#include "FileTransfer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#endif
+
+namespace fs = std::filesystem;
+
+namespace FileTransfer {
+
+static constexpr size_t STAGING_SIZE = 64 * 1024;
+static constexpr size_t TAR_BLOCK = 512;
+
+static std::string toUtf8(const fs::path& path) {
+    auto text = path.generic_u8string();
+    return std::string(text.begin(), text.end());
+}
+
+static bool sameChar(char a, char b) {
+#ifdef _WIN32
+    if (a >= 'A' && a <= 'Z') a = static_cast<char>(a - 'A' + 'a');
+    if (b >= 'A' && b <= 'Z') b = static_cast<char>(b - 'A' + 'a');
+#endif
+    return a == b;
+}
+
+bool hasWildcard(std::string_view text) {
+    return text.find_first_of("*?") != std::string_view::npos;
+}
+
+bool matchGlob(std::string_view pattern, std::string_view name) {
+    size_t p = 0, n = 0;
+    size_t star = std::string_view::npos, mark = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && pattern[p] == '?') {
+            // ? khớp một ký tự UTF-8, không phải một byte
+            n++;
+            while (n < name.size() && (static_cast<uint8_t>(name[n]) & 0xC0) == 0x80) n++;
+            p++;
+        }
+        else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = n;
+        }
+        else if (p < pattern.size() && sameChar(pattern[p], name[n])) {
+            p++;
+            n++;
+        }
+        else if (star != std::string_view::npos) {
+            p = star + 1;
+            n = ++mark;
+        }
+        else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+static std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) return {};
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+ListOptions parseListArgs(std::string_view args) {
+    ListOptions options;
+    args = trim(args);
+
+    std::string_view rest;
+    if (!args.empty() && args[0] == '"') {
+        size_t close = args.find('"', 1);
+        if (close == std::string_view::npos) {
+            options.directory = std::string(args.substr(1));
+            return options;
+        }
+        options.directory = std::string(args.substr(1, close - 1));
+        rest = args.substr(close + 1);
+    }
+    else {
+        rest = args;
+    }
+
+    // Đọc từ cuối: cờ, rồi tối đa một pattern; phần còn lại là thư mục (nếu chưa có trong ngoặc kép)
+    bool patternSeen = false;
+    while (true) {
+        rest = trim(rest);
+        size_t space = rest.find_last_of(" \t");
+        if (space == std::string_view::npos && options.directory.empty()) break;
+
+        std::string_view word = space == std::string_view::npos ? rest : rest.substr(space + 1);
+        if (word.empty()) break;
+        if (word == "recursive" || word == "-r") {
+            options.recursive = true;
+        }
+        else if (word == "hash") {
+            options.hash = true;
+        }
+        else if (!patternSeen && (hasWildcard(word) || !options.directory.empty())) {
+            options.pattern = std::string(word);
+            patternSeen = true;
+        }
+        else {
+            break;
+        }
+        rest = space == std::string_view::npos ? std::string_view() : rest.substr(0, space);
+    }
+
+    if (options.directory.empty()) {
+        options.directory = std::string(trim(rest));
+    }
+    return options;
+}
+
+// file_time_type chưa đổi thẳng sang system_clock được trong C++17; lấy mốc "bây giờ" một lần cho cả lượt
+struct TimeConverter {
+    fs::file_time_type fileNow = fs::file_time_type::clock::now();
+    std::chrono::system_clock::time_point systemNow = std::chrono::system_clock::now();
+
+    long long toUnixSeconds(fs::file_time_type time) const {
+        auto offset = std::chrono::duration_cast<std::chrono::system_clock::duration>(time - fileNow);
+        return std::chrono::duration_cast<std::chrono::seconds>((systemNow + offset).time_since_epoch()).count();
+    }
+};
+
+static bool hashFile(const fs::path& path, std::string& hex) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    BCRYPT_ALG_HANDLE algorithm = NULL;
+    BCRYPT_HASH_HANDLE hash = NULL;
+    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&algorithm, BCRYPT_SHA256_ALGORITHM, NULL, 0))) {
+        return false;
+    }
+
+    UCHAR digest[32];
+    bool ok = BCRYPT_SUCCESS(BCryptCreateHash(algorithm, &hash, NULL, 0, NULL, 0, 0));
+    std::vector<char> buffer(STAGING_SIZE);
+    while (ok && file) {
+        file.read(buffer.data(), buffer.size());
+        if (file.gcount() > 0) {
+            ok = BCRYPT_SUCCESS(BCryptHashData(hash, (PUCHAR)buffer.data(), (ULONG)file.gcount(), 0));
+        }
+    }
+    ok = ok && file.eof() && BCRYPT_SUCCESS(BCryptFinishHash(hash, digest, sizeof(digest), 0));
+    if (hash) BCryptDestroyHash(hash);
+    BCryptCloseAlgorithmProvider(algorithm, 0);
+    if (!ok) return false;
+
+    static const char HEX[] = "0123456789abcdef";
+    hex.clear();
+    for (UCHAR byte : digest) {
+        hex += HEX[byte >> 4];
+        hex += HEX[byte & 0x0F];
+    }
+    return true;
+#else
+    (void)path;
+    (void)hex;
+    return false;
+#endif
+}
+
+// Tên trong listing: TAB, xuống dòng và \ được escape để mỗi entry luôn nằm trên một dòng
+static void appendEscaped(std::string& out, const std::string& name) {
+    for (char c : name) {
+        switch (c) {
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\\': out += "\\\\"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+bool listDirectory(const ListOptions& options, std::string& listing, std::string& error) {
+    fs::path base = options.directory.empty() ? fs::path(".") : fs::u8path(options.directory);
+    std::error_code ec;
+    if (!fs::is_directory(base, ec)) {
+        error = "Directory not found: " + options.directory;
+        return false;
+    }
+
+    TimeConverter times;
+    size_t entries = 0;
+    bool truncated = false;
+
+    listing = "# type\tsize\tmtime\tname";
+    listing += options.hash ? "\tsha256\n" : "\n";
+
+    auto addEntry = [&](const fs::directory_entry& entry) {
+        std::string name = toUtf8(entry.path().filename());
+        if (!matchGlob(options.pattern, name)) return;
+        if (entries >= MAX_LIST_ENTRIES) {
+            truncated = true;
+            return;
+        }
+
+        std::error_code entryError;
+        bool directory = entry.is_directory(entryError);
+        fs::file_time_type modified = entry.last_write_time(entryError);
+        long long mtime = entryError ? 0 : times.toUnixSeconds(modified);
+
+        listing += directory ? "d\t-\t" : "f\t";
+        if (!directory) {
+            uintmax_t size = entry.file_size(entryError);
+            listing += entryError ? "-" : std::to_string(size);
+            listing += '\t';
+        }
+        listing += std::to_string(mtime);
+        listing += '\t';
+        appendEscaped(listing, options.recursive ? toUtf8(entry.path().lexically_relative(base)) : name);
+        if (directory) listing += '/';
+
+        if (options.hash) {
+            std::string hex;
+            listing += '\t';
+            listing += (!directory && hashFile(entry.path(), hex)) ? hex : "-";
+        }
+        listing += '\n';
+        entries++;
+    };
+
+    if (options.recursive) {
+        fs::recursive_directory_iterator it(base, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::recursive_directory_iterator() && !truncated; it.increment(ec)) {
+            addEntry(*it);
+        }
+    }
+    else {
+        fs::directory_iterator it(base, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::directory_iterator() && !truncated; it.increment(ec)) {
+            addEntry(*it);
+        }
+    }
+
+    // Lỗi giữa chừng thì báo lỗi cả lệnh, không gửi listing thiếu như thể đã đủ
+    if (ec) {
+        error = "Unable to read directory: " + options.directory + " (" + ec.message() + ", after " +
+            std::to_string(entries) + " entries)";
+        return false;
+    }
+    if (truncated) {
+        listing += "# truncated after " + std::to_string(MAX_LIST_ENTRIES) + " entries\n";
+    }
+    return true;
+}
+
+// Gom dữ liệu nhỏ (khung, header tar, file nhỏ) rồi mới gửi, để 10.000 file nhỏ không thành 20.000 lần send
+class StagingBuffer {
+public:
+    explicit StagingBuffer(const Sink& sink) : sink(sink), buffer(STAGING_SIZE), used(0), failed(false) {}
+
+    bool append(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0 && !failed) {
+            size_t chunk = std::min(size, buffer.size() - used);
+            memcpy(buffer.data() + used, bytes, chunk);
+            used += chunk;
+            bytes += chunk;
+            size -= chunk;
+            if (used == buffer.size()) flush();
+        }
+        return !failed;
+    }
+
+    bool zeros(size_t size) {
+        while (size > 0 && !failed) {
+            size_t chunk = std::min(size, buffer.size() - used);
+            memset(buffer.data() + used, 0, chunk);
+            used += chunk;
+            size -= chunk;
+            if (used == buffer.size()) flush();
+        }
+        return !failed;
+    }
+
+    // Đọc tối đa size byte từ file thẳng vào bộ đệm; trả số byte đọc được
+    size_t readFrom(std::ifstream& file, size_t size) {
+        size_t total = 0;
+        while (total < size && !failed && file) {
+            size_t chunk = std::min(size - total, buffer.size() - used);
+            file.read(buffer.data() + used, chunk);
+            size_t got = static_cast<size_t>(file.gcount());
+            used += got;
+            total += got;
+            if (used == buffer.size()) flush();
+        }
+        return total;
+    }
+
+    bool flush() {
+        if (used > 0 && !failed) {
+            failed = !sink(buffer.data(), used);
+        }
+        used = 0;
+        return !failed;
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    const Sink& sink;
+    std::vector<char> buffer;
+    size_t used;
+    bool failed;
+};
+
+static void appendSize(StagingBuffer& out, int64_t size) {
+    out.append(&size, sizeof(size));
+}
+
+static void appendStatus(StagingBuffer& out, const std::string& message) {
+    int32_t length = static_cast<int32_t>(message.size());
+    out.append(&length, sizeof(length));
+    out.append(message.data(), message.size());
+}
+
+static bool sendError(const Sink& sink, const std::string& message) {
+    StagingBuffer out(sink);
+    appendSize(out, -1);
+    appendStatus(out, message);
+    return out.flush();
+}
+
+bool sendListing(const Sink& sink, const ListOptions& options, std::string& summary) {
+    std::string listing, error;
+    if (!listDirectory(options, listing, error)) {
+        summary = error;
+        sendError(sink, error);
+        return false;
+    }
+
+    size_t entries = 0;
+    for (size_t line = 0; line < listing.size(); line = listing.find('\n', line) + 1) {
+        if (listing[line] != '#') entries++;
+    }
+    summary = "Listed " + options.directory + " (" + std::to_string(entries) + " entries)";
+    return sendBuffer(sink, listing.data(), listing.size(), summary);
+}
+
+bool sendBuffer(const Sink& sink, const char* data, size_t size, const std::string& status) {
+    StagingBuffer out(sink);
+    appendSize(out, static_cast<int64_t>(size));
+    out.append(data, size);
+    appendStatus(out, status);
+    return out.flush();
+}
+
+struct ArchiveEntry {
+    fs::path source;
+    std::string name;   // Tương đối, dùng dấu /
+    uint64_t size;
+    long long mtime;
+};
+
+static bool operator<(const ArchiveEntry& a, const ArchiveEntry& b) {
+    return a.name < b.name;
+}
+
+static uint64_t paddedSize(uint64_t size) {
+    return (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+}
+
+// Tên ustar: name tối đa 100 byte, hoặc tách ở một dấu / thành prefix (155) + name (100).
+// Dài hơn nữa thì thêm một entry GNU ././@LongLink (tar của Windows, GNU tar, 7-Zip đều đọc được)
+static bool splitUstarName(const std::string& name, size_t& split) {
+    if (name.size() <= 100) {
+        split = 0;
+        return true;
+    }
+    for (size_t slash = name.find('/'); slash != std::string::npos; slash = name.find('/', slash + 1)) {
+        if (slash > 155) break;
+        if (name.size() - slash - 1 <= 100 && slash + 1 < name.size()) {
+            split = slash;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t headerSize(const std::string& name) {
+    size_t split;
+    if (splitUstarName(name, split)) return TAR_BLOCK;
+    return TAR_BLOCK + paddedSize(name.size() + 1) + TAR_BLOCK;
+}
+
+static void writeOctal(char* field, size_t width, uint64_t value) {
+    // Số không vừa (file từ 8 GiB): dạng nhị phân base-256 của GNU
+    if (width <= 12 && value >= (1ULL << (3 * (width - 1)))) {
+        memset(field, 0, width);
+        field[0] = static_cast<char>(0x80);
+        for (size_t i = width - 1; i > 0 && value > 0; i--) {
+            field[i] = static_cast<char>(value & 0xFF);
+            value >>= 8;
+        }
+        return;
+    }
+    field[width - 1] = '\0';
+    for (size_t i = width - 1; i > 0; i--) {
+        field[i - 1] = static_cast<char>('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+static void appendHeaderBlock(StagingBuffer& out, const char* name, size_t nameSize, const char* prefix,
+    size_t prefixSize, uint64_t size, long long mtime, char type) {
+    char header[TAR_BLOCK] = {};
+    memcpy(header, name, std::min<size_t>(nameSize, 100));
+    writeOctal(header + 100, 8, type == 'L' ? 0 : 0644);   // mode
+    writeOctal(header + 108, 8, 0);                          // uid
+    writeOctal(header + 116, 8, 0);                          // gid
+    writeOctal(header + 124, 12, size);
+    writeOctal(header + 136, 12, static_cast<uint64_t>(std::max(0LL, mtime)));
+    header[156] = type;
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    memcpy(header + 345, prefix, std::min<size_t>(prefixSize, 155));
+
+    // Checksum tính với chính trường checksum là 8 dấu cách
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; i++) checksum += static_cast<uint8_t>(header[i]);
+    writeOctal(header + 148, 7, checksum);
+    header[155] = ' ';
+
+    out.append(header, sizeof(header));
+}
+
+static void appendHeader(StagingBuffer& out, const ArchiveEntry& entry) {
+    size_t split;
+    if (!splitUstarName(entry.name, split)) {
+        static const char LONG_LINK[] = "././@LongLink";
+        appendHeaderBlock(out, LONG_LINK, sizeof(LONG_LINK) - 1, "", 0, entry.name.size() + 1, 0, 'L');
+        out.append(entry.name.c_str(), entry.name.size() + 1);
+        out.zeros(paddedSize(entry.name.size() + 1) - (entry.name.size() + 1));
+        appendHeaderBlock(out, entry.name.data(), entry.name.size(), "", 0, entry.size, entry.mtime, '0');
+    }
+    else if (split == 0) {
+        appendHeaderBlock(out, entry.name.data(), entry.name.size(), "", 0, entry.size, entry.mtime, '0');
+    }
+    else {
+        appendHeaderBlock(out, entry.name.data() + split + 1, entry.name.size() - split - 1,
+            entry.name.data(), split, entry.size, entry.mtime, '0');
+    }
+}
+
+// Kích thước file đã báo trong header là cố định: file ngắn đi khi đang gửi thì bù số 0, dài ra thì cắt
+static bool appendContent(StagingBuffer& out, const ArchiveEntry& entry, bool& complete) {
+    uint64_t copied = 0;
+    std::ifstream file(entry.source, std::ios::binary);
+    if (file.is_open()) {
+        copied = out.readFrom(file, static_cast<size_t>(entry.size));
+    }
+    complete = copied == entry.size;
+    out.zeros(static_cast<size_t>(entry.size - copied));
+    return out.ok();
+}
+
+static bool collectEntries(const fs::path& base, const std::string& pattern, bool recursive,
+    std::vector<ArchiveEntry>& entries, std::string& error) {
+    TimeConverter times;
+    std::error_code ec;
+
+    auto addEntry = [&](const fs::directory_entry& entry) {
+        std::error_code entryError;
+        if (!entry.is_regular_file(entryError)) return true;
+        if (!matchGlob(pattern, toUtf8(entry.path().filename()))) return true;
+        if (entries.size() >= MAX_ARCHIVE_FILES) {
+            error = "More than " + std::to_string(MAX_ARCHIVE_FILES) + " files match, narrow the pattern";
+            return false;
+        }
+
+        uintmax_t size = entry.file_size(entryError);
+        if (entryError) return true;
+        fs::file_time_type modified = entry.last_write_time(entryError);
+        entries.push_back({ entry.path(), toUtf8(entry.path().lexically_relative(base)),
+            static_cast<uint64_t>(size), entryError ? 0 : times.toUnixSeconds(modified) });
+        return true;
+    };
+
+    if (recursive) {
+        fs::recursive_directory_iterator it(base, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (!addEntry(*it)) return false;
+        }
+    }
+    else {
+        fs::directory_iterator it(base, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            if (!addEntry(*it)) return false;
+        }
+    }
+
+    if (ec) {
+        error = "Unable to read directory: " + toUtf8(base) + " (" + ec.message() + ", after " +
+            std::to_string(entries.size()) + " files)";
+        return false;
+    }
+    std::sort(entries.begin(), entries.end());
+    return true;
+}
+
+static bool sendArchive(const Sink& sink, const std::string& path, const fs::path& base,
+    const std::string& pattern, bool recursive, std::string& summary) {
+    std::vector<ArchiveEntry> entries;
+    std::string error;
+    if (!collectEntries(base, pattern, recursive, entries, error)) {
+        summary = error;
+        sendError(sink, error);
+        return false;
+    }
+    if (entries.empty()) {
+        summary = "No files match " + path;
+        sendError(sink, summary);
+        return false;
+    }
+
+    // Biết trước kích thước cả archive nên vẫn dùng được khung int64 như một file thường
+    uint64_t total = 2 * TAR_BLOCK;
+    for (const ArchiveEntry& entry : entries) {
+        total += headerSize(entry.name) + paddedSize(entry.size);
+    }
+
+    StagingBuffer out(sink);
+    appendSize(out, static_cast<int64_t>(total));
+
+    std::vector<std::string> changed;
+    for (const ArchiveEntry& entry : entries) {
+        appendHeader(out, entry);
+        bool complete = true;
+        if (!appendContent(out, entry, complete)) break;
+        out.zeros(static_cast<size_t>(paddedSize(entry.size) - entry.size));
+        if (!complete) changed.push_back(entry.name);
+    }
+    out.zeros(2 * TAR_BLOCK);
+
+    summary = "Sent " + std::to_string(entries.size()) + " files from " + path + " (" +
+        std::to_string(total) + " bytes)";
+    std::string status = summary;
+    if (!changed.empty()) {
+        status += "; " + std::to_string(changed.size()) + " unreadable or changed while sending (zero-filled):";
+        for (size_t i = 0; i < changed.size() && i < 20; i++) {
+            status += " " + changed[i];
+        }
+        summary = status;
+    }
+    appendStatus(out, status);
+    return out.flush();
+}
+
+bool sendPath(const Sink& sink, const std::string& path, std::string& summary) {
+    fs::path target = fs::u8path(path);
+    std::string fileName = toUtf8(target.filename());
+    std::error_code ec;
+
+    if (hasWildcard(fileName)) {
+        fs::path base = target.parent_path();
+        bool recursive = false;
+        if (fileName == "**") {
+            fileName = "*";
+            recursive = true;
+        }
+        else if (base.filename() == "**") {
+            base = base.parent_path();
+            recursive = true;
+        }
+        if (hasWildcard(toUtf8(base))) {
+            summary = "Wildcards are only supported in the file name: " + path;
+            sendError(sink, summary);
+            return false;
+        }
+        return sendArchive(sink, path, base.empty() ? fs::path(".") : base, fileName, recursive, summary);
+    }
+
+    if (fs::is_directory(target, ec)) {
+        summary = "Is a directory: " + path;
+        sendError(sink, "Is a directory. Use " + path + "\\* or " + path + "\\**\\* to get its files as a .tar");
+        return false;
+    }
+
+    if (!fs::is_regular_file(target, ec)) {
+        summary = "File not found: " + path;
+        sendError(sink, "File not found.");
+        return false;
+    }
+
+    uintmax_t size = fs::file_size(target, ec);
+    std::ifstream file(target, std::ios::binary);
+    if (ec || !file.is_open()) {
+        summary = "Unable to open file: " + path;
+        sendError(sink, "Unable to open file.");
+        return false;
+    }
+
+    StagingBuffer out(sink);
+    appendSize(out, static_cast<int64_t>(size));
+    size_t copied = out.readFrom(file, static_cast<size_t>(size));
+    out.zeros(static_cast<size_t>(size - copied));
+    summary = "Sent file: " + path;
+    appendStatus(out, copied == size ? "File sent successfully." : "File changed while sending (zero-filled).");
+    return out.flush();
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// file::list và file::get.
+//
+// Kết quả gửi về client theo cùng một khung: int64 kích thước, đúng chừng đó byte dữ liệu, rồi một
+// message trạng thái (int32 độ dài + nội dung) như SendMessages. Không gửi được gì (không tìm thấy,
+// pattern sai...) thì kích thước là -1 và chỉ có message lỗi theo sau. Kết quả dạng văn bản (list::*,
+// help::cmd) cũng đi theo khung này để client đọc đúng kích thước thay vì đoán theo lần recv ngắn.
+//
+// file::get <path>: một file gửi nguyên nội dung. Phần tên file có * hoặc ? (vd C:\logs\*.txt) thì mọi
+// file khớp được gửi thành một file tar (ustar) dựng ngay khi gửi, không tạo file tạm: header và nội
+// dung các file nhỏ được gom vào một bộ đệm rồi mới gửi. Thư mục cha là ** (vd C:\logs\**\*.txt)
+// thì tìm cả trong thư mục con.
+//
+// file::list <dir> [pattern] [recursive] [hash]: mỗi dòng "loại<TAB>kích thước<TAB>mtime<TAB>tên[<TAB>sha256]",
+// loại là f (file) hoặc d (thư mục, kích thước "-"), mtime là giây Unix, tên tương đối so với dir và
+// dùng dấu /. sha256 chỉ tính khi có "hash" (phải đọc toàn bộ file).
+namespace FileTransfer {
+
+// Gửi đủ size byte; false khi kết nối lỗi
+using Sink = std::function<bool(const char* data, size_t size)>;
+
+struct ListOptions {
+    std::string directory;
+    std::string pattern = "*";
+    bool recursive = false;
+    bool hash = false;
+};
+
+static constexpr size_t MAX_LIST_ENTRIES = 100000;
+static constexpr size_t MAX_ARCHIVE_FILES = 100000;
+
+bool hasWildcard(std::string_view text);
+// * và ? như FindFirstFile; trên Windows không phân biệt hoa thường
+bool matchGlob(std::string_view pattern, std::string_view name);
+
+// Tách "<dir> [pattern] [recursive] [hash]" từ cuối, nên dir được phép chứa khoảng trắng
+ListOptions parseListArgs(std::string_view args);
+
+// Trả false và error khi thư mục không đọc được
+bool listDirectory(const ListOptions& options, std::string& listing, std::string& error);
+
+// Gửi listing đã dựng xong theo khung ở trên
+bool sendListing(const Sink& sink, const ListOptions& options, std::string& summary);
+// file::get; summary để ghi log phía server
+bool sendPath(const Sink& sink, const std::string& path, std::string& summary);
+// Kết quả đã có sẵn trong bộ nhớ, theo khung ở trên
+bool sendBuffer(const Sink& sink, const char* data, size_t size, const std::string& status);
+
+}
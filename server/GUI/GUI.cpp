@@ -1,4 +1,7 @@
 ﻿#include "GUI.h"
+#include "ScreenStreamer.h"
+#include "SecureSocket.h"
+#include "AppData.h"
 #include <wx/wx.h>
 #include <wx/stattext.h>
 #include <sstream>
@@ -6,19 +9,28 @@
 #include <ctime>
 #include <iomanip>
 
-wxDEFINE_EVENT(wxEVT_SERVER_LOG, wxCommandEvent);
+static std::string getListenPort() {
+    const char* portOverride = getenv(SERVER_PORT_ENV);
+    return (portOverride && *portOverride) ? portOverride : DEFAULT_PORT;
+}
+
+// %APPDATA%\EmailPCControl\<subdir>\<cổng>\server.jsonl (logs, metrics): mỗi server trên máy một file
+static std::string getServerJsonlPath(const std::string& subdir, const std::string& port) {
+    return AppData::path(subdir + "\\" + port + "\\server.jsonl");
+}
 
 BEGIN_EVENT_TABLE(ServerFrame, wxFrame)
 EVT_BUTTON(1001, ServerFrame::OnStart)
 EVT_BUTTON(1002, ServerFrame::OnStop)
 EVT_CLOSE(ServerFrame::OnClose)
-EVT_COMMAND(wxID_ANY, wxEVT_SERVER_LOG, ServerFrame::OnLogEvent)
 EVT_LIST_ITEM_ACTIVATED(wxID_ANY, ServerFrame::OnLogItemDblClick)
 EVT_BUTTON(1003, ServerFrame::OnClearHistory)
 END_EVENT_TABLE()
 
 ServerFrame::ServerFrame(const wxString& title)
-    : wxFrame(nullptr, wxID_ANY, title, wxDefaultPosition, wxSize(1024, 750))
+    : wxFrame(nullptr, wxID_ANY, title, wxDefaultPosition, wxSize(1024, 750)),
+    listenPort(getListenPort()),
+    historyStore("history\\" + listenPort)
 {
     // Create main panel with modern dark theme
     wxPanel* panel = new wxPanel(this);
@@ -177,10 +189,59 @@ ServerFrame::ServerFrame(const wxString& title)
     server = nullptr;
     serverThread = nullptr;
     isRunning = false;
+    activeClients = 0;
+    nextEntryId = 0;
+
+    reportedDrops = 0;
+
+    // Log được đẩy vào hàng đợi từ mọi thread, timer gom lại và hiển thị theo lô
+    std::string logPath = getServerJsonlPath("logs", listenPort);
+    if (!logPath.empty()) {
+        logger.setFileSink(std::make_unique<JsonlFileSink>(logPath));
+    }
+    logTimer.SetOwner(this);
+    Bind(wxEVT_TIMER, &ServerFrame::OnLogTimer, this, logTimer.GetId());
+    logTimer.Start(LOG_REFRESH_MS);
+
+    StartMetrics();
 
     Centre();
 }
 
+// Số liệu: http://127.0.0.1:9101/metrics và %APPDATA%\EmailPCControl\metrics\<cổng>\server.jsonl.
+// Server nghe cổng khác 27015 dùng cổng số liệu lệch tương ứng (27016 -> 9102)
+void ServerFrame::StartMetrics() {
+    Metrics::Registry& metrics = Metrics::registry();
+
+    // Độ dài hàng đợi đọc từ scheduler lúc xuất, không tốn gì trên đường chạy lệnh
+    for (int i = 0; i < static_cast<int>(CommandClass::Count); i++) {
+        CommandClass commandClass = static_cast<CommandClass>(i);
+        std::string labels = "lane=\"" + std::string(CommandScheduler::className(commandClass)) + "\"";
+        metrics.gaugeCallback("scheduler_queue_depth", "Commands waiting in a scheduler lane", labels,
+            [this, commandClass]() { return static_cast<double>(scheduler.getStats(commandClass).queued); });
+        metrics.gaugeCallback("scheduler_queue_wait_max_milliseconds", "Longest queue wait seen in a scheduler lane",
+            labels, [this, commandClass]() { return static_cast<double>(scheduler.getStats(commandClass).maxWaitMs); });
+    }
+
+    double overheadNs = Metrics::measureCounterOverheadNs();
+    metrics.gauge("metrics_counter_overhead_nanoseconds",
+        "Measured cost of one counter increment at startup").set(static_cast<int64_t>(overheadNs + 0.5));
+
+    int metricsPort = METRICS_PORT + (atoi(listenPort.c_str()) - atoi(DEFAULT_PORT));
+    if (metricsPort <= 0 || metricsPort > 65535) {
+        LogMessage(LogSeverity::Warning, wxString::Format("No metrics port for listen port %s", listenPort.c_str()));
+        return;
+    }
+
+    if (metricsExporter.start(metricsPort, getServerJsonlPath("metrics", listenPort), METRICS_DUMP_INTERVAL_SEC)) {
+        LogMessage(LogSeverity::Info, wxString::Format(
+            "Metrics on http://127.0.0.1:%d/metrics (counter overhead %.1f ns/event)", metricsPort, overheadNs));
+    }
+    else {
+        LogMessage(LogSeverity::Warning, wxString::Format("Failed to start metrics endpoint on port %d", metricsPort));
+    }
+}
+
 void ServerFrame::OnButtonHover(wxMouseEvent& event)
 {
     wxButton* button = static_cast<wxButton*>(event.GetEventObject());
@@ -196,6 +257,13 @@ void ServerFrame::OnButtonLeave(wxMouseEvent& event)
 }
 ServerFrame::~ServerFrame() {
     StopServer();
+    // Callback độ dài hàng đợi trỏ vào scheduler: dừng exporter trước khi frame bị hủy
+    metricsExporter.stop();
+
+    // Ghi nốt log còn trong hàng đợi ra file
+    logTimer.Stop();
+    while (logger.drain(logBatch, LOG_BATCH_LIMIT) > 0) {
+    }
 }
 
 void ServerFrame::OnStart(wxCommandEvent& event) {
@@ -224,19 +292,34 @@ void ServerFrame::OnLogItemDblClick(wxListEvent& event) {
         // Get the command text
         wxString commandText = logList->GetItemText(index, 1);
 
-        if (entry.isVideo && !entry.imageData.empty()) {
-            // Show video dialog
-            VideoDialog dialog(this, "Video - " + commandText, entry.imageData);
+        if (entry.blob.kind == BlobKind::Image) {
+            // Ảnh đã thu nhỏ được giữ trong LRU cache, mở lại không phải giải mã PNG.
+            // Nếu chưa có, dialog giải mã ngay trên vùng mmap ở thread nền.
+            wxImage preview;
+            std::shared_ptr<MappedBlob> blob;
+            if (!thumbnailCache.get(entry.blob.hash, preview)) {
+                blob = historyStore.open(entry.blob);
+            }
+
+            std::string hash = entry.blob.hash;
+            ImageDialog dialog(this, "Image - " + commandText, blob, preview,
+                [this, hash](const wxImage& image) {
+                    thumbnailCache.put(hash, image);
+                });
             dialog.ShowModal();
         }
-        else if (entry.isImage && !entry.imageData.empty()) {
-            // Show image dialog
-            ImageDialog dialog(this, "Image - " + commandText, entry.imageData);
+        else if (entry.blob.kind == BlobKind::Video) {
+            // OpenCV đọc thẳng object .avi, không chép cả video ra file tạm
+            VideoDialog dialog(this, "Video - " + commandText, historyStore.pathFor(entry.blob));
             dialog.ShowModal();
         }
-        else if (!entry.content.IsEmpty()) {
+        else if (entry.blob.kind == BlobKind::Text) {
             // Show content dialog for text content
-            ContentDialog dialog(this, "Command Details - " + commandText, entry.content);
+            std::shared_ptr<MappedBlob> blob = historyStore.open(entry.blob);
+            wxString content = blob && blob->length() > 0
+                ? wxString::FromUTF8(reinterpret_cast<const char*>(blob->data()), blob->length())
+                : wxString("No content available for this command.");
+            ContentDialog dialog(this, "Command Details - " + commandText, content);
             dialog.ShowModal();
         }
         else {
@@ -248,21 +331,36 @@ void ServerFrame::OnLogItemDblClick(wxListEvent& event) {
 }
 
 void ServerFrame::StartServer() {
-    server = new SocketServer(DEFAULT_PORT);
+    server = new SocketServer(listenPort.c_str());
 
     if (!server->initialize()) {
-        LogMessage("Failed to initialize Winsock", "", false);
+        LogMessage(LogSeverity::Error, "Failed to initialize Winsock");
         return;
     }
 
     if (!server->createListener()) {
-        LogMessage("Failed to create listening socket", "", false);
+        LogMessage(LogSeverity::Error, "Failed to create listening socket");
         delete server;
         server = nullptr;
         return;
     }
 
+    // Khóa công khai của server, để ghim trong server_keys.txt của client
+    std::string transportKey = SecureSocket::serverPublicKey();
+    if (transportKey.empty()) {
+        LogMessage(LogSeverity::Warning, "Transport key unavailable: only unencrypted clients can connect");
+    }
+    else {
+        LogMessage(LogSeverity::Info, "Transport key: " + transportKey);
+    }
+
     isRunning = true;
+    scheduler.start();
+    // Process mở/thoát ngoài app::/service:: (người dùng tự mở, process tự kết thúc) cũng làm list cũ đi
+    processWatcher.start([this]() {
+        resultCache.invalidate(CommandId::ListProcess);
+        resultCache.invalidate(CommandId::ListApp);
+        });
     statusText->SetLabel("ON");
     statusText->SetForegroundColour(*wxGREEN);
     startButton->Disable();
@@ -279,9 +377,15 @@ void ServerFrame::StopServer() {
         isRunning = false;
 
         if (server) {
-            server->closeClientConnection();
-            delete server;
-            server = nullptr;
+            // Đóng socket nghe để accept() thoát, đóng các client để recv() thoát
+            server->closeListener();
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex);
+                for (SOCKET clientSocket : clientSockets) {
+                    server->closeClientConnection(clientSocket);
+                }
+                clientSockets.clear();
+            }
         }
 
         if (serverThread) {
@@ -290,6 +394,25 @@ void ServerFrame::StopServer() {
             serverThread = nullptr;
         }
 
+        // Chờ các thread client xong lệnh đang chạy trước khi hủy server
+        {
+            std::unique_lock<std::mutex> lock(clientsMutex);
+            clientsCv.wait(lock, [this]() { return activeClients == 0; });
+        }
+        scheduler.stop();
+        processWatcher.stop();
+
+        ResultCache::Stats cacheStats = resultCache.getStats();
+        if (cacheStats.hits + cacheStats.misses > 0) {
+            LogMessage(LogSeverity::Info, wxString::Format("Result cache: %lld hits, %lld misses, %.0f%% hit rate",
+                cacheStats.hits, cacheStats.misses, cacheStats.hitRate() * 100));
+        }
+
+        if (server) {
+            delete server;
+            server = nullptr;
+        }
+
         statusText->SetLabel("OFF");
         statusText->SetForegroundColour(*wxRED);
         startButton->Enable();
@@ -302,252 +425,405 @@ void ServerFrame::StopServer() {
 
 void ServerFrame::ServerLoop() {
     while (isRunning) {
-        if (!server->acceptConnection()) {
+        SOCKET clientSocket = server->acceptConnection();
+        if (clientSocket == INVALID_SOCKET) {
+            if (isRunning) {
+                Sleep(100);  // Tránh vòng lặp bận khi accept lỗi liên tục
+            }
             continue;
         }
 
-        LogMessage("New client connected", "", false);
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (!isRunning) {
+                server->closeClientConnection(clientSocket);
+                break;
+            }
+            clientSockets.insert(clientSocket);
+            activeClients++;
+        }
 
-        while (isRunning) {
-            string command = server->receiveMessage();
+        LogMessage(LogSeverity::Info, "New client connected");
+        std::thread(&ServerFrame::HandleClient, this, clientSocket).detach();
+    }
+}
 
-            if (!isRunning) break;
+void ServerFrame::HandleClient(SOCKET clientSocket) {
+    long lastEntryId = 0;
 
-            if (command.empty()) {
-                LogMessage("Client disconnected", "", false);
-                break;
-            }
+    // Bắt tay trên thread của client để một client chậm không chặn accept
+    std::string transport;
+    bool accepted = SecureSocket::acceptServer(clientSocket, transport);
+    LogMessage(accepted ? LogSeverity::Info : LogSeverity::Warning,
+        (accepted ? "Client transport: " : "Client refused: ") + transport);
 
-            if (command.substr(0, 10) == "save_path:") {
-                string path = command.substr(10);
-                // Tìm và c?p nh?t LogEntry cu?i cùng v?i ???ng d?n file
-                if (!logEntries.empty()) {
-                    logEntries.back().savedPath = wxString::FromUTF8(path);
-                }
-                continue;
-            }
+    while (accepted && isRunning) {
+        string command = server->receiveMessage(clientSocket);
 
-            string response;
-            vector<BYTE> imageData;
+        if (!isRunning) break;
 
-            // Log command t? client
-            LogMessage(command, "", true);
+        if (command.empty()) {
+            LogMessage(LogSeverity::Info, "Client disconnected");
+            break;
+        }
 
-            if (command == "list::app") {
-                response = cmd.Applist();
-                server->sendMessage(response);
-                LogMessage("Sent application list", response, false);
+        ParsedCommand parsed = parseCommand(command);
 
-                if (!logEntries.empty()) {
-                    logEntries.back().content = response;
-                }
-            }
-            else if (command == "list::service") {
-                response = cmd.Listservice();
-                server->sendMessage(response);
-                LogMessage("Sent service list", response, false);
+        // Heartbeat từ connection pool của client: trả lời ngay, không ghi log
+        if (parsed.valid() && parsed.spec->id == CommandId::PingHeartbeat) {
+            server->sendMessage(clientSocket, "pong");
+            continue;
+        }
 
-                if (!logEntries.empty()) {
-                    logEntries.back().content = response;
-                }
+        if (command.substr(0, 10) == "save_path:") {
+            wxString path = wxString::FromUTF8(command.substr(10));
+            // Gắn đường dẫn file vào lệnh vừa chạy trên chính kết nối này
+            if (lastEntryId != 0) {
+                UpdateLogEntry(lastEntryId, [path](LogEntry& entry) {
+                    entry.savedPath = path;
+                    });
             }
-            else if (command == "list::process") {
-                response = cmd.Listprocess();
-                server->sendMessage(response);
-                LogMessage("Sent process list", response, false);
+            continue;
+        }
 
-                if (!logEntries.empty()) {
-                    logEntries.back().content = response;
-                }
-            }
-            else if (command == "help::cmd") {
-                response = cmd.help();
-                server->sendMessage(response);
-                LogMessage("Sent help information", response, false);
+        // Log command từ client
+        lastEntryId = LogCommand(command);
 
-                if (!logEntries.empty()) {
-                    logEntries.back().content = response;
-                }
-            }
-            else if (command == "screenshot::capture") {
-                int width, height;
-                imageData = cmd.captureScreenWithGDIPlus(width, height);
-                cmd.sendImage(server->getClientSocket(), imageData);
-                LogMessage("Sent screenshot", "Screenshot taken", false);
-
-                if (!logEntries.empty()) {
-                    logEntries.back().imageData = imageData;
-                    logEntries.back().isImage = true;
-                }
-            }
-            else if (command == "system::shutdown") {
-                LogMessage("Executing shutdown command", "", false);
-                cmd.shutdownComputer();
-            }
-            else if (command == "camera::open") {
-                cmd.openCamera();
-                Sleep(2000);
-                int width, height;
-                imageData = cmd.captureScreenWithGDIPlus(width, height);
-                cmd.sendImage(server->getClientSocket(), imageData);
-                LogMessage("Camera capture taken", "", false);
-
-                if (!logEntries.empty()) {
-                    logEntries.back().imageData = imageData;
-                    logEntries.back().isImage = true;
-                }
-            }
-            else if (command == "camera::close") {
-                cmd.closeCamera();
-                LogMessage("Camera closed", "", false);
-            }
-            else if (command == "system::restart") {
-                cmd.restartComputer();
-                LogMessage("Executing restart command", "", false);
-            }
-            else if (command == "system::lock") {
-                cmd.lockScreen();
-                LogMessage("Executing lock screen command", "", false);
-            }
-            else if (command.substr(0, 10) == "app::start") {
-                string appName = command.substr(11);  
-                if (appName.find(".exe") == string::npos) {
-                    appName += ".exe";
-                }
-                cmd.startApplication(appName);
-                LogMessage("Starting application: " + appName, "", false);
-            }
-            else if (command.substr(0, 9) == "app::stop") {
-                string appName = command.substr(10);   
-                if (appName.find(".exe") == string::npos) {
-                    appName += ".exe";
-                }
-                cmd.stopApplication(appName);
-                LogMessage("Stopping application: " + appName, "", false);
-            }
-            else if (command.substr(0, 14) == "service::start") {
-                string serviceName = command.substr(15);
-                cmd.startService(serviceName);
-                LogMessage("Starting service: " + serviceName, "", false);
-            }
-            else if (command.substr(0, 13) == "service::stop") {
-                string serviceName = command.substr(14);
-                cmd.stopService(serviceName);
-                LogMessage("Stopping service: " + serviceName, "", false);
+        if (!parsed.valid()) {
+            // "error::" là lệnh không hợp lệ mà client đã báo lại, chỉ cần ghi log
+            if (command.substr(0, 7) != "error::") {
+                LogMessage(LogSeverity::Error, "Error: " + string(parsed.error) + ": " + command);
             }
-            else if (command.substr(0, 9) == "file::get") {
-                string filepath = command.substr(10);
-                cmd.handleGetFile(server->getClientSocket(), filepath);
-                LogMessage("Sent file: " + filepath, "", false);
+            continue;
+        }
+
+        // Chạy trên worker của nhóm lệnh; chờ xong mới đọc lệnh tiếp theo
+        // để phản hồi trên kết nối này giữ đúng thứ tự client mong đợi
+        long entryId = lastEntryId;
+        // Thời gian chạy lệnh trên worker, không tính thời gian chờ trong hàng đợi
+        Metrics::Histogram* duration = &Metrics::registry().histogram("server_command_duration_microseconds",
+            "Command execution time on a scheduler worker", "command=\"" + std::string(parsed.spec->name) + "\"");
+        std::future<void> done = scheduler.submit(parsed.spec->commandClass, parsed.spec->highPriority,
+            [this, clientSocket, command, entryId, duration]() {
+                Metrics::ScopedTimer timer(*duration);
+                ExecuteCommand(clientSocket, parseCommand(command), entryId);
+            });
+
+        try {
+            done.get();
+        }
+        catch (const std::future_error&) {
+            break;  // Scheduler đã dừng trước khi lệnh được chạy
+        }
+        catch (const std::exception& e) {
+            LogMessage(LogSeverity::Error, "Error executing command: " + string(e.what()));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    // StopServer có thể đã đóng socket này
+    if (clientSockets.erase(clientSocket) > 0) {
+        server->closeClientConnection(clientSocket);
+    }
+    activeClients--;
+    clientsCv.notify_all();
+}
+
+void ServerFrame::UpdateLogEntry(long entryId, std::function<void(LogEntry&)> update) {
+    CallAfter([this, entryId, update]() {
+        for (auto it = logEntries.rbegin(); it != logEntries.rend(); ++it) {
+            if (it->id == entryId) {
+                update(*it);
+                return;
             }
-            else if (command.substr(0, 12) == "file::delete") {
-                string filepath = command.substr(13); 
-                cmd.handleDeleteFile(server->getClientSocket(), filepath);
-                LogMessage("Deleted file: " + filepath, "", false);
+        }
+        });
+}
+
+void ServerFrame::AttachResult(long entryId, BlobKind kind, const void* data, size_t size) {
+    // Ghi object ngay trên thread worker, UI thread chỉ nhận BlobRef
+    BlobRef ref = historyStore.put(kind, data, size);
+    if (ref.empty()) return;
+
+    CallAfter([this, entryId, ref]() {
+        for (auto it = logEntries.rbegin(); it != logEntries.rend(); ++it) {
+            if (it->id == entryId) {
+                historyStore.release(it->blob);
+                it->blob = ref;
+                EnforceHistoryRetention();
+                return;
             }
-            else if (command.substr(0, 14) == "camera::record") {
-                try {
-                    string durationStr = command.substr(14);
-                    int seconds = std::stoi(durationStr);
+        }
+        // Entry đã bị xóa khỏi lịch sử trước khi lệnh chạy xong
+        historyStore.release(ref);
+        });
+}
 
-                    if (seconds <= 0 || seconds > 300) {
-                        LogMessage("Error: Invalid recording duration", "", false);
-                        continue;
-                    }
+void ServerFrame::EnforceHistoryRetention() {
+    // Luôn giữ lại entry mới nhất, kể cả khi riêng nó đã vượt ngân sách dung lượng
+    while (logEntries.size() > 1 && historyStore.overBudget(logEntries.size())) {
+        thumbnailCache.erase(logEntries.front().blob.hash);
+        historyStore.release(logEntries.front().blob);
+        logEntries.pop_front();
+        logList->DeleteItem(0);
+    }
+}
 
-                    LogMessage("Opening camera and starting recording...", "", false);
+void ServerFrame::SendCachedResult(SOCKET clientSocket, const ParsedCommand& parsed, long entryId,
+    const wxString& description, const std::function<std::string()>& compute) {
+    bool hit;
+    ResultCache::Payload payload = resultCache.getOrCompute(parsed, compute, hit);
+    cmd.sendText(clientSocket, *payload);
+    LogMessage(LogSeverity::Success, hit ? description + " (cached)" : description);
 
-                    // Gọi hàm record từ Command class (đã bao gồm việc mở/đóng camera)
-                    vector<BYTE> videoData = cmd.recordVideo(seconds);
+    AttachResult(entryId, BlobKind::Text, payload->data(), payload->size());
+}
 
-                    // Gửi dữ liệu về client
-                    cmd.sendImage(server->getClientSocket(), videoData);
+void ServerFrame::ExecuteCommand(SOCKET clientSocket, const ParsedCommand& parsed, long entryId) {
+    string args(parsed.args);
+    string response;
+    vector<BYTE> imageData;
+
+    switch (parsed.spec->id) {
+    case CommandId::ListApp:
+        SendCachedResult(clientSocket, parsed, entryId, "Sent application list",
+            [this]() { return cmd.Applist(); });
+        break;
+
+    case CommandId::ListService:
+        SendCachedResult(clientSocket, parsed, entryId, "Sent service list",
+            [this]() { return cmd.Listservice(); });
+        break;
+
+    case CommandId::ListProcess:
+        SendCachedResult(clientSocket, parsed, entryId, "Sent process list",
+            [this]() { return cmd.Listprocess(); });
+        break;
+
+    case CommandId::HelpCmd:
+        SendCachedResult(clientSocket, parsed, entryId, "Sent help information",
+            [this]() { return cmd.help(); });
+        break;
+
+    case CommandId::ScreenshotCapture: {
+        int width, height;
+        imageData = cmd.captureScreenWithGDIPlus(width, height);
+        cmd.sendImage(clientSocket, imageData);
+        LogMessage(LogSeverity::Success, "Sent screenshot");
+
+        AttachResult(entryId, BlobKind::Image, imageData.data(), imageData.size());
+        break;
+    }
 
-                    LogMessage("Video recording completed and sent", "", false);
+    case CommandId::ScreenStream: {
+        const ScreenStream::StreamOptions& options = parsed.options;
+        LogMessage(LogSeverity::Info, wxString::Format("Streaming screen: %d fps, quality %d, %d seconds",
+            options.fps, options.quality, options.seconds));
+
+        // Chiếm kết nối cho tới khi stream kết thúc; dừng sớm nếu server bị tắt
+        GdiFrameSource source;
+        SocketStreamChannel channel(clientSocket);
+        ScreenStreamer streamer(source, channel, options);
+        StreamStats stats = streamer.run([this]() { return isRunning.load(); });
+
+        response = ScreenStreamer::formatSummary(stats);
+        LogMessage(stats.framesSent > 0 ? LogSeverity::Success : LogSeverity::Warning, response);
+        AttachResult(entryId, BlobKind::Text, response.data(), response.size());
+        break;
+    }
 
-                    if (!logEntries.empty()) {
-                        logEntries.back().imageData = videoData;
-                        logEntries.back().isVideo = true;  // Set the video flag
-                        logEntries.back().isImage = false; // Make sure image flag is false
-                        logEntries.back().content = "Video recording: " + to_string(videoData.size()) + " bytes";
-                    }
-                }
-                catch (const std::exception& e) {
-                    cmd.closeCamera(); // Ensure camera is closed in case of error
-                    LogMessage("Error in video recording: " + string(e.what()), "", false);
-                }
-                }
-            
+    case CommandId::SystemShutdown:
+        LogMessage(LogSeverity::Info, "Executing shutdown command");
+        cmd.shutdownComputer();
+        break;
+
+    case CommandId::CameraOpen: {
+        cmd.openCamera();
+        Sleep(2000);
+        int width, height;
+        imageData = cmd.captureScreenWithGDIPlus(width, height);
+        cmd.sendImage(clientSocket, imageData);
+        LogMessage(LogSeverity::Success, "Camera capture taken");
+
+        AttachResult(entryId, BlobKind::Image, imageData.data(), imageData.size());
+        break;
+    }
+
+    case CommandId::CameraClose:
+        cmd.closeCamera();
+        LogMessage(LogSeverity::Info, "Camera closed");
+        break;
+
+    case CommandId::SystemRestart:
+        cmd.restartComputer();
+        LogMessage(LogSeverity::Info, "Executing restart command");
+        break;
+
+    case CommandId::SystemLock:
+        cmd.lockScreen();
+        LogMessage(LogSeverity::Info, "Executing lock screen command");
+        break;
+
+    case CommandId::AppStart:
+        if (args.find(".exe") == string::npos) {
+            args += ".exe";
+        }
+        cmd.startApplication(args);
+        resultCache.invalidate(CommandId::ListApp);
+        resultCache.invalidate(CommandId::ListProcess);
+        LogMessage(LogSeverity::Info, "Starting application: " + args);
+        break;
+
+    case CommandId::AppStop:
+        if (args.find(".exe") == string::npos) {
+            args += ".exe";
         }
+        cmd.stopApplication(args);
+        resultCache.invalidate(CommandId::ListApp);
+        resultCache.invalidate(CommandId::ListProcess);
+        LogMessage(LogSeverity::Info, "Stopping application: " + args);
+        break;
+
+    case CommandId::ServiceStart: {
+        LogMessage(LogSeverity::Info, "Starting service: " + args);
+        bool succeeded = cmd.startService(args, response);
+        resultCache.invalidate(CommandId::ListService);
+        resultCache.invalidate(CommandId::ListProcess);
+        LogMessage(succeeded ? LogSeverity::Success : LogSeverity::Warning, response);
+
+        AttachResult(entryId, BlobKind::Text, response.data(), response.size());
+        break;
+    }
 
-        server->closeClientConnection();
+    case CommandId::ServiceStop: {
+        LogMessage(LogSeverity::Info, "Stopping service: " + args);
+        bool succeeded = cmd.stopService(args, response);
+        resultCache.invalidate(CommandId::ListService);
+        resultCache.invalidate(CommandId::ListProcess);
+        LogMessage(succeeded ? LogSeverity::Success : LogSeverity::Warning, response);
+
+        AttachResult(entryId, BlobKind::Text, response.data(), response.size());
+        break;
     }
-}
 
-void ServerFrame::LogMessage(const wxString& message, const wxString& details, bool isCommand) {
-    LogEntry* entry = new LogEntry{ message, details, isCommand };
-    entry->isImage = false;
-
-    wxDateTime now = wxDateTime::Now();
-    wxString timestamp = now.FormatTime();
-
-    // Xác định kiểu message và style
-    wxTextAttr style;
-    wxString prefix;
-    wxString source = isCommand ? "[CLIENT] " : "[SERVER] ";
-    wxString loweredMsg = message.Lower();
-
-    if (loweredMsg.Contains("error") || loweredMsg.Contains("failed")) {
-        style.SetTextColour(wxColour(255, 99, 71));  // Đỏ
-        prefix = "ERROR";
-    }
-    else if (loweredMsg.Contains("success") || loweredMsg.Contains("sent") || loweredMsg.Contains("deleted") || 
-        loweredMsg.Contains("starting") ||
-        loweredMsg.Contains("complete") || loweredMsg.Contains("saved")) {
-        style.SetTextColour(wxColour(46, 204, 113));  // Xanh lá
-        prefix = "SUCCESS";
-    }
-    else if (loweredMsg.Contains("::")) {
-        style.SetTextColour(wxColour(135, 206, 235));
-        prefix = "COMMAND";
-    }    
-    else if (loweredMsg.Contains("warning")) {
-        style.SetTextColour(wxColour(241, 196, 15));  // Vàng
-        prefix = "WARNING";
+    case CommandId::FileGet: {
+        bool sent = cmd.handleGetFile(clientSocket, args, response);
+        LogMessage(sent ? LogSeverity::Success : LogSeverity::Warning, response);
+        break;
     }
-    else {
-        style.SetTextColour(wxColour(189, 195, 199)); // Xám nhạt
-        prefix = "INFO";
+
+    case CommandId::FileList: {
+        bool sent = cmd.handleListFiles(clientSocket, args, response);
+        LogMessage(sent ? LogSeverity::Success : LogSeverity::Warning, response);
+        break;
     }
 
-    // Timestamp style
-    wxTextAttr timestampStyle;
-    timestampStyle.SetTextColour(wxColour(128, 128, 128));
-    timestampStyle.SetFont(messageLog->GetFont());
-    messageLog->SetDefaultStyle(timestampStyle);
-    messageLog->AppendText("[" + timestamp + "] ");
+    case CommandId::FileDelete:
+        cmd.handleDeleteFile(clientSocket, args);
+        LogMessage(LogSeverity::Success, "Deleted file: " + args);
+        break;
 
-    // Prefix style với font đậm
-    wxFont boldFont = messageLog->GetFont();
-    boldFont.SetWeight(wxFONTWEIGHT_BOLD);
-    style.SetFont(boldFont);
-    messageLog->SetDefaultStyle(style);
-    messageLog->AppendText("[" + prefix + "] " + source);
+    case CommandId::CameraRecord:
+        try {
+            LogMessage(LogSeverity::Info, "Opening camera and starting recording...");
+
+            // Gọi hàm record từ Command class (đã bao gồm việc mở/đóng camera)
+            vector<BYTE> videoData = cmd.recordVideo(parsed.seconds);
+
+            // Gửi dữ liệu về client
+            cmd.sendImage(clientSocket, videoData);
+
+            LogMessage(LogSeverity::Success, "Video recording completed and sent");
+
+            AttachResult(entryId, BlobKind::Video, videoData.data(), videoData.size());
+        }
+        catch (const std::exception& e) {
+            cmd.closeCamera(); // Ensure camera is closed in case of error
+            // Client đang chờ khung video: gửi video rỗng để nó không chờ mãi và kết nối không lệch khung
+            cmd.sendImage(clientSocket, vector<BYTE>());
+            LogMessage(LogSeverity::Error, "Error in video recording: " + string(e.what()));
+        }
+        break;
+
+    case CommandId::PingHeartbeat:
+        break;
+    }
+}
+
+void ServerFrame::LogMessage(LogSeverity severity, const wxString& message) {
+    logger.log(severity, false, std::string(message.utf8_str()));
+}
+
+long ServerFrame::LogCommand(const std::string& command) {
+    long entryId = ++nextEntryId;
+
+    // "error::" là lệnh không hợp lệ mà client đã báo lại
+    bool reportedError = command.compare(0, 7, "error::") == 0;
+    logger.log(reportedError ? LogSeverity::Error : LogSeverity::Command, true, command);
+
+    wxString text = wxString::FromUTF8(command);
+    CallAfter([this, entryId, text]() {
+        AddHistoryEntry(entryId, text);
+        });
+    return entryId;
+}
+
+void ServerFrame::OnLogTimer(wxTimerEvent& event) {
+    if (logger.drain(logBatch, LOG_BATCH_LIMIT) == 0 && logger.getDropped() == reportedDrops) {
+        return;
+    }
 
-    // Message với font thường
     wxFont normalFont = messageLog->GetFont();
     normalFont.SetWeight(wxFONTWEIGHT_NORMAL);
-    style.SetFont(normalFont);
-    messageLog->SetDefaultStyle(style);
-    messageLog->AppendText(message + "\n");
+    wxFont boldFont = normalFont;
+    boldFont.SetWeight(wxFONTWEIGHT_BOLD);
 
-    messageLog->ShowPosition(messageLog->GetLastPosition());
+    wxTextAttr timestampStyle;
+    timestampStyle.SetTextColour(wxColour(128, 128, 128));
+    timestampStyle.SetFont(normalFont);
+
+    // Ghi cả lô trong một lần vẽ lại
+    messageLog->Freeze();
+
+    long long dropped = logger.getDropped();
+    if (dropped != reportedDrops) {
+        LogRecord notice{};
+        notice.timestampMs = wxGetUTCTimeMillis().GetValue();
+        notice.severity = LogSeverity::Warning;
+        std::string text = std::to_string(dropped - reportedDrops) + " log messages dropped (queue full)";
+        notice.length = (uint16_t)text.copy(notice.message, LogRecord::MESSAGE_SIZE);
+        logBatch.push_back(notice);
+        reportedDrops = dropped;
+    }
+
+    for (const LogRecord& record : logBatch) {
+        wxTextAttr style;
+        switch (record.severity) {
+        case LogSeverity::Error: style.SetTextColour(wxColour(255, 99, 71)); break;      // Đỏ
+        case LogSeverity::Success: style.SetTextColour(wxColour(46, 204, 113)); break;   // Xanh lá
+        case LogSeverity::Command: style.SetTextColour(wxColour(135, 206, 235)); break;
+        case LogSeverity::Warning: style.SetTextColour(wxColour(241, 196, 15)); break;   // Vàng
+        default: style.SetTextColour(wxColour(189, 195, 199)); break;                    // Xám nhạt
+        }
 
-    if (isCommand) {
-        wxCommandEvent* event = new wxCommandEvent(wxEVT_SERVER_LOG);
-        event->SetClientData(entry);
-        wxQueueEvent(this, event);
+        wxString timestamp = wxDateTime(wxLongLong(record.timestampMs)).FormatTime();
+        messageLog->SetDefaultStyle(timestampStyle);
+        messageLog->AppendText("[" + timestamp + "] ");
+
+        // Prefix style với font đậm
+        style.SetFont(boldFont);
+        messageLog->SetDefaultStyle(style);
+        messageLog->AppendText(wxString("[") + Logger::severityLabel(record.severity) + "] " +
+            (record.fromClient ? "[CLIENT] " : "[SERVER] "));
+
+        // Message với font thường
+        style.SetFont(normalFont);
+        messageLog->SetDefaultStyle(style);
+        messageLog->AppendText(wxString::FromUTF8(record.message, record.length) + "\n");
     }
+
+    messageLog->Thaw();
+    messageLog->ShowPosition(messageLog->GetLastPosition());
 }
 
 void ServerFrame::OnClearHistory(wxCommandEvent& event)
@@ -555,91 +831,54 @@ void ServerFrame::OnClearHistory(wxCommandEvent& event)
     if (wxMessageBox("Are you sure you want to clear the command history?",
         "Confirm Clear", wxYES_NO | wxICON_QUESTION) == wxYES) {
         logList->DeleteAllItems();
+        for (const LogEntry& entry : logEntries) {
+            historyStore.release(entry.blob);
+        }
         logEntries.clear();
+        thumbnailCache.clear();
     }
 }
 
 void ServerFrame::FormatCommand(wxString& command) {
-    // Convert to uppercase
-    if (command.StartsWith("list::")) {
-        command = "LIST " + command.Mid(6).Upper();
-    }
-    else if (command == "screenshot::capture") {
-        command = "CAPTURE SCREEN";
-    }
-    else if (command == "system::shutdown") {
-        command = "SYSTEM SHUTDOWN";
-    }
-    else if (command == "system::restart") {
-        command = "SYSTEM RESTART";
-    }
-    else if (command == "system::lock") {
-        command = "LOCK SCREEN";
-    }
-    else if (command.StartsWith("app::start")) {
-        command = "START APP: " + command.Mid(10).Upper();
-    }
-    else if (command.StartsWith("app::stop")) {
-        command = "STOP APP: " + command.Mid(9).Upper();
-    }
-    else if (command == "camera::open") {
-        command = "OPEN CAMERA";
-    }
-    else if (command == "camera::close") {
-        command = "CLOSE CAMERA";
-    }
-    else if (command.StartsWith("camera::record")) {
-        command = "RECORD: " + command.Mid(14).Upper() + " SECONDS";
-    }
-    else if (command == "help::cmd") {
-        command = "HELP COMMAND";
-    }
-    else if (command.StartsWith("file::get")) {
-        command = "GET FILE: " + command.Mid(9).Upper();
-    }
-    else if (command.StartsWith("file::delete")) {
-        command = "DELETE FILE: " + command.Mid(12).Upper();
+    std::string raw = command.ToStdString();
+    ParsedCommand parsed = parseCommand(raw);
+    if (parsed.valid()) {
+        command = formatCommandLabel(parsed);
     }
 }
 
-void ServerFrame::OnLogEvent(wxCommandEvent& event)
+void ServerFrame::AddHistoryEntry(long entryId, const wxString& command)
 {
-    LogEntry* entry = static_cast<LogEntry*>(event.GetClientData());
-    if (!entry) return;
-
-    if (entry->isCommand) {
-        auto now = std::time(nullptr);
-        auto tm = *std::localtime(&now);
-        std::ostringstream timeStr;
-        timeStr << std::put_time(&tm, "%H:%M:%S");
+    auto now = std::time(nullptr);
+    auto tm = *std::localtime(&now);
+    std::ostringstream timeStr;
+    timeStr << std::put_time(&tm, "%H:%M:%S");
 
-        // Format command before displaying
-        wxString formattedCommand = entry->message;
-        FormatCommand(formattedCommand);
+    // Format command before displaying
+    wxString formattedCommand = command;
+    FormatCommand(formattedCommand);
 
-        long itemIndex = logList->InsertItem(logList->GetItemCount(), timeStr.str());
-        logList->SetItem(itemIndex, 1, formattedCommand);
+    long itemIndex = logList->InsertItem(logList->GetItemCount(), timeStr.str());
+    logList->SetItem(itemIndex, 1, formattedCommand);
 
-        // Thêm status và màu sắc
-        wxString status = "Executed";
-        wxColour itemColor = wxColour(46, 204, 113); // Màu xanh mặc định
-
-        if (entry->message.StartsWith("error") || entry->message.StartsWith("Error") || entry->message.StartsWith("ERROR") || entry->message.StartsWith("INVALID")) {
-            status = "Failed";
-            itemColor = wxColour(231, 76, 60); // Màu đỏ cho lỗi
-        }
+    // Thêm status và màu sắc
+    wxString status = "Executed";
+    wxColour itemColor = wxColour(46, 204, 113); // Màu xanh mặc định
 
-        logList->SetItem(itemIndex, 2, status);
-        logList->SetItemTextColour(itemIndex, itemColor);
+    if (command.StartsWith("error") || command.StartsWith("Error") || command.StartsWith("ERROR") || command.StartsWith("INVALID")) {
+        status = "Failed";
+        itemColor = wxColour(231, 76, 60); // Màu đỏ cho lỗi
+    }
 
-        // Tự động cuộn đến item mới
-        logList->EnsureVisible(itemIndex);
+    logList->SetItem(itemIndex, 2, status);
+    logList->SetItemTextColour(itemIndex, itemColor);
 
-        logEntries.push_back(*entry);
-    }
-    else {
-        messageLog->AppendText(entry->message + "\n");
-    }
+    // Tự động cuộn đến item mới
+    logList->EnsureVisible(itemIndex);
 
-    delete entry;
-}
\ No newline at end of file
+    LogEntry entry{};
+    entry.id = entryId;
+    entry.message = command;
+    logEntries.push_back(std::move(entry));
+    EnforceHistoryRetention();
+}
@@ -5,17 +5,31 @@
 #include <wx/mstream.h>
 #include "socket.h"
 #include "CommandExecutor.h"
+#include "CommandRegistry.h"
+#include "CommandScheduler.h"
+#include "ResultCache.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "HistoryStore.h"
+#include "PlaybackEngine.h"
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <set>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <iostream>
 #include <opencv2/opencv.hpp>
 #include <wx/rawbmp.h>
 #include <wx/filename.h>
 
 #define DEFAULT_PORT "27015"
-
-
-// Custom event for logging
-wxDECLARE_EVENT(wxEVT_SERVER_LOG, wxCommandEvent);
+// Ghi đè cổng lắng nghe, ví dụ để chạy nhiều server trên một máy khi đo hiệu năng.
+// Lịch sử, log và số liệu nằm trong thư mục theo cổng nên các server không dùng chung file
+#define SERVER_PORT_ENV "EMAILPC_SERVER_PORT"
 
 class ServerFrame : public wxFrame {
 public:
@@ -38,37 +52,74 @@ private:
 
     // Server components
     SocketServer* server;
+    std::string listenPort;
     std::thread* serverThread;
-    bool isRunning;
+    std::atomic<bool> isRunning;
     Command cmd;
+    CommandScheduler scheduler;
+    ResultCache resultCache;
+    ProcessWatcher processWatcher;
+
+    // Các client đang kết nối, mỗi client một thread HandleClient
+    std::set<SOCKET> clientSockets;
+    int activeClients;
+    std::mutex clientsMutex;
+    std::condition_variable clientsCv;
 
     // Event handlers
     void OnStart(wxCommandEvent& event);
     void OnStop(wxCommandEvent& event);
     void OnClose(wxCloseEvent& event);
-    void OnLogEvent(wxCommandEvent& event);
+    void OnLogTimer(wxTimerEvent& event);
     void OnLogItemDblClick(wxListEvent& event);
 
     // Server control methods
     void StartServer();
     void StopServer();
     void ServerLoop();
-
-    // Logging methods
-    void LogMessage(const wxString& message, const wxString& details = "", bool isCommand = false);
+    void HandleClient(SOCKET clientSocket);
+    void ExecuteCommand(SOCKET clientSocket, const ParsedCommand& parsed, long entryId);
+    // Gửi kết quả list::*/help::cmd, dùng lại kết quả trong cache nếu còn hạn
+    void SendCachedResult(SOCKET clientSocket, const ParsedCommand& parsed, long entryId,
+        const wxString& description, const std::function<std::string()>& compute);
+
+    // Logging methods: an toàn khi gọi từ mọi thread, UI cập nhật theo lô trong OnLogTimer
+    void LogMessage(LogSeverity severity, const wxString& message);
+    // Ghi lệnh từ client và thêm vào lịch sử; trả về id của LogEntry để gắn kết quả về sau
+    long LogCommand(const std::string& command);
+    void AddHistoryEntry(long entryId, const wxString& command);
+
+    static const int LOG_REFRESH_MS = 100;
+    static const size_t LOG_BATCH_LIMIT = 256;
+    Logger logger;
+    wxTimer logTimer;
+    std::vector<LogRecord> logBatch;
+    long long reportedDrops;
 
     // Store command responses for double-click viewing
+    // Chỉ giữ metadata; nội dung kết quả nằm trong historyStore
     struct LogEntry {
+        long id;
         wxString message;
-        wxString details;
-        bool isCommand;
         wxString savedPath;
-        wxString content;
-        std::vector<BYTE> imageData;  // Thêm trường này để lưu dữ liệu ảnh
-        bool isImage;                 // Flag để biết entry này có chứa ảnh không
-        bool isVideo;
+        BlobRef blob;
     };
-    std::vector<LogEntry> logEntries;
+    std::deque<LogEntry> logEntries;
+    std::atomic<long> nextEntryId;
+    HistoryStore historyStore;
+    LruCache<std::string, wxImage> thumbnailCache{ 16 };
+
+    // Cập nhật LogEntry theo id trên UI thread; bỏ qua nếu entry đã bị xóa khỏi lịch sử
+    void UpdateLogEntry(long entryId, std::function<void(LogEntry&)> update);
+    // Lưu kết quả lệnh vào historyStore (gọi từ worker) rồi gắn vào entry trên UI thread
+    void AttachResult(long entryId, BlobKind kind, const void* data, size_t size);
+    // Bỏ entry cũ nhất khi vượt số lượng hoặc dung lượng cho phép
+    void EnforceHistoryRetention();
+
+    static const int METRICS_PORT = 9101;    // Cho DEFAULT_PORT, xem StartMetrics
+    static const int METRICS_DUMP_INTERVAL_SEC = 60;
+    Metrics::Exporter metricsExporter;
+    void StartMetrics();
 
     DECLARE_EVENT_TABLE()
 };
@@ -119,43 +170,44 @@ public:
 
 class ImageDialog : public wxDialog {
 public:
-    ImageDialog(wxWindow* parent, const wxString& title, const std::vector<BYTE>& imageData)
-        : wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600))
+    static const int DIALOG_WIDTH = 800;
+    static const int DIALOG_HEIGHT = 600;
+
+    // Thu nhỏ vừa dialog, giữ tỷ lệ
+    static wxImage ScaleToFit(const wxImage& image, wxImageResizeQuality quality)
+    {
+        int maxWidth = DIALOG_WIDTH;
+        int maxHeight = DIALOG_HEIGHT - 50; // Space for button
+
+        double scaleWidth = (double)maxWidth / image.GetWidth();
+        double scaleHeight = (double)maxHeight / image.GetHeight();
+        double scale = std::min(scaleWidth, scaleHeight);
+
+        if (scale >= 1) {
+            return image.Copy();    // Không chia sẻ dữ liệu với ảnh gốc giữa các thread
+        }
+        return image.Scale(image.GetWidth() * scale, image.GetHeight() * scale, quality);
+    }
+
+    // cachedPreview: ảnh đã thu nhỏ lấy từ thumbnail cache (có thể rỗng).
+    // Nếu không có, PNG được đọc thẳng từ vùng mmap và giải mã trên thread nền:
+    // hiện bản thu nhỏ nhanh trước, rồi thay bằng bản chất lượng cao và báo về qua onPreviewReady.
+    ImageDialog(wxWindow* parent, const wxString& title, std::shared_ptr<MappedBlob> blob,
+        const wxImage& cachedPreview, std::function<void(const wxImage&)> onPreviewReady)
+        : wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(DIALOG_WIDTH, DIALOG_HEIGHT)),
+        m_blob(blob), m_onPreviewReady(onPreviewReady), m_cancelled(false),
+        m_openedAt(std::chrono::steady_clock::now())
     {
         // Đặt background màu tối
         SetBackgroundColour(wxColour(30, 30, 30));
 
         wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 
-        // Đảm bảo image handler được khởi tạo
-        wxInitAllImageHandlers();
-
-        // Convert image data to wxImage
-        wxMemoryInputStream memStream(imageData.data(), imageData.size());
-        wxImage image;
-        if (image.LoadFile(memStream, wxBITMAP_TYPE_PNG)) {
-            // Scale image to fit dialog while maintaining aspect ratio
-            int dialogWidth, dialogHeight;
-            GetSize(&dialogWidth, &dialogHeight);
-            dialogHeight -= 50; // Space for button
-
-            double scaleWidth = (double)dialogWidth / image.GetWidth();
-            double scaleHeight = (double)dialogHeight / image.GetHeight();
-            double scale = std::min(scaleWidth, scaleHeight);
-
-            if (scale < 1) {
-                image.Rescale(image.GetWidth() * scale, image.GetHeight() * scale, wxIMAGE_QUALITY_HIGH);
-            }
-
-            wxBitmap bitmap(image);
-            wxStaticBitmap* staticBitmap = new wxStaticBitmap(this, wxID_ANY, bitmap);
-            sizer->Add(staticBitmap, 1, wxALIGN_CENTER | wxALL, 5);
-        }
-        else {
-            wxStaticText* errorText = new wxStaticText(this, wxID_ANY, "Failed to load image");
-            errorText->SetForegroundColour(wxColour(255, 255, 255));  // White text
-            sizer->Add(errorText, 1, wxALIGN_CENTER | wxALL, 5);
-        }
+        m_imageView = new wxStaticBitmap(this, wxID_ANY, wxNullBitmap);
+        m_statusText = new wxStaticText(this, wxID_ANY, "Loading image...");
+        m_statusText->SetForegroundColour(wxColour(255, 255, 255));  // White text
+        sizer->Add(m_imageView, 1, wxALIGN_CENTER | wxALL, 5);
+        sizer->Add(m_statusText, 0, wxALIGN_CENTER | wxALL, 5);
 
         // Modern styled OK button
         wxButton* okButton = new wxButton(this, wxID_OK, "OK",
@@ -166,15 +218,107 @@ public:
 
         SetSizer(sizer);
         CenterOnParent();
+
+        if (cachedPreview.IsOk()) {
+            ShowImage(cachedPreview, true);
+        }
+        else if (m_blob) {
+            m_decodeThread = std::thread(&ImageDialog::DecodeLoop, this);
+        }
+        else {
+            m_statusText->SetLabel("Failed to load image");
+        }
+    }
+
+    ~ImageDialog() {
+        m_cancelled = true;
+        if (m_decodeThread.joinable()) {
+            m_decodeThread.join();
+        }
+    }
+
+private:
+    wxStaticBitmap* m_imageView;
+    wxStaticText* m_statusText;
+    std::shared_ptr<MappedBlob> m_blob;
+    std::function<void(const wxImage&)> m_onPreviewReady;
+    std::thread m_decodeThread;
+    std::atomic<bool> m_cancelled;
+    std::chrono::steady_clock::time_point m_openedAt;
+
+    // Ảnh chuyển từ thread giải mã sang UI thread. Bộ đếm tham chiếu của wxImage
+    // không an toàn đa luồng nên mọi thao tác trên ô này đều nằm trong m_pendingMutex.
+    std::mutex m_pendingMutex;
+    wxImage m_pendingImage;
+    bool m_pendingFinal = false;
+
+    void DecodeLoop() {
+        // wxImage dùng được ngoài UI thread; wxBitmap thì không, nên chỉ tạo bitmap trong ShowImage
+        wxMemoryInputStream memStream(m_blob->data(), m_blob->length());
+        wxImage image;
+        if (!image.LoadFile(memStream, wxBITMAP_TYPE_PNG)) {
+            if (!m_cancelled) {
+                CallAfter([this]() { m_statusText->SetLabel("Failed to load image"); });
+            }
+            return;
+        }
+
+        // Bản thu nhỏ nhanh để hiện sớm, sau đó bản chất lượng cao
+        const wxImageResizeQuality passes[] = { wxIMAGE_QUALITY_NORMAL, wxIMAGE_QUALITY_HIGH };
+        for (wxImageResizeQuality quality : passes) {
+            if (m_cancelled) return;
+
+            wxImage preview = ScaleToFit(image, quality);
+            {
+                std::lock_guard<std::mutex> lock(m_pendingMutex);
+                m_pendingImage = preview;
+                m_pendingFinal = quality == wxIMAGE_QUALITY_HIGH;
+                preview = wxImage();
+            }
+            CallAfter(&ImageDialog::OnPreviewDecoded);
+        }
+    }
+
+    void OnPreviewDecoded() {
+        wxImage image;
+        bool final;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            if (!m_pendingImage.IsOk()) return;   // Đã được lần gọi trước lấy
+            image = m_pendingImage;
+            final = m_pendingFinal;
+            m_pendingImage = wxImage();
+        }
+
+        ShowImage(image, final);
+        if (final && m_onPreviewReady) {
+            m_onPreviewReady(image);
+        }
+    }
+
+    void ShowImage(const wxImage& image, bool final) {
+        bool firstPixel = !m_imageView->GetBitmap().IsOk();
+        m_imageView->SetBitmap(wxBitmap(image));
+        m_statusText->SetLabel(final ? "" : "Refining...");
+        Layout();
+
+        if (firstPixel) {
+            long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - m_openedAt).count();
+            std::cout << "[INFO] Image preview: first pixel after " << elapsedMs << " ms" << std::endl;
+        }
     }
 };
 
 class VideoDialog : public wxDialog {
 public:
-    VideoDialog(wxWindow* parent, const wxString& title, const std::vector<BYTE>& videoData)
+    // videoPath: object .avi trong HistoryStore, mở trực tiếp không cần chép ra file tạm
+    VideoDialog(wxWindow* parent, const wxString& title, const std::string& videoPath)
         : wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(800, 600),
             wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
-        m_isPlaying(false), m_shouldExit(false), m_bitmap(nullptr)
+        m_bitmap(nullptr), m_frameTimer(this), m_scrubbing(false),
+        m_openedAt(std::chrono::steady_clock::now()), m_firstFrameShown(false),
+        m_presentedFrames(0), m_totalPresentUs(0)
     {
         SetBackgroundColour(wxColour(30, 30, 30));
         wxBoxSizer* mainSizer = new wxBoxSizer(wxVERTICAL);
@@ -190,6 +334,10 @@ public:
 
         mainSizer->Add(m_videoPanel, 1, wxEXPAND | wxALL, 5);
 
+        // Thanh tua theo số khung
+        m_seekSlider = new wxSlider(this, wxID_ANY, 0, 0, 1);
+        mainSizer->Add(m_seekSlider, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+
         // Controls
         wxPanel* controlPanel = new wxPanel(this, wxID_ANY);
         controlPanel->SetBackgroundColour(wxColour(30, 30, 30));
@@ -214,45 +362,71 @@ public:
         m_playPauseButton->Bind(wxEVT_BUTTON, &VideoDialog::OnPlayPause, this);
         m_restartButton->Bind(wxEVT_BUTTON, &VideoDialog::OnRestart, this);
         m_closeButton->Bind(wxEVT_BUTTON, &VideoDialog::OnClose, this);
+        m_seekSlider->Bind(wxEVT_SCROLL_THUMBTRACK, &VideoDialog::OnScrub, this);
+        m_seekSlider->Bind(wxEVT_SCROLL_THUMBRELEASE, &VideoDialog::OnScrubEnd, this);
+        m_seekSlider->Bind(wxEVT_SCROLL_CHANGED, &VideoDialog::OnScrubEnd, this);
         Bind(wxEVT_CLOSE_WINDOW, &VideoDialog::OnCloseWindow, this);
+        Bind(wxEVT_TIMER, &VideoDialog::OnFrameTimer, this, m_frameTimer.GetId());
 
-        // Tạo file tạm
-        m_tempVideoFile = wxFileName::CreateTempFileName("video") + ".avi";
-        std::ofstream outFile(m_tempVideoFile.ToStdString(), std::ios::binary);
-        outFile.write(reinterpret_cast<const char*>(videoData.data()), videoData.size());
-        outFile.close();
-
-        InitializeVideoCapture();
+        if (m_engine.open(videoPath)) {
+            if (m_engine.getFrameCount() > 1) {
+                m_seekSlider->SetRange(0, static_cast<int>(m_engine.getFrameCount() - 1));
+            }
+            else {
+                m_seekSlider->Disable();
+            }
 
-        // Start video thread
-        m_videoThread = std::thread(&VideoDialog::VideoLoop, this);
+            // Hỏi engine nhanh hơn tốc độ khung để khung được hiện trễ không quá nửa chu kỳ
+            int frameMs = static_cast<int>(1000.0 / m_engine.getFps());
+            int intervalMs = frameMs / 2;
+            if (intervalMs > 15) intervalMs = 15;
+            if (intervalMs < 5) intervalMs = 5;
+            m_frameTimer.Start(intervalMs);
+        }
+        else {
+            m_seekSlider->Disable();
+            wxMessageBox("Failed to open video file", "Error", wxOK | wxICON_ERROR);
+        }
 
         CenterOnParent();
     }
 
     ~VideoDialog() {
         StopVideo();
-        if (m_videoThread.joinable()) {
-            m_videoThread.join();
-        }
         if (m_bitmap) {
             delete m_bitmap;
         }
-        wxRemoveFile(m_tempVideoFile);
+
+        if (m_presentedFrames > 0) {
+            PlaybackStats stats = m_engine.getStats();
+            double avgUs = static_cast<double>(m_totalPresentUs) / m_presentedFrames;
+            std::cout << "[INFO] Video presentation: " << m_presentedFrames << " frames, "
+                << stats.dropped << " dropped, " << avgUs << " us/frame (~"
+                << (avgUs > 0 ? static_cast<long long>(1000000.0 / avgUs) : 0) << " fps capacity)" << std::endl;
+            std::cout << "[INFO] Video playback: queue depth avg " << stats.avgQueueDepth
+                << " max " << stats.maxQueueDepth << ", lateness avg " << stats.avgLatenessMs
+                << " ms max " << stats.maxLatenessMs << " ms, jitter avg " << stats.avgJitterMs
+                << " ms max " << stats.maxJitterMs << " ms" << std::endl;
+        }
     }
 
 private:
     wxPanel* m_videoPanel;
+    wxSlider* m_seekSlider;
     wxButton* m_playPauseButton;
     wxButton* m_restartButton;
     wxButton* m_closeButton;
-    cv::VideoCapture m_capture;
-    std::thread m_videoThread;
-    bool m_isPlaying;
-    bool m_shouldExit;
-    wxString m_tempVideoFile;
-    std::mutex m_mutex;
     wxBitmap* m_bitmap;
+    PlaybackEngine m_engine;
+    wxTimer m_frameTimer;
+    bool m_scrubbing;
+    std::chrono::steady_clock::time_point m_openedAt;
+    bool m_firstFrameShown;
+
+    cv::Mat m_presentFrame;     // Đổi chỗ với bộ đệm của engine, dùng lại giữa các khung
+    cv::Mat m_scaledFrame;      // Bộ đệm phụ khi không ghi thẳng được vào bitmap
+    long long m_presentedFrames;
+    long long m_totalPresentUs;
 
     wxButton* CreateStyledButton(wxWindow* parent, const wxString& label, const wxSize& size) {
         wxButton* button = new wxButton(parent, wxID_ANY, label, wxDefaultPosition, size);
@@ -261,20 +435,29 @@ private:
         return button;
     }
 
-    void InitializeVideoCapture() {
-        m_capture.open(m_tempVideoFile.ToStdString());
-        if (!m_capture.isOpened()) {
-            wxMessageBox("Failed to open video file", "Error", wxOK | wxICON_ERROR);
-        }
-    }
-
     void OnPanelResize(wxSizeEvent& event) {
         m_videoPanel->Refresh(false);
         event.Skip();
     }
 
-    void UpdateFrame(cv::Mat& frame) {
-        std::lock_guard<std::mutex> lock(m_mutex);
+    // wxTimer trên UI thread: engine quyết định khung nào đến hạn, khung trễ đã bị bỏ ở đó
+    void OnFrameTimer(wxTimerEvent& event) {
+        long frameIndex;
+        if (m_engine.acquireFrame(m_presentFrame, frameIndex) && !m_presentFrame.empty()) {
+            UpdateFrame(m_presentFrame);
+            if (!m_scrubbing) {
+                m_seekSlider->SetValue(static_cast<int>(frameIndex));
+            }
+        }
+
+        // Engine tự dừng khi hết video (không lặp)
+        if (!m_engine.isPlaying() && m_playPauseButton->GetLabel() == "Pause") {
+            m_playPauseButton->SetLabel("Play");
+        }
+    }
+
+    void UpdateFrame(const cv::Mat& frame) {
+        auto startTime = std::chrono::steady_clock::now();
 
         // Lấy kích thước panel
         int panelWidth = m_videoPanel->GetSize().GetWidth();
@@ -288,41 +471,60 @@ private:
         // Tính kích thước mới giữ nguyên tỷ lệ
         int newWidth = static_cast<int>(frame.cols * scale);
         int newHeight = static_cast<int>(frame.rows * scale);
+        if (newWidth <= 0 || newHeight <= 0) return;
 
-        // Tạo frame mới với kích thước đã tính
-        cv::Mat scaledFrame;
-        cv::resize(frame, scaledFrame, cv::Size(newWidth, newHeight), 0, 0, cv::INTER_LINEAR);
-        cv::cvtColor(scaledFrame, scaledFrame, cv::COLOR_BGR2RGB);
-
-        // Tạo hoặc cập nhật bitmap
+        // Tạo hoặc cập nhật bitmap (chỉ khi đổi kích thước)
         if (!m_bitmap || m_bitmap->GetWidth() != newWidth || m_bitmap->GetHeight() != newHeight) {
             if (m_bitmap) delete m_bitmap;
             m_bitmap = new wxBitmap(newWidth, newHeight, 24);
         }
 
-        // Copy dữ liệu frame vào bitmap
         wxNativePixelData data(*m_bitmap);
-        if (data) {
-            wxNativePixelData::Iterator p(data);
-            for (int y = 0; y < scaledFrame.rows; y++) {
-                wxNativePixelData::Iterator rowStart = p;
-                for (int x = 0; x < scaledFrame.cols; x++) {
-                    p.Red() = scaledFrame.at<cv::Vec3b>(y, x)[0];
-                    p.Green() = scaledFrame.at<cv::Vec3b>(y, x)[1];
-                    p.Blue() = scaledFrame.at<cv::Vec3b>(y, x)[2];
-                    ++p;
-                }
-                p = rowStart;
-                p.OffsetY(data, 1);
+        if (!data) return;
+
+        // Bọc bộ nhớ của bitmap bằng cv::Mat để cv::resize (đã vector hóa) ghi thẳng vào,
+        // không qua ảnh trung gian và không copy từng pixel. Với DIB 24-bit trên Windows,
+        // thứ tự byte là BGR giống OpenCV nên không cần cvtColor.
+        uchar* pixels = reinterpret_cast<uchar*>(data.GetPixels().m_ptr);
+        int stride = data.GetRowStride();
+        const bool nativeIsBgr = wxNativePixelFormat::BLUE < wxNativePixelFormat::RED;
+        const cv::Size targetSize(newWidth, newHeight);
+
+        if (stride > 0 && nativeIsBgr) {
+            cv::Mat target(targetSize, CV_8UC3, pixels, static_cast<size_t>(stride));
+            cv::resize(frame, target, targetSize, 0, 0, cv::INTER_LINEAR);
+        }
+        else {
+            // Bitmap lưu từ dưới lên (stride âm) hoặc định dạng RGB: resize vào bộ đệm
+            // dùng lại giữa các khung rồi chép từng hàng
+            cv::resize(frame, m_scaledFrame, targetSize, 0, 0, cv::INTER_LINEAR);
+            if (!nativeIsBgr) {
+                cv::cvtColor(m_scaledFrame, m_scaledFrame, cv::COLOR_BGR2RGB);
+            }
+            const size_t rowBytes = static_cast<size_t>(newWidth) * 3;
+            for (int y = 0; y < newHeight; y++) {
+                memcpy(pixels + static_cast<ptrdiff_t>(y) * stride, m_scaledFrame.ptr(y), rowBytes);
             }
         }
 
         m_videoPanel->Refresh(false);
+
+        auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+        m_presentedFrames++;
+        m_totalPresentUs += elapsedUs;
+
+        if (!m_firstFrameShown) {
+            m_firstFrameShown = true;
+            auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - m_openedAt).count();
+            std::cout << "[INFO] Video preview: first frame after " << elapsedMs << " ms" << std::endl;
+        }
     }
 
     void OnPaintVideo(wxPaintEvent& evt) {
+        // m_bitmap chỉ được đọc/ghi trên UI thread nên không cần khóa
         wxPaintDC dc(m_videoPanel);
-        std::lock_guard<std::mutex> lock(m_mutex);
 
         // Clear background
         dc.SetBackground(wxBrush(wxColour(0, 0, 0)));
@@ -337,18 +539,33 @@ private:
     }
 
     void OnPlayPause(wxCommandEvent& event) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_isPlaying = !m_isPlaying;
-        m_playPauseButton->SetLabel(m_isPlaying ? "Pause" : "Play");
+        if (m_engine.isPlaying()) {
+            m_engine.pause();
+            m_playPauseButton->SetLabel("Play");
+        }
+        else {
+            m_engine.play();
+            m_playPauseButton->SetLabel("Pause");
+        }
     }
 
     void OnRestart(wxCommandEvent& event) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_capture.set(cv::CAP_PROP_POS_FRAMES, 0);
-        m_isPlaying = true;
+        m_engine.seek(0);
+        m_engine.play();
         m_playPauseButton->SetLabel("Pause");
     }
 
+    // Kéo thanh tua: mỗi vị trí là một yêu cầu seek, thread giải mã chỉ xử lý yêu cầu mới nhất
+    void OnScrub(wxScrollEvent& event) {
+        m_scrubbing = true;
+        m_engine.seek(event.GetPosition());
+    }
+
+    void OnScrubEnd(wxScrollEvent& event) {
+        m_scrubbing = false;
+        m_engine.seek(event.GetPosition());
+    }
+
     void OnClose(wxCommandEvent& event) {
         Close();
     }
@@ -359,51 +576,7 @@ private:
     }
 
     void StopVideo() {
-        m_shouldExit = true;
-        m_isPlaying = false;
-    }
-
-    void VideoLoop() {
-        cv::Mat frame;
-        double fps = m_capture.get(cv::CAP_PROP_FPS);
-        if (fps <= 0) fps = 30.0;
-
-        const int frameDelay = static_cast<int>(1000.0 / fps);
-
-        while (!m_shouldExit) {
-            if (m_isPlaying) {
-                auto startTime = std::chrono::steady_clock::now();
-
-                bool frameRead;
-                {
-                    std::lock_guard<std::mutex> lock(m_mutex);
-                    frameRead = m_capture.read(frame);
-                    if (!frameRead) {
-                        m_capture.set(cv::CAP_PROP_POS_FRAMES, 0);
-                        continue;
-                    }
-                }
-
-                if (!frame.empty()) {
-                    CallAfter([this, frame]() mutable {
-                        if (!m_shouldExit) {
-                            UpdateFrame(frame);
-                        }
-                        });
-
-                    auto endTime = std::chrono::steady_clock::now();
-                    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>
-                        (endTime - startTime).count();
-
-                    if (elapsedMs < frameDelay) {
-                        std::this_thread::sleep_for(
-                            std::chrono::milliseconds(frameDelay - elapsedMs));
-                    }
-                }
-            }
-            else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            }
-        }
+        m_frameTimer.Stop();
+        m_engine.close();
     }
 };
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "HistoryStore.h"
+#include "AppData.h"
+#include <iostream>
+#include <bcrypt.h>
+
+#pragma comment(lib, "bcrypt.lib")
+
+MappedBlob::MappedBlob(const std::string& path)
+    : file(INVALID_HANDLE_VALUE), mapping(NULL), view(nullptr), size(0), opened(false)
+{
+    // FILE_SHARE_DELETE: object vẫn xóa được khi dialog còn mở, file biến mất khi đóng handle cuối
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Cannot open history object: " << path << std::endl;
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        return;
+    }
+    size = (size_t)fileSize.QuadPart;
+    if (size == 0) {
+        opened = true;  // Không ánh xạ được file rỗng, data() trả về nullptr
+        return;
+    }
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    opened = view != nullptr;
+    if (!opened) {
+        std::cerr << "Cannot map history object: " << path << " Error code: " << GetLastError() << std::endl;
+    }
+}
+
+MappedBlob::~MappedBlob() {
+    if (view) UnmapViewOfFile(view);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+HistoryStore::HistoryStore(const std::string& directory, Retention retention)
+    : retention(retention), lockFile(INVALID_HANDLE_VALUE), bytesStored(0), tempCounter(0)
+{
+    std::string storeDir = AppData::directory(directory);
+    if (storeDir.empty()) {
+        return;
+    }
+
+    // Không chia sẻ: server thứ hai mở cùng thư mục sẽ thất bại ở đây thay vì xóa object của server đầu
+    lockFile = CreateFileA((storeDir + "\\store.lock").c_str(), GENERIC_WRITE, 0, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (lockFile == INVALID_HANDLE_VALUE) {
+        std::cerr << "History store " << storeDir << " is in use by another process, history is not kept" << std::endl;
+        return;
+    }
+    objectDir = AppData::directory(directory + "\\objects");
+    if (objectDir.empty()) {
+        return;
+    }
+
+    // Chỉ mục nằm trong RAM nên object của lần chạy trước không còn ai tham chiếu
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA((objectDir + "\\*").c_str(), &findData);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                DeleteFileA((objectDir + "\\" + findData.cFileName).c_str());
+            }
+        } while (FindNextFileA(find, &findData));
+        FindClose(find);
+    }
+}
+
+HistoryStore::~HistoryStore() {
+    if (lockFile != INVALID_HANDLE_VALUE) CloseHandle(lockFile);
+}
+
+std::string HistoryStore::hashContent(const void* data, size_t size) {
+    BCRYPT_ALG_HANDLE algorithm = NULL;
+    UCHAR digest[32];
+
+    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&algorithm, BCRYPT_SHA256_ALGORITHM, NULL, 0))) {
+        return "";
+    }
+    NTSTATUS status = BCryptHash(algorithm, NULL, 0, (PUCHAR)data, (ULONG)size, digest, sizeof(digest));
+    BCryptCloseAlgorithmProvider(algorithm, 0);
+    if (!BCRYPT_SUCCESS(status)) {
+        return "";
+    }
+
+    static const char HEX[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(sizeof(digest) * 2);
+    for (UCHAR byte : digest) {
+        hex += HEX[byte >> 4];
+        hex += HEX[byte & 0x0F];
+    }
+    return hex;
+}
+
+const char* HistoryStore::extensionFor(BlobKind kind) {
+    switch (kind) {
+    case BlobKind::Text: return ".txt";
+    case BlobKind::Image: return ".png";
+    case BlobKind::Video: return ".avi";
+    default: return ".bin";
+    }
+}
+
+std::string HistoryStore::pathFor(const BlobRef& ref) const {
+    return objectDir + "\\" + ref.hash + extensionFor(ref.kind);
+}
+
+BlobRef HistoryStore::put(BlobKind kind, const void* data, size_t size) {
+    BlobRef ref;
+    if (objectDir.empty() || kind == BlobKind::None) {
+        return ref;
+    }
+
+    // Băm ngoài khóa: đây là phần tốn CPU
+    std::string hash = hashContent(data, size);
+    if (hash.empty()) {
+        std::cerr << "Cannot hash history object" << std::endl;
+        return ref;
+    }
+
+    ref.hash = hash;
+    ref.size = size;
+    ref.kind = kind;
+    std::string key = hash + extensionFor(kind);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    int& count = refCounts[key];
+    if (count > 0) {
+        count++;    // Đã có cùng nội dung: không ghi lại
+        return ref;
+    }
+
+    // Ghi ra file tạm rồi đổi tên, để không bao giờ đọc phải object ghi dở
+    std::string path = pathFor(ref);
+    std::string tempPath = path + ".tmp" + std::to_string(++tempCounter);
+    HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Cannot create history object: " << tempPath << std::endl;
+        refCounts.erase(key);
+        return BlobRef();
+    }
+
+    const BYTE* bytes = static_cast<const BYTE*>(data);
+    size_t written = 0;
+    bool ok = true;
+    while (written < size) {
+        DWORD chunk = (DWORD)((size - written) < 0x40000000 ? (size - written) : 0x40000000);
+        DWORD done = 0;
+        if (!WriteFile(file, bytes + written, chunk, &done, NULL) || done == 0) {
+            ok = false;
+            break;
+        }
+        written += done;
+    }
+    CloseHandle(file);
+
+    if (!ok || !MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        std::cerr << "Cannot write history object: " << path << std::endl;
+        DeleteFileA(tempPath.c_str());
+        refCounts.erase(key);
+        return BlobRef();
+    }
+
+    count = 1;
+    bytesStored += size;
+    return ref;
+}
+
+std::shared_ptr<MappedBlob> HistoryStore::open(const BlobRef& ref) {
+    if (ref.empty()) return nullptr;
+
+    std::shared_ptr<MappedBlob> blob = std::make_shared<MappedBlob>(pathFor(ref));
+    return blob->isOpen() ? blob : nullptr;
+}
+
+void HistoryStore::release(const BlobRef& ref) {
+    if (ref.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = refCounts.find(ref.hash + extensionFor(ref.kind));
+    if (it == refCounts.end()) return;
+
+    if (--it->second <= 0) {
+        refCounts.erase(it);
+        bytesStored -= ref.size;
+        DeleteFileA(pathFor(ref).c_str());
+    }
+}
+
+bool HistoryStore::overBudget(size_t entryCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entryCount > retention.maxEntries || bytesStored > retention.maxBytes;
+}
+
+unsigned long long HistoryStore::totalBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesStored;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <string>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <windows.h>
+
+// Loại nội dung kết quả của một lệnh trong lịch sử
+enum class BlobKind {
+    None,
+    Text,
+    Image,
+    Video
+};
+
+// Tham chiếu tới một object trong HistoryStore; LogEntry chỉ giữ phần này
+struct BlobRef {
+    std::string hash;           // SHA-256 dạng hex, cũng là tên file
+    unsigned long long size;
+    BlobKind kind;
+
+    BlobRef() : size(0), kind(BlobKind::None) {}
+    bool empty() const { return hash.empty(); }
+};
+
+// Vùng nhớ ánh xạ (mmap) của một object, chỉ đọc
+class MappedBlob {
+public:
+    explicit MappedBlob(const std::string& path);
+    ~MappedBlob();
+    MappedBlob(const MappedBlob&) = delete;
+    MappedBlob& operator=(const MappedBlob&) = delete;
+
+    bool isOpen() const { return opened; }
+    const BYTE* data() const { return static_cast<const BYTE*>(view); }
+    size_t length() const { return size; }
+
+private:
+    HANDLE file;
+    HANDLE mapping;
+    void* view;
+    size_t size;
+    bool opened;
+};
+
+// Lưu nội dung kết quả (text, ảnh, video) ra file theo hash nội dung, ghi một lần rồi
+// chỉ đọc qua mmap. Lịch sử trong RAM chỉ giữ metadata nên không phình theo số lệnh.
+// Object được đếm tham chiếu: nội dung trùng (ví dụ help::cmd) chỉ lưu một bản.
+// Mỗi store có thư mục riêng và khóa nó trong suốt thời gian chạy, vì lúc khởi động store xóa
+// mọi object cũ và release() xóa theo hash: hai server dùng chung thư mục sẽ xóa object của nhau.
+class HistoryStore {
+public:
+    struct Retention {
+        size_t maxEntries;
+        unsigned long long maxBytes;
+    };
+
+    static const size_t DEFAULT_MAX_ENTRIES = 1000;
+    static const unsigned long long DEFAULT_MAX_BYTES = 512ULL * 1024 * 1024;
+
+    // directory: thư mục con trong %APPDATA%\EmailPCControl, object nằm trong <directory>\objects.
+    // Thư mục đang bị process khác giữ thì store không lưu gì (put() trả về BlobRef rỗng)
+    explicit HistoryStore(const std::string& directory,
+        Retention retention = Retention{ DEFAULT_MAX_ENTRIES, DEFAULT_MAX_BYTES });
+    ~HistoryStore();
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // An toàn khi gọi từ nhiều thread
+    BlobRef put(BlobKind kind, const void* data, size_t size);
+    std::shared_ptr<MappedBlob> open(const BlobRef& ref);
+    void release(const BlobRef& ref);
+
+    std::string pathFor(const BlobRef& ref) const;
+    bool overBudget(size_t entryCount);
+    unsigned long long totalBytes();
+
+private:
+    static std::string hashContent(const void* data, size_t size);
+    static const char* extensionFor(BlobKind kind);
+
+    Retention retention;
+    HANDLE lockFile;
+    std::string objectDir;
+    std::unordered_map<std::string, int> refCounts;
+    unsigned long long bytesStored;
+    unsigned long tempCounter;
+    std::mutex mutex;
+};
+
+// Cache LRU kích thước cố định, dùng cho ảnh đã giải mã/thu nhỏ để hiển thị lại nhanh
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity(capacity) {}
+
+    bool get(const Key& key, Value& value) {
+        auto it = index.find(key);
+        if (it == index.end()) return false;
+        items.splice(items.begin(), items, it->second);
+        value = it->second->second;
+        return true;
+    }
+
+    void put(const Key& key, const Value& value) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = value;
+            items.splice(items.begin(), items, it->second);
+            return;
+        }
+
+        items.emplace_front(key, value);
+        index[key] = items.begin();
+        if (items.size() > capacity) {
+            index.erase(items.back().first);
+            items.pop_back();
+        }
+    }
+
+    void erase(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        items.erase(it->second);
+        index.erase(it);
+    }
+
+    void clear() {
+        items.clear();
+        index.clear();
+    }
+
+private:
+    size_t capacity;
+    std::list<std::pair<Key, Value>> items;
+    std::map<Key, typename std::list<std::pair<Key, Value>>::iterator> index;
+};
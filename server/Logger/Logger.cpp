@@ -0,0 +1,200 @@
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+LogRing::LogRing(size_t capacity) {
+    // Dung lượng phải là lũy thừa của 2 để dùng mask thay cho phép chia
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+}
+
+bool LogRing::tryPush(LogSeverity severity, bool fromClient, const std::string& message, long long timestampMs) {
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;   // Đầy
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& record = cell->record;
+    record.timestampMs = timestampMs;
+    record.severity = severity;
+    record.fromClient = fromClient;
+    size_t length = message.size();
+    if (length <= LogRecord::MESSAGE_SIZE) {
+        memcpy(record.message, message.data(), length);
+    }
+    else {
+        // Lùi điểm cắt về đầu một ký tự UTF-8 (bỏ các byte 10xxxxxx) để không cắt đôi chữ có dấu
+        size_t cut = LogRecord::MESSAGE_SIZE - 3;
+        while (cut > 0 && ((uint8_t)message[cut] & 0xC0) == 0x80) cut--;
+        memcpy(record.message, message.data(), cut);
+        memcpy(record.message + cut, "...", 3);
+        length = cut + 3;
+    }
+    record.length = (uint16_t)length;
+
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::tryPop(LogRecord& record) {
+    Cell* cell = &cells[dequeuePos & mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if ((intptr_t)sequence - (intptr_t)(dequeuePos + 1) < 0) {
+        return false;   // Rỗng hoặc producer chưa ghi xong ô này
+    }
+
+    record.timestampMs = cell->record.timestampMs;
+    record.severity = cell->record.severity;
+    record.fromClient = cell->record.fromClient;
+    record.length = cell->record.length;
+    memcpy(record.message, cell->record.message, record.length);
+
+    cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+JsonlFileSink::JsonlFileSink(const std::string& path, size_t maxBytes, int maxFiles)
+    : path(path), maxBytes(maxBytes), maxFiles(maxFiles), currentBytes(0)
+{
+    file.open(path, std::ios::app | std::ios::binary);
+    if (file.is_open()) {
+        file.seekp(0, std::ios::end);
+        currentBytes = (size_t)file.tellp();
+    }
+}
+
+void JsonlFileSink::write(const std::vector<LogRecord>& records) {
+    if (!file.is_open()) return;
+
+    for (const LogRecord& record : records) {
+        std::string line = "{\"ts\":" + std::to_string(record.timestampMs) +
+            ",\"severity\":\"" + severityName(record.severity) +
+            "\",\"source\":\"" + (record.fromClient ? "client" : "server") +
+            "\",\"message\":\"" + escapeJson(record.message, record.length) + "\"}\n";
+
+        if (currentBytes + line.size() > maxBytes) {
+            rotate();
+            if (!file.is_open()) return;
+        }
+        file.write(line.data(), line.size());
+        currentBytes += line.size();
+    }
+    file.flush();
+}
+
+void JsonlFileSink::rotate() {
+    file.close();
+
+    // server.jsonl -> server.jsonl.1 -> server.jsonl.2 ..., file cũ nhất bị xóa
+    std::remove((path + "." + std::to_string(maxFiles - 1)).c_str());
+    for (int i = maxFiles - 2; i >= 1; i--) {
+        std::rename((path + "." + std::to_string(i)).c_str(), (path + "." + std::to_string(i + 1)).c_str());
+    }
+    if (maxFiles > 1) {
+        std::rename(path.c_str(), (path + ".1").c_str());
+    }
+    else {
+        std::remove(path.c_str());
+    }
+
+    file.open(path, std::ios::trunc | std::ios::binary);
+    currentBytes = 0;
+}
+
+const char* JsonlFileSink::severityName(LogSeverity severity) {
+    switch (severity) {
+    case LogSeverity::Success: return "success";
+    case LogSeverity::Command: return "command";
+    case LogSeverity::Warning: return "warning";
+    case LogSeverity::Error: return "error";
+    default: return "info";
+    }
+}
+
+std::string JsonlFileSink::escapeJson(const char* text, size_t length) {
+    std::string escaped;
+    escaped.reserve(length + 8);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                escaped += buffer;
+            }
+            else {
+                escaped += (char)c;
+            }
+        }
+    }
+    return escaped;
+}
+
+Logger::Logger(size_t capacity) : ring(capacity), dropped(0) {
+}
+
+void Logger::log(LogSeverity severity, bool fromClient, const std::string& message) {
+    long long timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (!ring.tryPush(severity, fromClient, message, timestampMs)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t Logger::drain(std::vector<LogRecord>& records, size_t maxRecords) {
+    records.clear();
+    LogRecord record;
+    while (records.size() < maxRecords && ring.tryPop(record)) {
+        records.push_back(record);
+    }
+
+    if (fileSink && !records.empty()) {
+        fileSink->write(records);
+    }
+    return records.size();
+}
+
+void Logger::setFileSink(std::unique_ptr<JsonlFileSink> sink) {
+    fileSink = std::move(sink);
+}
+
+const char* Logger::severityLabel(LogSeverity severity) {
+    switch (severity) {
+    case LogSeverity::Success: return "SUCCESS";
+    case LogSeverity::Command: return "COMMAND";
+    case LogSeverity::Warning: return "WARNING";
+    case LogSeverity::Error: return "ERROR";
+    default: return "INFO";
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+enum class LogSeverity : uint8_t {
+    Info,
+    Success,
+    Command,
+    Warning,
+    Error
+};
+
+// Bản ghi kích thước cố định để producer không cấp phát khi ghi log
+struct LogRecord {
+    static const size_t MESSAGE_SIZE = 1000;
+
+    long long timestampMs;      // Unix time, mili giây
+    LogSeverity severity;
+    bool fromClient;
+    uint16_t length;
+    char message[MESSAGE_SIZE];
+
+    std::string text() const { return std::string(message, length); }
+};
+
+// Hàng đợi vòng nhiều producer - một consumer, không khóa (thuật toán của Vyukov).
+// Khi đầy, bản ghi mới bị bỏ và được đếm lại thay vì chặn thread đang chạy lệnh.
+class LogRing {
+public:
+    explicit LogRing(size_t capacity);
+
+    bool tryPush(LogSeverity severity, bool fromClient, const std::string& message, long long timestampMs);
+    // Chỉ được gọi từ một thread consumer
+    bool tryPop(LogRecord& record);
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;
+};
+
+// Ghi log ra file JSONL, xoay vòng khi file vượt quá kích thước cho phép
+class JsonlFileSink {
+public:
+    JsonlFileSink(const std::string& path, size_t maxBytes = 5 * 1024 * 1024, int maxFiles = 3);
+
+    void write(const std::vector<LogRecord>& records);
+
+private:
+    void rotate();
+    static const char* severityName(LogSeverity severity);
+    static std::string escapeJson(const char* text, size_t length);
+
+    std::string path;
+    size_t maxBytes;
+    int maxFiles;
+    size_t currentBytes;
+    std::ofstream file;
+};
+
+class Logger {
+public:
+    explicit Logger(size_t capacity = 4096);
+
+    // An toàn khi gọi từ nhiều thread
+    void log(LogSeverity severity, bool fromClient, const std::string& message);
+
+    // Consumer: lấy tối đa maxRecords bản ghi và ghi chúng ra file sink (nếu có)
+    size_t drain(std::vector<LogRecord>& records, size_t maxRecords);
+
+    void setFileSink(std::unique_ptr<JsonlFileSink> sink);
+    long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    static const char* severityLabel(LogSeverity severity);
+
+private:
+    LogRing ring;
+    std::unique_ptr<JsonlFileSink> fileSink;
+    std::atomic<long long> dropped;
+};
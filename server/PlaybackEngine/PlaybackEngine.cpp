@@ -0,0 +1,276 @@
+#include "PlaybackEngine.h"
+#include <chrono>
+#include <cmath>
+
+PlaybackEngine::PlaybackEngine(size_t capacity, Clock clock)
+    : clock(clock), fps(30.0), frameCount(0), looping(true), stopping(false),
+    slots(capacity < 2 ? 2 : capacity), head(0), count(0), generation(0),
+    seekRequested(false), seekTarget(0), endOfStream(false), lastDecodedIndex(-1),
+    playing(false), mediaBaseMs(0), wallBaseMs(0), presentedIndex(-1),
+    depthSamples(0), depthTotal(0), latenessSamples(0), latenessTotal(0),
+    jitterSamples(0), jitterTotal(0),
+    lastLatenessMs(0), hasLastLateness(false)
+{
+    stats = PlaybackStats{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+}
+
+PlaybackEngine::~PlaybackEngine() {
+    close();
+}
+
+double PlaybackEngine::now() const {
+    if (clock) return clock();
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool PlaybackEngine::open(const std::string& path) {
+    close();
+
+    if (!capture.open(path)) {
+        return false;
+    }
+
+    fps = capture.get(cv::CAP_PROP_FPS);
+    if (fps <= 0) fps = 30.0;
+    frameCount = static_cast<long>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        head = 0;
+        count = 0;
+        endOfStream = false;
+        lastDecodedIndex = -1;
+        presentedIndex = -1;
+        playing = false;
+        mediaBaseMs = 0;
+        wallBaseMs = now();
+    }
+
+    decodeThread = std::thread(&PlaybackEngine::decodeLoop, this);
+    return true;
+}
+
+void PlaybackEngine::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    decodeCv.notify_all();
+    if (decodeThread.joinable()) {
+        decodeThread.join();
+    }
+    capture.release();
+}
+
+void PlaybackEngine::play() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (playing) return;
+    playing = true;
+    wallBaseMs = now();
+    hasLastLateness = false;
+}
+
+void PlaybackEngine::pause() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!playing) return;
+    mediaBaseMs = mediaTimeLocked();
+    playing = false;
+}
+
+bool PlaybackEngine::isPlaying() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return playing;
+}
+
+void PlaybackEngine::setLooping(bool loop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    looping = loop;
+}
+
+void PlaybackEngine::seek(long frameIndex) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        seekLocked(frameIndex);
+    }
+    decodeCv.notify_all();
+}
+
+long PlaybackEngine::getPosition() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return presentedIndex;
+}
+
+double PlaybackEngine::mediaTimeLocked() const {
+    return playing ? mediaBaseMs + (now() - wallBaseMs) : mediaBaseMs;
+}
+
+void PlaybackEngine::seekLocked(long frameIndex) {
+    if (frameIndex < 0) frameIndex = 0;
+    if (frameCount > 0 && frameIndex >= frameCount) frameIndex = frameCount - 1;
+
+    // Bỏ toàn bộ khung đã đọc trước; khung đang giải mã dở sẽ bị loại nhờ generation
+    head = 0;
+    count = 0;
+    generation++;
+    seekRequested = true;
+    seekTarget = frameIndex;
+    endOfStream = false;
+
+    mediaBaseMs = frameIndex * 1000.0 / fps;
+    wallBaseMs = now();
+    presentedIndex = -1;
+    hasLastLateness = false;
+}
+
+void PlaybackEngine::popFront() {
+    head = (head + 1) % slots.size();
+    count--;
+}
+
+bool PlaybackEngine::acquireFrame(cv::Mat& frame, long& frameIndex) {
+    bool notifyDecoder = false;
+    bool acquired = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        depthSamples++;
+        depthTotal += count;
+
+        double mediaMs = mediaTimeLocked();
+        // Khung i đến hạn khi mediaTime >= i / fps (cộng sai số nhỏ cho phép tính dấu phẩy động)
+        long dueIndex = static_cast<long>(std::floor(mediaMs * fps / 1000.0 + 1e-6));
+
+        while (count > 0) {
+            Slot& front = slots[head];
+            if (front.index > dueIndex) break;
+
+            // Khung kế tiếp cũng đã đến hạn: khung này đã lỡ thời điểm, bỏ qua
+            if (count > 1 && slots[(head + 1) % slots.size()].index <= dueIndex) {
+                stats.dropped++;
+                popFront();
+                notifyDecoder = true;
+                continue;
+            }
+
+            cv::swap(frame, front.frame);
+            frameIndex = front.index;
+            presentedIndex = front.index;
+            popFront();
+            notifyDecoder = true;
+            acquired = true;
+            break;
+        }
+
+        if (acquired) {
+            // Trễ so với thời điểm khung đáng lẽ được hiện (chỉ có ý nghĩa khi đang phát)
+            if (playing) {
+                double latenessMs = mediaMs - frameIndex * 1000.0 / fps;
+                if (latenessMs < 0) latenessMs = 0;
+                latenessSamples++;
+                latenessTotal += latenessMs;
+                if (latenessMs > stats.maxLatenessMs) stats.maxLatenessMs = latenessMs;
+
+                if (hasLastLateness) {
+                    double jitterMs = std::fabs(latenessMs - lastLatenessMs);
+                    jitterSamples++;
+                    jitterTotal += jitterMs;
+                    if (jitterMs > stats.maxJitterMs) stats.maxJitterMs = jitterMs;
+                }
+                lastLatenessMs = latenessMs;
+                hasLastLateness = true;
+            }
+            stats.presented++;
+        }
+        else if (count == 0 && endOfStream && dueIndex > lastDecodedIndex) {
+            // Đã hiện hết khung cuối
+            if (looping && playing) {
+                seekLocked(0);
+                notifyDecoder = true;
+            }
+            else if (playing) {
+                mediaBaseMs = (lastDecodedIndex < 0 ? 0 : lastDecodedIndex) * 1000.0 / fps;
+                playing = false;
+            }
+        }
+    }
+
+    if (notifyDecoder) {
+        decodeCv.notify_all();
+    }
+    return acquired;
+}
+
+long PlaybackEngine::seekCapture(long target) {
+    capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(target));
+    long position = static_cast<long>(capture.get(cv::CAP_PROP_POS_FRAMES));
+
+    // Một số backend chỉ seek được tới keyframe hoặc vượt quá đích: quay về đầu rồi đọc bỏ
+    if (position < 0 || position > target) {
+        capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+        position = 0;
+    }
+    while (position < target && capture.grab()) {
+        position++;
+    }
+    return position;
+}
+
+void PlaybackEngine::decodeLoop() {
+    cv::Mat scratch;
+    long nextIndex = 0;
+
+    while (true) {
+        long target = -1;
+        unsigned long decodeGeneration;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decodeCv.wait(lock, [this]() {
+                return stopping || seekRequested || (!endOfStream && count < slots.size());
+                });
+            if (stopping) break;
+
+            if (seekRequested) {
+                target = seekTarget;
+                seekRequested = false;
+            }
+            decodeGeneration = generation;
+        }
+
+        if (target >= 0) {
+            nextIndex = seekCapture(target);
+        }
+
+        // Giải mã ngoài khóa để UI thread không phải chờ
+        bool frameRead = capture.read(scratch);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (decodeGeneration != generation) {
+            continue;   // Có seek mới trong lúc giải mã: khung này thuộc vị trí cũ
+        }
+        if (!frameRead || scratch.empty()) {
+            endOfStream = true;
+            continue;
+        }
+
+        Slot& slot = slots[(head + count) % slots.size()];
+        cv::swap(slot.frame, scratch);  // scratch nhận lại bộ đệm cũ để read() dùng lại
+        slot.index = nextIndex;
+        lastDecodedIndex = nextIndex;
+        nextIndex++;
+        count++;
+        stats.decoded++;
+        if (count > stats.maxQueueDepth) stats.maxQueueDepth = count;
+    }
+}
+
+PlaybackStats PlaybackEngine::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    PlaybackStats result = stats;
+    result.queueDepth = count;
+    result.avgQueueDepth = depthSamples > 0 ? depthTotal / depthSamples : 0;
+    result.avgLatenessMs = latenessSamples > 0 ? latenessTotal / latenessSamples : 0;
+    result.avgJitterMs = jitterSamples > 0 ? jitterTotal / jitterSamples : 0;
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+struct PlaybackStats {
+    long long decoded;
+    long long presented;
+    long long dropped;          // Khung đã giải mã nhưng quá hạn nên bỏ qua
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    double avgQueueDepth;       // Lấy mẫu mỗi lần acquireFrame
+    double avgLatenessMs;       // Trễ so với thời điểm khung đáng lẽ được hiện
+    double maxLatenessMs;
+    double avgJitterMs;         // Chênh lệch độ trễ giữa hai khung liên tiếp
+    double maxJitterMs;
+};
+
+// Phát video không phụ thuộc UI: thread giải mã đọc trước vào vòng đệm có giới hạn,
+// đồng hồ trình chiếu quyết định khung nào được hiện, khung trễ bị bỏ.
+// Seek được thực hiện trên thread giải mã và chính xác tới từng khung.
+// UI chỉ cần gọi acquireFrame() định kỳ (ví dụ từ wxTimer).
+class PlaybackEngine {
+public:
+    // Trả về thời gian đơn điệu tính bằng mili giây; thay được để chạy thử không cần đồng hồ thật
+    using Clock = std::function<double()>;
+
+    static const size_t DEFAULT_CAPACITY = 8;
+
+    explicit PlaybackEngine(size_t capacity = DEFAULT_CAPACITY, Clock clock = nullptr);
+    ~PlaybackEngine();
+    PlaybackEngine(const PlaybackEngine&) = delete;
+    PlaybackEngine& operator=(const PlaybackEngine&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    void play();
+    void pause();
+    bool isPlaying();
+    void setLooping(bool loop);
+
+    // Nhảy tới khung frameIndex; khung đó được hiện ngay cả khi đang tạm dừng
+    void seek(long frameIndex);
+
+    // Lấy khung đến hạn mới nhất (nếu có). frame được đổi chỗ với bộ đệm trong vòng
+    // nên bộ nhớ được dùng lại giữa các khung. Trả về false nếu chưa có khung mới.
+    bool acquireFrame(cv::Mat& frame, long& frameIndex);
+
+    double getFps() const { return fps; }
+    long getFrameCount() const { return frameCount; }
+    long getPosition();
+    PlaybackStats getStats();
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        long index;
+    };
+
+    void decodeLoop();
+    long seekCapture(long target);
+    double now() const;
+    double mediaTimeLocked() const;
+    void seekLocked(long frameIndex);
+    void popFront();
+
+    Clock clock;
+    cv::VideoCapture capture;   // Chỉ thread giải mã dùng sau khi open()
+    double fps;
+    long frameCount;
+    bool looping;
+
+    std::mutex mutex;
+    std::condition_variable decodeCv;
+    std::thread decodeThread;
+    bool stopping;
+
+    // Vòng đệm giải mã trước
+    std::vector<Slot> slots;
+    size_t head;
+    size_t count;
+    unsigned long generation;   // Tăng mỗi lần seek; khung của thế hệ cũ bị bỏ
+    bool seekRequested;
+    long seekTarget;
+    bool endOfStream;
+    long lastDecodedIndex;
+
+    // Đồng hồ trình chiếu: mediaTime = mediaBaseMs + (now - wallBaseMs) khi đang phát
+    bool playing;
+    double mediaBaseMs;
+    double wallBaseMs;
+    long presentedIndex;
+
+    PlaybackStats stats;
+    long long depthSamples;
+    double depthTotal;
+    long long latenessSamples;
+    double latenessTotal;
+    long long jitterSamples;
+    double jitterTotal;
+    double lastLatenessMs;
+    bool hasLastLateness;
+};
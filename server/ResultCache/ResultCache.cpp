@@ -0,0 +1,209 @@
+#include "ResultCache.h"
+#include <algorithm>
+#include <windows.h>
+#include <psapi.h>
+
+ResultCache::ResultCache() : nextFlightId(0) {
+    stats = Stats{ 0, 0, 0, 0, 0 };
+}
+
+std::chrono::milliseconds ResultCache::ttlFor(CommandId id) {
+    switch (id) {
+    case CommandId::ListApp: return std::chrono::milliseconds(2000);
+    case CommandId::ListProcess: return std::chrono::milliseconds(1000);
+    case CommandId::ListService: return std::chrono::milliseconds(3000);
+    case CommandId::HelpCmd: return std::chrono::hours(24);    // Chỉ đổi khi build lại server
+    default: return std::chrono::milliseconds(0);
+    }
+}
+
+std::string ResultCache::makeKey(const ParsedCommand& parsed) {
+    std::string key = parsed.spec->name;
+    if (!parsed.args.empty()) {
+        key += " ";
+        key += parsed.args;
+    }
+    return key;
+}
+
+ResultCache::Payload ResultCache::getOrCompute(const ParsedCommand& parsed,
+    const std::function<std::string()>& compute, bool& hit) {
+    auto startTime = std::chrono::steady_clock::now();
+    auto elapsedUs = [&startTime]() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    std::chrono::milliseconds ttl = ttlFor(parsed.spec->id);
+    if (ttl.count() == 0) {
+        hit = false;
+        return std::make_shared<const std::string>(compute());
+    }
+
+    std::string key = makeKey(parsed);
+    std::promise<Payload> promise;
+    std::shared_future<Payload> pending;
+    long flightId = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.expiresAt > startTime) {
+            hit = true;
+            stats.hits++;
+            stats.totalHitUs += elapsedUs();
+            return it->second.payload;
+        }
+
+        // Đã có request khác đang tính cùng lệnh: chờ kết quả đó thay vì tính lại
+        auto flight = inFlight.find(key);
+        if (flight != inFlight.end()) {
+            pending = flight->second.result;
+        }
+        else {
+            flightId = ++nextFlightId;
+            inFlight[key] = Flight{ flightId, promise.get_future().share() };
+        }
+    }
+
+    if (pending.valid()) {
+        Payload payload = pending.get();
+        std::lock_guard<std::mutex> lock(mutex);
+        hit = true;
+        stats.hits++;
+        stats.totalHitUs += elapsedUs();
+        return payload;
+    }
+
+    Payload payload;
+    try {
+        payload = std::make_shared<const std::string>(compute());
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto flight = inFlight.find(key);
+        if (flight != inFlight.end() && flight->second.id == flightId) {
+            inFlight.erase(flight);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // invalidate() trong lúc đang tính đã xóa inFlight: không lưu kết quả có thể đã cũ
+        auto flight = inFlight.find(key);
+        if (flight != inFlight.end() && flight->second.id == flightId) {
+            inFlight.erase(flight);
+            entries[key] = Entry{ payload, std::chrono::steady_clock::now() + ttl };
+        }
+        hit = false;
+        stats.misses++;
+        stats.totalMissUs += elapsedUs();
+    }
+    promise.set_value(payload);
+    return payload;
+}
+
+void ResultCache::invalidate(CommandId id) {
+    const CommandSpec* spec = nullptr;
+    for (const CommandSpec& candidate : COMMAND_TABLE) {
+        if (candidate.id == id) {
+            spec = &candidate;
+            break;
+        }
+    }
+    if (!spec) return;
+
+    std::string name = spec->name;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto matches = [&name](const std::string& key) {
+        return key.compare(0, name.size(), name) == 0 &&
+            (key.size() == name.size() || key[name.size()] == ' ');
+    };
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (matches(it->first)) {
+            it = entries.erase(it);
+            stats.invalidations++;
+        }
+        else {
+            ++it;
+        }
+    }
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        it = matches(it->first) ? inFlight.erase(it) : std::next(it);
+    }
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.invalidations += entries.size();
+    entries.clear();
+    inFlight.clear();
+}
+
+ResultCache::Stats ResultCache::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+ProcessWatcher::ProcessWatcher() : running(false) {
+}
+
+ProcessWatcher::~ProcessWatcher() {
+    stop();
+}
+
+void ProcessWatcher::start(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) return;
+    onChange = callback;
+    running = true;
+    worker = std::thread(&ProcessWatcher::run, this);
+}
+
+void ProcessWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+bool ProcessWatcher::snapshotPids(std::vector<unsigned long>& pids) {
+    // Mảng không đủ chỗ thì EnumProcesses trả về đúng bằng kích thước mảng: tăng rồi gọi lại
+    DWORD bytesReturned = 0;
+    do {
+        pids.resize(pids.empty() ? 1024 : pids.size() * 2);
+        if (!K32EnumProcesses(reinterpret_cast<DWORD*>(pids.data()), (DWORD)(pids.size() * sizeof(DWORD)), &bytesReturned)) {
+            return false;
+        }
+    } while (bytesReturned == pids.size() * sizeof(DWORD));
+
+    pids.resize(bytesReturned / sizeof(DWORD));
+    std::sort(pids.begin(), pids.end());
+    return true;
+}
+
+void ProcessWatcher::run() {
+    std::vector<unsigned long> previous, current;
+    bool haveSnapshot = snapshotPids(previous);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake.wait_for(lock, std::chrono::milliseconds(POLL_INTERVAL_MS), [this]() { return !running; });
+        if (!running) break;
+
+        lock.unlock();
+        if (snapshotPids(current)) {
+            if (haveSnapshot && current != previous) {
+                onChange();
+            }
+            previous.swap(current);
+            haveSnapshot = true;
+        }
+        lock.lock();
+    }
+}
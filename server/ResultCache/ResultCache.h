@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include "CommandRegistry.h"
+
+// Cache kết quả của các lệnh chỉ đọc (list::*, help::cmd) theo tên lệnh + tham số.
+// Kết quả được lưu sẵn dạng byte gửi đi, nhiều client trùng lệnh trong vài giây
+// dùng chung một lần tính. Các lệnh thay đổi trạng thái gọi invalidate().
+class ResultCache {
+public:
+    typedef std::shared_ptr<const std::string> Payload;
+
+    struct Stats {
+        long long hits;
+        long long misses;
+        long long invalidations;
+        long long totalHitUs;
+        long long totalMissUs;
+
+        double hitRate() const {
+            long long total = hits + misses;
+            return total == 0 ? 0.0 : (double)hits / total;
+        }
+    };
+
+    ResultCache();
+
+    // Thời gian sống của kết quả; 0 nghĩa là lệnh không được cache
+    static std::chrono::milliseconds ttlFor(CommandId id);
+
+    // Trả về kết quả còn hạn, hoặc gọi compute một lần cho mọi request trùng đang chờ
+    Payload getOrCompute(const ParsedCommand& parsed, const std::function<std::string()>& compute, bool& hit);
+
+    void invalidate(CommandId id);
+    void clear();
+    Stats getStats();
+
+private:
+    struct Entry {
+        Payload payload;
+        std::chrono::steady_clock::time_point expiresAt;
+    };
+
+    struct Flight {
+        long id;
+        std::shared_future<Payload> result;
+    };
+
+    static std::string makeKey(const ParsedCommand& parsed);
+
+    std::map<std::string, Entry> entries;
+    std::map<std::string, Flight> inFlight;
+    long nextFlightId;
+    std::mutex mutex;
+    Stats stats;
+};
+
+// Hook "process vừa start/stop" cho cache: process thoát hoặc được mở ngoài các lệnh app::/service::
+// không đi qua invalidate() của lệnh nào. Cứ POLL_INTERVAL_MS lấy danh sách PID bằng EnumProcesses
+// (vài chục µs, rẻ hơn nhiều so với snapshot + duyệt cửa sổ của list::*) và gọi onChange khi tập PID đổi.
+class ProcessWatcher {
+public:
+    static const int POLL_INTERVAL_MS = 250;
+
+    ProcessWatcher();
+    ~ProcessWatcher();
+
+    void start(std::function<void()> onChange);
+    void stop();
+
+private:
+    void run();
+    static bool snapshotPids(std::vector<unsigned long>& pids);
+
+    std::function<void()> onChange;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+};
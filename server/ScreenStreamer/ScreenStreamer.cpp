@@ -0,0 +1,487 @@
+#include "ScreenStreamer.h"
+#include "Metrics.h"
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include "SecureSocket.h"
+#endif
+
+using namespace ScreenStream;
+
+static Metrics::Counter& streamSentBytes() {
+    static Metrics::Counter& counter = Metrics::registry().counter(
+        "server_socket_sent_bytes_total", "Bytes sent to clients");
+    return counter;
+}
+
+#ifdef _WIN32
+GdiFrameSource::GdiFrameSource()
+    : memoryDC(NULL), dib(NULL), previousBitmap(NULL), bits(nullptr), surfaceWidth(0), surfaceHeight(0)
+{
+    screenDC = GetDC(nullptr);
+    if (screenDC) {
+        memoryDC = CreateCompatibleDC(screenDC);
+    }
+}
+
+GdiFrameSource::~GdiFrameSource() {
+    if (memoryDC && previousBitmap) SelectObject(memoryDC, previousBitmap);
+    if (dib) DeleteObject(dib);
+    if (memoryDC) DeleteDC(memoryDC);
+    if (screenDC) ReleaseDC(nullptr, screenDC);
+}
+
+bool GdiFrameSource::ensureSurface(int width, int height) {
+    if (dib && width == surfaceWidth && height == surfaceHeight) {
+        return true;
+    }
+
+    if (dib) {
+        SelectObject(memoryDC, previousBitmap);
+        DeleteObject(dib);
+        dib = NULL;
+    }
+
+    // DIB 32 bit top-down: hàng đầu tiên là hàng trên cùng, stride = width * 4
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = width;
+    info.bmiHeader.biHeight = -height;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    dib = CreateDIBSection(screenDC, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!dib) {
+        return false;
+    }
+    previousBitmap = SelectObject(memoryDC, dib);
+    surfaceWidth = width;
+    surfaceHeight = height;
+    return true;
+}
+
+bool GdiFrameSource::capture(ScreenFrame& frame) {
+    if (!memoryDC) return false;
+
+    int width = GetSystemMetrics(SM_CXSCREEN);
+    int height = GetSystemMetrics(SM_CYSCREEN);
+    if (width <= 0 || height <= 0 || !ensureSurface(width, height)) {
+        return false;
+    }
+
+    if (!BitBlt(memoryDC, 0, 0, width, height, screenDC, 0, 0, SRCCOPY | CAPTUREBLT)) {
+        return false;
+    }
+    GdiFlush();
+
+    frame.width = width;
+    frame.height = height;
+    frame.stride = static_cast<size_t>(width) * 4;
+    frame.pixels.resize(frame.stride * height);
+    memcpy(frame.pixels.data(), bits, frame.pixels.size());
+    return true;
+}
+
+SocketStreamChannel::SocketStreamChannel(SOCKET socket) : socket(socket) {
+}
+
+bool SocketStreamChannel::send(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t sent = 0;
+    while (sent < size) {
+        int chunk = static_cast<int>((size - sent) < 0x10000000 ? (size - sent) : 0x10000000);
+        int result = SecureSocket::send(socket, bytes + sent, chunk, 0);
+        if (result == SOCKET_ERROR || result == 0) {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+bool SocketStreamChannel::pollAcks(uint64_t& bytesAcked, uint32_t& lastSequence, int timeoutMs) {
+    int waitMs = timeoutMs;
+    while (true) {
+        // Ack đã giải mã sẵn trong SecureSocket thì select() không thấy
+        if (SecureSocket::buffered(socket) == 0) {
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(socket, &readSet);
+            timeval timeout = { waitMs / 1000, (waitMs % 1000) * 1000 };
+
+            int ready = select(0, &readSet, nullptr, nullptr, &timeout);
+            if (ready == SOCKET_ERROR) return false;
+            if (ready == 0) return true;
+        }
+
+        char buffer[256];
+        int received = SecureSocket::recv(socket, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.insert(pending.end(), buffer, buffer + received);
+
+        size_t offset = 0;
+        while (pending.size() - offset >= sizeof(StreamAck)) {
+            StreamAck ack;
+            memcpy(&ack, pending.data() + offset, sizeof(ack));
+            if (ack.magic != ACK_MAGIC) {
+                return false;   // Client gửi thứ khác ack: giao thức đã lệch
+            }
+            if (ack.bytesReceived > bytesAcked) bytesAcked = ack.bytesReceived;
+            lastSequence = ack.sequence;
+            offset += sizeof(StreamAck);
+        }
+        pending.erase(pending.begin(), pending.begin() + offset);
+
+        // Đã có ack mới: đọc nốt phần đang chờ rồi trả về ngay
+        waitMs = 0;
+    }
+}
+
+size_t SocketStreamChannel::targetBacklog() {
+    const size_t MIN_BACKLOG = 64 * 1024;
+    const size_t DEFAULT_BACKLOG = 256 * 1024;
+
+    // Windows ước lượng sẵn lượng dữ liệu nên giữ trong bộ đệm gửi cho kết nối này
+    ULONG idealBacklog = 0;
+    DWORD bytesReturned = 0;
+    if (WSAIoctl(socket, SIO_IDEAL_SEND_BACKLOG_QUERY, nullptr, 0, &idealBacklog, sizeof(idealBacklog),
+        &bytesReturned, nullptr, nullptr) == 0 && idealBacklog > 0) {
+        return idealBacklog > MIN_BACKLOG ? idealBacklog : MIN_BACKLOG;
+    }
+    return DEFAULT_BACKLOG;
+}
+#endif
+
+SyntheticFrameSource::SyntheticFrameSource(int width, int height)
+    : width(width), height(height), frameIndex(0)
+{
+}
+
+bool SyntheticFrameSource::capture(ScreenFrame& frame) {
+    const int BOX_WIDTH = 160;
+    const int BOX_HEIGHT = 120;
+    if (width < BOX_WIDTH * 2 || height < BOX_HEIGHT * 2) return false;
+
+    auto paintBackground = [&frame](int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) {
+            uint8_t* row = frame.pixels.data() + y * frame.stride;
+            for (int x = x0; x < x1; x++) {
+                row[x * 4 + 0] = static_cast<uint8_t>(x * 255 / frame.width);
+                row[x * 4 + 1] = static_cast<uint8_t>(y * 255 / frame.height);
+                row[x * 4 + 2] = 96;
+                row[x * 4 + 3] = 255;
+            }
+        }
+    };
+    auto boxOrigin = [this](long index, int& x, int& y) {
+        x = static_cast<int>((index * 8) % (width - BOX_WIDTH));
+        y = static_cast<int>((index * 4) % (height - BOX_HEIGHT));
+    };
+
+    if (frame.width != width || frame.height != height || frameIndex == 0) {
+        frame.width = width;
+        frame.height = height;
+        frame.stride = static_cast<size_t>(width) * 4;
+        frame.pixels.resize(frame.stride * height);
+        paintBackground(0, 0, width, height);
+    }
+    else {
+        // Chỉ vẽ lại vùng khối cũ, phần còn lại giữ nguyên như màn hình thật ít thay đổi
+        int oldX, oldY;
+        boxOrigin(frameIndex - 1, oldX, oldY);
+        paintBackground(oldX, oldY, oldX + BOX_WIDTH, oldY + BOX_HEIGHT);
+    }
+
+    int boxX, boxY;
+    boxOrigin(frameIndex, boxX, boxY);
+    for (int y = boxY; y < boxY + BOX_HEIGHT; y++) {
+        uint8_t* row = frame.pixels.data() + y * frame.stride;
+        for (int x = boxX; x < boxX + BOX_WIDTH; x++) {
+            row[x * 4 + 0] = 255;
+            row[x * 4 + 1] = static_cast<uint8_t>((x + frameIndex) & 0xFF);
+            row[x * 4 + 2] = 32;
+            row[x * 4 + 3] = 255;
+        }
+    }
+
+    // Bộ đếm frame dạng 16 ô đen/trắng ở góc trên
+    for (int bit = 0; bit < 16; bit++) {
+        uint8_t value = (frameIndex >> bit) & 1 ? 255 : 0;
+        for (int y = 0; y < 16; y++) {
+            uint8_t* cell = frame.pixels.data() + y * frame.stride + bit * 16 * 4;
+            for (int x = 0; x < 16; x++) {
+                cell[x * 4 + 0] = cell[x * 4 + 1] = cell[x * 4 + 2] = value;
+                cell[x * 4 + 3] = 255;
+            }
+        }
+    }
+
+    frameIndex++;
+    return true;
+}
+
+ScreenStreamer::ScreenStreamer(FrameSource& source, StreamChannel& channel, const StreamOptions& options)
+    : source(source), channel(channel), options(options), tilesX(0), tilesY(0), bytesSent(0)
+{
+}
+
+bool ScreenStreamer::sendMessage(MessageType type, const void* payload, size_t size) {
+    StreamMessageHeader header = {};
+    header.magic = MESSAGE_MAGIC;
+    header.type = static_cast<uint8_t>(type);
+    header.payloadSize = static_cast<uint32_t>(size);
+
+    message.resize(sizeof(header) + size);
+    memcpy(message.data(), &header, sizeof(header));
+    memcpy(message.data() + sizeof(header), payload, size);
+    if (!channel.send(message.data(), message.size())) {
+        return false;
+    }
+    bytesSent += message.size();
+    streamSentBytes().add(message.size());
+    return true;
+}
+
+void ScreenStreamer::resetTiles(int width, int height) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    previous.assign(static_cast<size_t>(width) * height * 4, 0);
+    tileQuality.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+}
+
+void ScreenStreamer::findDirtyTiles(const ScreenFrame& frame, bool keyFrame) {
+    dirtyTiles.clear();
+    const size_t previousStride = static_cast<size_t>(frame.width) * 4;
+
+    for (int ty = 0; ty < tilesY; ty++) {
+        int y0 = ty * TILE_SIZE;
+        int y1 = y0 + TILE_SIZE < frame.height ? y0 + TILE_SIZE : frame.height;
+        for (int tx = 0; tx < tilesX; tx++) {
+            int x0 = tx * TILE_SIZE;
+            int x1 = x0 + TILE_SIZE < frame.width ? x0 + TILE_SIZE : frame.width;
+            size_t rowBytes = static_cast<size_t>(x1 - x0) * 4;
+
+            // So từng hàng; gặp hàng khác đầu tiên là đủ để đánh dấu tile
+            bool dirty = keyFrame;
+            for (int y = y0; y < y1 && !dirty; y++) {
+                dirty = memcmp(frame.pixels.data() + y * frame.stride + x0 * 4,
+                    previous.data() + y * previousStride + x0 * 4, rowBytes) != 0;
+            }
+            if (!dirty) continue;
+
+            for (int y = y0; y < y1; y++) {
+                memcpy(previous.data() + y * previousStride + x0 * 4,
+                    frame.pixels.data() + y * frame.stride + x0 * 4, rowBytes);
+            }
+            dirtyTiles.push_back(ty * tilesX + tx);
+        }
+    }
+}
+
+bool ScreenStreamer::encodeTile(const ScreenFrame& frame, int tileIndex, int quality) {
+    int x = (tileIndex % tilesX) * TILE_SIZE;
+    int y = (tileIndex / tilesX) * TILE_SIZE;
+    int width = x + TILE_SIZE < frame.width ? TILE_SIZE : frame.width - x;
+    int height = y + TILE_SIZE < frame.height ? TILE_SIZE : frame.height - y;
+
+    cv::Mat tile(height, width, CV_8UC4,
+        const_cast<uint8_t*>(frame.pixels.data()) + y * frame.stride + x * 4, frame.stride);
+    cv::cvtColor(tile, tileBgr, cv::COLOR_BGRA2BGR);
+
+    static Metrics::Histogram& encodeTime = Metrics::registry().histogram(
+        "stream_tile_encode_microseconds", "JPEG encode time of one stream tile");
+    encodeParams.assign({ cv::IMWRITE_JPEG_QUALITY, quality });
+    {
+        Metrics::ScopedTimer timer(encodeTime);
+        if (!cv::imencode(".jpg", tileBgr, jpeg, encodeParams)) {
+            return false;
+        }
+    }
+
+    StreamTileInfo info;
+    info.x = static_cast<uint16_t>(x);
+    info.y = static_cast<uint16_t>(y);
+    info.width = static_cast<uint16_t>(width);
+    info.height = static_cast<uint16_t>(height);
+    info.jpegSize = static_cast<uint32_t>(jpeg.size());
+
+    size_t offset = message.size();
+    message.resize(offset + sizeof(info) + jpeg.size());
+    memcpy(message.data() + offset, &info, sizeof(info));
+    memcpy(message.data() + offset + sizeof(info), jpeg.data(), jpeg.size());
+
+    tileQuality[tileIndex] = static_cast<uint8_t>(quality);
+    return true;
+}
+
+StreamStats ScreenStreamer::run(const std::function<bool()>& keepRunning) {
+    using Clock = std::chrono::steady_clock;
+
+    StreamStats stats = {};
+    double qualityTotal = 0;
+    double dirtyTotal = 0;
+    bytesSent = 0;
+
+    ScreenFrame frame;
+    if (!source.capture(frame)) {
+        return stats;
+    }
+
+    const Clock::time_point startTime = Clock::now();
+    const Clock::time_point endTime = startTime + std::chrono::seconds(options.seconds);
+    const Clock::duration interval = std::chrono::microseconds(1000000 / options.fps);
+
+    int congestionQuality = options.quality;
+    uint64_t bytesAcked = 0;
+    uint32_t lastAckSequence = 0;
+    uint32_t sequence = 0;
+    int streamWidth = 0;
+    int streamHeight = 0;
+    bool keyFrame = true;
+    bool haveFrame = true;     // Frame đầu đã chụp ở trên
+    Clock::time_point deadline = startTime;
+
+    while (keepRunning() && Clock::now() < endTime) {
+        // Chờ tới lượt frame kế tiếp, trong lúc đó đọc ack
+        Clock::time_point now = Clock::now();
+        if (now < deadline) {
+            int waitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+            if (!channel.pollAcks(bytesAcked, lastAckSequence, waitMs)) break;
+            if (Clock::now() < deadline) continue;
+        }
+        else if (!channel.pollAcks(bytesAcked, lastAckSequence, 0)) {
+            break;
+        }
+
+        // Trễ quá một chu kỳ (chụp/mã hóa chậm): không dồn frame để đuổi kịp
+        deadline += interval;
+        if (Clock::now() > deadline) {
+            deadline = Clock::now() + interval;
+        }
+
+        // AIMD: dữ liệu chưa được ack vượt ngưỡng thì bỏ frame này và giảm chất lượng
+        size_t backlog = channel.targetBacklog();
+        uint64_t inFlight = bytesSent - bytesAcked;
+        if (inFlight > backlog) {
+            stats.framesSkipped++;
+            congestionQuality = congestionQuality * 7 / 10;
+            if (congestionQuality < MIN_QUALITY) congestionQuality = MIN_QUALITY;
+            continue;
+        }
+        if (inFlight < backlog / 2 && congestionQuality < options.quality) {
+            congestionQuality += 2;
+            if (congestionQuality > options.quality) congestionQuality = options.quality;
+        }
+
+        if (!haveFrame && !source.capture(frame)) break;
+        haveFrame = false;
+
+        // Frame đầu tiên hoặc đổi độ phân giải: báo lại kích thước và gửi toàn bộ tile
+        if (frame.width != streamWidth || frame.height != streamHeight) {
+            streamWidth = frame.width;
+            streamHeight = frame.height;
+            resetTiles(streamWidth, streamHeight);
+            keyFrame = true;
+
+            StreamStartInfo info;
+            info.width = static_cast<uint16_t>(streamWidth);
+            info.height = static_cast<uint16_t>(streamHeight);
+            info.tileSize = TILE_SIZE;
+            info.fps = static_cast<uint8_t>(options.fps);
+            info.quality = static_cast<uint8_t>(options.quality);
+            info.durationMs = static_cast<uint32_t>(options.seconds * 1000);
+            if (!sendMessage(MessageType::Start, &info, sizeof(info))) break;
+        }
+
+        findDirtyTiles(frame, keyFrame);
+        const size_t tileTotal = tileQuality.size();
+        double dirtyRatio = tileTotal > 0 ? static_cast<double>(dirtyTiles.size()) / tileTotal : 0;
+
+        // Nhiều chuyển động: mắt khó thấy chi tiết nên giảm chất lượng để giữ fps
+        int quality = congestionQuality - static_cast<int>(dirtyRatio * MOTION_QUALITY_DROP);
+        if (quality < MIN_QUALITY) quality = MIN_QUALITY;
+
+        // Màn hình gần như đứng yên và đường truyền rảnh: gửi lại tile cũ bị mã hóa thấp
+        refineTiles.clear();
+        if (!keyFrame && dirtyRatio < 0.1 && inFlight < backlog / 2) {
+            std::vector<bool> isDirty(tileTotal, false);
+            for (int index : dirtyTiles) isDirty[index] = true;
+            for (size_t i = 0; i < tileTotal && refineTiles.size() < static_cast<size_t>(REFINE_BUDGET); i++) {
+                if (!isDirty[i] && tileQuality[i] != 0 && tileQuality[i] + 10 < congestionQuality) {
+                    refineTiles.push_back(static_cast<int>(i));
+                }
+            }
+        }
+
+        StreamFrameInfo info;
+        info.sequence = ++sequence;
+        info.timestampMs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - startTime).count());
+        info.quality = static_cast<uint8_t>(quality);
+        info.flags = (keyFrame ? FRAME_FLAG_KEY : 0) | (refineTiles.empty() ? 0 : FRAME_FLAG_REFINE);
+
+        // Header và thông tin frame được điền sau khi biết số tile và kích thước payload
+        message.resize(sizeof(StreamMessageHeader) + sizeof(StreamFrameInfo));
+        int tileCount = 0;
+        for (int index : dirtyTiles) {
+            if (encodeTile(frame, index, quality)) tileCount++;
+        }
+        for (int index : refineTiles) {
+            if (encodeTile(frame, index, congestionQuality)) tileCount++;
+        }
+        info.tileCount = static_cast<uint16_t>(tileCount);
+
+        StreamMessageHeader header = {};
+        header.magic = MESSAGE_MAGIC;
+        header.type = static_cast<uint8_t>(MessageType::Frame);
+        header.payloadSize = static_cast<uint32_t>(message.size() - sizeof(header));
+        memcpy(message.data(), &header, sizeof(header));
+        memcpy(message.data() + sizeof(header), &info, sizeof(info));
+
+        if (!channel.send(message.data(), message.size())) break;
+        bytesSent += message.size();
+        streamSentBytes().add(message.size());
+
+        keyFrame = false;
+        stats.framesSent++;
+        stats.tilesSent += dirtyTiles.size();
+        stats.tilesRefined += refineTiles.size();
+        qualityTotal += quality;
+        dirtyTotal += dirtyRatio;
+    }
+
+    stats.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime).count();
+    stats.avgQuality = stats.framesSent > 0 ? qualityTotal / stats.framesSent : 0;
+    stats.avgDirtyRatio = stats.framesSent > 0 ? dirtyTotal / stats.framesSent : 0;
+
+    StreamEndInfo endInfo;
+    endInfo.framesSent = static_cast<uint32_t>(stats.framesSent);
+    endInfo.framesSkipped = static_cast<uint32_t>(stats.framesSkipped);
+    endInfo.durationMs = static_cast<uint32_t>(stats.durationMs);
+    endInfo.bytesSent = bytesSent;
+    if (sendMessage(MessageType::End, &endInfo, sizeof(endInfo))) {
+        // Chờ ack cuối để không còn ack nào sót lại lẫn vào lệnh tiếp theo trên kết nối này
+        Clock::time_point waitUntil = Clock::now() + std::chrono::seconds(5);
+        while (lastAckSequence != END_SEQUENCE && Clock::now() < waitUntil) {
+            if (!channel.pollAcks(bytesAcked, lastAckSequence, 100)) break;
+        }
+    }
+
+    stats.bytesSent = bytesSent;
+    return stats;
+}
+
+std::string ScreenStreamer::formatSummary(const StreamStats& stats) {
+    std::ostringstream summary;
+    summary.setf(std::ios::fixed);
+    summary.precision(1);
+    summary << "Screen stream: " << stats.framesSent << " frames in " << stats.durationMs / 1000.0 << " s ("
+        << stats.fps() << " fps), " << stats.kilobytesPerSecond() << " KB/s, "
+        << stats.framesSkipped << " skipped (congestion)\n";
+    summary << "Tiles: " << stats.tilesSent << " changed, " << stats.tilesRefined << " refined, "
+        << stats.avgDirtyRatio * 100 << "% dirty per frame, average quality " << stats.avgQuality << "\n";
+    return summary.str();
+}
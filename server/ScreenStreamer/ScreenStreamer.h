@@ -0,0 +1,140 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ScreenStream.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#endif
+
+// Ảnh BGRA 32 bit, hàng trên cùng trước; bộ đệm được dùng lại giữa các lần chụp
+struct ScreenFrame {
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    std::vector<uint8_t> pixels;
+};
+
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+    virtual bool capture(ScreenFrame& frame) = 0;
+};
+
+#ifdef _WIN32
+// Chụp màn hình chính bằng BitBlt vào một DIB section tạo sẵn
+class GdiFrameSource : public FrameSource {
+public:
+    GdiFrameSource();
+    ~GdiFrameSource();
+    bool capture(ScreenFrame& frame) override;
+
+private:
+    bool ensureSurface(int width, int height);
+
+    HDC screenDC;
+    HDC memoryDC;
+    HBITMAP dib;
+    HGDIOBJ previousBitmap;
+    void* bits;
+    int surfaceWidth;
+    int surfaceHeight;
+};
+#endif
+
+// Nguồn tổng hợp (nền tĩnh + khối chuyển động + bộ đếm), không cần màn hình thật.
+// Dùng để chạy thử và đo tốc độ trên Linux hoặc máy không có phiên desktop.
+class SyntheticFrameSource : public FrameSource {
+public:
+    SyntheticFrameSource(int width, int height);
+    bool capture(ScreenFrame& frame) override;
+
+private:
+    int width;
+    int height;
+    long frameIndex;
+};
+
+// Kênh truyền của một phiên stream
+class StreamChannel {
+public:
+    virtual ~StreamChannel() {}
+    virtual bool send(const void* data, size_t size) = 0;
+    // Đọc các ack đã đến, chờ tối đa timeoutMs. Trả về false nếu kết nối lỗi
+    virtual bool pollAcks(uint64_t& bytesAcked, uint32_t& lastSequence, int timeoutMs) = 0;
+    // Lượng dữ liệu nên để trong đường truyền (ước lượng băng thông x độ trễ)
+    virtual size_t targetBacklog() = 0;
+};
+
+#ifdef _WIN32
+class SocketStreamChannel : public StreamChannel {
+public:
+    explicit SocketStreamChannel(SOCKET socket);
+    bool send(const void* data, size_t size) override;
+    bool pollAcks(uint64_t& bytesAcked, uint32_t& lastSequence, int timeoutMs) override;
+    size_t targetBacklog() override;
+
+private:
+    SOCKET socket;
+    std::vector<char> pending;  // Phần ack nhận chưa đủ
+};
+#endif
+
+struct StreamStats {
+    long long framesSent;
+    long long framesSkipped;
+    long long tilesSent;
+    long long tilesRefined;
+    unsigned long long bytesSent;
+    long long durationMs;
+    double avgQuality;
+    double avgDirtyRatio;
+
+    double fps() const { return durationMs > 0 ? framesSent * 1000.0 / durationMs : 0; }
+    double kilobytesPerSecond() const { return durationMs > 0 ? bytesSent / 1.024 / durationMs : 0; }
+};
+
+// Gửi màn hình liên tục theo giao thức trong ScreenStream.h:
+// - chỉ gửi các tile 64x64 thay đổi so với frame trước (dirty tile)
+// - chất lượng JPEG giảm khi nhiều vùng chuyển động, tile tĩnh được gửi lại nét hơn sau đó
+// - AIMD theo lượng dữ liệu chưa được ack: vượt ngưỡng thì bỏ frame và giảm chất lượng
+class ScreenStreamer {
+public:
+    ScreenStreamer(FrameSource& source, StreamChannel& channel, const ScreenStream::StreamOptions& options);
+
+    // Chạy tới hết thời lượng, khi kết nối lỗi hoặc keepRunning() trả về false
+    StreamStats run(const std::function<bool()>& keepRunning);
+
+    static std::string formatSummary(const StreamStats& stats);
+
+private:
+    static const int REFINE_BUDGET = 8;             // Số tile tối đa gửi lại mỗi frame
+    static const int MOTION_QUALITY_DROP = 30;      // Giảm tối đa khi mọi tile đều đổi
+
+    bool sendMessage(ScreenStream::MessageType type, const void* payload, size_t size);
+    void resetTiles(int width, int height);
+    void findDirtyTiles(const ScreenFrame& frame, bool keyFrame);
+    bool encodeTile(const ScreenFrame& frame, int tileIndex, int quality);
+
+    FrameSource& source;
+    StreamChannel& channel;
+    ScreenStream::StreamOptions options;
+
+    int tilesX;
+    int tilesY;
+    std::vector<uint8_t> previous;          // Frame đã gửi gần nhất (BGRA)
+    std::vector<uint8_t> tileQuality;       // Chất lượng lần cuối gửi từng tile, 0 = chưa gửi
+    std::vector<int> dirtyTiles;
+    std::vector<int> refineTiles;
+
+    // Bộ đệm dùng lại giữa các frame
+    cv::Mat tileBgr;
+    std::vector<uchar> jpeg;
+    std::vector<int> encodeParams;
+    std::vector<char> message;
+
+    uint64_t bytesSent;
+};
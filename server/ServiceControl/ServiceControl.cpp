@@ -0,0 +1,236 @@
+#include "ServiceControl.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+namespace {
+    // Dùng khi không đăng ký được thông báo (ví dụ SCM báo client lagging)
+    const DWORD FALLBACK_POLL_MS = 250;
+
+    std::string trimName(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos) return "";
+        size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(start, end - start + 1);
+    }
+}
+
+std::vector<ServiceControl::Result> ServiceControl::run(Action action, const std::string& names, DWORD timeoutMs) {
+    std::vector<std::string> serviceNames;
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        name = trimName(name);
+        if (!name.empty()) {
+            serviceNames.push_back(name);
+        }
+    }
+
+    if (serviceNames.empty()) {
+        return { Result{ names, false, "No service name specified", 0 } };
+    }
+    if (serviceNames.size() > MAX_BATCH) {
+        return { Result{ names, false, "Too many services (limit " + std::to_string(MAX_BATCH) + ")", 0 } };
+    }
+
+    SC_HANDLE scManager = OpenSCManager(NULL, NULL, SC_MANAGER_CONNECT);
+    if (scManager == NULL) {
+        DWORD error = GetLastError();
+        return { Result{ names, false, "Failed to open Service Control Manager. Error code: " + std::to_string(error), 0 } };
+    }
+
+    std::vector<Result> results(serviceNames.size());
+    if (serviceNames.size() == 1) {
+        results[0] = controlOne(scManager, action, serviceNames[0], timeoutMs);
+    }
+    else {
+        // Mỗi service một thread: APC của NotifyServiceStatusChange chạy trên thread đã đăng ký
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < serviceNames.size(); i++) {
+            workers.emplace_back([&, i]() {
+                results[i] = controlOne(scManager, action, serviceNames[i], timeoutMs);
+                });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    CloseServiceHandle(scManager);
+    return results;
+}
+
+ServiceControl::Result ServiceControl::controlOne(SC_HANDLE scManager, Action action,
+    const std::string& name, DWORD timeoutMs) {
+    Result result{ name, false, "", 0 };
+    bool starting = action == Action::Start;
+    DWORD targetState = starting ? SERVICE_RUNNING : SERVICE_STOPPED;
+    DWORD pendingState = starting ? SERVICE_START_PENDING : SERVICE_STOP_PENDING;
+
+    SC_HANDLE service = OpenServiceA(scManager, name.c_str(),
+        (starting ? SERVICE_START : SERVICE_STOP) | SERVICE_QUERY_STATUS);
+    if (service == NULL) {
+        DWORD error = GetLastError();
+        result.message = "Failed to open service. Error code: " + std::to_string(error);
+        return result;
+    }
+
+    SERVICE_STATUS_PROCESS ssp = {};
+    DWORD bytesNeeded;
+    QueryServiceStatusEx(service, SC_STATUS_PROCESS_INFO, (LPBYTE)&ssp,
+        sizeof(SERVICE_STATUS_PROCESS), &bytesNeeded);
+
+    if (ssp.dwCurrentState == targetState) {
+        result.success = true;
+        result.message = starting ? "Already running" : "Already stopped";
+        CloseServiceHandle(service);
+        return result;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Service đang chuyển sang đúng trạng thái cần: chỉ chờ, không gửi lệnh lại
+    if (ssp.dwCurrentState != pendingState) {
+        BOOL sent;
+        if (starting) {
+            sent = StartServiceA(service, 0, NULL);
+        }
+        else {
+            SERVICE_STATUS status;
+            sent = ControlService(service, SERVICE_CONTROL_STOP, &status);
+        }
+
+        if (!sent) {
+            DWORD error = GetLastError();
+            result.message = std::string(starting ? "Failed to start service" : "Failed to stop service") +
+                ". Error code: " + std::to_string(error);
+            CloseServiceHandle(service);
+            return result;
+        }
+    }
+    CloseServiceHandle(service);
+
+    DWORD state = 0;
+    bool changed = waitForState(scManager, name, state, timeoutMs);
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+
+    if (!changed) {
+        result.message = "Timed out waiting for state change";
+    }
+    else if (state == targetState) {
+        result.success = true;
+        result.message = starting ? "Started" : "Stopped";
+    }
+    else {
+        result.message = starting ? "Service stopped while starting" : "Service is still running";
+    }
+
+    std::cout << "Service " << name << ": " << result.message << " (" << result.elapsedMs << " ms)" << std::endl;
+    return result;
+}
+
+void CALLBACK ServiceControl::onStatusChange(PVOID parameter) {
+    SERVICE_NOTIFYA* notify = static_cast<SERVICE_NOTIFYA*>(parameter);
+    *static_cast<bool*>(notify->pContext) = true;
+}
+
+bool ServiceControl::waitForState(SC_HANDLE scManager, const std::string& name, DWORD& state, DWORD timeoutMs) {
+    // Handle riêng cho việc chờ: đóng handle là cách duy nhất để hủy thông báo đang chờ
+    SC_HANDLE service = OpenServiceA(scManager, name.c_str(), SERVICE_QUERY_STATUS);
+    if (service == NULL) {
+        return false;
+    }
+
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    bool fired = false;
+    SERVICE_NOTIFYA notify = {};
+    bool reached = false;
+
+    while (!reached) {
+        fired = false;
+        notify = {};
+        notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+        notify.pfnNotifyCallback = onStatusChange;
+        notify.pContext = &fired;
+
+        // Nếu service đã ở trạng thái này, callback được xếp hàng ngay
+        DWORD error = NotifyServiceStatusChangeA(service,
+            SERVICE_NOTIFY_RUNNING | SERVICE_NOTIFY_STOPPED, &notify);
+
+        if (error != ERROR_SUCCESS) {
+            SERVICE_STATUS_PROCESS ssp = {};
+            DWORD bytesNeeded;
+            if (!QueryServiceStatusEx(service, SC_STATUS_PROCESS_INFO, (LPBYTE)&ssp,
+                sizeof(SERVICE_STATUS_PROCESS), &bytesNeeded)) {
+                break;
+            }
+            state = ssp.dwCurrentState;
+            if (state == SERVICE_RUNNING || state == SERVICE_STOPPED) {
+                reached = true;
+                break;
+            }
+        }
+        else {
+            // SleepEx trả về WAIT_IO_COMPLETION ngay khi APC của callback chạy xong
+            while (!fired) {
+                ULONGLONG now = GetTickCount64();
+                if (now >= deadline) break;
+                SleepEx((DWORD)(deadline - now), TRUE);
+            }
+
+            if (fired) {
+                if (notify.dwNotificationStatus != ERROR_SUCCESS) {
+                    break;  // Service bị xóa hoặc SCM đóng
+                }
+                state = notify.ServiceStatus.dwCurrentState;
+                reached = true;
+                break;
+            }
+        }
+
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) break;
+        if (error != ERROR_SUCCESS) {
+            ULONGLONG remaining = deadline - now;
+            SleepEx(remaining < FALLBACK_POLL_MS ? (DWORD)remaining : FALLBACK_POLL_MS, FALSE);
+        }
+    }
+
+    CloseServiceHandle(service);
+    // APC đã xếp hàng trước khi đóng handle vẫn trỏ vào notify trên stack: xử lý hết trước khi trả về
+    SleepEx(0, TRUE);
+    return reached;
+}
+
+bool ServiceControl::allSucceeded(const std::vector<Result>& results) {
+    for (const Result& result : results) {
+        if (!result.success) return false;
+    }
+    return true;
+}
+
+std::string ServiceControl::formatReport(Action action, const std::vector<Result>& results) {
+    size_t succeeded = 0;
+    size_t nameWidth = 7;
+    for (const Result& result : results) {
+        if (result.success) succeeded++;
+        if (result.name.size() > nameWidth) nameWidth = result.name.size();
+    }
+
+    std::ostringstream report;
+    report << (action == Action::Start ? "Start service: " : "Stop service: ")
+        << succeeded << "/" << results.size() << " succeeded\n";
+
+    for (const Result& result : results) {
+        report << "  " << std::left << std::setw(nameWidth) << result.name << "  "
+            << std::setw(4) << (result.success ? "OK" : "FAIL") << "  " << result.message;
+        if (result.elapsedMs > 0) {
+            report << " (" << result.elapsedMs << " ms)";
+        }
+        report << "\n";
+    }
+    return report.str();
+}
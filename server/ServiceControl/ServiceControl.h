@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <windows.h>
+
+// Điều khiển service qua SCM. Thay vì Sleep(1000) rồi hỏi lại trạng thái,
+// mỗi service đăng ký NotifyServiceStatusChange và chờ APC trong SleepEx,
+// nên trả về ngay khi service chuyển trạng thái. Nhiều service được xử lý song song.
+class ServiceControl {
+public:
+    enum class Action {
+        Start,
+        Stop
+    };
+
+    struct Result {
+        std::string name;
+        bool success;
+        std::string message;
+        long long elapsedMs;    // Từ lúc gửi lệnh tới lúc service chuyển trạng thái
+    };
+
+    static const DWORD DEFAULT_TIMEOUT_MS = 10000;
+    static const size_t MAX_BATCH = 32;
+
+    // names: danh sách tên service, phân cách bằng dấu phẩy
+    static std::vector<Result> run(Action action, const std::string& names,
+        DWORD timeoutMs = DEFAULT_TIMEOUT_MS);
+    static std::string formatReport(Action action, const std::vector<Result>& results);
+    static bool allSucceeded(const std::vector<Result>& results);
+
+private:
+    static Result controlOne(SC_HANDLE scManager, Action action, const std::string& name, DWORD timeoutMs);
+    static bool waitForState(SC_HANDLE scManager, const std::string& name, DWORD& state, DWORD timeoutMs);
+    static void CALLBACK onStatusChange(PVOID parameter);
+};
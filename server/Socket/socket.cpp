@@ -1,9 +1,11 @@
 #include "socket.h"
+#include "Metrics.h"
+#include "SecureSocket.h"
+#include "CommandRegistry.h"
 
 SocketServer::SocketServer(const char* port)
     : m_port(port)
     , m_listenSocket(INVALID_SOCKET)
-    , m_clientSocket(INVALID_SOCKET)
     , m_initialized(false)
 {
 }
@@ -72,64 +74,93 @@ bool SocketServer::createListener() {
     return true;
 }
 
-bool SocketServer::acceptConnection() {
-    m_clientSocket = accept(m_listenSocket, NULL, NULL);
-    if (m_clientSocket == INVALID_SOCKET) {
+SOCKET SocketServer::acceptConnection() {
+    SOCKET clientSocket = accept(m_listenSocket, NULL, NULL);
+    if (clientSocket == INVALID_SOCKET) {
+        // Không dọn Winsock ở đây: lỗi accept không làm hỏng các client đang kết nối,
+        // và socket nghe bị đóng khi dừng server cũng đi vào nhánh này
         std::cerr << "accept failed with error: " << WSAGetLastError() << std::endl;
-        closesocket(m_listenSocket);
-        cleanup();
-        return false;
+        return INVALID_SOCKET;
+    }
+    // Kết quả được ghi thành nhiều lần send (kích thước, dữ liệu, trạng thái): với Nagle, phần sau phải chờ
+    // client ACK phần trước, mà client trì hoãn ACK (40-200 ms) vì chưa có gì để gửi lại
+    BOOL noDelay = TRUE;
+    if (setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay)) == SOCKET_ERROR) {
+        std::cerr << "Failed to disable Nagle: " << WSAGetLastError() << std::endl;
     }
     std::cout << "Client connected." << std::endl;
-    return true;
+    return clientSocket;
 }
 
-bool SocketServer::sendMessage(const std::string& message) {
-    int sendResult = send(m_clientSocket, message.c_str(), message.length(), 0);
+bool SocketServer::sendMessage(SOCKET clientSocket, const std::string& message) {
+    static Metrics::Counter& sentBytes = Metrics::registry().counter(
+        "server_socket_sent_bytes_total", "Bytes sent to clients");
+
+    int sendResult = SecureSocket::send(clientSocket, message.c_str(), message.length(), 0);
     if (sendResult == SOCKET_ERROR) {
         std::cerr << "send failed with error: " << WSAGetLastError() << std::endl;
         return false;
     }
+    sentBytes.add(sendResult);
     return true;
 }
 
-std::string SocketServer::receiveMessage() {
-    char recvbuf[DEFAULT_BUFLEN];
-    int recvResult = recv(m_clientSocket, recvbuf, DEFAULT_BUFLEN, 0);
+// recv có thể trả về ít hơn yêu cầu, hoặc gộp nhiều message vào một lần: đọc đúng size byte
+bool SocketServer::receiveExact(SOCKET clientSocket, char* buffer, int size) {
+    int totalReceived = 0;
+    while (totalReceived < size) {
+        int recvResult = SecureSocket::recv(clientSocket, buffer + totalReceived, size - totalReceived, 0);
+        if (recvResult == 0) {
+            std::cout << "Connection closed by client" << std::endl;
+            return false;
+        }
+        if (recvResult < 0) {
+            std::cerr << "recv failed with error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+        totalReceived += recvResult;
+    }
+    return true;
+}
 
-    if (recvResult > 0) {
-        return std::string(recvbuf, recvResult);
+std::string SocketServer::receiveMessage(SOCKET clientSocket) {
+    uint32_t length = 0;
+    if (!receiveExact(clientSocket, (char*)&length, sizeof(length))) {
+        return "";
     }
-    else if (recvResult == 0) {
-        std::cout << "Connection closed by client" << std::endl;
+    length = ntohl(length);
+    if (length == 0 || length > MAX_COMMAND_SIZE) {
+        std::cerr << "Invalid command frame length: " << length << std::endl;
         return "";
     }
-    else {
-        std::cerr << "recv failed with error: " << WSAGetLastError() << std::endl;
+
+    std::string message(length, '\0');
+    if (!receiveExact(clientSocket, &message[0], (int)length)) {
         return "";
     }
+    return message;
 }
 
-void SocketServer::closeClientConnection() {
-    if (m_clientSocket != INVALID_SOCKET) {
-        int iResult = shutdown(m_clientSocket, SD_SEND);
+void SocketServer::closeClientConnection(SOCKET clientSocket) {
+    if (clientSocket != INVALID_SOCKET) {
+        int iResult = shutdown(clientSocket, SD_SEND);
         if (iResult == SOCKET_ERROR) {
             std::cerr << "shutdown failed with error: " << WSAGetLastError() << std::endl;
         }
-        closesocket(m_clientSocket);
-        m_clientSocket = INVALID_SOCKET;
+        SecureSocket::detach(clientSocket);
+        closesocket(clientSocket);
     }
 }
 
-void SocketServer::cleanup() {
-    if (m_clientSocket != INVALID_SOCKET) {
-        closesocket(m_clientSocket);
-        m_clientSocket = INVALID_SOCKET;
-    }
+void SocketServer::closeListener() {
     if (m_listenSocket != INVALID_SOCKET) {
         closesocket(m_listenSocket);
         m_listenSocket = INVALID_SOCKET;
     }
+}
+
+void SocketServer::cleanup() {
+    closeListener();
     if (m_initialized) {
         WSACleanup();
         m_initialized = false;
@@ -13,19 +13,20 @@ public:
 
     bool initialize();
     bool createListener();
-    bool acceptConnection();
-    bool sendMessage(const std::string& message);
-    std::string receiveMessage();
-    void closeClientConnection();
+    // Mỗi client có socket riêng để nhiều kết nối được phục vụ song song
+    SOCKET acceptConnection();
+    bool sendMessage(SOCKET clientSocket, const std::string& message);
+    // Đọc một message theo khung lệnh của client (uint32 độ dài + nội dung, xem MAX_COMMAND_SIZE).
+    // Chuỗi rỗng khi kết nối đóng, lỗi hoặc khung không hợp lệ
+    std::string receiveMessage(SOCKET clientSocket);
+    void closeClientConnection(SOCKET clientSocket);
+    void closeListener();
     void cleanup();
 
-    // Add this new method
-    SOCKET getClientSocket() const { return m_clientSocket; }
-
 private:
-    static const int DEFAULT_BUFLEN = 4096;
+    bool receiveExact(SOCKET clientSocket, char* buffer, int size);
+
     const char* m_port;
     SOCKET m_listenSocket;
-    SOCKET m_clientSocket;
     bool m_initialized;
 };
@@ -7,6 +7,9 @@ public:
         if (!wxApp::OnInit())
             return false;
 
+        // Một lần cho cả chương trình: dialog giải mã ảnh trên thread nền
+        wxInitAllImageHandlers();
+
         ServerFrame* frame = new ServerFrame("Remote Control Server");
         frame->Show(true);
         return true;
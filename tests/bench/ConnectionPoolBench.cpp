@@ -0,0 +1,189 @@
+// Chi phí kết nối mỗi email: kết nối mới cho từng email (như trước khi có ConnectionPool)
+// so với lấy session từ pool, trên loopback tới một server.
+// Cách dùng: ConnectionPoolBench [số email] [số lệnh mỗi email] [kích thước kết quả]
+#include "ConnectionPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static bool recvAll(SOCKET s, char* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t received = ::recv(s, buffer, size, 0);
+        if (received <= 0) return false;
+        buffer += received;
+        size -= received;
+    }
+    return true;
+}
+
+// Server giả: một thread cho mỗi kết nối như HandleClient, trả lời mọi lệnh bằng một kết quả
+// ResultKind::Text (int64 kích thước + dữ liệu + int32 trạng thái) và heartbeat bằng "pong"
+class LoopbackServer {
+public:
+    explicit LoopbackServer(size_t resultSize) : accepted(0), result(resultSize, 'x') {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        bind(listener, (sockaddr*)&address, sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        listen(listener, SOMAXCONN);
+        acceptThread = std::thread([this]() {
+            while (true) {
+                SOCKET client = accept(listener, nullptr, nullptr);
+                if (client == INVALID_SOCKET) break;
+                accepted++;
+                std::thread(&LoopbackServer::serve, this, client).detach();
+            }
+        });
+    }
+
+    ~LoopbackServer() {
+        shutdown(listener, SHUT_RDWR);
+        closesocket(listener);
+        acceptThread.join();
+    }
+
+    int port;
+    std::atomic<long long> accepted;
+
+private:
+    void serve(SOCKET client) {
+        while (true) {
+            uint32_t length = 0;
+            if (!recvAll(client, (char*)&length, sizeof(length))) break;
+            std::string command(ntohl(length), '\0');
+            if (!recvAll(client, &command[0], command.size())) break;
+
+            if (command == "ping::heartbeat") {
+                ::send(client, "pong", 4, MSG_NOSIGNAL);
+                continue;
+            }
+            std::string frame(sizeof(long long), '\0');
+            long long size = (long long)result.size();
+            memcpy(&frame[0], &size, sizeof(size));
+            frame += result;
+            const std::string status = "Command executed";
+            int statusSize = (int)status.size();
+            frame.append((const char*)&statusSize, sizeof(statusSize));
+            frame += status;
+            ::send(client, frame.data(), frame.size(), MSG_NOSIGNAL);
+        }
+        closesocket(client);
+    }
+
+    std::string result;
+    SOCKET listener;
+    std::thread acceptThread;
+};
+
+struct RunResult {
+    double totalMs;
+    std::vector<double> emailUs;
+    long long connects;
+    int failures;
+};
+
+// Một email: lấy session, gửi các lệnh, đọc kết quả, trả session
+static bool runEmail(SocketClient* session, int commands) {
+    for (int i = 0; i < commands; i++) {
+        std::string status;
+        if (session->sendCommand("list::process") == SOCKET_ERROR || !session->receiveFile("/dev/null", status)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static RunResult run(int emails, const std::function<SocketClient*()>& acquire,
+    const std::function<void(SocketClient*, bool)>& release, int commands) {
+    RunResult result = { 0, {}, 0, 0 };
+    result.emailUs.reserve(emails);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < emails; i++) {
+        Clock::time_point emailStart = Clock::now();
+        SocketClient* session = acquire();
+        bool ok = session && runEmail(session, commands);
+        if (!ok) result.failures++;
+        release(session, ok);
+        result.emailUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - emailStart).count());
+    }
+    result.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+    return values[index];
+}
+
+static void report(const char* mode, const RunResult& result, int emails) {
+    printf("%-16s %10.1f %12.1f %9.1f %9.1f %9lld %9d\n", mode, result.totalMs,
+        result.totalMs * 1000.0 / emails, percentile(result.emailUs, 0.50), percentile(result.emailUs, 0.99),
+        result.connects, result.failures);
+}
+
+int main(int argc, char** argv) {
+    int emails = argc > 1 ? atoi(argv[1]) : 500;
+    int commands = argc > 2 ? atoi(argv[2]) : 1;
+    size_t resultSize = argc > 3 ? (size_t)atol(argv[3]) : 2048;
+    if (emails <= 0 || commands <= 0) {
+        fprintf(stderr, "usage: %s [emails] [commands per email] [result bytes]\n", argv[0]);
+        return 2;
+    }
+
+    // Bỏ log "Data saved to ..." của SocketClient khỏi kết quả đo
+    std::cout.setstate(std::ios::failbit);
+
+    LoopbackServer server(resultSize);
+    printf("%d emails, %d command(s) each, %zu byte results, loopback port %d\n",
+        emails, commands, resultSize, server.port);
+    printf("%-16s %10s %12s %9s %9s %9s %9s\n", "mode", "total ms", "us/email", "p50 us", "p99 us", "connects", "failures");
+
+    // Trước ConnectionPool: connect và đóng cho mỗi email
+    long long acceptedBefore = server.accepted;
+    RunResult direct = run(emails,
+        [&]() {
+            SocketClient* session = new SocketClient();
+            if (!session->connect("127.0.0.1", server.port)) {
+                delete session;
+                return (SocketClient*)nullptr;
+            }
+            return session;
+        },
+        [](SocketClient* session, bool) { delete session; },
+        commands);
+    direct.connects = server.accepted - acceptedBefore;
+    report("connect/email", direct, emails);
+
+    ConnectionPool pool;
+    acceptedBefore = server.accepted;
+    RunResult pooled = run(emails,
+        [&]() { return pool.acquire("127.0.0.1", server.port); },
+        [&](SocketClient* session, bool ok) { pool.release(session, ok); },
+        commands);
+    pooled.connects = server.accepted - acceptedBefore;
+    report("pool", pooled, emails);
+
+    ConnectionPool::Stats stats = pool.getStats();
+    printf("pool stats: connects %lld, reuses %lld, stale drops %lld\n", stats.connects, stats.reuses, stats.staleDrops);
+    printf("connect overhead saved: %.1f us/email (%.1f%%)\n",
+        (direct.totalMs - pooled.totalMs) * 1000.0 / emails,
+        100.0 * (direct.totalMs - pooled.totalMs) / direct.totalMs);
+    return direct.failures + pooled.failures == 0 ? 0 : 1;
+}
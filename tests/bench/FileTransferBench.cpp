@@ -0,0 +1,168 @@
+// Lấy nhiều file nhỏ qua loopback: N lệnh file::get (mỗi file một lệnh, một lần nhận và một save_path như
+// ProcessEmail) so với một lệnh file::get <dir>\*.txt trả về một file tar. Đo cả file::list của thư mục đó,
+// bước client cần trước khi biết tên file. Server là HeadlessServer (SocketServer + FileTransfer thật),
+// client là SocketClient.
+// Cách dùng: FileTransferBench <đường dẫn HeadlessServer> [số file] [byte mỗi file]
+#include "socket.h"
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static int freePort() {
+    SOCKET probe = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(probe, (sockaddr*)&address, sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(probe, (sockaddr*)&address, &length);
+    closesocket(probe);
+    return ntohs(address.sin_port);
+}
+
+static pid_t startServer(const char* program, int port) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        std::string portText = std::to_string(port);
+        execl(program, program, portText.c_str(), (char*)nullptr);
+        perror(program);
+        _exit(127);
+    }
+    return pid;
+}
+
+// Chờ server mở cổng; thử bằng socket thô để SocketClient không in lỗi cho mỗi lần thử
+static bool waitForServer(int port) {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 100; attempt++) {
+        SOCKET probe = socket(AF_INET, SOCK_STREAM, 0);
+        bool open = ::connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+        closesocket(probe);
+        if (open) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+// file::get rồi save_path, như ProcessEmail với ResultKind::File
+static bool fetch(SocketClient& client, const std::string& command, const fs::path& target) {
+    std::string status;
+    if (client.sendCommand(command) <= 0 || !client.receiveFile(target.string(), status)) {
+        fprintf(stderr, "%s: %s\n", command.c_str(), status.empty() ? "connection error" : status.c_str());
+        return false;
+    }
+    client.sendCommand("save_path:" + target.string());
+    return true;
+}
+
+// Số entry file thường trong tar (bỏ qua longlink)
+static int countTarFiles(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    char header[512];
+    int files = 0;
+    while (file.read(header, sizeof(header)) && header[0] != '\0') {
+        unsigned long long size = strtoull(std::string(header + 124, 11).c_str(), nullptr, 8);
+        if (header[156] == '0') files++;
+        file.seekg((size + 511) / 512 * 512, std::ios::cur);
+    }
+    return files;
+}
+
+static void printRow(const char* name, int commands, double ms, int files, uintmax_t bytes) {
+    printf("%-28s %9d %10.1f %12.1f %12ju\n", name, commands, ms, ms * 1000 / files, bytes);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <HeadlessServer> [files] [bytes per file]\n", argv[0]);
+        return 2;
+    }
+    int files = argc > 2 ? atoi(argv[2]) : 10000;
+    size_t fileSize = argc > 3 ? (size_t)atol(argv[3]) : 1024;
+    if (files <= 0) {
+        fprintf(stderr, "usage: %s <HeadlessServer> [files] [bytes per file]\n", argv[0]);
+        return 2;
+    }
+
+    char pattern[] = "/tmp/FileTransferBench.XXXXXX";
+    if (!mkdtemp(pattern)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    fs::path dir = pattern;
+    fs::path source = dir / "source";
+    fs::path received = dir / "received";
+    fs::create_directories(source);
+    fs::create_directories(received);
+    std::string content(fileSize, 'x');
+    for (int i = 0; i < files; i++) {
+        std::ofstream(source / ("file" + std::to_string(i) + ".txt"), std::ios::binary) << content;
+    }
+
+    // SocketClient in một dòng "Data saved to" cho mỗi file nhận được
+    std::cout.setstate(std::ios::badbit);
+
+    int port = freePort();
+    pid_t server = startServer(argv[1], port);
+    SocketClient client;
+    if (!waitForServer(port) || !client.connect("127.0.0.1", port)) {
+        fprintf(stderr, "cannot connect to HeadlessServer on port %d\n", port);
+        kill(server, SIGTERM);
+        fs::remove_all(dir);
+        return 1;
+    }
+
+    printf("%d files of %zu bytes, loopback\n", files, fileSize);
+    printf("%-28s %9s %10s %12s %12s\n", "mode", "commands", "ms", "us per file", "bytes");
+
+    Clock::time_point start = Clock::now();
+    fs::path listing = received / "listing.tsv";
+    bool ok = fetch(client, "file::list " + source.string() + " *.txt", listing);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (ok) printRow("file::list", 1, ms, files, fs::file_size(listing));
+
+    start = Clock::now();
+    uintmax_t bytes = 0;
+    for (int i = 0; i < files && ok; i++) {
+        std::string name = "file" + std::to_string(i) + ".txt";
+        ok = fetch(client, "file::get " + (source / name).string(), received / name);
+        if (ok) bytes += fs::file_size(received / name);
+    }
+    ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (ok) printRow("file::get each file", files, ms, files, bytes);
+
+    start = Clock::now();
+    fs::path archive = received / "source.tar";
+    ok = ok && fetch(client, "file::get " + (source / "*.txt").string(), archive);
+    ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (ok) {
+        printRow("file::get *.txt (tar)", 1, ms, files, fs::file_size(archive));
+        int archived = countTarFiles(archive);
+        if (archived != files) {
+            fprintf(stderr, "archive has %d files, expected %d\n", archived, files);
+            ok = false;
+        }
+    }
+
+    client.disconnect();
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    fs::remove_all(dir);
+    return ok ? 0 : 1;
+}
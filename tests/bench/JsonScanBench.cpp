@@ -0,0 +1,141 @@
+// Đọc các trường cần thiết của một kết quả messages.get (threadId, historyId, internalDate, header
+// Subject/From/Date, data của part text/plain) bằng JsonScan so với cách cũ của decodeEmailContent:
+// istringstream + Json::parseFromStream dựng cả cây Json::Value, kể cả data base64 của mọi file đính kèm.
+// Thư có 40 header và 0 đến 5 file đính kèm lớn; kết quả hai cách được so khớp trước khi đo.
+// Cách dùng: JsonScanBench [hệ số số vòng]
+#include "JsonScan.h"
+#include <json/json.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+struct Fields {
+    std::string threadId, subject, from, date, data;
+    unsigned long long historyId = 0;
+    long long internalDateMs = 0;
+
+    bool operator==(const Fields& other) const {
+        return threadId == other.threadId && subject == other.subject && from == other.from && date == other.date &&
+            data == other.data && historyId == other.historyId && internalDateMs == other.internalDateMs;
+    }
+};
+
+static std::string message(size_t attachments, size_t attachmentBytes) {
+    static const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::mt19937 random(1);
+    std::string json = R"({"id":"18c1","threadId":"18c0","labelIds":["INBOX","UNREAD"],)"
+        R"("snippet":"screenshot é - 10.0.0.5","payload":{"partId":"","mimeType":"multipart/mixed","headers":[)";
+    for (int i = 0; i < 40; i++) {
+        json += R"({"name":"X-Header-)" + std::to_string(i) + R"(","value":"value with \"quotes\" )" +
+            std::to_string(i) + R"("},)";
+    }
+    json += R"({"name":"Subject","value":"Mail Control"},{"name":"From","value":"Ops <ops@example.com>"},)"
+        R"({"name":"Date","value":"Mon, 1 Jan 2024 10:00:00 +0000"}],"body":{"size":0},"parts":[)";
+    for (size_t a = 0; a < attachments; a++) {
+        json += R"({"partId":")" + std::to_string(a + 1) + R"(","mimeType":"application/octet-stream",)"
+            R"("filename":"f.bin","body":{"size":)" + std::to_string(attachmentBytes) + R"(,"data":")";
+        for (size_t i = 0; i < attachmentBytes; i++) json += BASE64URL[random() & 63];
+        json += R"("}},)";
+    }
+    json += R"({"partId":"0","mimeType":"text/plain","body":{"size":20,"data":"c2NyZWVuc2hvdCAtIDEwLjAuMC41"}}]},)"
+        R"("sizeEstimate":1,"historyId":"991","internalDate":"1704103200000"})";
+    return json;
+}
+
+static Fields readJsoncpp(const std::string& json) {
+    Fields fields;
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::istringstream stream(json);
+    std::string errors;
+    if (!Json::parseFromStream(builder, stream, &root, &errors)) return fields;
+    for (const Json::Value& header : root["payload"]["headers"]) {
+        std::string name = header["name"].asString();
+        if (name == "Subject") fields.subject = header["value"].asString();
+        else if (name == "From") fields.from = header["value"].asString();
+        else if (name == "Date") fields.date = header["value"].asString();
+    }
+    for (const Json::Value& part : root["payload"]["parts"]) {
+        if (part["mimeType"].asString() == "text/plain") {
+            fields.data = part["body"]["data"].asString();
+            break;
+        }
+    }
+    fields.threadId = root["threadId"].asString();
+    fields.historyId = std::stoull(root["historyId"].asString());
+    fields.internalDateMs = std::stoll(root["internalDate"].asString());
+    return fields;
+}
+
+static Fields readJsonScan(const std::string& json) {
+    Fields fields;
+    JsonScan::Value root;
+    if (!JsonScan::parse(json, root)) return fields;
+    JsonScan::Value payload;
+    root.forEachMember([&](std::string_view name, const JsonScan::Value& value) {
+        if (name == "payload") payload = value;
+        else if (name == "threadId") fields.threadId = value.asString();
+        else if (name == "historyId") fields.historyId = value.asUInt64();
+        else if (name == "internalDate") fields.internalDateMs = value.asInt64();
+        return true;
+    });
+    payload["headers"].forEach([&](const JsonScan::Value& header) {
+        std::string name = header["name"].asString();
+        if (name == "Subject") fields.subject = header["value"].asString();
+        else if (name == "From") fields.from = header["value"].asString();
+        else if (name == "Date") fields.date = header["value"].asString();
+        return true;
+    });
+    payload["parts"].forEach([&](const JsonScan::Value& part) {
+        if (part["mimeType"].stringBody() != "text/plain") return true;
+        fields.data = std::string(part["body"]["data"].stringBody());
+        return false;
+    });
+    return fields;
+}
+
+template <typename Function>
+static double microseconds(const std::string& json, int rounds, Function function) {
+    size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink += function(json).data.size();
+    }
+    double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+    return sink ? elapsed : -1;
+}
+
+int main(int argc, char** argv) {
+    double scale = argc > 1 ? atof(argv[1]) : 1;
+    if (scale <= 0) {
+        fprintf(stderr, "usage: %s [round scale]\n", argv[0]);
+        return 2;
+    }
+
+    const struct {
+        size_t attachments, bytes;
+    } shapes[] = { { 0, 0 }, { 2, 256 * 1024 }, { 3, 4 * 1024 * 1024 }, { 5, 8 * 1024 * 1024 } };
+
+    printf("%-28s %10s %12s %12s %8s\n", "attachments", "MB JSON", "jsoncpp us", "JsonScan us", "speedup");
+    int mismatches = 0;
+    for (const auto& shape : shapes) {
+        std::string json = message(shape.attachments, shape.bytes);
+        if (!(readJsoncpp(json) == readJsonScan(json))) {
+            fprintf(stderr, "fields differ for %zu attachments\n", shape.attachments);
+            mismatches++;
+        }
+        int rounds = static_cast<int>((json.size() < 100000 ? 20000 : json.size() < 2000000 ? 200 : 10) * scale);
+        if (rounds < 1) rounds = 1;
+        double old = microseconds(json, rounds, readJsoncpp);
+        double scan = microseconds(json, rounds, readJsonScan);
+        char label[64];
+        snprintf(label, sizeof(label), "%zu x %zu KB", shape.attachments, shape.bytes / 1024);
+        printf("%-28s %10.1f %12.0f %12.0f %7.1fx\n", label, json.size() / 1e6, old, scan, old / scan);
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+// MailHeader so với std::regex cũ trên một tập header From, và bộ tách query so với regex cũ của
+// OAuthCallbackServer::extractCode trên một request callback thật.
+// "regex mỗi lần gọi" là EmailHandler::extractEmail trước đây (dựng std::regex trong hàm);
+// "regex static" cho biết phần nào là chi phí dựng regex, phần nào là chi phí khớp.
+// Cách dùng: MailHeaderBench [số vòng]
+#include "MailHeader.h"
+#include "utils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const char* ADDRESS_PATTERN = R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})";
+
+static const std::vector<std::string> FROM_HEADERS = {
+    "a@b.com",
+    "John Doe <john.doe@example.org>",
+    "\"Doe, John\" <john@x.org>",
+    "=?UTF-8?B?Tmd1eeG7hW4gVsSDbiBB?= <nguyen.van.a@company.com.vn>",
+    "john@x.org (John Doe)",
+    "\"Very Long Display Name With Many Words In It\" <very.long.local.part+tag@subdomain.example.co.uk>",
+    "Google <no-reply@accounts.google.com>",
+    "Team: a@x.org, b@y.org;",
+};
+
+static const std::string CALLBACK_REQUEST = "GET /?state=abc&code=4%2F0AeaYSHDxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+    "&scope=https%3A%2F%2Fmail.google.com%2F HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: Mozilla/5.0\r\n"
+    "Accept: text/html\r\n\r\n";
+
+static size_t sink = 0;
+
+template <typename Function>
+static void bench(const char* name, const std::vector<std::string>& inputs, int rounds, Function function) {
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const std::string& input : inputs) {
+            sink += function(input).size();
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (rounds * inputs.size());
+    printf("%-36s %10.0f\n", name, ns);
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%zu From headers x %d rounds\n", FROM_HEADERS.size(), rounds);
+    printf("%-36s %10s\n", "extractEmail", "ns/header");
+    bench("regex per call (old)", FROM_HEADERS, rounds, [](const std::string& from) {
+        std::regex pattern(ADDRESS_PATTERN);
+        std::smatch match;
+        return std::regex_search(from, match, pattern) ? match.str() : from;
+    });
+    bench("static regex", FROM_HEADERS, rounds, [](const std::string& from) {
+        static const std::regex pattern(ADDRESS_PATTERN);
+        std::smatch match;
+        return std::regex_search(from, match, pattern) ? match.str() : from;
+    });
+    bench("MailHeader::firstMailbox", FROM_HEADERS, rounds, [](const std::string& from) {
+        MailHeader::Address address;
+        return MailHeader::firstMailbox(from, address) ? std::string(address.addrSpec) : from;
+    });
+
+    printf("\n%-36s %10s\n", "extractCode", "ns/request");
+    std::vector<std::string> requests = { CALLBACK_REQUEST };
+    bench("regex per call (old)", requests, rounds, [](const std::string& request) {
+        std::regex pattern("code=([^&\\s]+)");
+        std::smatch match;
+        return std::regex_search(request, match, pattern) ? std::string(match[1]) : std::string();
+    });
+    bench("findQueryParam + urlDecode", requests, rounds, [](const std::string& request) {
+        std::string_view target(request);
+        target = target.substr(0, target.find("\r\n"));
+        target = target.substr(target.find('?') + 1);
+        target = target.substr(0, target.find(' '));
+        std::string_view code;
+        return findQueryParam(target, "code", code) ? urlDecode(code) : std::string();
+    });
+
+    return sink == 0;
+}
@@ -0,0 +1,119 @@
+// Đọc nội dung thư lệnh từ kết quả messages.get: JsonScan + MimeWalker (view vào buffer, chỉ giải mã part
+// được chọn) so với cách cũ bằng jsoncpp (dựng cả cây Json::Value, asString() sao chép body của từng part).
+// Ba loại thư: trả lời từ điện thoại có ảnh nhỏ, thư HTML 50 KB, và thư kèm file 3 MB.
+// Cách dùng: MimeWalkerBench [số vòng]
+#include "MimeWalker.h"
+#include "JsonScan.h"
+#include "utils.h"
+#include <json/json.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string base64url(const std::string& data) {
+    std::string encoded = base64_encode(data);
+    while (!encoded.empty() && encoded.back() == '=') encoded.pop_back();
+    for (char& c : encoded) {
+        if (c == '+') c = '-';
+        else if (c == '/') c = '_';
+    }
+    return encoded;
+}
+
+static std::string part(const std::string& mimeType, const std::string& data, const std::string& filename = "",
+    const std::string& children = "") {
+    std::string json = R"({"partId":"0","mimeType":")" + mimeType + R"(","filename":")" + filename +
+        R"(","headers":[{"name":"Content-Type","value":")" + mimeType + R"(; charset=UTF-8"}],"body":{"size":)" +
+        std::to_string(data.size());
+    if (!data.empty()) json += R"(,"data":")" + base64url(data) + "\"";
+    json += "}";
+    if (!children.empty()) json += R"(,"parts":[)" + children + "]";
+    return json + "}";
+}
+
+static std::string message(const std::string& attachmentType, size_t attachmentSize, const std::string& html) {
+    std::string alternative = part("multipart/alternative", "", "",
+        part("text/plain", "list::process; screenshot::capture - 10.0.0.2\r\n") + "," +
+        part("text/html", html));
+    std::string payload = part("multipart/mixed", "", "",
+        alternative + "," + part(attachmentType, std::string(attachmentSize, 'x'), "attachment.bin"));
+    payload.insert(payload.find(R"("headers":[)") + 11,
+        R"({"name":"Subject","value":"Mail Control"},{"name":"From","value":"A <a@b.com>"},)");
+    return R"({"id":"m1","threadId":"t1","internalDate":"1700000000000","payload":)" + payload + "}";
+}
+
+// Cách cũ: cây Json::Value, duyệt đệ quy, asString() sao chép data của mỗi part văn bản
+static bool findTextJsoncpp(const Json::Value& node, std::string& text) {
+    if (node["mimeType"].asString() == "text/plain") {
+        text = base64_decode(node["body"]["data"].asString());
+        return true;
+    }
+    for (const Json::Value& child : node["parts"]) {
+        if (findTextJsoncpp(child, text)) return true;
+    }
+    return false;
+}
+
+static size_t readJsoncpp(const std::string& json) {
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value root;
+    std::string errors;
+    std::string text;
+    if (!reader->parse(json.data(), json.data() + json.size(), &root, &errors)) return 0;
+    findTextJsoncpp(root["payload"], text);
+    return text.size();
+}
+
+static size_t readMimeWalker(const std::string& json) {
+    JsonScan::Value root;
+    if (!JsonScan::parse(json, root)) return 0;
+    MimeWalker::Selection selection = MimeWalker::select(root["payload"]);
+    return selection.hasText ? MimeWalker::decodeText(selection.text, selection.text.inlineData()).size() : 0;
+}
+
+template <typename Function>
+static void bench(const char* name, const std::string& json, int rounds, Function function) {
+    size_t total = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        total += function(json);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-36s %10.1f %10.0f%s\n", name, seconds / rounds * 1e6, json.size() * rounds / seconds / 1e6,
+        total == 0 ? "  (no text found)" : "");
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    std::string newsletter;
+    while (newsletter.size() < 50000) {
+        newsletter += "<p>Lorem ipsum dolor sit amet, <b>consectetur</b> adipiscing.</p>";
+    }
+    struct {
+        const char* name;
+        std::string json;
+        int rounds;
+    } messages[] = {
+        { "mobile reply + 200 B image", message("image/png", 200, "<div>list::process</div>"), rounds * 50 },
+        { "50 KB HTML alternative", message("image/png", 200, newsletter), rounds * 5 },
+        { "3 MB attachment", message("application/zip", 3000000, "<div>list::process</div>"), rounds / 20 + 1 },
+    };
+
+    printf("%-36s %10s %10s\n", "message / reader", "us/msg", "MB/s");
+    for (const auto& entry : messages) {
+        printf("%s (%zu bytes JSON)\n", entry.name, entry.json.size());
+        bench("  jsoncpp tree (old)", entry.json, entry.rounds, readJsoncpp);
+        bench("  JsonScan + MimeWalker", entry.json, entry.rounds, readMimeWalker);
+    }
+    return 0;
+}
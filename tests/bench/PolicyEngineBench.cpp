@@ -0,0 +1,104 @@
+// Chi phí của PolicyEngine khi policy.json có nhiều luật: thời gian biên dịch và thời gian quyết định mỗi email.
+// Luật xen kẽ địa chỉ, "*@domain" và "*@*.domain" (hai loại sau cần DKIM pass), cuối cùng là một luật "*";
+// mỗi email có 2 server và 2 lệnh, người gửi chọn ngẫu nhiên trong số các luật, 1/4 là người lạ (bị từ chối).
+// Đo với 100, 1000 và [số luật] luật để thấy chỉ mục theo người gửi giữ thời gian gần như không đổi.
+// Cách dùng: PolicyEngineBench [số luật] [số email]
+#include "PolicyEngine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const char* DKIM_PASS = "mx.google.com; dkim=pass header.i=@corp.example header.s=s1; "
+    "spf=pass smtp.mailfrom=corp.example; dmarc=pass header.from=corp.example";
+
+static std::string makePolicy(int rules) {
+    std::string json = R"({ "default": "deny", "rate_limit": { "per_minute": 1e9, "burst": 1e9 }, "rules": [)";
+    for (int i = 0; i < rules - 1; i++) {
+        std::string n = std::to_string(i);
+        switch (i % 3) {
+        case 0:
+            json += R"({ "senders": ["user)" + n + R"(@corp.example"], "targets": ["10.)" + std::to_string(i % 256) +
+                R"(.0.0/16"], "commands": ["introspection"] },)";
+            break;
+        case 1:
+            json += R"({ "senders": ["*@dept)" + n + R"(.corp.example"], "auth": "pass",)"
+                R"( "commands": ["introspection", "transfer"] },)";
+            break;
+        default:
+            json += R"({ "senders": ["*@*.site)" + n + R"(.example"], "auth": "pass", "targets": ["10.0.0.0/8"] },)";
+            break;
+        }
+    }
+    json += R"({ "senders": ["*"], "targets": ["172.16.0.0/12"], "commands": ["introspection"] }]})";
+    return json;
+}
+
+static std::vector<PolicyEngine::Request> makeRequests(int rules, size_t count) {
+    std::mt19937 random(1);
+    std::vector<PolicyEngine::Request> requests;
+    for (size_t i = 0; i < count; i++) {
+        PolicyEngine::Request request;
+        request.mailboxAccount = "me@gmail.com";
+        int rule = static_cast<int>(random() % (rules - 1));
+        std::string n = std::to_string(rule);
+        if (random() % 4 == 0) {
+            request.sender = "stranger" + n + "@elsewhere.example";
+        }
+        else if (rule % 3 == 0) {
+            request.sender = "user" + n + "@corp.example";
+        }
+        else if (rule % 3 == 1) {
+            request.sender = "x@dept" + n + ".corp.example";
+        }
+        else {
+            request.sender = "x@pc.site" + n + ".example";
+        }
+        request.authenticationResults = DKIM_PASS;
+        request.targets = { { "10." + std::to_string(rule % 256) + ".3.4" }, { "172.16.1.1" } };
+        request.commands = { "list::app", "list::process" };
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+static void bench(int rules, int emails) {
+    PolicyEngine engine("", []() { return 0LL; });
+    std::string json = makePolicy(rules);
+    std::string error;
+    Clock::time_point start = Clock::now();
+    if (!engine.loadFromString(json, error)) {
+        fprintf(stderr, "policy rejected: %s\n", error.c_str());
+        exit(1);
+    }
+    double compileMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<PolicyEngine::Request> requests = makeRequests(rules, 4096);
+    int allowed = 0;
+    start = Clock::now();
+    for (int i = 0; i < emails; i++) {
+        allowed += engine.evaluate(requests[i % requests.size()]).allowed;
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / emails;
+    printf("%8zu %12.1f %12.0f %9.1f%%\n", engine.ruleCount(), compileMs, ns, 100.0 * allowed / emails);
+}
+
+int main(int argc, char** argv) {
+    int rules = argc > 1 ? atoi(argv[1]) : 10000;
+    int emails = argc > 2 ? atoi(argv[2]) : 200000;
+    if (rules < 2 || emails <= 0) {
+        fprintf(stderr, "usage: %s [rules] [emails]\n", argv[0]);
+        return 2;
+    }
+    printf("%d emails, 2 servers x 2 commands each\n", emails);
+    printf("%8s %12s %12s %10s\n", "rules", "compile ms", "ns/email", "allowed");
+    for (int count : { 100, 1000 }) {
+        if (count < rules) bench(count, emails);
+    }
+    bench(rules, emails);
+    return 0;
+}
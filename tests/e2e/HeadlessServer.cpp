@@ -0,0 +1,222 @@
+// Server không giao diện cho tests/e2e: SocketServer, CommandScheduler, ResultCache và FileTransfer
+// của server thật, vòng đọc lệnh giống ServerFrame::HandleClient. Chỉ phần Command (WinAPI, GDI+,
+// OpenCV) được thay bằng MockCommand trả kết quả dựng sẵn, khung trả về theo ResultKind như server thật.
+// screen::stream không được hỗ trợ.
+// Cách dùng: HeadlessServer <cổng> [byte kết quả văn bản] [byte ảnh] [ms mỗi lệnh]
+// SIGTERM/SIGINT: in thống kê rồi thoát.
+#include "socket.h"
+#include "CommandRegistry.h"
+#include "CommandScheduler.h"
+#include "ResultCache.h"
+#include "FileTransfer.h"
+#include "SecureSocket.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Kết quả dựng sẵn thay cho WinAPI; delayMs giả lập thời gian chạy lệnh thật
+class MockCommand {
+public:
+    MockCommand(size_t textBytes, size_t imageBytes, int delayMs)
+        : textBytes(textBytes), imageBytes(imageBytes), delayMs(delayMs) {}
+
+    // Dạng bảng như list::process: mỗi dòng một process giả
+    std::string text(const char* command) {
+        work();
+        std::string result = std::string(command) + "\n";
+        for (int line = 0; result.size() < textBytes; line++) {
+            char row[96];
+            snprintf(row, sizeof(row), "%-40s %8d %12d K\n", ("mock_process_" + std::to_string(line) + ".exe").c_str(),
+                1000 + line, 4096 + line * 16);
+            result += row;
+        }
+        result.resize(textBytes);
+        return result;
+    }
+
+    std::vector<BYTE> image() {
+        work();
+        std::vector<BYTE> png(imageBytes);
+        for (size_t i = 0; i < png.size(); i++) png[i] = static_cast<BYTE>(i * 31);
+        return png;
+    }
+
+    void work() {
+        if (delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+    }
+
+private:
+    size_t textBytes;
+    size_t imageBytes;
+    int delayMs;
+};
+
+static FileTransfer::Sink socketSink(SOCKET clientSocket) {
+    return [clientSocket](const char* data, size_t size) {
+        size_t sent = 0;
+        while (sent < size) {
+            int result = SecureSocket::send(clientSocket, data + sent, static_cast<int>(size - sent), 0);
+            if (result == SOCKET_ERROR || result == 0) return false;
+            sent += result;
+        }
+        return true;
+    };
+}
+
+// int32 độ dài + dữ liệu: Command::sendImage và Command::SendMessages
+static void sendSized(SOCKET clientSocket, const char* data, int size) {
+    FileTransfer::Sink sink = socketSink(clientSocket);
+    if (sink(reinterpret_cast<const char*>(&size), sizeof(size))) sink(data, size);
+}
+
+class HeadlessServer {
+public:
+    HeadlessServer(const std::string& port, MockCommand& cmd) : port(port), server(this->port.c_str()), cmd(cmd) {}
+
+    bool start() {
+        if (!server.initialize() || !server.createListener()) return false;
+        scheduler.start();
+        return true;
+    }
+
+    void run() {
+        while (true) {
+            SOCKET clientSocket = server.acceptConnection();
+            if (clientSocket == INVALID_SOCKET) break;
+            std::thread(&HeadlessServer::handleClient, this, clientSocket).detach();
+        }
+    }
+
+    void printStats() {
+        ResultCache::Stats cache = resultCache.getStats();
+        fprintf(stderr, "server %s: %lld connections, %lld commands, cache hits %lld misses %lld\n",
+            port.c_str(), connections.load(), commands.load(), cache.hits, cache.misses);
+    }
+
+private:
+    void handleClient(SOCKET clientSocket) {
+        connections++;
+        std::string transport;
+        bool accepted = SecureSocket::acceptServer(clientSocket, transport);
+
+        while (accepted) {
+            std::string command = server.receiveMessage(clientSocket);
+            if (command.empty()) break;
+
+            ParsedCommand parsed = parseCommand(command);
+            if (parsed.valid() && parsed.spec->id == CommandId::PingHeartbeat) {
+                server.sendMessage(clientSocket, "pong");
+                continue;
+            }
+            if (command.compare(0, 10, "save_path:") == 0 || !parsed.valid()) {
+                continue;   // Server thật chỉ ghi log
+            }
+
+            commands++;
+            std::future<void> done = scheduler.submit(parsed.spec->commandClass, parsed.spec->highPriority,
+                [this, clientSocket, command]() { execute(clientSocket, parseCommand(command)); });
+            try {
+                done.get();
+            }
+            catch (const std::exception&) {
+                break;
+            }
+        }
+        server.closeClientConnection(clientSocket);
+    }
+
+    void execute(SOCKET clientSocket, const ParsedCommand& parsed) {
+        std::string summary;
+        switch (parsed.spec->resultKind) {
+        case ResultKind::Text: {
+            bool hit;
+            ResultCache::Payload payload = resultCache.getOrCompute(parsed,
+                [this, &parsed]() { return cmd.text(parsed.spec->name); }, hit);
+            FileTransfer::sendBuffer(socketSink(clientSocket), payload->data(), payload->size(), "");
+            break;
+        }
+        case ResultKind::Image:
+        case ResultKind::Video: {
+            std::vector<BYTE> image = cmd.image();
+            sendSized(clientSocket, reinterpret_cast<const char*>(image.data()), static_cast<int>(image.size()));
+            break;
+        }
+        case ResultKind::File:
+            // FileTransfer thật trên thư mục của máy chạy benchmark
+            if (parsed.spec->id == CommandId::FileList) {
+                FileTransfer::sendListing(socketSink(clientSocket), FileTransfer::parseListArgs(parsed.args), summary);
+            }
+            else {
+                FileTransfer::sendPath(socketSink(clientSocket), std::string(parsed.args), summary);
+            }
+            break;
+        case ResultKind::Status: {
+            cmd.work();
+            const std::string message = "File deleted successfully.";
+            sendSized(clientSocket, message.data(), static_cast<int>(message.size()));
+            break;
+        }
+        case ResultKind::Stream:
+        case ResultKind::None:
+            cmd.work();
+            break;
+        }
+
+        switch (parsed.spec->id) {
+        case CommandId::AppStart:
+        case CommandId::AppStop:
+            resultCache.invalidate(CommandId::ListApp);
+            resultCache.invalidate(CommandId::ListProcess);
+            break;
+        case CommandId::ServiceStart:
+        case CommandId::ServiceStop:
+            resultCache.invalidate(CommandId::ListService);
+            resultCache.invalidate(CommandId::ListProcess);
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::string port;
+    SocketServer server;
+    MockCommand& cmd;
+    CommandScheduler scheduler;
+    ResultCache resultCache;
+    std::atomic<long long> connections{ 0 };
+    std::atomic<long long> commands{ 0 };
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <port> [text bytes] [image bytes] [ms per command]\n", argv[0]);
+        return 2;
+    }
+    MockCommand cmd(argc > 2 ? (size_t)atol(argv[2]) : 4096, argc > 3 ? (size_t)atol(argv[3]) : 65536,
+        argc > 4 ? atoi(argv[4]) : 0);
+
+    // Tín hiệu chỉ được nhận trên thread chờ bên dưới
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    HeadlessServer server(argv[1], cmd);
+    if (!server.start()) return 1;
+    std::thread([&server, signals]() {
+        int received;
+        sigwait(&signals, &received);
+        server.printStats();
+        _exit(0);
+    }).detach();
+
+    fprintf(stderr, "server listening on %s\n", argv[1]);
+    server.run();
+    return 0;
+}
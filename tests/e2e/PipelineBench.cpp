@@ -0,0 +1,400 @@
+// Benchmark đầu-cuối email -> socket -> trả lời, không cần Gmail thật hay Windows.
+// Mỗi hộp thư (một thread) lần lượt thả thư lệnh vào gmail_mock.py, đọc lại bằng EmailHandler thật
+// (poll messages.list, hoặc history.list như khi có push), kiểm tra PolicyEngine, ghi CommandJournal,
+// gửi lệnh qua ConnectionPool tới các HeadlessServer rồi gửi email trả lời kèm file kết quả.
+// Các bước đi theo MainFrame::ProcessEmail, FanOutCommands và ExecuteCommandsOnHost, bỏ phần giao diện.
+// Độ trễ một email: từ lúc thả thư vào mock tới khi messages.send trả về.
+//
+// Cách dùng: PipelineBench --mock http://127.0.0.1:<cổng> --servers 127.0.0.1:<cổng>[,...]
+//     [--emails N] [--mailboxes M] [--commands "list::process; help::cmd"] [--poll list|history]
+//     [--work-dir DIR] [--pids tên=pid,...]
+#include "handleMail.h"
+#include "ConnectionPool.h"
+#include "CommandJournal.h"
+#include "CommandRegistry.h"
+#include "PolicyEngine.h"
+#include "Inventory.h"
+#include "Metrics.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string mockUrl;
+    std::string servers;
+    int emails = 200;
+    int mailboxes = 4;
+    std::string commands = "list::process; help::cmd; screenshot::capture";
+    bool history = false;
+    std::string workDir = "e2e_work";
+    std::vector<std::pair<std::string, int>> pids;
+};
+
+struct Totals {
+    std::mutex mutex;
+    std::vector<double> latencyMs;
+    long long commands = 0;
+    long long failedCommands = 0;
+    long long failedEmails = 0;
+    long long quotaUnits = 0;
+};
+
+static size_t collect(void* data, size_t size, size_t count, std::string* out) {
+    out->append(static_cast<char*>(data), size * count);
+    return size * count;
+}
+
+// Gọi endpoint điều khiển của mock (không qua HttpPool để không lẫn vào số liệu của client)
+static bool mockRequest(const std::string& url, const std::string* body, Json::Value& result) {
+    CURL* curl = curl_easy_init();
+    if (!curl) return false;
+    std::string response;
+    curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    if (body) curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body->c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    bool ok = curl_easy_perform(curl) == CURLE_OK;
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    std::istringstream stream(response);
+    return ok && Json::parseFromStream(builder, stream, &result, &errors);
+}
+
+static long long statusKb(int pid, const char* field) {
+    std::ifstream status("/proc/" + (pid == 0 ? std::string("self") : std::to_string(pid)) + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, strlen(field), field) == 0) {
+            return atoll(line.c_str() + strlen(field));
+        }
+    }
+    return -1;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+class Pipeline {
+public:
+    explicit Pipeline(const Options& options)
+        : options(options),
+        journal((fs::path(options.workDir) / "command_journal.jsonl").string()),
+        policy("") {
+        // Chỉ người gửi của kịch bản, DKIM hợp lệ, tới server loopback; không giới hạn tần suất
+        std::string error;
+        policy.loadFromString(R"({
+            "default": "deny",
+            "rate_limit": { "per_minute": 1000000, "burst": 1000000 },
+            "rules": [ { "senders": ["*@example.com"], "auth": "pass", "targets": ["127.0.0.0/8"] } ]
+        })", error);
+    }
+
+    // Một hộp thư: thả thư, đọc lại, chạy lệnh, trả lời; lặp emails lần
+    void runMailbox(int index, int emails, Totals& totals) {
+        std::string account = "mailbox" + std::to_string(index) + "@example.com";
+        std::string sender = "ops" + std::to_string(index) + "@example.com";
+        EmailHandler handler("token-" + std::to_string(index));
+        fs::path tempDir = fs::path(options.workDir) / ("mailbox" + std::to_string(index));
+        fs::create_directories(tempDir);
+
+        unsigned long long historyId = 0;
+        long long expirationMs = 0;
+        if (options.history && !handler.watch("projects/mock/topics/gmail", historyId, expirationMs)) {
+            std::cerr << "users.watch failed" << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < emails; i++) {
+            Json::Value inject;
+            inject["mailbox"] = "token-" + std::to_string(index);
+            inject["from"] = "Ops " + std::to_string(index) + " <" + sender + ">";
+            inject["subject"] = COMMAND_SUBJECT;
+            inject["body"] = options.commands + " - " + options.servers;
+            std::string body = Json::FastWriter().write(inject);
+
+            Clock::time_point start = Clock::now();
+            Json::Value injected;
+            if (!mockRequest(options.mockUrl + "/mock/inject", &body, injected)) {
+                std::cerr << "Cannot reach the Gmail mock" << std::endl;
+                std::lock_guard<std::mutex> lock(totals.mutex);
+                totals.failedEmails++;
+                continue;
+            }
+
+            EmailHandler::EmailInfo email;
+            if (options.history) {
+                // Như OnMailPush: lấy id thư mới từ history rồi đọc từng thư
+                std::vector<std::string> ids;
+                unsigned long long latest = historyId;
+                if (handler.listHistory(historyId, ids, latest) && !ids.empty()) {
+                    email = handler.readEmail(ids.back());
+                }
+                historyId = latest;
+            }
+            else {
+                email = handler.readNewestEmail();
+            }
+
+            int commandCount = 0, failed = 0;
+            bool ok = email.isCommand() && processEmail(handler, email, account, tempDir, commandCount, failed);
+            double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(totals.mutex);
+            totals.latencyMs.push_back(latencyMs);
+            totals.commands += commandCount;
+            totals.failedCommands += failed;
+            if (!ok) totals.failedEmails++;
+        }
+
+        std::lock_guard<std::mutex> lock(totals.mutex);
+        totals.quotaUnits += handler.getQuotaUnitsUsed();
+    }
+
+    ConnectionPool::Stats poolStats() { return pool.getStats(); }
+
+private:
+    struct HostResult {
+        std::string report;
+        std::vector<std::string> attachments;
+        int succeeded = 0;
+        int failed = 0;
+    };
+
+    // MainFrame::ProcessEmail + FanOutCommands + SendCommandReply
+    bool processEmail(EmailHandler& handler, EmailHandler::EmailInfo email, const std::string& account,
+        const fs::path& tempDir, int& commandCount, int& failed) {
+        if (!journal.recordReceived(account, email)) return true;
+
+        std::string content = trim(email.content);
+        size_t lastDash = content.rfind(" - ");
+        if (lastDash == std::string::npos) return false;
+        std::string targetSpec = trim(content.substr(lastDash + 3));
+        std::string error;
+        std::vector<Inventory::Target> targets = inventory.resolve(targetSpec, error);
+
+        std::vector<std::string> commands;
+        std::stringstream list(content.substr(0, lastDash));
+        std::string command;
+        while (std::getline(list, command, ';')) {
+            command = trim(command);
+            if (!command.empty()) commands.push_back(command);
+        }
+
+        PolicyEngine::Request request;
+        request.sender = email.from;
+        request.mailboxAccount = account;
+        request.authenticationResults = email.authenticationResults;
+        for (const Inventory::Target& target : targets) request.targets.push_back({ target.ip });
+        request.commands = commands;
+        PolicyEngine::Decision decision = policy.evaluate(request);
+        if (targets.empty() || !decision.allowed) {
+            std::cerr << "Email rejected: " << (targets.empty() ? error : decision.reason) << std::endl;
+            journal.recordFinished(email.id);
+            return false;
+        }
+
+        std::vector<HostResult> results(targets.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < targets.size(); i++) {
+            std::string prefix = targets.size() > 1 ? "host" + std::to_string(i) + "_" : "";
+            workers.emplace_back([&, i, prefix]() {
+                results[i] = executeOnHost(targets[i], commands, tempDir, prefix, email);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        std::string reply = "This is an automated reply to your email.\nProcessed commands:\n";
+        std::vector<std::string> attachments;
+        for (const HostResult& result : results) {
+            reply += result.report;
+            attachments.insert(attachments.end(), result.attachments.begin(), result.attachments.end());
+            commandCount += result.succeeded + result.failed;
+            failed += result.failed;
+        }
+
+        bool sent = handler.sendReplyEmail(email.from, email.subject, reply, email.threadId, attachments);
+        if (sent) {
+            journal.recordFinished(email.id);
+            for (const std::string& file : attachments) fs::remove(file);
+        }
+        return sent && failed == 0;
+    }
+
+    // MainFrame::ExecuteCommandsOnHost
+    HostResult executeOnHost(const Inventory::Target& target, const std::vector<std::string>& commands,
+        const fs::path& tempDir, const std::string& prefix, const EmailHandler::EmailInfo& email) {
+        HostResult result;
+        SocketClient* session = pool.acquire(target.ip, target.port);
+        if (!session) {
+            result.report = "Failed to connect to server\n";
+            result.failed = static_cast<int>(commands.size());
+            return result;
+        }
+        bool healthy = true;
+
+        for (size_t index = 0; index < commands.size() && healthy; index++) {
+            const std::string& command = commands[index];
+            ParsedCommand parsed = parseCommand(command);
+            if (!parsed.valid() || parsed.spec->internal || parsed.spec->resultKind == ResultKind::Stream) {
+                result.report += "- " + command + ": Invalid command\n";
+                result.failed++;
+                continue;
+            }
+
+            std::string step = target.label() + "#" + std::to_string(index);
+            if (!journal.stepStarted(email.id, step) || session->sendCommand(command) == SOCKET_ERROR) {
+                healthy = false;
+                result.failed++;
+                continue;
+            }
+
+            std::string filename;
+            if (parsed.spec->resultKind != ResultKind::None && parsed.spec->resultKind != ResultKind::Status) {
+                filename = prefix + resultFileName(parsed);
+            }
+            std::string fullPath = (tempDir / filename).string();
+            std::string status;
+            bool ok = true;
+            switch (parsed.spec->resultKind) {
+            case ResultKind::Text:
+            case ResultKind::File:
+                ok = session->receiveFile(fullPath, status);
+                if (!ok && status.empty()) healthy = false;
+                break;
+            case ResultKind::Image:
+                session->receiveAndSaveImage(fullPath);
+                break;
+            case ResultKind::Video:
+                session->receiveVideoData(fullPath);
+                break;
+            case ResultKind::Status:
+                ok = healthy = session->receiveStatus(status);
+                break;
+            default:
+                break;
+            }
+
+            std::string line = "- " + command + ": " + (ok ? "Generated " + filename : "Error: " + status) + "\n";
+            if (ok && !filename.empty()) {
+                result.attachments.push_back(fullPath);
+                session->sendCommand("save_path:" + fullPath);
+            }
+            journal.stepDone(email.id, step, ok, line, ok ? fullPath : "");
+            result.report += line;
+            if (ok) result.succeeded++;
+            else result.failed++;
+        }
+
+        pool.release(session, healthy);
+        return result;
+    }
+
+    const Options& options;
+    CommandJournal journal;
+    PolicyEngine policy;
+    Inventory inventory;
+    ConnectionPool pool{ 4 };
+};
+
+static bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i], value = argv[i + 1];
+        if (name == "--mock") options.mockUrl = value;
+        else if (name == "--servers") options.servers = value;
+        else if (name == "--emails") options.emails = atoi(value.c_str());
+        else if (name == "--mailboxes") options.mailboxes = atoi(value.c_str());
+        else if (name == "--commands") options.commands = value;
+        else if (name == "--poll") options.history = value == "history";
+        else if (name == "--work-dir") options.workDir = value;
+        else if (name == "--pids") {
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                size_t equals = item.find('=');
+                if (equals != std::string::npos) {
+                    options.pids.push_back({ item.substr(0, equals), atoi(item.c_str() + equals + 1) });
+                }
+            }
+        }
+        else return false;
+    }
+    return (argc % 2) == 1 && !options.mockUrl.empty() && !options.servers.empty()
+        && options.emails > 0 && options.mailboxes > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fprintf(stderr, "usage: %s --mock URL --servers IP:PORT[,...] [--emails N] [--mailboxes M]\n"
+            "    [--commands \"cmd; cmd\"] [--poll list|history] [--work-dir DIR] [--pids name=pid,...]\n", argv[0]);
+        return 2;
+    }
+    setenv(GMAIL_API_BASE_ENV, (options.mockUrl + "/gmail/v1/users/me").c_str(), 1);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    fs::remove_all(options.workDir);
+    fs::create_directories(options.workDir);
+    // SocketClient ghi "Data saved to ..." cho mỗi kết quả
+    std::cout.setstate(std::ios::failbit);
+
+    Totals totals;
+    Clock::time_point start = Clock::now();
+    {
+        Pipeline pipeline(options);
+        std::vector<std::thread> mailboxes;
+        for (int i = 0; i < options.mailboxes; i++) {
+            int emails = options.emails / options.mailboxes + (i < options.emails % options.mailboxes ? 1 : 0);
+            mailboxes.emplace_back(&Pipeline::runMailbox, &pipeline, i, emails, std::ref(totals));
+        }
+        for (std::thread& mailbox : mailboxes) mailbox.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        uint64_t socketBytes = Metrics::registry().counter("client_socket_sent_bytes_total", "Bytes sent to servers").value()
+            + Metrics::registry().counter("client_socket_received_bytes_total", "Bytes received from servers").value();
+        Json::Value mockStats;
+        mockRequest(options.mockUrl + "/mock/stats", nullptr, mockStats);
+        long long httpBytes = mockStats["bytesIn"].asInt64() + mockStats["bytesOut"].asInt64();
+        ConnectionPool::Stats pool = pipeline.poolStats();
+        size_t emails = totals.latencyMs.size();
+
+        printf("emails          %zu in %.2f s (%d mailboxes, %s poll), %lld failed\n", emails, seconds,
+            options.mailboxes, options.history ? "history" : "list", totals.failedEmails);
+        printf("throughput      %.1f emails/s, %.1f commands/s\n", emails / seconds, totals.commands / seconds);
+        printf("latency ms      p50 %.2f  p99 %.2f  max %.2f\n", percentile(totals.latencyMs, 0.50),
+            percentile(totals.latencyMs, 0.99), percentile(totals.latencyMs, 1.0));
+        printf("commands        %lld, %lld failed\n", totals.commands, totals.failedCommands);
+        printf("bytes/command   %.0f socket (sent + received)\n",
+            totals.commands ? (double)socketBytes / totals.commands : 0.0);
+        printf("bytes/email     %.0f Gmail API (mock in + out), %.1f quota units\n",
+            emails ? (double)httpBytes / emails : 0.0, emails ? (double)totals.quotaUnits / emails : 0.0);
+        printf("connections     %lld new, %lld reused, %lld stale\n", pool.connects, pool.reuses, pool.staleDrops);
+        printf("rss kB          client %lld (peak %lld)", statusKb(0, "VmRSS:"), statusKb(0, "VmHWM:"));
+        for (const auto& process : options.pids) {
+            printf(", %s %lld (peak %lld)", process.first.c_str(), statusKb(process.second, "VmRSS:"),
+                statusKb(process.second, "VmHWM:"));
+        }
+        printf("\n");
+    }
+    curl_global_cleanup();
+    return totals.failedEmails == 0 && totals.failedCommands == 0 ? 0 : 1;
+}
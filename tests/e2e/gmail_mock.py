@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Giả lập Gmail REST API trên loopback cho tests/e2e (chỉ thư viện chuẩn, không cần mạng).
+
+Client trỏ tới đây qua EMAILPC_GMAIL_API_BASE=http://127.0.0.1:<cổng>/gmail/v1/users/me.
+Mỗi access token (Authorization: Bearer ...) là một hộp thư riêng.
+
+Gmail API:
+  GET  /gmail/v1/users/me/messages?maxResults=N          messages.list, mới -> cũ
+  GET  /gmail/v1/users/me/messages/<id>?format=full      messages.get (multipart/mixed > multipart/alternative)
+  GET  /gmail/v1/users/me/messages/<id>/attachments/<a>  messages.attachments.get
+  GET  /gmail/v1/users/me/history?startHistoryId=N       history.list (messageAdded, có phân trang)
+  POST /gmail/v1/users/me/messages/send                  messages.send
+  POST /gmail/v1/users/me/watch                          users.watch
+  POST /batch/gmail/v1                                   batch (multipart/mixed gồm các request GET ở trên)
+Điều khiển:
+  POST /mock/inject  {"mailbox", "from", "subject", "body", "attachment"?}  thêm thư vào INBOX -> {"id", "historyId"}
+  GET  /mock/stats                                       số request, byte vào/ra và số thư đã gửi
+Cách dùng: gmail_mock.py <cổng> [--latency ms]
+"""
+import argparse
+import base64
+import json
+import threading
+import time
+from email.utils import formatdate
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+API_PREFIX = "/gmail/v1/users/me"
+HISTORY_PAGE_SIZE = 100
+
+
+def b64url(data):
+    return base64.urlsafe_b64encode(data).decode("ascii").rstrip("=")
+
+
+class Mailbox:
+    def __init__(self):
+        self.messages = {}      # id -> message JSON (format=full)
+        self.attachments = {}   # (id, attachmentId) -> bytes
+        self.inbox = []         # id, cũ -> mới
+        self.history = []       # (historyId, id)
+        self.sent = []
+
+
+class Store:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.mailboxes = {}
+        self.next_id = 1
+        self.history_id = 1000
+        self.requests = {}
+        self.bytes_in = 0
+        self.bytes_out = 0
+
+    def mailbox(self, token):
+        box = self.mailboxes.get(token)
+        if box is None:
+            box = self.mailboxes[token] = Mailbox()
+        return box
+
+    def inject(self, token, sender, subject, body, attachment=None):
+        with self.lock:
+            message_id = "%016x" % self.next_id
+            self.next_id += 1
+            self.history_id += 1
+            box = self.mailbox(token)
+            domain = sender.rsplit("@", 1)[-1].rstrip(">")
+            text = {"mimeType": "text/plain", "filename": "",
+                    "headers": [{"name": "Content-Type", "value": "text/plain; charset=UTF-8"}],
+                    "body": {"size": len(body.encode()), "data": b64url(body.encode())}}
+            html = {"mimeType": "text/html", "filename": "",
+                    "headers": [{"name": "Content-Type", "value": "text/html; charset=UTF-8"}],
+                    "body": {"size": 0, "data": b64url(("<div>%s</div>" % body).encode())}}
+            parts = [{"mimeType": "multipart/alternative", "filename": "", "headers": [], "body": {"size": 0},
+                      "parts": [text, html]}]
+            if attachment is not None:
+                # Thư có lệnh trong file .txt đính kèm: nội dung lấy qua messages.attachments.get
+                data = attachment.encode()
+                attachment_id = "att-" + message_id
+                box.attachments[(message_id, attachment_id)] = data
+                parts.append({"mimeType": "text/plain", "filename": "commands.txt",
+                              "headers": [{"name": "Content-Disposition", "value": "attachment; filename=commands.txt"}],
+                              "body": {"size": len(data), "attachmentId": attachment_id}})
+            box.messages[message_id] = {
+                "id": message_id,
+                "threadId": message_id,
+                "labelIds": ["INBOX", "UNREAD"],
+                "historyId": str(self.history_id),
+                "internalDate": str(int(time.time() * 1000)),
+                "payload": {
+                    "mimeType": "multipart/mixed",
+                    "headers": [
+                        {"name": "Authentication-Results",
+                         "value": "mx.google.com; dkim=pass header.i=@%s; spf=pass; dmarc=pass header.from=%s"
+                                  % (domain, domain)},
+                        {"name": "From", "value": sender},
+                        {"name": "To", "value": "me@example.com"},
+                        {"name": "Subject", "value": subject},
+                        {"name": "Date", "value": formatdate(localtime=False)},
+                    ],
+                    "body": {"size": 0},
+                    "parts": parts,
+                },
+            }
+            box.inbox.append(message_id)
+            box.history.append((self.history_id, message_id))
+            return {"id": message_id, "historyId": str(self.history_id)}
+
+
+store = Store()
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    # Header và body được ghi riêng: không tắt Nagle thì mỗi request chờ thêm delayed ACK (~40 ms)
+    disable_nagle_algorithm = True
+    latency = 0.0
+
+    def log_message(self, *args):
+        pass
+
+    def count(self, endpoint, received):
+        with store.lock:
+            store.requests[endpoint] = store.requests.get(endpoint, 0) + 1
+            store.bytes_in += received
+
+    def reply(self, status, body, content_type="application/json"):
+        if not isinstance(body, bytes):
+            body = json.dumps(body).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+        with store.lock:
+            store.bytes_out += len(body)
+
+    def token(self):
+        return self.headers.get("Authorization", "").split(" ")[-1]
+
+    def read_body(self):
+        return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+    def do_GET(self):
+        if self.path == "/mock/stats":
+            with store.lock:
+                sent = sum(len(box.sent) for box in store.mailboxes.values())
+                stats = {"requests": dict(store.requests), "bytesIn": store.bytes_in,
+                         "bytesOut": store.bytes_out, "sent": sent}
+            return self.reply(200, stats)
+        if not self.path.startswith(API_PREFIX + "/"):
+            return self.reply(404, {"error": {"code": 404, "message": "Not found"}})
+        self.count("GET " + self.endpoint(self.path), len(self.requestline))
+        if self.latency:
+            time.sleep(self.latency)
+        status, body = self.api_get(self.token(), self.path[len(API_PREFIX):])
+        self.reply(status, body)
+
+    def do_POST(self):
+        body = self.read_body()
+        if self.path == "/mock/inject":
+            request = json.loads(body)
+            return self.reply(200, store.inject(request["mailbox"], request["from"], request["subject"],
+                                                request.get("body", ""), request.get("attachment")))
+        if self.path == "/batch/gmail/v1":
+            self.count("POST batch", len(body))
+            if self.latency:
+                time.sleep(self.latency)
+            return self.batch(body)
+        if not self.path.startswith(API_PREFIX + "/"):
+            return self.reply(404, {"error": {"code": 404, "message": "Not found"}})
+        self.count("POST " + self.endpoint(self.path), len(body))
+        if self.latency:
+            time.sleep(self.latency)
+        path = self.path[len(API_PREFIX):]
+        token = self.token()
+        if path == "/messages/send":
+            request = json.loads(body)
+            raw = base64.urlsafe_b64decode(request["raw"] + "=" * (-len(request["raw"]) % 4))
+            with store.lock:
+                box = store.mailbox(token)
+                box.sent.append({"threadId": request.get("threadId", ""), "size": len(raw)})
+                sent_id = "sent-%d" % len(box.sent)
+            return self.reply(200, {"id": sent_id, "threadId": request.get("threadId", ""), "labelIds": ["SENT"]})
+        if path == "/watch":
+            with store.lock:
+                history_id = store.history_id
+            return self.reply(200, {"historyId": str(history_id),
+                                    "expiration": str(int(time.time() * 1000) + 7 * 24 * 3600 * 1000)})
+        self.reply(404, {"error": {"code": 404, "message": "Not found"}})
+
+    @staticmethod
+    def endpoint(path):
+        parts = urlsplit(path).path[len(API_PREFIX):].strip("/").split("/")
+        if parts[0] == "messages" and len(parts) >= 4:
+            return "messages.attachments"
+        if parts[0] == "messages" and len(parts) >= 2 and parts[1] != "send":
+            return "messages.get"
+        return ".".join(parts[:2])
+
+    def api_get(self, token, path):
+        url = urlsplit(path)
+        query = parse_qs(url.query)
+        parts = url.path.strip("/").split("/")
+        with store.lock:
+            box = store.mailbox(token)
+            if parts == ["messages"]:
+                limit = int(query.get("maxResults", ["100"])[0])
+                ids = box.inbox[::-1][:limit]
+                return 200, {"messages": [{"id": i, "threadId": i} for i in ids], "resultSizeEstimate": len(ids)} \
+                    if ids else {"resultSizeEstimate": 0}
+            if len(parts) == 2 and parts[0] == "messages":
+                message = box.messages.get(parts[1])
+                return (200, message) if message else (404, {"error": {"code": 404, "message": "Not Found"}})
+            if len(parts) == 4 and parts[0] == "messages" and parts[2] == "attachments":
+                data = box.attachments.get((parts[1], parts[3]))
+                if data is None:
+                    return 404, {"error": {"code": 404, "message": "Not Found"}}
+                return 200, {"size": len(data), "data": b64url(data)}
+            if parts == ["history"]:
+                start = int(query.get("startHistoryId", ["0"])[0])
+                offset = int(query.get("pageToken", ["0"])[0])
+                added = [(h, i) for h, i in box.history if h > start]
+                page = added[offset:offset + HISTORY_PAGE_SIZE]
+                result = {"historyId": str(store.history_id),
+                          "history": [{"id": str(h), "messagesAdded": [
+                              {"message": {"id": i, "threadId": i, "labelIds": ["INBOX", "UNREAD"]}}]}
+                              for h, i in page]}
+                if offset + HISTORY_PAGE_SIZE < len(added):
+                    result["nextPageToken"] = str(offset + HISTORY_PAGE_SIZE)
+                return 200, result
+        return 404, {"error": {"code": 404, "message": "Not found"}}
+
+    # Mỗi phần application/http chứa một request GET; trả về multipart/mixed theo cùng thứ tự
+    def batch(self, body):
+        content_type = self.headers.get("Content-Type", "")
+        if "boundary=" not in content_type:
+            return self.reply(400, {"error": {"code": 400, "message": "Missing boundary"}})
+        boundary = content_type.split("boundary=", 1)[1].strip('"')
+        token = self.token()
+        out_boundary = "batch_mock_%d" % int(time.time() * 1000)
+        chunks = []
+        for part in body.decode().split("--" + boundary)[1:]:
+            if part.startswith("--"):
+                break
+            headers, _, request = part.strip("\r\n").partition("\r\n\r\n")
+            content_id = ""
+            for line in headers.split("\r\n"):
+                if line.lower().startswith("content-id:"):
+                    content_id = line.split(":", 1)[1].strip().strip("<>")
+            request_line = request.split("\r\n", 1)[0].split(" ")
+            inner_token = token
+            for line in request.split("\r\n")[1:]:
+                if line.lower().startswith("authorization:"):
+                    inner_token = line.split(" ")[-1]
+            path = request_line[1] if len(request_line) > 1 else ""
+            if request_line[0] == "GET" and path.startswith(API_PREFIX + "/"):
+                status, result = self.api_get(inner_token, path[len(API_PREFIX):])
+            else:
+                status, result = 400, {"error": {"code": 400, "message": "Only GET is supported in a batch"}}
+            payload = json.dumps(result)
+            chunks.append("--%s\r\nContent-Type: application/http\r\nContent-ID: <response-%s>\r\n\r\n"
+                          "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s\r\n"
+                          % (out_boundary, content_id, status, "OK" if status == 200 else "Error",
+                             len(payload), payload))
+        chunks.append("--%s--\r\n" % out_boundary)
+        self.reply(200, "".join(chunks).encode(), "multipart/mixed; boundary=" + out_boundary)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("port", type=int)
+    parser.add_argument("--latency", type=float, default=0.0, help="độ trễ thêm cho mỗi request Gmail API (ms)")
+    args = parser.parse_args()
+    Handler.latency = args.latency / 1000.0
+    ThreadingHTTPServer.daemon_threads = True
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), Handler)
+    print("gmail mock on http://127.0.0.1:%d%s" % (server.server_address[1], API_PREFIX), flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+// NoiseCrypto.h bằng OpenSSL 3 cho các chương trình kiểm tra trên Linux (bản chính dùng Windows CNG).
+// Khóa bí mật xuất ra dạng 32 byte thô của X25519
+#include "NoiseCrypto.h"
+#include "NoiseCryptoTest.h"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+namespace NoiseCryptoTest {
+
+static std::mutex queueMutex;
+static std::deque<std::vector<uint8_t>> queue;
+
+void queueRandom(const std::vector<uint8_t>& bytes) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.push_back(bytes);
+}
+
+size_t queuedRandom() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queue.size();
+}
+
+void clearQueuedRandom() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.clear();
+}
+
+// false: hàng đợi rỗng; true: đã chép giá trị đầu hàng (valid = đúng kích thước yêu cầu)
+static bool takeQueued(uint8_t* out, size_t size, bool& valid) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (queue.empty()) return false;
+    std::vector<uint8_t> bytes = std::move(queue.front());
+    queue.pop_front();
+    valid = bytes.size() == size;
+    if (valid) memcpy(out, bytes.data(), size);
+    return true;
+}
+
+}
+
+namespace NoiseCrypto {
+
+bool randomBytes(uint8_t* out, size_t size) {
+    bool valid;
+    if (NoiseCryptoTest::takeQueued(out, size, valid)) return valid;
+    return RAND_bytes(out, static_cast<int>(size)) == 1;
+}
+
+bool sha256(const uint8_t* data, size_t size, Key& digest) {
+    return SHA256(data, size, digest.data()) != nullptr;
+}
+
+bool hmacSha256(const Key& key, const uint8_t* data, size_t size, Key& mac) {
+    unsigned int length = static_cast<unsigned int>(mac.size());
+    return HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()), data, size, mac.data(), &length) != nullptr;
+}
+
+static bool rawPublicKey(EVP_PKEY* key, Key& publicBytes) {
+    size_t length = publicBytes.size();
+    return EVP_PKEY_get_raw_public_key(key, publicBytes.data(), &length) == 1 && length == KEY_SIZE;
+}
+
+KeyPair::KeyPair() : handle(nullptr) {
+    publicBytes.fill(0);
+}
+
+KeyPair::~KeyPair() {
+    reset();
+}
+
+KeyPair::KeyPair(KeyPair&& other) noexcept : handle(other.handle), publicBytes(other.publicBytes) {
+    other.handle = nullptr;
+}
+
+KeyPair& KeyPair::operator=(KeyPair&& other) noexcept {
+    if (this != &other) {
+        reset();
+        handle = other.handle;
+        publicBytes = other.publicBytes;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+void KeyPair::reset() {
+    if (handle) {
+        EVP_PKEY_free(static_cast<EVP_PKEY*>(handle));
+        handle = nullptr;
+    }
+}
+
+bool KeyPair::generate() {
+    std::vector<uint8_t> secret(KEY_SIZE);
+    bool valid;
+    if (NoiseCryptoTest::takeQueued(secret.data(), secret.size(), valid)) {
+        return valid && importPrivate(secret);
+    }
+
+    reset();
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, nullptr);
+    bool ok = context && EVP_PKEY_keygen_init(context) == 1 && EVP_PKEY_keygen(context, &key) == 1;
+    EVP_PKEY_CTX_free(context);
+    if (!ok || !rawPublicKey(key, publicBytes)) {
+        EVP_PKEY_free(key);
+        return false;
+    }
+    handle = key;
+    return true;
+}
+
+bool KeyPair::importPrivate(const std::vector<uint8_t>& secret) {
+    reset();
+    if (secret.size() != KEY_SIZE) return false;
+
+    EVP_PKEY* key = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, secret.data(), secret.size());
+    if (!key || !rawPublicKey(key, publicBytes)) {
+        EVP_PKEY_free(key);
+        return false;
+    }
+    handle = key;
+    return true;
+}
+
+std::vector<uint8_t> KeyPair::exportPrivate() const {
+    std::vector<uint8_t> secret(KEY_SIZE);
+    size_t length = secret.size();
+    if (!handle || EVP_PKEY_get_raw_private_key(static_cast<EVP_PKEY*>(handle), secret.data(), &length) != 1) {
+        return {};
+    }
+    return secret;
+}
+
+bool KeyPair::dh(const Key& remotePublic, Key& shared) const {
+    if (!handle) return false;
+
+    EVP_PKEY* remote = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, remotePublic.data(), remotePublic.size());
+    if (!remote) return false;
+    EVP_PKEY_CTX* context = EVP_PKEY_CTX_new(static_cast<EVP_PKEY*>(handle), nullptr);
+    size_t length = shared.size();
+    bool ok = context && EVP_PKEY_derive_init(context) == 1 && EVP_PKEY_derive_set_peer(context, remote) == 1 &&
+        EVP_PKEY_derive(context, shared.data(), &length) == 1 && length == KEY_SIZE;
+    EVP_PKEY_CTX_free(context);
+    EVP_PKEY_free(remote);
+
+    // Điểm bậc thấp cho kết quả toàn số 0, như bản CNG
+    uint8_t any = 0;
+    for (uint8_t byte : shared) any |= byte;
+    return ok && any != 0;
+}
+
+Aead::Aead() : handle(nullptr) {
+}
+
+Aead::~Aead() {
+    reset();
+}
+
+void Aead::reset() {
+    if (handle) {
+        EVP_CIPHER_CTX_free(static_cast<EVP_CIPHER_CTX*>(handle));
+        handle = nullptr;
+    }
+}
+
+bool Aead::setKey(const Key& key) {
+    reset();
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    if (!context || EVP_CipherInit_ex(context, EVP_aes_256_gcm(), nullptr, key.data(), nullptr, -1) != 1) {
+        EVP_CIPHER_CTX_free(context);
+        return false;
+    }
+    handle = context;
+    return true;
+}
+
+static void makeNonce(uint64_t counter, uint8_t nonce[12]) {
+    memset(nonce, 0, 4);
+    for (int i = 0; i < 8; i++) {
+        nonce[4 + i] = static_cast<uint8_t>(counter >> (56 - 8 * i));
+    }
+}
+
+bool Aead::seal(uint64_t nonce, const uint8_t* ad, size_t adSize,
+    const uint8_t* plain, size_t size, uint8_t* out) {
+    if (!handle) return false;
+    EVP_CIPHER_CTX* context = static_cast<EVP_CIPHER_CTX*>(handle);
+    uint8_t iv[12];
+    makeNonce(nonce, iv);
+    int length;
+    return EVP_EncryptInit_ex(context, nullptr, nullptr, nullptr, iv) == 1 &&
+        (adSize == 0 || EVP_EncryptUpdate(context, nullptr, &length, ad, static_cast<int>(adSize)) == 1) &&
+        (size == 0 || EVP_EncryptUpdate(context, out, &length, plain, static_cast<int>(size)) == 1) &&
+        EVP_EncryptFinal_ex(context, out + size, &length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, out + size) == 1;
+}
+
+bool Aead::open(uint64_t nonce, const uint8_t* ad, size_t adSize,
+    const uint8_t* cipher, size_t size, uint8_t* out) {
+    if (!handle || size < TAG_SIZE) return false;
+    EVP_CIPHER_CTX* context = static_cast<EVP_CIPHER_CTX*>(handle);
+    uint8_t iv[12];
+    makeNonce(nonce, iv);
+    size_t plainSize = size - TAG_SIZE;
+    int length;
+    return EVP_DecryptInit_ex(context, nullptr, nullptr, nullptr, iv) == 1 &&
+        (adSize == 0 || EVP_DecryptUpdate(context, nullptr, &length, ad, static_cast<int>(adSize)) == 1) &&
+        (plainSize == 0 || EVP_DecryptUpdate(context, out, &length, cipher, static_cast<int>(plainSize)) == 1) &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, const_cast<uint8_t*>(cipher + plainSize)) == 1 &&
+        EVP_DecryptFinal_ex(context, out + plainSize, &length) == 1;
+}
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+// Điều khiển backend NoiseCrypto của tests/linux (OpenSSL thay cho Windows CNG) từ chương trình kiểm tra
+#include <cstdint>
+#include <vector>
+
+namespace NoiseCryptoTest {
+
+// Các lần randomBytes/KeyPair::generate tiếp theo lấy lần lượt các giá trị này (generate: khóa bí mật 32 byte)
+// thay vì sinh ngẫu nhiên, để bắt tay cho ra đúng các byte của vector kiểm tra. Hết hàng đợi thì ngẫu nhiên lại
+void queueRandom(const std::vector<uint8_t>& bytes);
+// Số giá trị chưa dùng đến; clearQueuedRandom bỏ chúng đi (bắt tay hỏng trước khi sinh khóa tạm)
+size_t queuedRandom();
+void clearQueuedRandom();
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+// Thay cho common/SecureChannel/SecureSocket.h khi chạy trên Linux: kênh không mã hóa,
+// như khi client chưa ghim khóa của server (NoiseCrypto chỉ có bản Windows CNG)
+#include <winsock2.h>
+#include <string>
+
+namespace SecureSocket {
+
+inline bool connectClient(SOCKET, const std::string&, int) { return true; }
+inline bool acceptServer(SOCKET, std::string&) { return true; }
+inline int send(SOCKET s, const char* data, int size, int flags) { return (int)::send(s, data, size, flags | MSG_NOSIGNAL); }
+inline int recv(SOCKET s, char* buffer, int size, int flags) { return (int)::recv(s, buffer, size, flags); }
+inline size_t buffered(SOCKET) { return 0; }
+inline void detach(SOCKET) {}
+
+inline std::string clientPublicKey() { return ""; }
+inline std::string serverPublicKey() { return ""; }
+
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Inventory.h còn include các header này; đường dẫn %APPDATA% đã chuyển sang AppData
+#include "windows.h"
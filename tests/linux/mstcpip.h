@@ -0,0 +1,20 @@
+#pragma once
+#include "winsock2.h"
+
+struct tcp_keepalive {
+    unsigned long onoff;
+    unsigned long keepalivetime;
+    unsigned long keepaliveinterval;
+};
+#define SIO_KEEPALIVE_VALS 0x98000004
+
+// Chỉ hỗ trợ SIO_KEEPALIVE_VALS; idle và interval tính bằng ms như trên Windows
+inline int WSAIoctl(SOCKET s, DWORD, void* in, DWORD, void*, DWORD, DWORD*, void*, void*) {
+    const tcp_keepalive* settings = (const tcp_keepalive*)in;
+    int idle = (int)(settings->keepalivetime / 1000);
+    int interval = (int)(settings->keepaliveinterval / 1000);
+    if (idle < 1) idle = 1;
+    if (interval < 1) interval = 1;
+    return setsockopt(s, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) == 0
+        && setsockopt(s, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) == 0 ? 0 : SOCKET_ERROR;
+}
@@ -0,0 +1,22 @@
+#pragma once
+// K32EnumProcesses đọc /proc (ProcessWatcher của ResultCache)
+#include "windows.h"
+#include <dirent.h>
+#include <cstdlib>
+
+inline BOOL K32EnumProcesses(DWORD* pids, DWORD bytes, DWORD* bytesReturned) {
+    DIR* proc = opendir("/proc");
+    if (!proc) return FALSE;
+    DWORD count = 0;
+    DWORD capacity = bytes / sizeof(DWORD);
+    while (dirent* entry = readdir(proc)) {
+        char* end = nullptr;
+        unsigned long pid = strtoul(entry->d_name, &end, 10);
+        if (*end != '\0' || end == entry->d_name) continue;
+        if (count == capacity) break;
+        pids[count++] = (DWORD)pid;
+    }
+    closedir(proc);
+    *bytesReturned = count * sizeof(DWORD);
+    return TRUE;
+}
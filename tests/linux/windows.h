@@ -0,0 +1,38 @@
+#pragma once
+// Thay thế tối thiểu cho <windows.h> để build các module không phụ thuộc giao diện trên Linux (xem tests/run.sh).
+// Chỉ có những kiểu và hàm mà các module đó dùng; không dùng cho code GUI.
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned char UCHAR;
+typedef UCHAR* PUCHAR;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef unsigned long ULONG;
+typedef long HRESULT;
+typedef long NTSTATUS;
+typedef unsigned int UINT;
+typedef void* HANDLE;
+typedef wchar_t* PWSTR;
+typedef const wchar_t* LPCWSTR;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+#define MAX_PATH 260
+#define SUCCEEDED(hr) ((hr) >= 0)
+#define FAILED(hr) ((hr) < 0)
+#define ZeroMemory(p, n) memset((p), 0, (n))
+
+inline DWORD GetLastError() { return (DWORD)errno; }
+inline void SecureZeroMemory(void* p, size_t n) {
+    volatile unsigned char* bytes = (volatile unsigned char*)p;
+    while (n--) *bytes++ = 0;
+}
+inline void Sleep(DWORD ms) { usleep((useconds_t)ms * 1000); }
@@ -0,0 +1,29 @@
+#pragma once
+// Winsock trên socket POSIX (xem windows.h cùng thư mục)
+#include "windows.h"
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET ((SOCKET)-1)
+#define SOCKET_ERROR (-1)
+#define SD_RECEIVE SHUT_RD
+#define SD_SEND SHUT_WR
+#define SD_BOTH SHUT_RDWR
+#define MAKEWORD(low, high) ((WORD)(((BYTE)(low)) | ((WORD)((BYTE)(high))) << 8))
+
+struct WSADATA { WORD wVersion; };
+inline int WSAStartup(WORD, WSADATA*) { return 0; }
+inline int WSACleanup() { return 0; }
+inline int WSAGetLastError() { return errno; }
+inline int closesocket(SOCKET s) { return ::close(s); }
+
+// Winsock bỏ qua tham số đầu của select; trên POSIX nó là fd lớn nhất + 1
+inline int winsockSelect(int, fd_set* readSet, fd_set* writeSet, fd_set* exceptSet, timeval* timeout) {
+    return ::select(FD_SETSIZE, readSet, writeSet, exceptSet, timeout);
+}
+#define select winsockSelect
@@ -0,0 +1,145 @@
+#!/usr/bin/env bash
+# Build và chạy test/benchmark của các module không phụ thuộc giao diện trên Linux bằng g++.
+# tests/linux thay cho các header Windows mà các module đó dùng. Không cần mạng.
+# Cách dùng: tests/run.sh [unit|bench|e2e] [tên chương trình...]
+#   unit: các chương trình kiểm tra, dừng ở chương trình đầu tiên thất bại
+#   e2e: gmail_mock.py + HeadlessServer trên các cổng loopback trống, PipelineBench đo toàn bộ đường đi.
+#        E2E_SERVERS, E2E_EMAILS, E2E_MAILBOXES, E2E_POLL (list|history) thay đổi kịch bản
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+OUT="${BUILD_DIR:-$ROOT/_test_build}"
+CXX="${CXX:-g++}"
+CXXFLAGS=(-std=c++17 -O2 -g -pthread -Wall -Wno-unknown-pragmas -Itests/linux)
+mkdir -p "$OUT"
+cd "$ROOT"
+
+MODE="${1:-bench}"
+shift || true
+ONLY=("$@")
+
+selected() {
+    [ ${#ONLY[@]} -eq 0 ] && return 0
+    local name
+    for name in "${ONLY[@]}"; do [ "$name" = "$1" ] && return 0; done
+    return 1
+}
+
+# build <tên> <cờ và nguồn cho g++...>: đường dẫn tính từ thư mục gốc của repo
+build() {
+    local name="$1"
+    shift
+    selected "$name" || return 0
+    echo "== build $name"
+    "$CXX" "${CXXFLAGS[@]}" "$@" -o "$OUT/$name"
+}
+
+# run <tên> [tham số...]
+run() {
+    local name="$1"
+    shift
+    selected "$name" || return 0
+    echo "== run $name $*"
+    "$OUT/$name" "$@"
+}
+
+CLIENT_SOCKET=(-Iclient/Socket -Icommon/Metrics -Icommon/CommandRegistry -Icommon/ScreenStream
+    client/Socket/socket.cpp common/Metrics/Metrics.cpp)
+# SecureChannel với NoiseCrypto bằng OpenSSL (tests/linux/NoiseCryptoOpenSSL.cpp) thay cho Windows CNG
+SECURE_CHANNEL=(-Icommon/SecureChannel common/SecureChannel/SecureChannel.cpp tests/linux/NoiseCryptoOpenSSL.cpp -lcrypto)
+HEADLESS_SERVER=(-Iserver/Socket -Iserver/CommandScheduler -Iserver/ResultCache -Iserver/FileTransfer
+    -Icommon/CommandRegistry -Icommon/Metrics -Icommon/ScreenStream
+    tests/e2e/HeadlessServer.cpp server/Socket/socket.cpp server/CommandScheduler/CommandScheduler.cpp
+    server/ResultCache/ResultCache.cpp server/FileTransfer/FileTransfer.cpp common/Metrics/Metrics.cpp)
+MIME_WALKER=(-Iclient/MimeWalker -Iclient/JsonScan -Iclient/utils client/MimeWalker/MimeWalker.cpp
+    client/JsonScan/JsonScan.cpp client/utils/utils.cpp)
+# MailHeader giải mã charset bằng MimeWalker::toUtf8
+MAIL_HEADER=(-Iclient/MailHeader client/MailHeader/MailHeader.cpp "${MIME_WALKER[@]}")
+POLICY_ENGINE=(-I/usr/include/jsoncpp -Iclient/PolicyEngine -Icommon/CommandRegistry -Icommon/ScreenStream
+    -Icommon/Metrics -Icommon/AppData "${MAIL_HEADER[@]}" client/PolicyEngine/PolicyEngine.cpp
+    common/Metrics/Metrics.cpp common/AppData/AppData.cpp -ljsoncpp)
+
+case "$MODE" in
+unit)
+    build SecureChannelTest tests/unit/SecureChannelTest.cpp "${SECURE_CHANNEL[@]}"
+    run SecureChannelTest
+    build CommandJournalTest -I/usr/include/jsoncpp -Iclient/CommandJournal -Iclient/handleMail -Icommon/Metrics \
+        -Icommon/AppData tests/unit/CommandJournalTest.cpp client/CommandJournal/CommandJournal.cpp \
+        common/Metrics/Metrics.cpp common/AppData/AppData.cpp -ljsoncpp
+    run CommandJournalTest
+    build PolicyEngineTest tests/unit/PolicyEngineTest.cpp "${POLICY_ENGINE[@]}"
+    run PolicyEngineTest
+    build FileTransferTest -Iserver/FileTransfer tests/unit/FileTransferTest.cpp server/FileTransfer/FileTransfer.cpp
+    run FileTransferTest
+    build MailHeaderTest tests/unit/MailHeaderTest.cpp "${MAIL_HEADER[@]}"
+    run MailHeaderTest
+    build JsonScanTest -Iclient/JsonScan tests/unit/JsonScanTest.cpp client/JsonScan/JsonScan.cpp
+    run JsonScanTest
+    build MimeWalkerTest tests/unit/MimeWalkerTest.cpp "${MIME_WALKER[@]}"
+    run MimeWalkerTest tests/unit/mime_corpus.json
+    ;;
+bench)
+    build ConnectionPoolBench -Iclient/ConnectionPool "${CLIENT_SOCKET[@]}" \
+        tests/bench/ConnectionPoolBench.cpp client/ConnectionPool/ConnectionPool.cpp
+    run ConnectionPoolBench 500 1 2048
+    build SecureChannelBench tests/bench/SecureChannelBench.cpp "${SECURE_CHANNEL[@]}"
+    run SecureChannelBench 2000 512
+    build PolicyEngineBench tests/bench/PolicyEngineBench.cpp "${POLICY_ENGINE[@]}"
+    run PolicyEngineBench 10000 200000
+    build MailHeaderBench tests/bench/MailHeaderBench.cpp "${MAIL_HEADER[@]}"
+    run MailHeaderBench 20000
+    build JsonScanBench -I/usr/include/jsoncpp -Iclient/JsonScan tests/bench/JsonScanBench.cpp \
+        client/JsonScan/JsonScan.cpp -ljsoncpp
+    run JsonScanBench
+    build MimeWalkerBench -I/usr/include/jsoncpp tests/bench/MimeWalkerBench.cpp "${MIME_WALKER[@]}" -ljsoncpp
+    run MimeWalkerBench 2000
+    # FileTransferBench tự chạy HeadlessServer
+    if selected FileTransferBench && [ ${#ONLY[@]} -gt 0 ]; then
+        ONLY+=(HeadlessServer)
+    fi
+    build HeadlessServer "${HEADLESS_SERVER[@]}"
+    build FileTransferBench "${CLIENT_SOCKET[@]}" tests/bench/FileTransferBench.cpp
+    run FileTransferBench "$OUT/HeadlessServer" 10000 1024
+    ;;
+e2e)
+    build HeadlessServer "${HEADLESS_SERVER[@]}"
+    build PipelineBench -I/usr/include/jsoncpp -Iclient/handleMail -Iclient/HttpPool -Iclient/JsonScan \
+        -Iclient/MimeWalker -Iclient/MailHeader -Iclient/utils -Iclient/ConnectionPool -Iclient/CommandJournal \
+        -Iclient/PolicyEngine -Iclient/Inventory -Icommon/AppData "${CLIENT_SOCKET[@]}" \
+        tests/e2e/PipelineBench.cpp client/handleMail/handleMail.cpp client/HttpPool/HttpPool.cpp \
+        client/JsonScan/JsonScan.cpp client/MimeWalker/MimeWalker.cpp client/MailHeader/MailHeader.cpp \
+        client/utils/utils.cpp client/ConnectionPool/ConnectionPool.cpp client/CommandJournal/CommandJournal.cpp \
+        client/PolicyEngine/PolicyEngine.cpp client/Inventory/Inventory.cpp common/AppData/AppData.cpp \
+        -lcurl -ljsoncpp
+    selected PipelineBench || exit 0
+
+    # Cổng trống do hệ điều hành chọn
+    free_port() {
+        python3 -c 'import socket; s = socket.socket(); s.bind(("127.0.0.1", 0)); print(s.getsockname()[1])'
+    }
+    PIDS=()
+    trap 'kill "${PIDS[@]}" 2>/dev/null; wait 2>/dev/null' EXIT
+
+    MOCK_PORT="$(free_port)"
+    python3 tests/e2e/gmail_mock.py "$MOCK_PORT" &
+    PIDS+=($!)
+    PROCESSES="mock=$!"
+    SERVERS=""
+    for _ in $(seq "${E2E_SERVERS:-2}"); do
+        PORT="$(free_port)"
+        "$OUT/HeadlessServer" "$PORT" 4096 65536 1 >/dev/null &
+        PIDS+=($!)
+        PROCESSES="$PROCESSES,server$PORT=$!"
+        SERVERS="${SERVERS:+$SERVERS,}127.0.0.1:$PORT"
+    done
+    sleep 1
+
+    run PipelineBench --mock "http://127.0.0.1:$MOCK_PORT" --servers "$SERVERS" \
+        --emails "${E2E_EMAILS:-200}" --mailboxes "${E2E_MAILBOXES:-4}" --poll "${E2E_POLL:-list}" \
+        --work-dir "$OUT/e2e_work" --pids "$PROCESSES"
+    ;;
+*)
+    echo "usage: $0 [unit|bench|e2e] [program...]" >&2
+    exit 2
+    ;;
+esac
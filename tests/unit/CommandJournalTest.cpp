@@ -0,0 +1,307 @@
+// Kiểm tra CommandJournal trong một thư mục tạm.
+// - Trạng thái bước và email chưa xong còn nguyên sau khi mở lại, sau khi nén, và khi dòng cuối bị cắt
+// - Không ghi được nhật ký thì stepStarted trả false (người gọi không gửi lệnh)
+// - Tắt đột ngột: chạy lại chính chương trình này ở chế độ "child" (xử lý EMAILS email giống ProcessEmail,
+//   mỗi email HOSTS host song song, mỗi host COMMANDS lệnh) và SIGKILL nó ở thời điểm ngẫu nhiên cho tới khi
+//   nó chạy xong. Mỗi lệnh phải chạy đúng một lần; lệnh không chạy chỉ được phép khi đã báo "không rõ kết quả"
+//   (InDoubt), và email nào cũng có trả lời.
+// Cách dùng: CommandJournalTest [seed]
+#include "CommandJournal.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+static const int EMAILS = 100;
+static const int HOSTS = 16;
+static const int COMMANDS = 3;
+
+static EmailHandler::EmailInfo makeEmail(int index) {
+    EmailHandler::EmailInfo email;
+    email.id = "m" + std::to_string(index);
+    email.subject = COMMAND_SUBJECT;
+    email.from = "ops@example.com";
+    email.content = "list::process; help::cmd; screenshot::capture - 10.0.0.0/28";
+    email.threadId = "t" + std::to_string(index);
+    email.internalDateMs = 1700000000000LL + index;
+    return email;
+}
+
+static size_t countLines(const fs::path& path) {
+    std::ifstream file(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) lines++;
+    return lines;
+}
+
+static void testReopen(const fs::path& dir) {
+    std::string path = (dir / "reopen.jsonl").string();
+    {
+        CommandJournal journal(path);
+        CHECK(journal.recordReceived("account", makeEmail(1)));
+        CHECK(journal.recordReceived("account", makeEmail(2)));
+        CHECK(journal.stepStarted("m1", "10.0.0.1#0"));
+        journal.stepDone("m1", "10.0.0.1#0", true, "- list::process: Generated process_list.txt\n", "C:\\tmp\\a.txt");
+        CHECK(journal.stepStarted("m1", "10.0.0.1#1"));
+        CHECK(journal.stepStarted("m1", "10.0.0.1#2"));
+        journal.stepDone("m1", "10.0.0.1#2", false, "- screenshot::capture: Error\n", "");
+        journal.recordFinished("m2");
+    }
+
+    CommandJournal journal(path);
+    std::string result, attachment;
+    CHECK(journal.stepState("m1", "10.0.0.1#0", result, attachment) == CommandJournal::StepState::Succeeded);
+    CHECK(result == "- list::process: Generated process_list.txt\n" && attachment == "C:\\tmp\\a.txt");
+    CHECK(journal.stepState("m1", "10.0.0.1#1", result, attachment) == CommandJournal::StepState::InDoubt);
+    CHECK(journal.stepState("m1", "10.0.0.1#2", result, attachment) == CommandJournal::StepState::Failed);
+    CHECK(journal.stepState("m1", "10.0.0.2#0", result, attachment) == CommandJournal::StepState::NotStarted);
+
+    std::vector<CommandJournal::Entry> unfinished = journal.unfinished();
+    CHECK(unfinished.size() == 1);
+    CHECK(!unfinished.empty() && unfinished[0].account == "account" && unfinished[0].email.id == "m1" &&
+        unfinished[0].email.content == makeEmail(1).content && unfinished[0].email.threadId == "t1");
+
+    // Email đã xong: nhận lại (poll trùng, khởi động lại) thì không xử lý lần nữa
+    CHECK(journal.isKnown("m2"));
+    CHECK(!journal.recordReceived("account", makeEmail(2)));
+    CHECK(journal.recordReceived("account", makeEmail(1)));
+    CHECK(journal.newestInternalDateMs() == makeEmail(2).internalDateMs);
+}
+
+// Dòng cuối bị cắt giữa chừng khi tiến trình bị tắt: bỏ dòng đó, giữ phần trước
+static void testTornLastLine(const fs::path& dir) {
+    std::string path = (dir / "torn.jsonl").string();
+    {
+        CommandJournal journal(path);
+        journal.recordReceived("account", makeEmail(1));
+        CHECK(journal.stepStarted("m1", "h#0"));
+    }
+    {
+        std::ofstream file(path, std::ios::app | std::ios::binary);
+        file << "{\"op\":\"done\",\"id\":\"m1\",\"st";
+    }
+
+    CommandJournal journal(path);
+    std::string result, attachment;
+    CHECK(journal.stepState("m1", "h#0", result, attachment) == CommandJournal::StepState::InDoubt);
+    CHECK(journal.unfinished().size() == 1);
+    // Ghi tiếp sau dòng hỏng vẫn đọc lại được
+    journal.stepDone("m1", "h#0", true, "ok\n", "");
+    journal.flush();
+    CommandJournal reopened(path);
+    CHECK(reopened.stepState("m1", "h#0", result, attachment) == CommandJournal::StepState::Succeeded);
+}
+
+// Sau COMPACT_AFTER_RECORDS dòng, file chỉ còn trạng thái hiện tại
+static void testCompaction(const fs::path& dir) {
+    std::string path = (dir / "compact.jsonl").string();
+    {
+        CommandJournal journal(path);
+        journal.recordReceived("account", makeEmail(0));
+        CHECK(journal.stepStarted("m0", "h#0"));
+        journal.stepDone("m0", "h#0", true, "ok\n", "");
+        CHECK(journal.stepStarted("m0", "h#1"));
+        for (size_t i = 1; i <= CommandJournal::COMPACT_AFTER_RECORDS; i++) {
+            journal.recordReceived("account", makeEmail(static_cast<int>(i)));
+            journal.recordFinished("m" + std::to_string(i));
+        }
+    }
+    CHECK(countLines(path) < CommandJournal::COMPACT_AFTER_RECORDS);
+
+    CommandJournal journal(path);
+    std::string result, attachment;
+    CHECK(journal.stepState("m0", "h#0", result, attachment) == CommandJournal::StepState::Succeeded);
+    CHECK(journal.stepState("m0", "h#1", result, attachment) == CommandJournal::StepState::InDoubt);
+    CHECK(journal.unfinished().size() == 1);
+    // Chỉ MAX_FINISHED_IDS email xong gần nhất được giữ để chống trùng
+    CHECK(journal.isKnown("m" + std::to_string(CommandJournal::COMPACT_AFTER_RECORDS)));
+    CHECK(!journal.isKnown("m1"));
+}
+
+// Thư mục của nhật ký biến mất: không ghi được thì không cho gửi lệnh, có lại thì ghi tiếp
+static void testUnwritable(const fs::path& dir) {
+    fs::path subdir = dir / "gone";
+    fs::create_directories(subdir);
+    CommandJournal journal((subdir / "journal.jsonl").string());
+    CHECK(journal.stepStarted("m1", "h#0"));
+
+    // Mỗi dòng không ghi được đều in lỗi ra stderr: ẩn đi trong lúc cố ý xóa thư mục
+    fflush(stderr);
+    int savedStderr = dup(STDERR_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDERR_FILENO);
+
+    fs::remove_all(subdir);
+    for (size_t i = 0; i <= CommandJournal::COMPACT_AFTER_RECORDS; i++) {
+        EmailHandler::EmailInfo email = makeEmail(static_cast<int>(i));
+        journal.recordReceived("account", email);
+        journal.recordFinished(email.id);
+    }
+    bool startedWithoutFile = journal.stepStarted("m2", "h#0");
+
+    fs::create_directories(subdir);
+    bool startedAfterRestore = journal.stepStarted("m3", "h#0");
+
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+    close(devNull);
+    CHECK(!startedWithoutFile);
+    CHECK(startedAfterRestore);
+}
+
+// ---- Tắt đột ngột ----
+
+// Một dòng mỗi lần write với O_APPEND: không lẫn giữa các thread, còn nguyên khi tiến trình bị SIGKILL
+static void logLine(const fs::path& file, const std::string& line) {
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (fd < 0) return;
+    std::string data = line + "\n";
+    if (write(fd, data.data(), data.size()) < 0) perror("write");
+    close(fd);
+}
+
+// Như MainFrame::ProcessEmail + ExecuteCommandsOnHost: effects.log thay cho việc server chạy lệnh,
+// replies.log thay cho email trả lời
+static void processEmail(CommandJournal& journal, const fs::path& dir, const EmailHandler::EmailInfo& email) {
+    if (!journal.recordReceived("account", email)) return;
+
+    std::vector<std::thread> hosts;
+    for (int host = 0; host < HOSTS; host++) {
+        hosts.emplace_back([&, host]() {
+            for (int command = 0; command < COMMANDS; command++) {
+                std::string step = "10.0.0." + std::to_string(host) + "#" + std::to_string(command);
+                std::string result, attachment;
+                CommandJournal::StepState state = journal.stepState(email.id, step, result, attachment);
+                if (state == CommandJournal::StepState::InDoubt) {
+                    logLine(dir / "indoubt.log", email.id + " " + step);
+                    continue;
+                }
+                if (state != CommandJournal::StepState::NotStarted || !journal.stepStarted(email.id, step)) continue;
+                usleep(200);
+                logLine(dir / "effects.log", email.id + " " + step);
+                journal.stepDone(email.id, step, true, "- command: ok\n", "");
+            }
+        });
+    }
+    for (std::thread& host : hosts) host.join();
+    logLine(dir / "replies.log", email.id);
+    journal.recordFinished(email.id);
+}
+
+static int runChild(const fs::path& dir) {
+    CommandJournal journal((dir / "journal.jsonl").string());
+    for (const CommandJournal::Entry& entry : journal.unfinished()) {
+        processEmail(journal, dir, entry.email);
+    }
+    for (int i = 1; i <= EMAILS; i++) {
+        processEmail(journal, dir, makeEmail(i));
+    }
+    return 0;
+}
+
+static void testCrashInjection(const char* self, const fs::path& dir, unsigned seed) {
+    std::mt19937 random(seed);
+    int kills = 0;
+    while (true) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            execl("/proc/self/exe", self, "child", dir.c_str(), (char*)nullptr);
+            _exit(99);
+        }
+        usleep(random() % 60000);
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+            break;
+        }
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        kills++;
+    }
+
+    std::map<std::string, int> effects, inDoubt, replies;
+    std::string id, step;
+    {
+        std::ifstream file(dir / "effects.log");
+        while (file >> id >> step) effects[id + " " + step]++;
+    }
+    {
+        std::ifstream file(dir / "indoubt.log");
+        while (file >> id >> step) inDoubt[id + " " + step]++;
+    }
+    {
+        std::ifstream file(dir / "replies.log");
+        while (file >> id) replies[id]++;
+    }
+
+    int once = 0, repeated = 0, reportedNotRun = 0, silentlyLost = 0, missingReplies = 0;
+    for (int i = 1; i <= EMAILS; i++) {
+        std::string emailId = "m" + std::to_string(i);
+        if (replies[emailId] == 0) missingReplies++;
+        for (int host = 0; host < HOSTS; host++) {
+            for (int command = 0; command < COMMANDS; command++) {
+                std::string key = emailId + " 10.0.0." + std::to_string(host) + "#" + std::to_string(command);
+                int runs = effects[key];
+                if (runs == 1) once++;
+                else if (runs > 1) repeated++;
+                else if (inDoubt[key]) reportedNotRun++;
+                else silentlyLost++;
+            }
+        }
+    }
+
+    printf("crash injection (seed %u): %d kills, %d steps: %d once, %d in doubt, %d repeated, %d lost, "
+        "%d emails without reply\n", seed, kills, EMAILS * HOSTS * COMMANDS, once, reportedNotRun, repeated,
+        silentlyLost, missingReplies);
+    CHECK(repeated == 0);
+    CHECK(silentlyLost == 0);
+    CHECK(missingReplies == 0);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::string(argv[1]) == "child") {
+        return runChild(argv[2]);
+    }
+
+    char pattern[] = "/tmp/CommandJournalTest.XXXXXX";
+    if (!mkdtemp(pattern)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    fs::path dir = pattern;
+
+    testReopen(dir);
+    testTornLastLine(dir);
+    testCompaction(dir);
+    testUnwritable(dir);
+
+    fs::path crashDir = dir / "crash";
+    fs::create_directories(crashDir);
+    unsigned seed = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : std::random_device{}();
+    testCrashInjection(argv[0], crashDir, seed);
+
+    if (failures == 0) fs::remove_all(dir);
+    else fprintf(stderr, "journal files kept in %s\n", dir.c_str());
+    printf(failures ? "CommandJournalTest: %d failures\n" : "CommandJournalTest: all passed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
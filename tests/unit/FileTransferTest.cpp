@@ -0,0 +1,256 @@
+// Kiểm tra FileTransfer trong một thư mục tạm, đọc kết quả đúng theo khung gửi về client.
+// - matchGlob, parseListArgs (thư mục có khoảng trắng, có dấu nháy, cờ ở cuối)
+// - file::get một file, file không có, thư mục, glob không khớp, glob ở phần thư mục
+// - file::get glob: tar giải nén được bằng tar hệ thống (cần có lệnh tar) và đúng từng byte, kể cả tên
+//   dài hơn 100 byte (prefix ustar và GNU longlink), file rỗng, file lớn hơn bộ đệm gom
+// - file::list: dòng tiêu đề, cột, tên tương đối, escape tab, recursive, cột hash (SHA-256 chỉ tính trên
+//   Windows qua CNG; ở đây là "-"), thư mục không có
+// Cách dùng: FileTransferTest
+#include "FileTransfer.h"
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+// int64 kích thước, dữ liệu, rồi int32 độ dài + message trạng thái
+struct Frame {
+    bool complete = false;
+    long long size = 0;
+    std::string data;
+    std::string status;
+};
+
+static Frame parseFrame(const std::string& wire) {
+    Frame frame;
+    size_t offset = sizeof(frame.size);
+    if (wire.size() < offset) return frame;
+    memcpy(&frame.size, wire.data(), sizeof(frame.size));
+    if (frame.size >= 0) {
+        if (wire.size() < offset + frame.size) return frame;
+        frame.data = wire.substr(offset, frame.size);
+        offset += frame.size;
+    }
+    int32_t length;
+    if (wire.size() < offset + sizeof(length)) return frame;
+    memcpy(&length, wire.data() + offset, sizeof(length));
+    offset += sizeof(length);
+    if (length < 0 || wire.size() != offset + length) return frame;
+    frame.status = wire.substr(offset, length);
+    frame.complete = true;
+    return frame;
+}
+
+static void writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+struct Capture {
+    std::string wire;
+    FileTransfer::Sink sink = [this](const char* data, size_t size) {
+        wire.append(data, size);
+        return true;
+    };
+};
+
+static void testGlobAndArgs() {
+    using FileTransfer::matchGlob;
+    CHECK(matchGlob("*.txt", "a.txt"));
+    CHECK(!matchGlob("*.txt", "a.txt.bak"));
+    CHECK(matchGlob("a?c", "abc"));
+    CHECK(matchGlob("a?c", "a\xc3\xa9" "c"));   // ? là một ký tự UTF-8, không phải một byte
+    CHECK(matchGlob("*", ""));
+    CHECK(matchGlob("*a*b*", "xxaybzb"));
+    CHECK(!matchGlob("*a*b", "xxaybz"));
+    CHECK(FileTransfer::hasWildcard("C:\\logs\\*.txt"));
+    CHECK(!FileTransfer::hasWildcard("C:\\logs\\a.txt"));
+
+    FileTransfer::ListOptions options = FileTransfer::parseListArgs("C:\\My Files *.log recursive hash");
+    CHECK(options.directory == "C:\\My Files" && options.pattern == "*.log" && options.recursive && options.hash);
+    options = FileTransfer::parseListArgs("C:\\logs");
+    CHECK(options.directory == "C:\\logs" && options.pattern == "*" && !options.recursive && !options.hash);
+    options = FileTransfer::parseListArgs("\"C:\\a hash\" report.txt");
+    CHECK(options.directory == "C:\\a hash" && options.pattern == "report.txt" && !options.hash);
+    options = FileTransfer::parseListArgs("/tmp -r");
+    CHECK(options.directory == "/tmp" && options.recursive);
+}
+
+// Cây thử: tên dài cần prefix ustar (thư mục 120 byte) và GNU longlink (tên file 150 byte)
+static void makeTree(const fs::path& root) {
+    writeFile(root / "a.txt", "hello");
+    writeFile(root / "b.log", std::string(1000, 'b'));
+    writeFile(root / "sub/c.txt", std::string(70000, 'c'));
+    writeFile(root / "sub/empty.txt", "");
+    writeFile(root / "sub" / std::string(120, 'd') / "x.txt", "long prefix");
+    writeFile(root / "sub" / (std::string(150, 'n') + ".txt"), "gnu longlink");
+    writeFile(root / "tab\tname.txt", "t");
+}
+
+static void testSingleFile(const fs::path& root) {
+    std::string summary;
+    Capture capture;
+    CHECK(FileTransfer::sendPath(capture.sink, (root / "sub/c.txt").string(), summary));
+    Frame frame = parseFrame(capture.wire);
+    CHECK(frame.complete && frame.size == 70000 && frame.data == std::string(70000, 'c'));
+    CHECK(frame.status == "File sent successfully.");
+
+    // Lỗi: kích thước -1 và chỉ có message
+    const char* failing[] = { "nope.txt", "", "*/x.txt", "*.zip" };
+    for (const char* name : failing) {
+        Capture error;
+        CHECK(!FileTransfer::sendPath(error.sink, (root / name).string(), summary));
+        frame = parseFrame(error.wire);
+        CHECK(frame.complete && frame.size == -1 && !frame.status.empty());
+    }
+}
+
+// Giải nén bằng tar hệ thống rồi so với cây gốc
+static void checkArchive(const fs::path& root, const fs::path& scratch, const std::string& pattern) {
+    std::string summary;
+    Capture capture;
+    CHECK(FileTransfer::sendPath(capture.sink, (root / pattern).string(), summary));
+    Frame frame = parseFrame(capture.wire);
+    CHECK(frame.complete && frame.size % 512 == 0);
+    if (pattern != "*.txt") {
+        // Chỉ tên file 150 byte cần longlink; thư mục 120 byte vừa prefix ustar
+        size_t longLinks = 0;
+        for (size_t at = frame.data.find("././@LongLink"); at != std::string::npos;
+            at = frame.data.find("././@LongLink", at + 1)) {
+            longLinks++;
+        }
+        CHECK(longLinks == 1);
+    }
+
+    fs::path archive = scratch / "out.tar";
+    fs::path extracted = scratch / "extracted";
+    fs::remove_all(extracted);
+    fs::create_directories(extracted);
+    writeFile(archive, frame.data);
+    std::string command = "tar -xf '" + archive.string() + "' -C '" + extracted.string() + "'";
+    CHECK(system(command.c_str()) == 0);
+
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file()) continue;
+        fs::path relative = entry.path().lexically_relative(root);
+        bool expected = pattern == "**" ||
+            (pattern == "*.txt" ? relative.parent_path().empty() && relative.extension() == ".txt"
+                : relative.extension() == ".txt");
+        fs::path copy = extracted / relative;
+        if (fs::exists(copy) != expected) {
+            fprintf(stderr, "FAIL %s: %s %s\n", pattern.c_str(), relative.c_str(), expected ? "missing" : "unexpected");
+            failures++;
+        }
+        else if (expected) {
+            CHECK(readFile(copy) == readFile(entry.path()));
+        }
+    }
+}
+
+static std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line)) lines.push_back(line);
+    return lines;
+}
+
+static void testListing(const fs::path& root) {
+    std::string summary;
+    Capture capture;
+    CHECK(FileTransfer::sendListing(capture.sink, FileTransfer::parseListArgs(root.string()), summary));
+    Frame frame = parseFrame(capture.wire);
+    CHECK(frame.complete);
+    std::vector<std::string> lines = splitLines(frame.data);
+    // Tiêu đề, rồi a.txt, b.log, sub/, tab\tname.txt
+    CHECK(lines.size() == 5);
+    CHECK(!lines.empty() && lines[0] == "# type\tsize\tmtime\tname");
+    bool sawDirectory = false;
+    for (const std::string& line : lines) {
+        if (line[0] == '#') continue;
+        std::vector<std::string> columns;
+        size_t start = 0;
+        for (size_t tab = line.find('\t'); tab != std::string::npos; tab = line.find('\t', start)) {
+            columns.push_back(line.substr(start, tab - start));
+            start = tab + 1;
+        }
+        columns.push_back(line.substr(start));
+        CHECK(columns.size() == 4);
+        if (columns.size() != 4) continue;
+        if (columns[3] == "sub/") {
+            sawDirectory = true;
+            CHECK(columns[0] == "d" && columns[1] == "-");
+        }
+        if (columns[3] == "b.log") {
+            CHECK(columns[0] == "f" && columns[1] == "1000");
+            CHECK(atoll(columns[2].c_str()) > 1000000000LL);
+        }
+    }
+    CHECK(sawDirectory);
+    CHECK(frame.data.find("tab\\tname.txt") != std::string::npos);
+
+    Capture recursive;
+    CHECK(FileTransfer::sendListing(recursive.sink, FileTransfer::parseListArgs(root.string() + " *.txt recursive hash"),
+        summary));
+    frame = parseFrame(recursive.wire);
+    CHECK(frame.complete);
+    CHECK(frame.data.find("\tsub/c.txt\t") != std::string::npos);
+    CHECK(frame.data.find("b.log") == std::string::npos);
+    CHECK(frame.data.rfind("# type\tsize\tmtime\tname\tsha256\n", 0) == 0);
+    CHECK(frame.data.find("\ta.txt\t") != std::string::npos);
+    CHECK(splitLines(frame.data).size() == 7);
+
+    Capture missing;
+    CHECK(!FileTransfer::sendListing(missing.sink, FileTransfer::parseListArgs((root / "nonexistent").string()), summary));
+    frame = parseFrame(missing.wire);
+    CHECK(frame.complete && frame.size == -1 && !frame.status.empty());
+}
+
+int main() {
+    char pattern[] = "/tmp/FileTransferTest.XXXXXX";
+    if (!mkdtemp(pattern)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    fs::path dir = pattern;
+    fs::path root = dir / "tree";
+    makeTree(root);
+
+    testGlobAndArgs();
+    testSingleFile(root);
+    for (const char* archivePattern : { "*.txt", "**/*.txt", "**" }) {
+        checkArchive(root, dir, archivePattern);
+    }
+    testListing(root);
+
+    if (failures) {
+        printf("FileTransferTest: %d failures (files kept in %s)\n", failures, dir.c_str());
+        return 1;
+    }
+    fs::remove_all(dir);
+    printf("FileTransferTest: all passed\n");
+    return 0;
+}
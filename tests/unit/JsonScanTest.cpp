@@ -0,0 +1,299 @@
+// Kiểm tra JsonScan.
+// - Các trường Gmail/OAuth: historyId/internalDate dạng số và dạng chuỗi, escape và cặp surrogate,
+//   body base64url đọc bằng stringBody (view vào buffer, không sao chép), JSON hỏng bị từ chối
+// - Ngẫu nhiên: sinh cây giá trị cùng văn bản JSON của nó (khoảng trắng, escape \uXXXX, \/ ... chọn ngẫu nhiên),
+//   đọc lại bằng JsonScan và so với cây; mọi tiền tố thật sự của văn bản phải bị từ chối.
+//   Tên member không có escape, như trong phản hồi của Gmail (JsonScan so sánh tên nguyên văn)
+// Cách dùng: JsonScanTest [số văn bản] [seed]
+#include "JsonScan.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+    std::string actualText = (actual); \
+    std::string expectedText = (expected); \
+    if (actualText != expectedText) { \
+        fprintf(stderr, "FAIL %s:%d: %s is [%s], expected [%s]\n", __FILE__, __LINE__, #actual, \
+            actualText.c_str(), expectedText.c_str()); \
+        failures++; \
+    } \
+} while (0)
+
+static JsonScan::Value parsed(const std::string& json) {
+    JsonScan::Value root;
+    CHECK(JsonScan::parse(json, root));
+    return root;
+}
+
+static void testGmailFields() {
+    const std::string json = R"( {"id":"18c1","threadId":"18c0","historyId":"991","internalDate":"1704103200000",
+        "sizeEstimate":4096,"big":18446744073709551615,"neg":-42,"flag":true,"none":null,
+        "snippet":"a\"b\\c\/d\né😀中",
+        "payload":{"headers":[{"name":"Subject","value":"Mail Control"},{"name":"X","value":"\"\\"}],
+        "body":{"data":"bGlzdDo6YXBw-_"}}} )";
+    JsonScan::Value root = parsed(json);
+    CHECK(root.isObject());
+    CHECK_EQUAL(root["threadId"].asString(), "18c0");
+    CHECK(root["historyId"].asUInt64() == 991);
+    CHECK(root["internalDate"].asInt64() == 1704103200000LL);
+    CHECK(root["sizeEstimate"].asInt64() == 4096);
+    CHECK(root["big"].asUInt64() == 18446744073709551615ULL);
+    CHECK(root["neg"].asInt64() == -42);
+    CHECK_EQUAL(root["flag"].asString(), "true");
+    CHECK(root["none"].exists() && root["none"].asString().empty());
+    CHECK(!root["missing"].exists() && root["missing"]["deeper"].asString().empty());
+    CHECK_EQUAL(root["snippet"].asString(), "a\"b\\c/d\n\xc3\xa9\xf0\x9f\x98\x80\xe4\xb8\xad");
+
+    std::vector<std::string> values;
+    root["payload"]["headers"].forEach([&](const JsonScan::Value& header) {
+        values.push_back(header["value"].asString());
+        return true;
+    });
+    CHECK(values.size() == 2 && values[0] == "Mail Control" && values[1] == "\"\\");
+
+    std::string_view data = root["payload"]["body"]["data"].stringBody();
+    CHECK(data == "bGlzdDo6YXBw-_");
+    CHECK(data.data() > json.data() && data.data() + data.size() < json.data() + json.size());
+
+    // Dừng sớm: chỉ member đầu tiên được duyệt
+    int members = 0;
+    root.forEachMember([&](std::string_view, const JsonScan::Value&) { return ++members < 1; });
+    CHECK(members == 1);
+
+    // Chuỗi kết thúc bằng "\\" ngay trước dấu nháy đóng, dấu ngoặc nằm trong chuỗi
+    const std::string trickyJson = R"(["a\\", "}]", "\\\"]"])";
+    JsonScan::Value tricky = parsed(trickyJson);
+    std::vector<std::string> elements;
+    tricky.forEach([&](const JsonScan::Value& element) {
+        elements.push_back(element.asString());
+        return true;
+    });
+    CHECK(elements.size() == 3 && elements[0] == "a\\" && elements[1] == "}]" && elements[2] == "\\\"]");
+
+    CHECK(JsonScan::skipValue(" [1, {\"a\": \"]\"}] tail", 0) == 16);
+    CHECK(JsonScan::skipValue("12,3", 0) == 2);
+
+    const char* broken[] = { "", "   ", "{\"a\":1", "{\"a\":\"x}", "[1,2}", "{\"a\":[}]}", "{} x", "\"abc",
+        "\"abc\\\"", "]", "{\"a\":1}}" };
+    for (const char* json : broken) {
+        JsonScan::Value root;
+        if (JsonScan::parse(json, root)) {
+            fprintf(stderr, "FAIL broken JSON accepted: [%s]\n", json);
+            failures++;
+        }
+    }
+}
+
+// Giá trị mong đợi: text là chuỗi đã bỏ escape (String) hoặc văn bản nguyên văn (số, literal)
+struct Node {
+    enum Kind { Literal, String, Array, Object } kind = Literal;
+    std::string text;
+    std::vector<std::pair<std::string, Node>> children;
+};
+
+class Generator {
+public:
+    explicit Generator(unsigned seed) : random(seed) {}
+
+    Node value(int depth, std::string& json) {
+        Node node;
+        int choice = random() % (depth < 5 ? 6 : 3);
+        if (choice == 0) {
+            static const char* LITERALS[] = { "null", "true", "false", "0", "-1", "3.25e-7", "1704103200000",
+                "18446744073709551615" };
+            node.text = LITERALS[random() % 8];
+            json += node.text;
+        }
+        else if (choice <= 2) {
+            node.kind = Node::String;
+            node.text = quoted(json);
+        }
+        else if (choice <= 4) {
+            node.kind = Node::Object;
+            json += '{';
+            int count = random() % 5;
+            for (int i = 0; i < count; i++) {
+                if (i > 0) json += ',';
+                // Tên không trùng nhau để operator[] tìm đúng member
+                std::string name = "k" + std::to_string(i) + (random() % 2 ? "_name" : "");
+                space(json);
+                json += '"' + name + '"';
+                space(json);
+                json += ':';
+                space(json);
+                node.children.emplace_back(name, value(depth + 1, json));
+                space(json);
+            }
+            json += '}';
+        }
+        else {
+            node.kind = Node::Array;
+            json += '[';
+            int count = random() % 5;
+            for (int i = 0; i < count; i++) {
+                if (i > 0) json += ',';
+                space(json);
+                node.children.emplace_back("", value(depth + 1, json));
+                space(json);
+            }
+            json += ']';
+        }
+        return node;
+    }
+
+private:
+    void space(std::string& json) {
+        static const char WHITESPACE[] = " \t\r\n";
+        while (random() % 3 == 0) json += WHITESPACE[random() % 4];
+    }
+
+    // Trả chuỗi đã bỏ escape, ghi dạng JSON của nó vào json
+    std::string quoted(std::string& json) {
+        static const unsigned long CODE_POINTS[] = { 'a', 'z', ' ', '"', '\\', '/', '\n', '\t', '\r', 0x01, '{',
+            ']', ',', ':', 0xE9, 0x4E2D, 0x1F600, 0x10FFFF };
+        std::string text;
+        json += '"';
+        int length = random() % 12;
+        for (int i = 0; i < length; i++) {
+            unsigned long codePoint = CODE_POINTS[random() % (sizeof(CODE_POINTS) / sizeof(CODE_POINTS[0]))];
+            std::string utf8 = toUtf8(codePoint);
+            text += utf8;
+            bool escape = random() % 2 == 0;
+            if (codePoint == '"' || codePoint == '\\') json += std::string("\\") + static_cast<char>(codePoint);
+            else if (codePoint == '\n' && escape) json += "\\n";
+            else if (codePoint == '\t' && escape) json += "\\t";
+            else if (codePoint == '/' && escape) json += "\\/";
+            else if (codePoint < 0x20 || escape) json += unicodeEscape(codePoint);
+            else json += utf8;
+        }
+        json += '"';
+        return text;
+    }
+
+    static std::string unicodeEscape(unsigned long codePoint) {
+        char buffer[32];
+        if (codePoint < 0x10000) {
+            snprintf(buffer, sizeof(buffer), "\\u%04lx", codePoint);
+        }
+        else {
+            codePoint -= 0x10000;
+            snprintf(buffer, sizeof(buffer), "\\u%04lX\\u%04lX", 0xD800 + (codePoint >> 10),
+                0xDC00 + (codePoint & 0x3FF));
+        }
+        return buffer;
+    }
+
+    static std::string toUtf8(unsigned long codePoint) {
+        std::string out;
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return out;
+    }
+
+    std::mt19937 random;
+};
+
+static bool matches(const Node& node, const JsonScan::Value& value) {
+    switch (node.kind) {
+    case Node::Literal:
+        return !value.isString() && !value.isObject() && !value.isArray() && value.raw() == node.text;
+    case Node::String:
+        return value.isString() && value.asString() == node.text;
+    case Node::Array: {
+        size_t index = 0;
+        bool same = value.isArray();
+        value.forEach([&](const JsonScan::Value& element) {
+            same = index < node.children.size() && matches(node.children[index++].second, element);
+            return same;
+        });
+        return same && index == node.children.size();
+    }
+    case Node::Object: {
+        size_t index = 0;
+        bool same = value.isObject();
+        value.forEachMember([&](std::string_view name, const JsonScan::Value& member) {
+            same = index < node.children.size() && name == node.children[index].first &&
+                matches(node.children[index].second, member);
+            index++;
+            return same;
+        });
+        for (const auto& child : node.children) {
+            same = same && matches(child.second, value[child.first]);
+        }
+        return same && index == node.children.size() && !value["absent"].exists();
+    }
+    }
+    return false;
+}
+
+static void randomDocuments(int documents, unsigned seed) {
+    Generator generator(seed);
+    size_t bytes = 0;
+    for (int i = 0; i < documents; i++) {
+        std::string json;
+        Node root = generator.value(0, json);
+        bytes += json.size();
+
+        JsonScan::Value value;
+        if (!JsonScan::parse(json, value) || !matches(root, value)) {
+            fprintf(stderr, "FAIL random document %d: %s\n", i, json.c_str());
+            failures++;
+            continue;
+        }
+        // Tiền tố thật sự của một object/mảng luôn thiếu dấu đóng
+        if (root.kind == Node::Object || root.kind == Node::Array) {
+            for (size_t length = 0; length < json.size(); length++) {
+                if (JsonScan::parse(std::string_view(json).substr(0, length), value)) {
+                    fprintf(stderr, "FAIL prefix of %d accepted: %.*s\n", i, static_cast<int>(length), json.c_str());
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+    printf("random (seed %u): %d documents, %zu bytes\n", seed, documents, bytes);
+}
+
+int main(int argc, char** argv) {
+    int documents = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : std::random_device()();
+
+    testGmailFields();
+    randomDocuments(documents, seed);
+
+    if (failures) {
+        printf("JsonScanTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("JsonScanTest: all passed\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Kiểm tra MailHeader và bộ tách query của OAuth callback (utils).
+// - Địa chỉ: display name, quoted string, comment lồng nhau, group, source route cũ, dạng "user@host (Name)",
+//   địa chỉ giả trong display name, header hỏng
+// - Encoded-word RFC 2047 (B và Q, charset khác UTF-8, encoded-word hỏng) trong display name và Subject
+// - Authentication-Results: authserv-id, kết quả từng phương thức, domain của các chữ ký DKIM pass
+// - findQueryParam/urlDecode trên query của dòng request như OAuthCallbackServer::extractCode
+// - Fuzz: đột biến ngẫu nhiên một vài header mẫu; mọi địa chỉ trả về phải là addr-spec hợp lệ và là view
+//   nằm trong header, không hàm nào được crash (chạy với -fsanitize=address,undefined để bắt lỗi bộ nhớ)
+// Cách dùng: MailHeaderTest [số lần fuzz] [seed]
+#include "MailHeader.h"
+#include "utils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+    std::string actualText = (actual); \
+    std::string expectedText = (expected); \
+    if (actualText != expectedText) { \
+        fprintf(stderr, "FAIL %s:%d: %s is [%s], expected [%s]\n", __FILE__, __LINE__, #actual, \
+            actualText.c_str(), expectedText.c_str()); \
+        failures++; \
+    } \
+} while (0)
+
+static std::string firstAddress(const std::string& header) {
+    MailHeader::Address address;
+    return MailHeader::firstMailbox(header, address) ? std::string(address.addrSpec) : "<none>";
+}
+
+static std::string firstName(const std::string& header) {
+    MailHeader::Address address;
+    return MailHeader::firstMailbox(header, address) ? MailHeader::decodeDisplayName(address.displayName) : "<none>";
+}
+
+static void testAddresses() {
+    CHECK_EQUAL(firstAddress("a@b.com"), "a@b.com");
+    CHECK_EQUAL(firstAddress("John Doe <john@x.org>"), "john@x.org");
+    CHECK_EQUAL(firstAddress("\"boss@company.com\" <attacker@evil.example>"), "attacker@evil.example");
+    CHECK_EQUAL(firstAddress("\"Doe, John\" <john@x.org>, other@y.org"), "john@x.org");
+    CHECK_EQUAL(firstAddress("john@x.org (John Doe)"), "john@x.org");
+    CHECK_EQUAL(firstAddress("<@relay.net:user@host.com>"), "user@host.com");
+    CHECK_EQUAL(firstAddress("\"a b\"@x.org"), "\"a b\"@x.org");
+    CHECK_EQUAL(firstAddress("Name <\"odd>local\"@x.org>"), "\"odd>local\"@x.org");
+    CHECK_EQUAL(firstAddress("Team: a@x.org, B <b@y.org>;, c@z.org"), "a@x.org");
+    CHECK_EQUAL(firstAddress("bad, <good@x.org>"), "good@x.org");
+
+    CHECK_EQUAL(firstAddress("undisclosed-recipients:;"), "<none>");
+    CHECK_EQUAL(firstAddress("broken <a@b.com"), "<none>");
+    CHECK_EQUAL(firstAddress("no address here"), "<none>");
+    CHECK_EQUAL(firstAddress("<a@b.com> trailing"), "<none>");
+    CHECK_EQUAL(firstAddress(""), "<none>");
+
+    CHECK_EQUAL(firstName("john@x.org (John (the) Doe)"), "John Doe");
+    CHECK_EQUAL(firstName("\"Doe, \\\"JD\\\" John\" <j@x.org>"), "Doe, \"JD\" John");
+
+    // Group: mỗi địa chỉ mang tên group chứa nó
+    MailHeader::AddressParser parser("Team: a@x.org, B <b@y.org>;, c@z.org");
+    MailHeader::Address address;
+    std::string seen;
+    while (parser.next(address)) {
+        seen += std::string(address.addrSpec) + "|" + std::string(address.group) + ";";
+    }
+    CHECK_EQUAL(seen, "a@x.org|Team;b@y.org|Team;c@z.org|;");
+    CHECK(!parser.failed());
+
+    MailHeader::AddressParser broken("bad, <good@x.org>");
+    while (broken.next(address)) {}
+    CHECK(broken.failed());
+
+    CHECK(MailHeader::isValidAddrSpec("a.b+tag@sub.example.org"));
+    CHECK(MailHeader::isValidAddrSpec("user@[192.168.1.1]"));
+    CHECK(!MailHeader::isValidAddrSpec("a..b@x.org"));
+    CHECK(!MailHeader::isValidAddrSpec("@x.org"));
+    CHECK(!MailHeader::isValidAddrSpec("a@"));
+}
+
+static void testEncodedWords() {
+    CHECK_EQUAL(firstName("=?UTF-8?B?Tmd1eeG7hW4gVsSDbiBB?= <a@x.vn>"), "Nguy\xe1\xbb\x85n V\xc4\x83n A");
+    CHECK_EQUAL(firstName("=?iso-8859-1?Q?Andr=E9?= =?iso-8859-1?Q?_M=FCller?= <a@x.de>"), "Andr\xc3\xa9 M\xc3\xbcller");
+    CHECK_EQUAL(MailHeader::decodeEncodedWords("=?UTF-8?Q?Mail_Control?="), "Mail Control");
+    CHECK_EQUAL(MailHeader::decodeEncodedWords("=?utf-8?b?TWFpbA==?= =?utf-8?b?IENvbnRyb2w=?="), "Mail Control");
+    CHECK_EQUAL(MailHeader::decodeEncodedWords("Re: =?utf-8?b?TWFpbA==?= x =?bad"), "Re: Mail x =?bad");
+    CHECK_EQUAL(MailHeader::decodeEncodedWords("plain subject"), "plain subject");
+}
+
+static void testAuthenticationResults() {
+    MailHeader::AuthenticationResults results;
+    CHECK(MailHeader::parseAuthenticationResults("mx.google.com;\r\n       dkim=pass header.i=@company.com "
+        "header.s=s1 header.b=abc;\r\n       dkim=PASS header.d=esp.example; arc=none;\r\n       spf=pass "
+        "(google.com: domain of a@company.com designates 1.2.3.4 as permitted sender) smtp.mailfrom=a@company.com;"
+        "\r\n       dmarc=pass (p=REJECT sp=REJECT dis=NONE) header.from=company.com", results));
+    CHECK_EQUAL(results.authservId, "mx.google.com");
+    CHECK_EQUAL(results.dkim, "pass");
+    CHECK(results.dkimPassDomains.size() == 2);
+    CHECK(results.dkimPassDomains.size() == 2 && results.dkimPassDomains[0] == "company.com" &&
+        results.dkimPassDomains[1] == "esp.example");
+    CHECK_EQUAL(results.spf, "pass");
+    CHECK_EQUAL(results.dmarc, "pass");
+    CHECK_EQUAL(results.arc, "none");
+
+    // Một chữ ký fail và một pass: kết quả là pass, chỉ domain của chữ ký pass được tính
+    results = MailHeader::AuthenticationResults();
+    CHECK(MailHeader::parseAuthenticationResults(
+        "mx.google.com; dkim=fail header.d=company.com; dkim=pass header.d=list.example; dmarc=fail", results));
+    CHECK_EQUAL(results.dkim, "pass");
+    CHECK(results.dkimPassDomains.size() == 1 && results.dkimPassDomains[0] == "list.example");
+    CHECK_EQUAL(results.dmarc, "fail");
+    CHECK_EQUAL(results.spf, "");
+
+    results = MailHeader::AuthenticationResults();
+    CHECK(MailHeader::parseAuthenticationResults("mx.google.com 1; none", results));
+    CHECK_EQUAL(results.authservId, "mx.google.com");
+    CHECK(results.dkim.empty() && results.dkimPassDomains.empty());
+}
+
+// Query của dòng request, như OAuthCallbackServer::extractCode
+static std::string callbackCode(const std::string& request) {
+    std::string_view requestLine(request);
+    requestLine = requestLine.substr(0, requestLine.find("\r\n"));
+    size_t targetStart = requestLine.find(' ');
+    if (targetStart == std::string_view::npos) return "";
+    std::string_view target = requestLine.substr(targetStart + 1);
+    target = target.substr(0, target.find(' '));
+    size_t queryStart = target.find('?');
+    if (queryStart == std::string_view::npos) return "";
+    std::string_view query = target.substr(queryStart + 1);
+    query = query.substr(0, query.find('#'));
+    std::string_view code;
+    if (!findQueryParam(query, "code", code)) return "";
+    return urlDecode(code);
+}
+
+static void testQuery() {
+    CHECK_EQUAL(callbackCode("GET /?state=x&code=4%2F0AbC-d_e&scope=https%3A%2F%2Fmail.google.com%2F HTTP/1.1\r\n"
+        "Host: localhost\r\n\r\n"), "4/0AbC-d_e");
+    CHECK_EQUAL(callbackCode("GET /?xcode=1&code=2 HTTP/1.1\r\n"), "2");
+    CHECK_EQUAL(callbackCode("GET /?error=access_denied HTTP/1.1\r\nReferer: http://x/?code=evil\r\n"), "");
+    CHECK_EQUAL(callbackCode("GET /favicon.ico HTTP/1.1\r\n"), "");
+    CHECK_EQUAL(callbackCode("GET /?code=a#code=b HTTP/1.1\r\n"), "a");
+
+    std::string_view value;
+    CHECK(findQueryParam("a=1&b=&c", "b", value) && value.empty());
+    CHECK(!findQueryParam("a=1&b=2", "c", value));
+    CHECK_EQUAL(urlDecode("a+b%20c%2x%"), "a b c%2x%");
+}
+
+static void fuzz(int iterations, unsigned seed) {
+    static const std::string ALPHABET = "ab@.<>\"(),:;\\ =?QB_%2Fx\t-[]";
+    const std::vector<std::string> seeds = {
+        "\"Doe, J\" <j@x.org>",
+        "=?utf-8?q?a=C3=A9?= <a@b>",
+        "T: a@b, (c) d@e;",
+        "<@r:u@h>",
+        "mx.google.com; dkim=pass header.i=@x.org; dmarc=pass",
+    };
+    std::mt19937 random(seed);
+    size_t found = 0;
+    for (int i = 0; i < iterations; i++) {
+        std::string header = seeds[i % seeds.size()];
+        int mutations = 1 + random() % 6;
+        for (int m = 0; m < mutations; m++) {
+            size_t position = header.empty() ? 0 : random() % (header.size() + 1);
+            switch (random() % 3) {
+            case 0:
+                header.insert(header.begin() + position, ALPHABET[random() % ALPHABET.size()]);
+                break;
+            case 1:
+                if (position < header.size()) header.erase(position, 1);
+                break;
+            default:
+                if (position < header.size()) header[position] = static_cast<char>(random() % 256);
+                break;
+            }
+        }
+
+        MailHeader::AddressParser parser(header);
+        MailHeader::Address address;
+        while (parser.next(address)) {
+            found++;
+            if (!MailHeader::isValidAddrSpec(address.addrSpec) || address.addrSpec.data() < header.data() ||
+                address.addrSpec.data() + address.addrSpec.size() > header.data() + header.size()) {
+                fprintf(stderr, "FAIL fuzz: [%s] yielded [%.*s]\n", header.c_str(),
+                    static_cast<int>(address.addrSpec.size()), address.addrSpec.data());
+                failures++;
+            }
+            MailHeader::decodeDisplayName(address.displayName);
+        }
+        MailHeader::decodeEncodedWords(header);
+        MailHeader::AuthenticationResults results;
+        MailHeader::parseAuthenticationResults(header, results);
+        urlDecode(header);
+        std::string_view value;
+        findQueryParam(header, "code", value);
+    }
+    printf("fuzz (seed %u): %d headers, %zu mailboxes\n", seed, iterations, found);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    unsigned seed = argc > 2 ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : std::random_device()();
+
+    testAddresses();
+    testEncodedWords();
+    testAuthenticationResults();
+    testQuery();
+    fuzz(iterations, seed);
+
+    if (failures) {
+        printf("MailHeaderTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("MailHeaderTest: all passed\n");
+    return 0;
+}
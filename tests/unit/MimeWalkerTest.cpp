@@ -0,0 +1,156 @@
+// Kiểm tra MimeWalker trên tập thư trong tests/unit/mime_corpus.json (sinh bằng mime_corpus.py):
+// part văn bản được chọn và nội dung đã giải mã, các file lệnh .txt đính kèm, và body được đọc thẳng từ
+// buffer JSON gốc (view, không sao chép). Sau đó là các hàm giải mã: quoted-printable, charset,
+// HTML sang văn bản, tham số header.
+// Cách dùng: MimeWalkerTest [đường dẫn mime_corpus.json]
+#include "MimeWalker.h"
+#include "JsonScan.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(actual, expected) do { \
+    std::string actualText = (actual); \
+    std::string expectedText = (expected); \
+    if (actualText != expectedText) { \
+        fprintf(stderr, "FAIL %s:%d: %s is [%s], expected [%s]\n", __FILE__, __LINE__, #actual, \
+            actualText.c_str(), expectedText.c_str()); \
+        failures++; \
+    } \
+} while (0)
+
+static bool isNull(const JsonScan::Value& value) {
+    return value.raw() == "null";
+}
+
+static bool insideBuffer(std::string_view view, const std::string& buffer) {
+    return view.empty() || (view.data() >= buffer.data() && view.data() + view.size() <= buffer.data() + buffer.size());
+}
+
+static void checkCase(const JsonScan::Value& testCase, const std::string& corpus) {
+    std::string name = testCase["name"].asString();
+    JsonScan::Value expectedText = testCase["text"];
+    MimeWalker::Selection selection = MimeWalker::select(testCase["message"]["payload"]);
+
+    if (selection.hasText == isNull(expectedText)) {
+        fprintf(stderr, "FAIL %s: %s\n", name.c_str(), selection.hasText ? "unexpected text part" : "no text part");
+        failures++;
+    }
+    else if (selection.hasText) {
+        std::string text = MimeWalker::decodeText(selection.text, selection.text.inlineData());
+        if (text != expectedText.asString()) {
+            fprintf(stderr, "FAIL %s: text is [%s], expected [%s]\n", name.c_str(), text.c_str(),
+                expectedText.asString().c_str());
+            failures++;
+        }
+        CHECK(insideBuffer(selection.text.inlineData(), corpus));
+    }
+
+    size_t index = 0;
+    testCase["commandFiles"].forEach([&](const JsonScan::Value& expected) {
+        if (index >= selection.commandFiles.size()) {
+            index++;
+            return true;
+        }
+        const MimeWalker::Part& file = selection.commandFiles[index++];
+        if (file.filename != expected["filename"].asString() ||
+            file.attachmentId() != expected["attachmentId"].asString()) {
+            fprintf(stderr, "FAIL %s: command file %zu is %s (%s)\n", name.c_str(), index, file.filename.c_str(),
+                file.attachmentId().c_str());
+            failures++;
+        }
+        JsonScan::Value data = expected["data"];
+        if (isNull(data)) {
+            CHECK(file.inlineData().empty());
+        }
+        else {
+            CHECK_EQUAL(MimeWalker::decodeText(file, file.inlineData()), data.asString());
+            CHECK(insideBuffer(file.inlineData(), corpus));
+        }
+        return true;
+    });
+    if (index != selection.commandFiles.size()) {
+        fprintf(stderr, "FAIL %s: %zu command files, expected %zu\n", name.c_str(), selection.commandFiles.size(),
+            index);
+        failures++;
+    }
+}
+
+static void testWalkOrder(const JsonScan::Value& root) {
+    // Cha trước con, theo thứ tự trong thư; visit trả false thì dừng hẳn
+    JsonScan::Value mobileReply;
+    root.forEach([&](const JsonScan::Value& testCase) {
+        if (testCase["name"].asString() == "mobile reply") mobileReply = testCase["message"]["payload"];
+        return !mobileReply.exists();
+    });
+    std::string order;
+    MimeWalker::walk(mobileReply, [&](const MimeWalker::Part& part) {
+        order += std::to_string(part.depth) + ":" + part.mimeType + " ";
+        return true;
+    });
+    CHECK_EQUAL(order, "0:multipart/mixed 1:multipart/alternative 2:text/plain 2:text/html 1:image/png ");
+
+    int visited = 0;
+    MimeWalker::walk(mobileReply, [&](const MimeWalker::Part& part) {
+        visited++;
+        return part.mimeType != "text/plain";
+    });
+    CHECK(visited == 3);
+}
+
+static void testDecoders() {
+    CHECK_EQUAL(MimeWalker::decodeQuotedPrintable("a=3Db=\r\nc=\nd"), "a=bcd");
+    CHECK_EQUAL(MimeWalker::decodeQuotedPrintable("caf=E9 =C3=A9"), "caf\xe9 \xc3\xa9");
+    CHECK_EQUAL(MimeWalker::decodeQuotedPrintable("=ZZ ="), "=ZZ =");
+
+    CHECK_EQUAL(MimeWalker::toUtf8("caf\xe9", "iso-8859-1"), "caf\xc3\xa9");
+    CHECK_EQUAL(MimeWalker::toUtf8("\x80", "windows-1252"), "\xe2\x82\xac");
+    CHECK_EQUAL(MimeWalker::toUtf8("\xc3\xa9", "utf-8"), "\xc3\xa9");
+    CHECK_EQUAL(MimeWalker::toUtf8("abc", "x-unknown"), "abc");
+
+    CHECK_EQUAL(MimeWalker::htmlToText("<script>var a = '<p>';</script>a&lt;b&gt;c<br/>d"), "a<b>c\nd");
+
+    CHECK_EQUAL(MimeWalker::headerParam("text/plain; charset=\"UTF-8\"; format=flowed", "charset"), "UTF-8");
+    CHECK_EQUAL(MimeWalker::headerParam("text/plain; CHARSET=us-ascii", "charset"), "us-ascii");
+    CHECK_EQUAL(MimeWalker::headerParam("attachment; filename=\"a \\\"b\\\".txt\"", "filename"), "a \"b\".txt");
+    CHECK_EQUAL(MimeWalker::headerParam("attachment; filename=\"a;b.txt\"; size=3", "size"), "3");
+    CHECK_EQUAL(MimeWalker::headerParam("attachment; xfilename=a.txt", "filename"), "");
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "tests/unit/mime_corpus.json";
+    std::ifstream file(path, std::ios::binary);
+    std::string corpus((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonScan::Value root;
+    if (!JsonScan::parse(corpus, root) || !root.isArray()) {
+        fprintf(stderr, "cannot read corpus %s\n", path);
+        return 1;
+    }
+
+    int cases = 0;
+    root.forEach([&](const JsonScan::Value& testCase) {
+        checkCase(testCase, corpus);
+        cases++;
+        return true;
+    });
+    CHECK(cases > 0);
+    testWalkOrder(root);
+    testDecoders();
+
+    if (failures) {
+        printf("MimeWalkerTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("MimeWalkerTest: %d messages, all passed\n", cases);
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Kiểm tra PolicyEngine với một tập email giả mạo và hợp lệ.
+// - Mỗi email là header From và Authentication-Results nguyên văn; người gửi được tách bằng
+//   MailHeader::firstMailbox như EmailHandler::extractEmail, nên giả mạo bằng display name cũng được kiểm tra
+// - Luật mặc định khi không có policy.json, phạm vi server/lệnh, luật deny đứng trước, giới hạn tần suất
+//   (đồng hồ giả), policy sai cú pháp, và nạp lại policy.json khi file đổi hoặc bị xóa
+// Cách dùng: PolicyEngineTest
+#include "PolicyEngine.h"
+#include "MailHeader.h"
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+static const char* MAILBOX = "me@gmail.com";
+
+static long long fakeNowMs = 0;
+
+static long long fakeClock() {
+    return fakeNowMs;
+}
+
+struct Message {
+    const char* name;
+    const char* from;                       // Header From nguyên văn
+    const char* authenticationResults;      // Header Authentication-Results trên cùng
+    std::vector<std::string> targets;
+    std::vector<std::string> commands;
+    bool allowed;
+};
+
+static PolicyEngine::Request makeRequest(const Message& message) {
+    PolicyEngine::Request request;
+    MailHeader::Address address;
+    request.sender = MailHeader::firstMailbox(message.from, address) ? std::string(address.addrSpec) : message.from;
+    request.mailboxAccount = MAILBOX;
+    request.authenticationResults = message.authenticationResults;
+    for (const std::string& ip : message.targets) {
+        request.targets.push_back({ ip });
+    }
+    request.commands = message.commands;
+    return request;
+}
+
+static void checkCorpus(PolicyEngine& engine, const std::vector<Message>& corpus) {
+    for (const Message& message : corpus) {
+        PolicyEngine::Decision decision = engine.evaluate(makeRequest(message));
+        if (decision.allowed != message.allowed) {
+            fprintf(stderr, "FAIL %s: expected %s, got %s %s\n", message.name, message.allowed ? "allow" : "deny",
+                decision.allowed ? "allow" : "deny", decision.reason.c_str());
+            failures++;
+        }
+        CHECK(decision.allowed || !decision.reason.empty());
+    }
+}
+
+static const char* COMPANY_PASS = "mx.google.com; dkim=pass header.i=@company.com header.s=s1 header.b=abc; arc=none; "
+    "spf=pass (google.com: domain of alice@company.com designates 1.2.3.4 as permitted sender) "
+    "smtp.mailfrom=alice@company.com; dmarc=pass (p=REJECT sp=REJECT dis=NONE) header.from=company.com";
+// Qua mailing list: chữ ký DKIM gốc hỏng nhưng chuỗi ARC hợp lệ
+static const char* COMPANY_FORWARDED = "mx.google.com; dkim=fail header.i=@company.com; "
+    "arc=pass (i=1 spf=pass dkim=pass dmarc=pass); spf=fail smtp.mailfrom=list@lists.example; "
+    "dmarc=pass header.from=company.com";
+
+static void testBuiltInPolicy() {
+    // Không có policy.json: chỉ chính hộp thư, không có kết quả fail
+    PolicyEngine engine("", fakeClock);
+    checkCorpus(engine, {
+        { "self, no results", "me@gmail.com", "", { "10.0.0.1" }, { "list::app" }, true },
+        { "self, display name and case", "Me <ME@Gmail.com>",
+            "mx.google.com; dkim=pass header.d=gmail.com; dmarc=pass header.from=gmail.com",
+            { "10.0.0.1" }, { "system::shutdown" }, true },
+        { "self, spoofed", "me@gmail.com",
+            "mx.google.com; dkim=none; spf=fail smtp.mailfrom=me@gmail.com; dmarc=fail header.from=gmail.com",
+            { "10.0.0.1" }, { "list::app" }, false },
+        { "other gmail user", "other@gmail.com", "mx.google.com; dkim=pass header.d=gmail.com; dmarc=pass",
+            { "10.0.0.1" }, { "list::app" }, false },
+        { "self in display name only", "\"me@gmail.com\" <attacker@evil.example>", "",
+            { "10.0.0.1" }, { "list::app" }, false },
+        { "no targets", "me@gmail.com", "", {}, { "list::app" }, false },
+        { "no commands", "me@gmail.com", "", { "10.0.0.1" }, {}, false },
+    });
+}
+
+static const char* POLICY = R"({
+    "default": "deny",
+    "rate_limit": { "per_minute": 60, "burst": 100 },
+    "rules": [
+        { "senders": ["intern@company.com"], "commands": ["power"], "action": "deny" },
+        { "senders": ["*@company.com"], "auth": "pass",
+          "targets": ["192.168.1.0/24", "10.0.0.5"], "commands": ["introspection", "screenshot::capture"] },
+        { "senders": ["boss@company.com"], "auth": "pass", "rate_limit": { "per_minute": 1, "burst": 2 } },
+        { "senders": ["*@*.partner.org"], "auth": "pass", "commands": ["list::app"] },
+        { "senders": ["$self"], "auth": "not_fail" }
+    ]
+})";
+
+static void testCorpus() {
+    PolicyEngine engine("", fakeClock);
+    std::string error;
+    CHECK(engine.loadFromString(POLICY, error));
+    CHECK(engine.ruleCount() == 5);
+
+    checkCorpus(engine, {
+        // Hợp lệ
+        { "company, aligned DKIM", "Alice <alice@company.com>", COMPANY_PASS,
+            { "192.168.1.20" }, { "list::app", "screenshot::capture" }, true },
+        { "company, forwarded with ARC", "alice@company.com", COMPANY_FORWARDED,
+            { "10.0.0.5" }, { "list::process" }, true },
+        { "partner subdomain", "x@eu.partner.org", "mx.google.com; dkim=pass header.d=partner.org",
+            { "1.1.1.1" }, { "list::app" }, true },
+        { "boss, any command and target", "boss@company.com", COMPANY_PASS, { "8.8.8.8" }, { "system::shutdown" }, true },
+        { "intern, not power", "intern@company.com", COMPANY_PASS, { "192.168.1.20" }, { "list::service" }, true },
+        { "self, passing results", "me@gmail.com", "mx.google.com; dkim=pass header.d=gmail.com; dmarc=pass",
+            { "172.16.0.1" }, { "file::delete C:\\a.txt" }, true },
+
+        // Giả mạo
+        { "company, DKIM and DMARC fail", "alice@company.com",
+            "mx.google.com; dkim=fail header.i=@company.com; spf=softfail smtp.mailfrom=alice@company.com; "
+            "dmarc=fail (p=NONE) header.from=company.com",
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "results from another server", "alice@company.com", "evil.example; dkim=pass header.i=@company.com; dmarc=pass",
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "DKIM of a lookalike domain", "alice@company.com",
+            "mx.google.com; dkim=pass header.i=@notcompany.com; spf=pass; dmarc=none",
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "DKIM of a suffix domain", "alice@company.com",
+            "mx.google.com; dkim=pass header.d=company.com.evil.example; dmarc=none",
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "no Authentication-Results", "alice@company.com", "", { "192.168.1.20" }, { "list::app" }, false },
+        { "company in display name only", "\"alice@company.com\" <alice@evil.example>", COMPANY_PASS,
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "partner apex is not a subdomain", "x@partner.org", "mx.google.com; dkim=pass header.d=partner.org",
+            { "1.1.1.1" }, { "list::app" }, false },
+        { "DKIM of a domain that only ends the same", "x@eu.partner.org",
+            "mx.google.com; dkim=pass header.d=u.partner.org; dmarc=none", { "1.1.1.1" }, { "list::app" }, false },
+        { "lookalike partner domain", "x@eu.evilpartner.org", "mx.google.com; dkim=pass header.d=evilpartner.org",
+            { "1.1.1.1" }, { "list::app" }, false },
+        { "self with failing results", "me@gmail.com",
+            "mx.google.com; dkim=none; spf=fail smtp.mailfrom=me@gmail.com; dmarc=fail header.from=gmail.com",
+            { "192.168.1.20" }, { "list::app" }, false },
+        { "stranger", "someone@elsewhere.example", "mx.google.com; dkim=pass header.d=elsewhere.example; dmarc=pass",
+            { "192.168.1.20" }, { "list::app" }, false },
+
+        // Phạm vi server và lệnh
+        { "company, target outside range", "alice@company.com", COMPANY_PASS,
+            { "192.168.2.20" }, { "list::app" }, false },
+        { "company, one target outside range", "alice@company.com", COMPANY_PASS,
+            { "192.168.1.20", "192.168.2.20" }, { "list::app" }, false },
+        { "company, power command", "alice@company.com", COMPANY_PASS,
+            { "192.168.1.20" }, { "list::app", "system::shutdown" }, false },
+        { "company, unknown command", "alice@company.com", COMPANY_PASS, { "192.168.1.20" }, { "bogus::cmd" }, false },
+        { "company, target is a name", "alice@company.com", COMPANY_PASS, { "pc-01" }, { "list::app" }, false },
+        { "intern, power before company rule", "intern@company.com", COMPANY_PASS,
+            { "192.168.1.20" }, { "system::restart" }, false },
+        { "partner, command outside rule", "x@eu.partner.org", "mx.google.com; dkim=pass header.d=partner.org",
+            { "1.1.1.1" }, { "list::process" }, false },
+    });
+}
+
+static void testRateLimit() {
+    PolicyEngine engine("", fakeClock);
+    std::string error;
+    CHECK(engine.loadFromString(POLICY, error));
+    Message boss = { "boss", "boss@company.com", COMPANY_PASS, { "8.8.8.8" }, { "list::app" }, true };
+    Message alice = { "alice", "alice@company.com", COMPANY_PASS, { "192.168.1.20" }, { "list::app" }, true };
+
+    // Luật của boss: burst 2, 1 email mỗi phút
+    fakeNowMs = 0;
+    CHECK(engine.evaluate(makeRequest(boss)).allowed);
+    CHECK(engine.evaluate(makeRequest(boss)).allowed);
+    PolicyEngine::Decision limited = engine.evaluate(makeRequest(boss));
+    CHECK(!limited.allowed);
+    CHECK(limited.reason.find("Too many") != std::string::npos);
+    // Giới hạn theo từng người gửi
+    CHECK(engine.evaluate(makeRequest(alice)).allowed);
+
+    fakeNowMs += 30000;
+    CHECK(!engine.evaluate(makeRequest(boss)).allowed);
+    fakeNowMs += 30000;
+    CHECK(engine.evaluate(makeRequest(boss)).allowed);
+    CHECK(!engine.evaluate(makeRequest(boss)).allowed);
+
+    // Email bị từ chối vì luật không tốn lượt
+    Message bossSpoofed = boss;
+    bossSpoofed.authenticationResults = "mx.google.com; dkim=fail; dmarc=fail";
+    fakeNowMs += 120000;
+    for (int i = 0; i < 10; i++) {
+        CHECK(!engine.evaluate(makeRequest(bossSpoofed)).allowed);
+    }
+    CHECK(engine.evaluate(makeRequest(boss)).allowed);
+}
+
+static void testInvalidPolicy() {
+    PolicyEngine engine("", fakeClock);
+    std::string error;
+    const char* invalid[] = {
+        "not json",
+        R"({ "default": "deny" })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "targets": ["10.0.0.0/33"] }] })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "targets": ["10.0.0.256"] }] })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "commands": ["nope"] }] })",
+        R"({ "rules": [{ "senders": ["not an address"] }] })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "auth": "maybe" }] })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "action": "perhaps" }] })",
+        R"({ "rules": [{ "senders": ["x@y.com"], "rate_limit": { "per_minute": 0 } }] })",
+    };
+    for (const char* json : invalid) {
+        error.clear();
+        bool loaded = engine.loadFromString(json, error);
+        if (loaded || error.empty()) {
+            fprintf(stderr, "FAIL accepted invalid policy: %s\n", json);
+            failures++;
+        }
+    }
+    // Luật cũ (mặc định) vẫn được dùng
+    CHECK(engine.ruleCount() == 1);
+    CHECK(engine.evaluate(makeRequest({ "self", MAILBOX, "", { "10.0.0.1" }, { "list::app" }, true })).allowed);
+}
+
+static void writeFile(const fs::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::trunc);
+    file << text;
+}
+
+static void testReload(const fs::path& dir) {
+    fs::path path = dir / "policy.json";
+    Message stranger = { "stranger", "a@b.example", "", { "1.2.3.4" }, { "list::app" }, true };
+    Message self = { "self", MAILBOX, "", { "1.2.3.4" }, { "list::app" }, true };
+
+    // Thời điểm sửa chỉ chính xác tới giây: mỗi lần ghi đổi cả kích thước để engine thấy file đã đổi
+    writeFile(path, R"({ "rules": [{ "senders": ["*"] }] })");
+    PolicyEngine engine(path.string(), fakeClock);
+    CHECK(engine.ruleCount() == 1);
+    CHECK(engine.evaluate(makeRequest(stranger)).allowed);
+
+    writeFile(path, R"({ "rules": [], "default": "deny" })");
+    CHECK(!engine.evaluate(makeRequest(stranger)).allowed);
+    CHECK(engine.ruleCount() == 0);
+
+    // File hỏng: giữ luật đang dùng
+    writeFile(path, "garbage");
+    CHECK(!engine.evaluate(makeRequest(stranger)).allowed);
+    CHECK(engine.ruleCount() == 0);
+
+    writeFile(path, R"({ "rules": [{ "senders": ["*@b.example"] }, { "senders": ["$self"] }] })");
+    CHECK(engine.evaluate(makeRequest(stranger)).allowed);
+    CHECK(engine.ruleCount() == 2);
+
+    // File bị xóa: quay về luật mặc định
+    fs::remove(path);
+    CHECK(!engine.evaluate(makeRequest(stranger)).allowed);
+    CHECK(engine.evaluate(makeRequest(self)).allowed);
+}
+
+int main() {
+    char pattern[] = "/tmp/PolicyEngineTest.XXXXXX";
+    if (!mkdtemp(pattern)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    fs::path dir = pattern;
+
+    testBuiltInPolicy();
+    testCorpus();
+    testRateLimit();
+    testInvalidPolicy();
+    testReload(dir);
+
+    if (failures) {
+        printf("PolicyEngineTest: %d failures (files kept in %s)\n", failures, dir.c_str());
+        return 1;
+    }
+    fs::remove_all(dir);
+    printf("PolicyEngineTest: all passed\n");
+    return 0;
+}
@@ -0,0 +1,577 @@
+// Kiểm tra SecureChannel trên socketpair với backend OpenSSL của tests/linux.
+// - Vector: với khóa và khóa tạm cố định, từng byte trên dây của cả hai vai phải khớp noise_vectors.py
+//   (cài đặt Noise độc lập, đi theo token của pattern)
+// - Bắt tay đầy đủ, nối lại 0-RTT, từ chối vé (phát lại, server mất vé, client bị gỡ) và bắt tay lại
+// - Sửa bất kỳ byte nào của tin nhắn bắt tay hay record thì bên nhận báo lỗi
+// Cách dùng: SecureChannelTest
+#include "SecureChannel.h"
+#include "NoiseCryptoTest.h"
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+using Bytes = std::vector<uint8_t>;
+using Key = SecureChannel::Key;
+
+// Sinh bằng: python3 tests/unit/noise_vectors.py
+static const char* KK_INIT = "010038d19bf3f082782c877b0d47d93427f8311160781c7c733fd89f88970aef490d8aa0ee19a4cb8a1b149fa00034553d5921dfdb1d883e8b51a0";
+static const char* KK_RESPONSE = "020030ff2ee45601ec1b67310c7790404585ae697331eee1c1f8cf2419731c1fff3e6b836b98c2ecc941f05bd49211fdd28bd2";
+static const char* KK_CLIENT_RECORD = "1700199d7ad9d737d933cf4947245181462dd296c219a6af5fc6c6dc";
+static const char* KK_SERVER_RECORD = "170014ae9c67ace36caf06ab6cf98c759dea36fa9c26aa";
+static const char* NNPSK0_INIT = "03004f717171717171717171717171717171717b0d47d93427f8311160781c7c733fd89f88970aef490d8aa0ee19a4cb8a1b14f11b4ebb665244975e8eac26c60b94ea885c6ac2c090fb6a474641c0f5d8a2";
+static const char* NNPSK0_RESPONSE = "040044ff2ee45601ec1b67310c7790404585ae697331eee1c1f8cf2419731c1fff3e6bc81de368647a950cab290d58ab13038bdce7fb86b08f95ac1aeeade714a431d9b44dd0db";
+static const char* NNPSK0_SERVER_RECORD = "1700140a5d7ffb331b4e4cf31d4321eab23ea8fd4432a8";
+static const char* NNPSK0_CLIENT_RECORD = "170019c07dfe229dacaa7f56ad41e7e65fec4a95b793f19a6d81bb9e";
+static const char* NNPSK0_RESUMPTION_PSK = "8df7fa282e099bd8ff50bf5e072a20224877b1eb8890cd90b95273775891b55c";
+
+// Giá trị cố định của noise_vectors.py
+static const Bytes CLIENT_STATIC(32, 0x11);
+static const Bytes SERVER_STATIC(32, 0x22);
+static const Bytes CLIENT_EPHEMERAL(32, 0x33);
+static const Bytes SERVER_EPHEMERAL(32, 0x44);
+static const Bytes TICKET_ID(16, 0x71);
+static const Bytes NEW_TICKET_ID(16, 0x72);
+static const Key TICKET_PSK = [] { Key key; key.fill(0x5A); return key; }();
+static const std::string COMMAND = "list::app";
+static const std::string EARLY_DATA = "ping::heartbeat";
+static const std::string REPLY = "pong";
+
+static Bytes fromHex(const char* text) {
+    Bytes bytes;
+    for (size_t i = 0; text[i] && text[i + 1]; i += 2) {
+        bytes.push_back(static_cast<uint8_t>(std::stoi(std::string(text + i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+struct SocketPair {
+    int client;
+    int server;
+
+    SocketPair() {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        client = fds[0];
+        server = fds[1];
+        // Bên kia không gửi gì (bắt tay hỏng): recv báo lỗi thay vì treo cả chương trình
+        timeval timeout = { 5, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(server, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    ~SocketPair() {
+        close(client);
+        close(server);
+    }
+};
+
+static SecureChannel::Io ioFor(int fd) {
+    SecureChannel::Io io;
+    io.sendAll = [fd](const uint8_t* data, size_t size) {
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t result = ::send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+            if (result <= 0) return false;
+            sent += result;
+        }
+        return true;
+    };
+    io.recvSome = [fd](uint8_t* buffer, size_t size) { return static_cast<int>(::recv(fd, buffer, size, 0)); };
+    return io;
+}
+
+static void writeBytes(int fd, const Bytes& bytes) {
+    CHECK(::send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(bytes.size()));
+}
+
+// Đúng size byte bên kia đã gửi, và không còn gì phía sau
+static Bytes readBytes(int fd, size_t size) {
+    Bytes bytes(size);
+    ssize_t received = size ? ::recv(fd, bytes.data(), size, MSG_WAITALL) : 0;
+    bytes.resize(received > 0 ? received : 0);
+    uint8_t extra;
+    CHECK(::recv(fd, &extra, 1, MSG_DONTWAIT) == -1 && errno == EAGAIN);
+    return bytes;
+}
+
+static std::string receiveText(SecureChannel& channel, size_t size) {
+    std::string text;
+    std::vector<uint8_t> buffer(7000);
+    while (text.size() < size) {
+        int result = channel.recv(buffer.data(), buffer.size());
+        if (result <= 0) break;
+        text.append(reinterpret_cast<const char*>(buffer.data()), result);
+    }
+    return text;
+}
+
+static int sendText(SecureChannel& channel, const std::string& text) {
+    return channel.send(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+// Mọi khóa tạm/ticket id đã nạp phải được dùng đúng chỗ; bỏ phần thừa để không lẫn sang test sau
+static void checkQueueUsed() {
+    CHECK(NoiseCryptoTest::queuedRandom() == 0);
+    NoiseCryptoTest::clearQueuedRandom();
+}
+
+struct Keys {
+    NoiseCrypto::KeyPair client;
+    NoiseCrypto::KeyPair server;
+    NoiseCrypto::KeyPair other;
+    SecureChannel::Keyring clients;
+
+    Keys() {
+        client.importPrivate(CLIENT_STATIC);
+        server.importPrivate(SERVER_STATIC);
+        other.generate();
+        clients.add(client.publicKey());
+    }
+};
+
+// ---- Vector: vai client ----
+
+static void testKKClientVector(Keys& keys) {
+    SocketPair pair;
+    SecureChannel channel(ioFor(pair.client));
+    NoiseCryptoTest::queueRandom(CLIENT_EPHEMERAL);
+    writeBytes(pair.server, fromHex(KK_RESPONSE));
+
+    CHECK(channel.connect(keys.client, keys.server.publicKey(), nullptr, "vector"));
+    CHECK(channel.mode() == SecureChannel::Mode::Full);
+    CHECK(readBytes(pair.server, fromHex(KK_INIT).size()) == fromHex(KK_INIT));
+
+    CHECK(sendText(channel, COMMAND) == static_cast<int>(COMMAND.size()));
+    CHECK(readBytes(pair.server, fromHex(KK_CLIENT_RECORD).size()) == fromHex(KK_CLIENT_RECORD));
+    writeBytes(pair.server, fromHex(KK_SERVER_RECORD));
+    CHECK(receiveText(channel, REPLY.size()) == REPLY);
+    checkQueueUsed();
+}
+
+static void testNNpsk0ClientVector(Keys& keys) {
+    SocketPair pair;
+    SecureChannel::TicketCache cache;
+    SecureChannel::Ticket ticket;
+    memcpy(ticket.id, TICKET_ID.data(), TICKET_ID.size());
+    ticket.psk = TICKET_PSK;
+    ticket.expiresMs = LLONG_MAX;
+    cache.store("vector", ticket);
+
+    SecureChannel channel(ioFor(pair.client));
+    NoiseCryptoTest::queueRandom(CLIENT_EPHEMERAL);
+    writeBytes(pair.server, fromHex(NNPSK0_RESPONSE));
+
+    CHECK(channel.connect(keys.client, keys.server.publicKey(), &cache, "vector"));
+    CHECK(sendText(channel, EARLY_DATA) == static_cast<int>(EARLY_DATA.size()));
+    CHECK(channel.mode() == SecureChannel::Mode::Resumed);
+    CHECK(readBytes(pair.server, fromHex(NNPSK0_INIT).size()) == fromHex(NNPSK0_INIT));
+
+    // Vé mới trong RESUME_RESPONSE, khóa PSK suy ra từ phiên vừa xong
+    SecureChannel::Ticket issued;
+    CHECK(cache.take("vector", issued));
+    CHECK(Bytes(issued.id, issued.id + sizeof(issued.id)) == NEW_TICKET_ID);
+    CHECK(Bytes(issued.psk.begin(), issued.psk.end()) == fromHex(NNPSK0_RESUMPTION_PSK));
+
+    writeBytes(pair.server, fromHex(NNPSK0_SERVER_RECORD));
+    CHECK(receiveText(channel, REPLY.size()) == REPLY);
+    CHECK(sendText(channel, COMMAND) == static_cast<int>(COMMAND.size()));
+    CHECK(readBytes(pair.server, fromHex(NNPSK0_CLIENT_RECORD).size()) == fromHex(NNPSK0_CLIENT_RECORD));
+    checkQueueUsed();
+}
+
+// ---- Vector: vai server ----
+
+static void testKKServerVector(Keys& keys) {
+    SocketPair pair;
+    SecureChannel channel(ioFor(pair.server));
+    NoiseCryptoTest::queueRandom(SERVER_EPHEMERAL);
+    writeBytes(pair.client, fromHex(KK_INIT));
+
+    CHECK(channel.accept(keys.server, keys.clients, nullptr));
+    CHECK(channel.mode() == SecureChannel::Mode::Full);
+    CHECK(channel.remoteKey() == keys.client.publicKey());
+    CHECK(readBytes(pair.client, fromHex(KK_RESPONSE).size()) == fromHex(KK_RESPONSE));
+
+    writeBytes(pair.client, fromHex(KK_CLIENT_RECORD));
+    CHECK(receiveText(channel, COMMAND.size()) == COMMAND);
+    CHECK(sendText(channel, REPLY) == static_cast<int>(REPLY.size()));
+    CHECK(readBytes(pair.client, fromHex(KK_SERVER_RECORD).size()) == fromHex(KK_SERVER_RECORD));
+    checkQueueUsed();
+}
+
+static void testNNpsk0ServerVector(Keys& keys) {
+    SocketPair pair;
+    SecureChannel::TicketStore tickets;
+    uint8_t id[SecureChannel::TICKET_ID_SIZE];
+    NoiseCryptoTest::queueRandom(TICKET_ID);
+    CHECK(tickets.issue(TICKET_PSK, keys.client.publicKey(), id));
+
+    SecureChannel channel(ioFor(pair.server));
+    NoiseCryptoTest::queueRandom(SERVER_EPHEMERAL);
+    NoiseCryptoTest::queueRandom(NEW_TICKET_ID);
+    writeBytes(pair.client, fromHex(NNPSK0_INIT));
+
+    CHECK(channel.accept(keys.server, keys.clients, &tickets));
+    CHECK(channel.mode() == SecureChannel::Mode::Resumed);
+    CHECK(channel.remoteKey() == keys.client.publicKey());
+    CHECK(channel.buffered() == EARLY_DATA.size());
+    CHECK(readBytes(pair.client, fromHex(NNPSK0_RESPONSE).size()) == fromHex(NNPSK0_RESPONSE));
+    CHECK(receiveText(channel, EARLY_DATA.size()) == EARLY_DATA);
+    CHECK(sendText(channel, REPLY) == static_cast<int>(REPLY.size()));
+    CHECK(readBytes(pair.client, fromHex(NNPSK0_SERVER_RECORD).size()) == fromHex(NNPSK0_SERVER_RECORD));
+
+    Key psk, clientKey;
+    CHECK(tickets.redeem(NEW_TICKET_ID.data(), psk, clientKey));
+    CHECK(Bytes(psk.begin(), psk.end()) == fromHex(NNPSK0_RESUMPTION_PSK));
+    CHECK(clientKey == keys.client.publicKey());
+    checkQueueUsed();
+}
+
+// ---- Sửa dữ liệu trên dây ----
+
+// Mỗi vị trí của tin nhắn bắt tay đầu: server phải từ chối, kể cả khi sửa header frame
+static void testTamperedInit(Keys& keys, const char* vector, bool resume) {
+    Bytes original = fromHex(vector);
+    for (size_t position = 0; position < original.size(); position++) {
+        SocketPair pair;
+        SecureChannel::TicketStore tickets;
+        uint8_t id[SecureChannel::TICKET_ID_SIZE];
+        if (resume) {
+            NoiseCryptoTest::queueRandom(TICKET_ID);
+            tickets.issue(TICKET_PSK, keys.client.publicKey(), id);
+        }
+
+        Bytes tampered = original;
+        tampered[position] ^= 0x01;
+        writeBytes(pair.client, tampered);
+        shutdown(pair.client, SHUT_WR);
+
+        SecureChannel channel(ioFor(pair.server));
+        bool accepted = channel.accept(keys.server, keys.clients, resume ? &tickets : nullptr);
+        CHECK(!accepted);
+        if (accepted) fprintf(stderr, "  %s accepted with byte %zu flipped\n", resume ? "RESUME_INIT" : "FULL_INIT", position);
+    }
+}
+
+// Mỗi vị trí của FULL_RESPONSE: client không được hoàn tất bắt tay
+static void testTamperedResponse(Keys& keys) {
+    Bytes original = fromHex(KK_RESPONSE);
+    for (size_t position = 0; position < original.size(); position++) {
+        SocketPair pair;
+        Bytes tampered = original;
+        tampered[position] ^= 0x80;
+        writeBytes(pair.server, tampered);
+        shutdown(pair.server, SHUT_WR);
+
+        SecureChannel channel(ioFor(pair.client));
+        NoiseCryptoTest::queueRandom(CLIENT_EPHEMERAL);
+        bool connected = channel.connect(keys.client, keys.server.publicKey(), nullptr, "tamper");
+        CHECK(!connected);
+        if (connected) fprintf(stderr, "  FULL_RESPONSE accepted with byte %zu flipped\n", position);
+    }
+}
+
+// Mỗi vị trí của record đầu sau bắt tay: recv trả -1 và kênh không dùng được nữa
+static void testTamperedRecord(Keys& keys) {
+    Bytes original = fromHex(KK_CLIENT_RECORD);
+    for (size_t position = 0; position < original.size(); position++) {
+        SocketPair pair;
+        SecureChannel channel(ioFor(pair.server));
+        NoiseCryptoTest::queueRandom(SERVER_EPHEMERAL);
+        writeBytes(pair.client, fromHex(KK_INIT));
+        bool accepted = channel.accept(keys.server, keys.clients, nullptr);
+        CHECK(accepted);
+        if (!accepted) return;
+        readBytes(pair.client, fromHex(KK_RESPONSE).size());
+
+        Bytes tampered = original;
+        tampered[position] ^= 0x01;
+        writeBytes(pair.client, tampered);
+        shutdown(pair.client, SHUT_WR);
+        uint8_t buffer[64];
+        int result = channel.recv(buffer, sizeof(buffer));
+        CHECK(result == -1);
+        if (result != -1) fprintf(stderr, "  record accepted with byte %zu flipped\n", position);
+        CHECK(channel.send(buffer, 1) == -1);
+    }
+
+    // Nửa frame rồi đóng: lỗi, không phải đóng bình thường
+    SocketPair pair;
+    SecureChannel channel(ioFor(pair.server));
+    writeBytes(pair.client, fromHex(KK_INIT));
+    CHECK(channel.accept(keys.server, keys.clients, nullptr));
+    writeBytes(pair.client, Bytes{ SecureChannel::RECORD, 0x00 });
+    shutdown(pair.client, SHUT_WR);
+    uint8_t buffer[8];
+    CHECK(channel.recv(buffer, sizeof(buffer)) == -1);
+}
+
+// ---- Bắt tay giữa hai SecureChannel ----
+
+struct Session {
+    SocketPair pair;
+    SecureChannel client;
+    SecureChannel server;
+    bool accepted;
+    std::thread thread;
+
+    Session() : client(ioFor(pair.client)), server(ioFor(pair.server)), accepted(false) {}
+
+    // Server accept trên thread riêng; gọi finish() sau khi client đã gửi xong tin nhắn bắt tay
+    void startServer(Keys& keys, SecureChannel::TicketStore* tickets) {
+        thread = std::thread([this, &keys, tickets]() {
+            accepted = server.accept(keys.server, keys.clients, tickets);
+            if (!accepted) shutdown(pair.server, SHUT_RDWR);
+        });
+    }
+
+    void finish() {
+        if (thread.joinable()) thread.join();
+    }
+
+    ~Session() {
+        finish();
+    }
+};
+
+static void testFullHandshake(Keys& keys) {
+    SecureChannel::TicketStore tickets;
+    SecureChannel::TicketCache cache;
+    Session session;
+    session.startServer(keys, &tickets);
+    CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    session.finish();
+    CHECK(session.accepted);
+    CHECK(session.client.mode() == SecureChannel::Mode::Full);
+    CHECK(session.server.mode() == SecureChannel::Mode::Full);
+    CHECK(session.server.remoteKey() == keys.client.publicKey());
+    CHECK(tickets.size() == 1);
+
+    // Dữ liệu nhiều record theo cả hai chiều
+    std::string large(200000, '\0');
+    for (size_t i = 0; i < large.size(); i++) large[i] = static_cast<char>(i * 7);
+    std::thread writer([&]() {
+        CHECK(sendText(session.client, COMMAND) == static_cast<int>(COMMAND.size()));
+        CHECK(sendText(session.client, large) == static_cast<int>(large.size()));
+    });
+    CHECK(receiveText(session.server, COMMAND.size()) == COMMAND);
+    CHECK(receiveText(session.server, large.size()) == large);
+    writer.join();
+    CHECK(sendText(session.server, REPLY) == static_cast<int>(REPLY.size()));
+    CHECK(receiveText(session.client, REPLY.size()) == REPLY);
+
+    shutdown(session.pair.client, SHUT_WR);
+    uint8_t buffer[1];
+    CHECK(session.server.recv(buffer, 1) == 0);
+}
+
+// Nối lại 0-RTT, rồi phát lại nguyên gói nối lại: vé đã dùng nên server trả RESUME_REJECT
+static void testResumeAndReplay(Keys& keys) {
+    SecureChannel::TicketStore tickets;
+    SecureChannel::TicketCache cache;
+    {
+        Session session;
+        session.startServer(keys, &tickets);
+        CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    }
+
+    Bytes flight;
+    {
+        SocketPair pair;
+        SecureChannel::Io io = ioFor(pair.client);
+        auto sendAll = io.sendAll;
+        io.sendAll = [&flight, sendAll](const uint8_t* data, size_t size) {
+            flight.insert(flight.end(), data, data + size);
+            return sendAll(data, size);
+        };
+        SecureChannel client(io);
+        SecureChannel server(ioFor(pair.server));
+        CHECK(client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+        bool accepted = false;
+        std::thread thread([&]() { accepted = server.accept(keys.server, keys.clients, &tickets); });
+        CHECK(sendText(client, EARLY_DATA) == static_cast<int>(EARLY_DATA.size()));
+        thread.join();
+        CHECK(accepted);
+        CHECK(server.mode() == SecureChannel::Mode::Resumed);
+        CHECK(client.mode() == SecureChannel::Mode::Resumed);
+        CHECK(server.remoteKey() == keys.client.publicKey());
+        CHECK(receiveText(server, EARLY_DATA.size()) == EARLY_DATA);
+        CHECK(sendText(server, REPLY) == static_cast<int>(REPLY.size()));
+        CHECK(receiveText(client, REPLY.size()) == REPLY);
+    }
+
+    SocketPair pair;
+    SecureChannel server(ioFor(pair.server));
+    writeBytes(pair.client, flight);
+    shutdown(pair.client, SHUT_WR);
+    CHECK(!server.accept(keys.server, keys.clients, &tickets));
+    CHECK(server.buffered() == 0);
+    Bytes reject = readBytes(pair.client, 3);
+    CHECK(reject == (Bytes{ SecureChannel::RESUME_REJECT, 0, 0 }));
+}
+
+// Server khởi động lại (mất vé): RESUME_REJECT, bắt tay đầy đủ trên cùng kết nối và gửi lại lệnh 0-RTT
+static void testResumeRejectedFallsBack(Keys& keys) {
+    SecureChannel::TicketStore tickets;
+    SecureChannel::TicketCache cache;
+    {
+        Session session;
+        session.startServer(keys, &tickets);
+        CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    }
+
+    SecureChannel::TicketStore restarted;
+    Session session;
+    CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    std::string command = "file::get C:\\a.txt";
+    std::string received;
+    std::thread thread([&]() {
+        session.accepted = session.server.accept(keys.server, keys.clients, &restarted);
+        received = receiveText(session.server, command.size());
+        sendText(session.server, REPLY);
+    });
+    CHECK(sendText(session.client, command) == static_cast<int>(command.size()));
+    CHECK(receiveText(session.client, REPLY.size()) == REPLY);
+    thread.join();
+    CHECK(session.accepted);
+    CHECK(received == command);
+    CHECK(session.client.mode() == SecureChannel::Mode::Full);
+    CHECK(session.server.mode() == SecureChannel::Mode::Full);
+}
+
+// Client bị gỡ khỏi authorized_clients.txt sau khi nhận vé: vé bị từ chối và bắt tay đầy đủ cũng thất bại
+static void testResumeRejectedForRemovedClient(Keys& keys) {
+    SecureChannel::TicketStore tickets;
+    SecureChannel::TicketCache cache;
+    {
+        Session session;
+        session.startServer(keys, &tickets);
+        CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    }
+
+    SecureChannel::Keyring withoutClient;
+    withoutClient.add(keys.other.publicKey());
+    Session session;
+    CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    std::thread thread([&]() {
+        session.accepted = session.server.accept(keys.server, withoutClient, &tickets);
+        shutdown(session.pair.server, SHUT_RDWR);
+    });
+    CHECK(sendText(session.client, COMMAND) == -1);
+    thread.join();
+    CHECK(!session.accepted);
+    CHECK(session.server.buffered() == 0);
+}
+
+// Lần gửi đầu lớn hơn một record khi nối lại: 16 KB đầu đi kèm bắt tay, phần còn lại sau đó
+static void testLargeEarlyWrite(Keys& keys) {
+    SecureChannel::TicketStore tickets;
+    SecureChannel::TicketCache cache;
+    {
+        Session session;
+        session.startServer(keys, &tickets);
+        CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    }
+
+    Session session;
+    CHECK(session.client.connect(keys.client, keys.server.publicKey(), &cache, "server"));
+    std::string large(50000, 'q');
+    large.back() = 'z';
+    std::string received;
+    std::thread thread([&]() {
+        session.accepted = session.server.accept(keys.server, keys.clients, &tickets);
+        received = receiveText(session.server, large.size());
+    });
+    CHECK(sendText(session.client, large) == static_cast<int>(large.size()));
+    thread.join();
+    CHECK(session.accepted);
+    CHECK(session.server.mode() == SecureChannel::Mode::Resumed);
+    CHECK(received == large);
+}
+
+static void testUnpinnedKeys(Keys& keys) {
+    {
+        // Client chưa có trong authorized_clients.txt
+        Session session;
+        session.startServer(keys, nullptr);
+        CHECK(!session.client.connect(keys.other, keys.server.publicKey(), nullptr, "server"));
+        session.finish();
+        CHECK(!session.accepted);
+    }
+    {
+        // Khóa ghim cho server không phải khóa của server đang trả lời
+        Session session;
+        session.startServer(keys, nullptr);
+        CHECK(!session.client.connect(keys.client, keys.other.publicKey(), nullptr, "server"));
+        session.finish();
+        CHECK(!session.accepted);
+    }
+}
+
+static void testTicketExpiry() {
+    long long now = 0;
+    SecureChannel::TicketStore tickets([&now]() { return now; });
+    Key psk{}, clientKey{};
+    psk[0] = 1;
+    uint8_t id[SecureChannel::TICKET_ID_SIZE];
+    CHECK(tickets.issue(psk, clientKey, id));
+    now = SecureChannel::TicketStore::TICKET_LIFETIME_MS;
+    Key redeemedPsk, redeemedClient;
+    CHECK(!tickets.redeem(id, redeemedPsk, redeemedClient));
+    CHECK(tickets.size() == 0);
+
+    now = 0;
+    for (size_t i = 0; i < SecureChannel::TicketStore::MAX_TICKETS + 5; i++) tickets.issue(psk, clientKey, id);
+    CHECK(tickets.size() == SecureChannel::TicketStore::MAX_TICKETS);
+    CHECK(tickets.redeem(id, redeemedPsk, redeemedClient));
+    CHECK(!tickets.redeem(id, redeemedPsk, redeemedClient));
+
+    long long clientNow = 0;
+    SecureChannel::TicketCache cache([&clientNow]() { return clientNow; });
+    SecureChannel::Ticket ticket{};
+    ticket.expiresMs = 1000;
+    cache.store("server", ticket);
+    clientNow = 1000;
+    CHECK(!cache.take("server", ticket));
+}
+
+int main() {
+    Keys keys;
+
+    testKKClientVector(keys);
+    testKKServerVector(keys);
+    testNNpsk0ClientVector(keys);
+    testNNpsk0ServerVector(keys);
+
+    testTamperedInit(keys, KK_INIT, false);
+    testTamperedInit(keys, NNPSK0_INIT, true);
+    testTamperedResponse(keys);
+    testTamperedRecord(keys);
+    checkQueueUsed();
+
+    testFullHandshake(keys);
+    testResumeAndReplay(keys);
+    testResumeRejectedFallsBack(keys);
+    testResumeRejectedForRemovedClient(keys);
+    testLargeEarlyWrite(keys);
+    testUnpinnedKeys(keys);
+    testTicketExpiry();
+
+    printf(failures ? "SecureChannelTest: %d failures\n" : "SecureChannelTest: all passed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
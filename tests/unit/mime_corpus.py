@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Sinh tests/unit/mime_corpus.json cho MimeWalkerTest: mỗi case là một kết quả messages.get?format=full
+# của Gmail API (payload lồng nhau, body base64url như Gmail trả về) và nội dung mong đợi:
+#   text: văn bản đã giải mã của part được chọn, null nếu thư không có part văn bản nào
+#   commandFiles: các file .txt đính kèm theo thứ tự trong thư; data là nội dung đã giải mã,
+#                 null khi Gmail chỉ trả attachmentId (phải gọi attachments.get)
+# Cách dùng: python3 tests/unit/mime_corpus.py > tests/unit/mime_corpus.json
+import base64
+import json
+import quopri
+
+
+def b64url(data):
+    if isinstance(data, str):
+        data = data.encode()
+    return base64.urlsafe_b64encode(data).decode().rstrip("=")
+
+
+def part(mime, data=None, headers=(), filename="", parts=None, attachment_id=None):
+    node = {"partId": "0", "mimeType": mime, "filename": filename,
+            "headers": [{"name": name, "value": value} for name, value in headers]}
+    body = {"size": len(data) if data else 0}
+    if data is not None:
+        body["data"] = b64url(data)
+    if attachment_id:
+        body["attachmentId"] = attachment_id
+    node["body"] = body
+    if parts is not None:
+        node["parts"] = parts
+    return node
+
+
+def message(payload):
+    payload["headers"] = [
+        {"name": "Subject", "value": "Mail Control"},
+        {"name": "From", "value": "A <a@b.com>"},
+        {"name": "Date", "value": "Mon, 1 Jan 2024 10:00:00 +0000"},
+    ] + payload["headers"]
+    return {"id": "m1", "threadId": "t1", "internalDate": "1700000000000", "payload": payload}
+
+
+def nested(depth, leaf):
+    for _ in range(depth):
+        leaf = part("multipart/mixed", parts=[leaf])
+    return leaf
+
+
+UTF8 = [("Content-Type", "text/plain; charset=UTF-8")]
+cases = []
+
+
+def case(name, payload, text, command_files=()):
+    cases.append({"name": name, "message": message(payload), "text": text,
+                  "commandFiles": [{"filename": f, "attachmentId": a, "data": d} for f, a, d in command_files]})
+
+
+case("single text/plain", part("text/plain", "list::app - 10.0.0.1", UTF8), "list::app - 10.0.0.1")
+
+# Thư trả lời từ điện thoại: text/plain trong multipart/alternative trong multipart/mixed
+alternative = part("multipart/alternative", parts=[
+    part("text/plain", "list::process - 10.0.0.2\r\n", [("Content-Type", "text/plain; charset=\"UTF-8\"")]),
+    part("text/html", "<div>list::process - 10.0.0.2</div>", [("Content-Type", "text/html; charset=UTF-8")]),
+])
+case("mobile reply", part("multipart/mixed", parts=[alternative, part("image/png", "png", filename="a.png")]),
+     "list::process - 10.0.0.2\r\n")
+
+case("html only", part("multipart/alternative", parts=[
+    part("text/html", "<html><head><style>p{}</style></head><body><p>kill&nbsp;1234 &amp; screenshot</p>"
+         "<br>- 10.0.0.3</body></html>")]),
+    "kill 1234 & screenshot\n- 10.0.0.3")
+
+case("html before text/plain", part("multipart/alternative", parts=[
+    part("text/html", "<p>ignored</p>"), part("text/plain", "help::cmd - 10.0.0.4")]),
+    "help::cmd - 10.0.0.4")
+
+qp = quopri.encodestring("caf\xe9 - 10.0.0.5 ".encode("latin1") + b"x" * 80).decode()
+case("quoted-printable latin1", part("text/plain", qp, [
+    ("Content-Type", "text/plain; charset=ISO-8859-1"), ("Content-Transfer-Encoding", "quoted-printable")]),
+    "caf\xe9 - 10.0.0.5 " + "x" * 80)
+
+case("windows-1252", part("text/plain", b"\x80 \x93quoted\x94 - 10.0.0.6", [
+    ("Content-Type", "text/plain; charset=windows-1252")]),
+    "€ “quoted” - 10.0.0.6")
+
+# Byte mã hóa thành '-' và '_' trong base64url
+case("base64url alphabet", part("text/plain", "??>>?? ~~ - 10.0.0.7 \xff".encode()),
+     "??>>?? ~~ - 10.0.0.7 \xff")
+
+case("uppercase types", part("TEXT/PLAIN", "screenshot::capture - 10.0.0.8", [
+    ("CONTENT-TYPE", "Text/Plain; CHARSET=\"UTF-8\"")]),
+    "screenshot::capture - 10.0.0.8")
+
+case("inline command file", part("multipart/mixed", parts=[
+    part("text/plain", "\r\n"),
+    part("text/plain", "system::restart - 10.0.0.9",
+         [("Content-Disposition", "attachment; filename=\"cmds.TXT\"")], filename="cmds.TXT")]),
+    "\r\n", [("cmds.TXT", "", "system::restart - 10.0.0.9")])
+
+case("command file by attachmentId", part("multipart/mixed", parts=[
+    part("multipart/alternative", parts=[part("text/plain", "")]),
+    part("text/plain", None, filename="c.txt", attachment_id="ATT1")]),
+    "", [("c.txt", "ATT1", None)])
+
+# Tên file chỉ có trong Content-Disposition; file không phải .txt không phải lệnh và không là nội dung thư
+case("attachments are not the body", part("multipart/mixed", parts=[
+    part("text/plain", "notes", [("Content-Disposition", "attachment; filename=notes.txt")]),
+    part("text/plain", "log", filename="server.log"),
+    part("text/plain", "list::service - 10.0.0.10"),
+    part("application/zip", None, filename="a.zip", attachment_id="ATT2")]),
+    "list::service - 10.0.0.10", [("notes.txt", "", "notes")])
+
+case("10 levels deep", nested(10, part("text/plain", "deep - 10.0.0.11")), "deep - 10.0.0.11")
+
+# Sâu hơn MimeWalker::MAX_DEPTH (32): bị bỏ qua, không đệ quy tiếp
+case("40 levels deep", nested(40, part("text/plain", "too deep")), None)
+
+case("no text part", part("multipart/mixed", parts=[part("image/png", "png", filename="a.png")]), None)
+
+# Mỗi case một dòng
+print("[\n" + ",\n".join(json.dumps(c, ensure_ascii=False) for c in cases) + "\n]")
@@ -0,0 +1,368 @@
+#!/usr/bin/env python3
+"""Vector kiểm tra cho bắt tay của SecureChannel, sinh bằng một cài đặt Noise độc lập (chỉ thư viện chuẩn).
+
+SecureChannel viết tay từng bước của hai pattern; ở đây HandshakeState đi theo token của pattern như
+đặc tả Noise (mục 5), X25519 theo RFC 7748 và AES-256-GCM theo NIST SP 800-38D viết lại bằng Python.
+Các hàm nguyên thủy được tự kiểm tra với vector công bố (RFC 7748 6.1, FIPS-197 C.3, GCM test case 13/14)
+trước khi sinh vector.
+
+Khóa bí mật, khóa tạm và ticket id cố định; SecureChannelTest nạp đúng các giá trị này vào backend
+NoiseCrypto của tests/linux rồi so từng byte trên dây với vector:
+  kk_*      Noise_KK_25519_AESGCM_SHA256, server không cấp vé (payload rỗng), sau đó một record mỗi chiều
+  nnpsk0_*  Noise_NNpsk0_25519_AESGCM_SHA256 với vé cố định, lệnh 0-RTT, server cấp vé mới
+Cách dùng: noise_vectors.py   (in "tên hex" mỗi dòng, chép vào SecureChannelTest.cpp khi giao thức đổi)
+"""
+import hashlib
+import hmac
+
+# ---- X25519 (RFC 7748) ----
+P = 2 ** 255 - 19
+A24 = 121665
+
+
+def x25519(scalar, u):
+    k = bytearray(scalar)
+    k[0] &= 248
+    k[31] &= 127
+    k[31] |= 64
+    k = int.from_bytes(k, "little")
+    x1 = int.from_bytes(u, "little") & ((1 << 255) - 1)
+    x2, z2, x3, z3 = 1, 0, x1, 1
+    swap = 0
+    for t in reversed(range(255)):
+        bit = (k >> t) & 1
+        swap ^= bit
+        if swap:
+            x2, x3, z2, z3 = x3, x2, z3, z2
+        swap = bit
+        a = x2 + z2
+        aa = a * a
+        b = x2 - z2
+        bb = b * b
+        e = aa - bb
+        c = x3 + z3
+        d = x3 - z3
+        da = d * a
+        cb = c * b
+        x3 = (da + cb) ** 2 % P
+        z3 = x1 * (da - cb) ** 2 % P
+        x2 = aa * bb % P
+        z2 = e * (aa + A24 * e) % P
+    if swap:
+        x2, z2 = x3, z3
+    return (x2 * pow(z2, P - 2, P) % P).to_bytes(32, "little")
+
+
+def public_key(private):
+    return x25519(private, (9).to_bytes(32, "little"))
+
+
+# ---- AES-256 (FIPS-197), S-box dựng từ nghịch đảo trong GF(2^8) ----
+def _xtime(a):
+    return ((a << 1) ^ 0x1B) & 0xFF if a & 0x80 else a << 1
+
+
+def _gf_mul(a, b):
+    result = 0
+    while b:
+        if b & 1:
+            result ^= a
+        a = _xtime(a)
+        b >>= 1
+    return result
+
+
+def _sbox():
+    box = []
+    for x in range(256):
+        inverse = 0 if x == 0 else next(y for y in range(1, 256) if _gf_mul(x, y) == 1)
+        s = inverse
+        for shift in range(1, 5):
+            s ^= ((inverse << shift) | (inverse >> (8 - shift))) & 0xFF
+        box.append(s ^ 0x63)
+    return box
+
+
+SBOX = _sbox()
+
+
+def _expand_key(key):
+    words = [list(key[i:i + 4]) for i in range(0, 32, 4)]
+    rcon = 1
+    for i in range(8, 60):
+        temp = list(words[i - 1])
+        if i % 8 == 0:
+            temp = [SBOX[b] for b in temp[1:] + temp[:1]]
+            temp[0] ^= rcon
+            rcon = _xtime(rcon)
+        elif i % 8 == 4:
+            temp = [SBOX[b] for b in temp]
+        words.append([a ^ b for a, b in zip(words[i - 8], temp)])
+    return [sum(words[r * 4:r * 4 + 4], []) for r in range(15)]
+
+
+def aes_encrypt_block(round_keys, block):
+    state = [b ^ k for b, k in zip(block, round_keys[0])]
+    for r in range(1, 15):
+        state = [SBOX[b] for b in state]
+        # ShiftRows: state theo cột, byte (hàng i, cột c) nằm ở 4c + i
+        state = [state[(4 * (c + i) + i) % 16] for c in range(4) for i in range(4)]
+        if r != 14:
+            mixed = []
+            for c in range(4):
+                a = state[4 * c:4 * c + 4]
+                mixed += [
+                    _xtime(a[0]) ^ _xtime(a[1]) ^ a[1] ^ a[2] ^ a[3],
+                    a[0] ^ _xtime(a[1]) ^ _xtime(a[2]) ^ a[2] ^ a[3],
+                    a[0] ^ a[1] ^ _xtime(a[2]) ^ _xtime(a[3]) ^ a[3],
+                    _xtime(a[0]) ^ a[0] ^ a[1] ^ a[2] ^ _xtime(a[3]),
+                ]
+            state = mixed
+        state = [b ^ k for b, k in zip(state, round_keys[r])]
+    return bytes(state)
+
+
+# ---- AES-256-GCM (NIST SP 800-38D), IV 96 bit ----
+def _ghash_mul(x, y):
+    z = 0
+    v = y
+    for i in range(127, -1, -1):
+        if (x >> i) & 1:
+            z ^= v
+        v = (v >> 1) ^ (0xE1 << 120) if v & 1 else v >> 1
+    return z
+
+
+def _ghash(h, ad, cipher):
+    def blocks(data):
+        padded = data + b"\0" * (-len(data) % 16)
+        return [int.from_bytes(padded[i:i + 16], "big") for i in range(0, len(padded), 16)]
+
+    y = 0
+    lengths = ((len(ad) * 8) << 64) | (len(cipher) * 8)
+    for block in blocks(ad) + blocks(cipher) + [lengths]:
+        y = _ghash_mul(y ^ block, h)
+    return y
+
+
+def _gcm(key, iv, ad, data, decrypt=False, tag=None):
+    round_keys = _expand_key(key)
+    h = int.from_bytes(aes_encrypt_block(round_keys, b"\0" * 16), "big")
+    j0 = iv + b"\0\0\0\1"
+    out = bytearray()
+    for i in range(0, len(data), 16):
+        counter = iv + (2 + i // 16).to_bytes(4, "big")
+        stream = aes_encrypt_block(round_keys, counter)
+        out += bytes(a ^ b for a, b in zip(data[i:i + 16], stream))
+    cipher = bytes(data) if decrypt else bytes(out)
+    mac = (_ghash(h, ad, cipher) ^ int.from_bytes(aes_encrypt_block(round_keys, j0), "big")).to_bytes(16, "big")
+    if decrypt:
+        if not hmac.compare_digest(mac, tag):
+            raise ValueError("bad tag")
+        return bytes(out)
+    return bytes(out) + mac
+
+
+def aead_seal(key, nonce, ad, plain):
+    return _gcm(key, b"\0" * 4 + nonce.to_bytes(8, "big"), ad, plain)
+
+
+def aead_open(key, nonce, ad, cipher):
+    return _gcm(key, b"\0" * 4 + nonce.to_bytes(8, "big"), ad, cipher[:-16], True, cipher[-16:])
+
+
+def self_check():
+    alice = bytes.fromhex("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a")
+    bob = bytes.fromhex("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb")
+    assert public_key(alice).hex() == "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a"
+    assert public_key(bob).hex() == "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f"
+    assert x25519(alice, public_key(bob)).hex() == "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742"
+
+    key = bytes(range(32))
+    block = aes_encrypt_block(_expand_key(key), bytes.fromhex("00112233445566778899aabbccddeeff"))
+    assert block.hex() == "8ea2b7ca516745bfeafc49904b496089"
+
+    zero = b"\0" * 32
+    assert _gcm(zero, b"\0" * 12, b"", b"").hex() == "530f8afbc74536b9a963b4f1c4cb738b"
+    assert _gcm(zero, b"\0" * 12, b"", b"\0" * 16).hex() == \
+        "cea7403d4d606b6e074ec5d3baf39d18" "d0d1c8a799996bf0265b98b5d48ab919"
+
+
+# ---- Noise (đặc tả rev 34, mục 5) ----
+def _hkdf(chaining_key, ikm, count):
+    temp = hmac.new(chaining_key, ikm, hashlib.sha256).digest()
+    outputs = []
+    previous = b""
+    for i in range(count):
+        previous = hmac.new(temp, previous + bytes([i + 1]), hashlib.sha256).digest()
+        outputs.append(previous)
+    return outputs
+
+
+class SymmetricState:
+    def __init__(self, protocol_name):
+        name = protocol_name.encode()
+        self.h = name.ljust(32, b"\0") if len(name) <= 32 else hashlib.sha256(name).digest()
+        self.ck = self.h
+        self.k = None
+        self.n = 0
+
+    def mix_hash(self, data):
+        self.h = hashlib.sha256(self.h + data).digest()
+
+    def mix_key(self, ikm):
+        self.ck, self.k = _hkdf(self.ck, ikm, 2)
+        self.n = 0
+
+    def mix_key_and_hash(self, ikm):
+        self.ck, temp_h, self.k = _hkdf(self.ck, ikm, 3)
+        self.mix_hash(temp_h)
+        self.n = 0
+
+    def encrypt_and_hash(self, plain):
+        cipher = plain if self.k is None else aead_seal(self.k, self.n, self.h, plain)
+        if self.k is not None:
+            self.n += 1
+        self.mix_hash(cipher)
+        return cipher
+
+    def decrypt_and_hash(self, cipher):
+        plain = cipher if self.k is None else aead_open(self.k, self.n, self.h, cipher)
+        if self.k is not None:
+            self.n += 1
+        self.mix_hash(cipher)
+        return plain
+
+    def split(self):
+        return _hkdf(self.ck, b"", 2)
+
+
+PATTERNS = {
+    "KK": (["s"], ["s"], [["e", "es", "ss"], ["e", "ee", "se"]]),
+    "NNpsk0": ([], [], [["psk", "e"], ["e", "ee"]]),
+}
+
+
+class HandshakeState:
+    def __init__(self, pattern, initiator, prologue, s=None, e=None, rs=None, psk=None):
+        self.initiator = initiator
+        self.pre_initiator, self.pre_responder, self.messages = PATTERNS[pattern]
+        self.ss = SymmetricState("Noise_%s_25519_AESGCM_SHA256" % pattern)
+        self.s, self.e, self.rs, self.re, self.psk = s, e, rs, None, psk
+        self.is_psk = "psk" in pattern
+        self.ss.mix_hash(prologue)
+        for token in self.pre_initiator:
+            self.ss.mix_hash(public_key(self.s) if initiator else self.rs)
+        for token in self.pre_responder:
+            self.ss.mix_hash(self.rs if initiator else public_key(self.s))
+        self.index = 0
+
+    def _dh(self, token):
+        # Token ghi theo vai initiator: "es" = e của initiator với s của responder
+        mine, theirs = (token[0], token[1]) if self.initiator else (token[1], token[0])
+        private = self.e if mine == "e" else self.s
+        remote = self.re if theirs == "e" else self.rs
+        return x25519(private, remote)
+
+    def write_message(self, payload):
+        out = b""
+        for token in self.messages[self.index]:
+            if token == "e":
+                pub = public_key(self.e)
+                out += pub
+                self.ss.mix_hash(pub)
+                if self.is_psk:
+                    self.ss.mix_key(pub)
+            elif token == "psk":
+                self.ss.mix_key_and_hash(self.psk)
+            else:
+                self.ss.mix_key(self._dh(token))
+        self.index += 1
+        return out + self.ss.encrypt_and_hash(payload)
+
+    def read_message(self, message):
+        for token in self.messages[self.index]:
+            if token == "e":
+                self.re, message = message[:32], message[32:]
+                self.ss.mix_hash(self.re)
+                if self.is_psk:
+                    self.ss.mix_key(self.re)
+            elif token == "psk":
+                self.ss.mix_key_and_hash(self.psk)
+            else:
+                self.ss.mix_key(self._dh(token))
+        self.index += 1
+        return self.ss.decrypt_and_hash(message)
+
+
+# ---- Lớp dây của SecureChannel ----
+PROLOGUE = b"EmailPCControl/1"
+RESUMPTION_LABEL = b"EmailPCControl resumption"
+FULL_INIT, FULL_RESPONSE, RESUME_INIT, RESUME_RESPONSE, RECORD = 0x01, 0x02, 0x03, 0x04, 0x17
+TICKET_LIFETIME_S = 12 * 60 * 60
+
+# Giá trị cố định, SecureChannelTest dùng đúng các giá trị này
+CLIENT_STATIC = bytes([0x11] * 32)
+SERVER_STATIC = bytes([0x22] * 32)
+CLIENT_EPHEMERAL = bytes([0x33] * 32)
+SERVER_EPHEMERAL = bytes([0x44] * 32)
+TICKET_ID = bytes([0x71] * 16)
+TICKET_PSK = bytes([0x5A] * 32)
+NEW_TICKET_ID = bytes([0x72] * 16)
+COMMAND = b"list::app"
+EARLY_DATA = b"ping::heartbeat"
+REPLY = b"pong"
+
+
+def frame(kind, body):
+    return bytes([kind]) + len(body).to_bytes(2, "big") + body
+
+
+def record(key, nonce, data):
+    return frame(RECORD, aead_seal(key, nonce, b"", data))
+
+
+def vectors():
+    result = []
+
+    key_id = hashlib.sha256(public_key(CLIENT_STATIC)).digest()[:8]
+    client = HandshakeState("KK", True, PROLOGUE + key_id, s=CLIENT_STATIC, e=CLIENT_EPHEMERAL,
+                            rs=public_key(SERVER_STATIC))
+    server = HandshakeState("KK", False, PROLOGUE + key_id, s=SERVER_STATIC, e=SERVER_EPHEMERAL,
+                            rs=public_key(CLIENT_STATIC))
+    init = client.write_message(b"")
+    server.read_message(init)
+    response = server.write_message(b"")
+    assert client.read_message(response) == b""
+    to_server, to_client = client.ss.split()
+    assert server.ss.split() == [to_server, to_client]
+    result += [
+        ("kk_init", frame(FULL_INIT, key_id + init)),
+        ("kk_response", frame(FULL_RESPONSE, response)),
+        ("kk_client_record", record(to_server, 0, COMMAND)),
+        ("kk_server_record", record(to_client, 0, REPLY)),
+    ]
+
+    client = HandshakeState("NNpsk0", True, PROLOGUE + TICKET_ID, e=CLIENT_EPHEMERAL, psk=TICKET_PSK)
+    server = HandshakeState("NNpsk0", False, PROLOGUE + TICKET_ID, e=SERVER_EPHEMERAL, psk=TICKET_PSK)
+    init = client.write_message(EARLY_DATA)
+    assert server.read_message(init) == EARLY_DATA
+    ticket = NEW_TICKET_ID + TICKET_LIFETIME_S.to_bytes(4, "big")
+    response = server.write_message(ticket)
+    assert client.read_message(response) == ticket
+    to_server, to_client = client.ss.split()
+    resumption_psk = _hkdf(client.ss.ck, RESUMPTION_LABEL, 1)[0]
+    result += [
+        ("nnpsk0_init", frame(RESUME_INIT, TICKET_ID + init)),
+        ("nnpsk0_response", frame(RESUME_RESPONSE, response)),
+        ("nnpsk0_server_record", record(to_client, 0, REPLY)),
+        ("nnpsk0_client_record", record(to_server, 0, COMMAND)),
+        ("nnpsk0_resumption_psk", resumption_psk),
+    ]
+    return result
+
+
+if __name__ == "__main__":
+    self_check()
+    for name, value in vectors():
+        print(name, value.hex())